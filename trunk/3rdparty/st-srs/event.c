@@ -119,6 +119,9 @@ typedef struct _epoll_fd_data {
     int wr_ref_cnt;
     int ex_ref_cnt;
     int revents;
+    /* For batch, the events registered in kernel, and whether fired without waiter. */
+    int reg_events;
+    int unwanted;
 } _epoll_fd_data_t;
 
 static struct _st_epolldata {
@@ -130,6 +133,12 @@ static struct _st_epolldata {
     int fd_hint;
     int epfd;
     pid_t pid;
+    /*
+     * For batch, the descriptor stays registered when no thread waits on it, so the
+     * next wait on the same events costs no epoll_ctl, which is one wait per read or
+     * write for a busy connection. It's unregistered lazily when fired without waiter.
+     */
+    int batch;
 } *_st_epoll_data;
 
 #ifndef ST_EPOLL_EVTLIST_SIZE
@@ -141,6 +150,8 @@ static struct _st_epolldata {
 #define _ST_EPOLL_WRITE_CNT(fd)  (_st_epoll_data->fd_data[fd].wr_ref_cnt)
 #define _ST_EPOLL_EXCEP_CNT(fd)  (_st_epoll_data->fd_data[fd].ex_ref_cnt)
 #define _ST_EPOLL_REVENTS(fd)    (_st_epoll_data->fd_data[fd].revents)
+#define _ST_EPOLL_REG_EVENTS(fd) (_st_epoll_data->fd_data[fd].reg_events)
+#define _ST_EPOLL_UNWANTED(fd)   (_st_epoll_data->fd_data[fd].unwanted)
 
 #define _ST_EPOLL_READ_BIT(fd)   (_ST_EPOLL_READ_CNT(fd) ? EPOLLIN : 0)
 #define _ST_EPOLL_WRITE_BIT(fd)  (_ST_EPOLL_WRITE_CNT(fd) ? EPOLLOUT : 0)
@@ -1121,6 +1132,10 @@ ST_HIDDEN void _st_epoll_pollset_del(struct pollfd *pds, int npds)
         if (pd->events & POLLPRI)
             _ST_EPOLL_EXCEP_CNT(pd->fd)--;
 
+        /* For batch, keep it registered, see _st_epoll_dispatch() */
+        if (_st_epoll_data->batch)
+            continue;
+
         events = _ST_EPOLL_EVENTS(pd->fd);
         /*
          * The _ST_EPOLL_REVENTS check below is needed so we can use
@@ -1168,6 +1183,30 @@ ST_HIDDEN int _st_epoll_pollset_add(struct pollfd *pds, int npds)
             _ST_EPOLL_EXCEP_CNT(fd)++;
 
         events = _ST_EPOLL_EVENTS(fd);
+
+        /* For batch, only register when the events is not in kernel */
+        if (_st_epoll_data->batch) {
+            if ((events & ~_ST_EPOLL_REG_EVENTS(fd)) == 0)
+                continue;
+            op = _ST_EPOLL_REG_EVENTS(fd) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+            ev.events = events;
+            ev.data.fd = fd;
+            if (epoll_ctl(_st_epoll_data->epfd, op, fd, &ev) < 0) {
+                if (op != EPOLL_CTL_ADD || errno != EEXIST)
+                    break;
+                op = EPOLL_CTL_MOD;
+                if (epoll_ctl(_st_epoll_data->epfd, op, fd, &ev) < 0)
+                    break;
+            }
+            if (op == EPOLL_CTL_ADD) {
+                _st_epoll_data->evtlist_cnt++;
+                if (_st_epoll_data->evtlist_cnt > _st_epoll_data->evtlist_size)
+                    _st_epoll_evtlist_expand();
+            }
+            _ST_EPOLL_REG_EVENTS(fd) = events;
+            continue;
+        }
+
         if (events != old_events) {
             op = old_events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
             ev.events = events;
@@ -1243,6 +1282,11 @@ ST_HIDDEN void _st_epoll_dispatch(void)
                 /* Also set I/O bits on error */
                 _ST_EPOLL_REVENTS(osfd) |= _ST_EPOLL_EVENTS(osfd);
             }
+            /* For batch, the events no thread waits on, must be unregistered */
+            if (_st_epoll_data->batch) {
+                events = _ST_EPOLL_EVENTS(osfd);
+                _ST_EPOLL_UNWANTED(osfd) = !events || (_ST_EPOLL_REVENTS(osfd) & (EPOLLIN | EPOLLOUT | EPOLLPRI) & ~events);
+            }
         }
 
         for (q = _ST_IOQ.next; q != &_ST_IOQ; q = q->next) {
@@ -1295,6 +1339,13 @@ ST_HIDDEN void _st_epoll_dispatch(void)
             osfd = _st_epoll_data->evtlist[i].data.fd;
             _ST_EPOLL_REVENTS(osfd) = 0;
             events = _ST_EPOLL_EVENTS(osfd);
+            /* For batch, keep the descriptors that woke up threads, which will wait again */
+            if (_st_epoll_data->batch) {
+                if (!_ST_EPOLL_UNWANTED(osfd))
+                    continue;
+                _ST_EPOLL_UNWANTED(osfd) = 0;
+                _ST_EPOLL_REG_EVENTS(osfd) = events;
+            }
             op = events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
             ev.events = events;
             ev.data.fd = osfd;
@@ -1310,16 +1361,32 @@ ST_HIDDEN int _st_epoll_fd_new(int osfd)
     if (osfd >= _st_epoll_data->fd_data_size && _st_epoll_fd_data_expand(osfd) < 0)
         return -1;
 
+    /* The descriptor is reused, which is never registered */
+    _ST_EPOLL_REG_EVENTS(osfd) = 0;
+    _ST_EPOLL_UNWANTED(osfd) = 0;
+
     return 0;   
 }
 
 ST_HIDDEN int _st_epoll_fd_close(int osfd)
 {
+    struct epoll_event ev;
+
     if (_ST_EPOLL_READ_CNT(osfd) || _ST_EPOLL_WRITE_CNT(osfd) || _ST_EPOLL_EXCEP_CNT(osfd)) {
         errno = EBUSY;
         return -1;
     }
 
+    /* For batch, unregister it, because the file maybe shared by a forked process */
+    if (_st_epoll_data->batch && _ST_EPOLL_REG_EVENTS(osfd)) {
+        ev.events = 0;
+        ev.data.fd = osfd;
+        if (epoll_ctl(_st_epoll_data->epfd, EPOLL_CTL_DEL, osfd, &ev) == 0) {
+            _st_epoll_data->evtlist_cnt--;
+        }
+        _ST_EPOLL_REG_EVENTS(osfd) = 0;
+    }
+
     return 0;
 }
 
@@ -1355,6 +1422,27 @@ static _st_eventsys_t _st_epoll_eventsys = {
     _st_epoll_fd_close,
     _st_epoll_fd_getlimit
 };
+
+ST_HIDDEN int _st_epoll_batch_init(void)
+{
+    if (_st_epoll_init() < 0)
+        return -1;
+
+    _st_epoll_data->batch = 1;
+    return 0;
+}
+
+static _st_eventsys_t _st_epoll_batch_eventsys = {
+    "epoll-batch",
+    ST_EVENTSYS_BATCH,
+    _st_epoll_batch_init,
+    _st_epoll_dispatch,
+    _st_epoll_pollset_add,
+    _st_epoll_pollset_del,
+    _st_epoll_fd_new,
+    _st_epoll_fd_close,
+    _st_epoll_fd_getlimit
+};
 #endif  /* MD_HAVE_EPOLL */
 
 
@@ -1391,6 +1479,14 @@ int st_set_eventsys(int eventsys)
 #elif defined (MD_HAVE_EPOLL)
         if (_st_epoll_is_supported())
             _st_eventsys = &_st_epoll_eventsys;
+#endif
+        break;
+    case ST_EVENTSYS_BATCH:
+#if defined (MD_HAVE_KQUEUE)
+        _st_eventsys = &_st_kq_eventsys;
+#elif defined (MD_HAVE_EPOLL)
+        if (_st_epoll_is_supported())
+            _st_eventsys = &_st_epoll_batch_eventsys;
 #endif
         break;
     default:
@@ -68,6 +68,8 @@
 #define ST_EVENTSYS_SELECT  1
 #define ST_EVENTSYS_POLL    2
 #define ST_EVENTSYS_ALT     3
+/* The epoll which keeps the descriptors registered between waits, fallback to ALT. */
+#define ST_EVENTSYS_BATCH   4
 
 #ifdef __cplusplus
 extern "C" {
@@ -0,0 +1,395 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_async_file.hpp>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_service_st.hpp>
+#include <srs_kernel_utility.hpp>
+
+// The bytes of write-behind buffer to submit to I/O thread.
+#define SRS_ASYNC_FILE_CHUNK (64 * 1024)
+// The interval to check the state of file, when wait for the I/O thread.
+#define SRS_ASYNC_FILE_WAIT (1 * SRS_UTIME_MILLISECONDS)
+
+// The job of I/O thread, to write the data at offset, or close the fd.
+class SrsAsyncFileJob
+{
+public:
+    SrsAsyncFileState* state;
+    int fd;
+    int64_t offset;
+    std::vector<char> data;
+    bool close;
+public:
+    SrsAsyncFileJob(SrsAsyncFileState* s, int f) {
+        state = s;
+        fd = f;
+        offset = 0;
+        close = false;
+    }
+    virtual ~SrsAsyncFileJob() {
+    }
+};
+
+SrsAsyncFileState::SrsAsyncFileState()
+{
+    pending = 0;
+    error = 0;
+    closed = false;
+}
+
+SrsAsyncFileState::~SrsAsyncFileState()
+{
+}
+
+SrsAsyncFileWorker* SrsAsyncFileWorker::_instance = NULL;
+
+SrsAsyncFileWorker::SrsAsyncFileWorker()
+{
+    started = false;
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&cond, NULL);
+}
+
+SrsAsyncFileWorker::~SrsAsyncFileWorker()
+{
+    // The I/O thread is never stopped, see instance().
+}
+
+SrsAsyncFileWorker* SrsAsyncFileWorker::instance()
+{
+    // The worker lives as long as the process, because the I/O thread never quit.
+    if (!_instance) {
+        _instance = new SrsAsyncFileWorker();
+    }
+    return _instance;
+}
+
+srs_error_t SrsAsyncFileWorker::start()
+{
+    srs_error_t err = srs_success;
+    
+    if (started) {
+        return err;
+    }
+    
+    // The signals are handled by ST thread, so block them in I/O thread, which inherits the mask.
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    
+    int r0 = pthread_create(&tid, NULL, pfn, this);
+    
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    
+    if (r0 != 0) {
+        return srs_error_new(ERROR_SYSTEM_IO_THREAD, "create I/O thread, r0=%d", r0);
+    }
+    pthread_detach(tid);
+    started = true;
+    
+    srs_trace("async file: start I/O thread");
+    
+    return err;
+}
+
+void SrsAsyncFileWorker::submit(SrsAsyncFileJob* job)
+{
+    pthread_mutex_lock(&lock);
+    job->state->pending += (int64_t)job->data.size();
+    jobs.push_back(job);
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+}
+
+void SrsAsyncFileWorker::fetch(SrsAsyncFileState* state, SrsAsyncFileState& v)
+{
+    pthread_mutex_lock(&lock);
+    v.pending = state->pending;
+    v.error = state->error;
+    v.closed = state->closed;
+    pthread_mutex_unlock(&lock);
+}
+
+void* SrsAsyncFileWorker::pfn(void* arg)
+{
+    SrsAsyncFileWorker* worker = (SrsAsyncFileWorker*)arg;
+    worker->cycle();
+    return NULL;
+}
+
+void SrsAsyncFileWorker::cycle()
+{
+    while (true) {
+        pthread_mutex_lock(&lock);
+        while (jobs.empty()) {
+            pthread_cond_wait(&cond, &lock);
+        }
+        SrsAsyncFileJob* job = jobs.front();
+        jobs.pop_front();
+        pthread_mutex_unlock(&lock);
+        
+        execute(job);
+    }
+}
+
+void SrsAsyncFileWorker::execute(SrsAsyncFileJob* job)
+{
+    int error = 0;
+    
+    if (job->close) {
+        if (::close(job->fd) < 0) {
+            error = errno;
+        }
+    } else {
+        char* p = job->data.empty()? NULL : &job->data[0];
+        size_t left = job->data.size();
+        off_t offset = (off_t)job->offset;
+        while (left > 0) {
+            ssize_t nwrite = ::pwrite(job->fd, p, left, offset);
+            if (nwrite < 0 && errno == EINTR) {
+                continue;
+            }
+            if (nwrite <= 0) {
+                error = nwrite < 0? errno : EIO;
+                break;
+            }
+            p += nwrite;
+            left -= nwrite;
+            offset += nwrite;
+        }
+    }
+    
+    pthread_mutex_lock(&lock);
+    SrsAsyncFileState* state = job->state;
+    if (error && !state->error) {
+        state->error = error;
+    }
+    state->pending -= (int64_t)job->data.size();
+    if (job->close) {
+        state->closed = true;
+    }
+    pthread_mutex_unlock(&lock);
+    
+    srs_freep(job);
+}
+
+SrsAsyncFileWriter::SrsAsyncFileWriter(int64_t max)
+{
+    state = new SrsAsyncFileState();
+    max_pending = max;
+    offset = size = 0;
+    buffer_offset = 0;
+}
+
+SrsAsyncFileWriter::~SrsAsyncFileWriter()
+{
+    close();
+    srs_freep(state);
+}
+
+srs_error_t SrsAsyncFileWriter::open(string p)
+{
+    return do_open(p, O_CREAT|O_WRONLY|O_TRUNC);
+}
+
+srs_error_t SrsAsyncFileWriter::open_append(string p)
+{
+    // Never use O_APPEND, which ignores the offset of pwrite.
+    return do_open(p, O_WRONLY);
+}
+
+void SrsAsyncFileWriter::close()
+{
+    srs_error_t err = srs_success;
+    
+    if (fd < 0) {
+        return;
+    }
+    
+    if ((err = flush()) != srs_success) {
+        srs_warn("async file: ignore flush %s err %s", path.c_str(), srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    
+    // The close is the last job of file, wait for it, then the state is never used by I/O thread.
+    SrsAsyncFileJob* job = new SrsAsyncFileJob(state, fd);
+    job->close = true;
+    SrsAsyncFileWorker::instance()->submit(job);
+    fd = -1;
+    
+    SrsAsyncFileState v;
+    while (true) {
+        SrsAsyncFileWorker::instance()->fetch(state, v);
+        if (v.closed) {
+            break;
+        }
+        srs_usleep(SRS_ASYNC_FILE_WAIT);
+    }
+    
+    if (v.error) {
+        srs_warn("async file: write or close %s failed, errno=%d", path.c_str(), v.error);
+    }
+}
+
+bool SrsAsyncFileWriter::is_open()
+{
+    return fd > 0;
+}
+
+void SrsAsyncFileWriter::seek2(int64_t v)
+{
+    offset = v;
+}
+
+int64_t SrsAsyncFileWriter::tellg()
+{
+    return offset;
+}
+
+srs_error_t SrsAsyncFileWriter::write(void* buf, size_t count, ssize_t* pnwrite)
+{
+    srs_error_t err = srs_success;
+    
+    if (fd < 0) {
+        return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "write to closed file %s", path.c_str());
+    }
+    
+    // Submit the buffer when seeked, the I/O thread writes in order, so the overwrite is ok.
+    if (!buffer.empty() && buffer_offset + (int64_t)buffer.size() != offset) {
+        if ((err = flush()) != srs_success) {
+            return srs_error_wrap(err, "flush");
+        }
+    }
+    
+    if (buffer.empty()) {
+        buffer_offset = offset;
+    }
+    buffer.insert(buffer.end(), (char*)buf, (char*)buf + count);
+    
+    offset += count;
+    size = srs_max(size, offset);
+    
+    if ((int)buffer.size() >= SRS_ASYNC_FILE_CHUNK && (err = flush()) != srs_success) {
+        return srs_error_wrap(err, "flush");
+    }
+    
+    if (pnwrite) {
+        *pnwrite = count;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsAsyncFileWriter::lseek(off_t v, int whence, off_t* seeked)
+{
+    if (whence == SEEK_SET) {
+        offset = v;
+    } else if (whence == SEEK_CUR) {
+        offset += v;
+    } else if (whence == SEEK_END) {
+        offset = size + v;
+    } else {
+        return srs_error_new(ERROR_SYSTEM_FILE_SEEK, "seek file %s whence=%d", path.c_str(), whence);
+    }
+    
+    if (seeked) {
+        *seeked = (off_t)offset;
+    }
+    
+    return srs_success;
+}
+
+srs_error_t SrsAsyncFileWriter::do_open(string p, int flags)
+{
+    srs_error_t err = srs_success;
+    
+    if (fd > 0) {
+        return srs_error_new(ERROR_SYSTEM_FILE_ALREADY_OPENED, "file %s already opened", p.c_str());
+    }
+    
+    if ((err = SrsAsyncFileWorker::instance()->start()) != srs_success) {
+        return srs_error_wrap(err, "start worker");
+    }
+    
+    mode_t mode = S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH;
+    if ((fd = ::open(p.c_str(), flags, mode)) < 0) {
+        return srs_error_new(ERROR_SYSTEM_FILE_OPENE, "open file %s failed", p.c_str());
+    }
+    
+    path = p;
+    size = offset = (int64_t)::lseek(fd, 0, SEEK_END);
+    buffer.clear();
+    
+    srs_freep(state);
+    state = new SrsAsyncFileState();
+    
+    return err;
+}
+
+srs_error_t SrsAsyncFileWriter::flush()
+{
+    srs_error_t err = srs_success;
+    
+    if (!buffer.empty()) {
+        SrsAsyncFileJob* job = new SrsAsyncFileJob(state, fd);
+        job->offset = buffer_offset;
+        job->data.swap(buffer);
+        SrsAsyncFileWorker::instance()->submit(job);
+    }
+    
+    if ((err = wait(max_pending)) != srs_success) {
+        return srs_error_wrap(err, "wait");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsAsyncFileWriter::wait(int64_t max)
+{
+    srs_error_t err = srs_success;
+    
+    SrsAsyncFileState v;
+    while (true) {
+        SrsAsyncFileWorker::instance()->fetch(state, v);
+        if (v.error) {
+            return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "write to file %s failed, errno=%d", path.c_str(), v.error);
+        }
+        if (v.pending <= max) {
+            break;
+        }
+        
+        // The disk is slow, wait for I/O thread, other ST threads run.
+        srs_usleep(SRS_ASYNC_FILE_WAIT);
+    }
+    
+    return err;
+}
@@ -0,0 +1,122 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_ASYNC_FILE_HPP
+#define SRS_APP_ASYNC_FILE_HPP
+
+#include <srs_core.hpp>
+
+#include <pthread.h>
+#include <deque>
+#include <vector>
+
+#include <srs_kernel_file.hpp>
+
+class SrsAsyncFileJob;
+
+// The state of file shared with the I/O thread, protected by the lock of worker.
+class SrsAsyncFileState
+{
+public:
+    // The bytes submitted but not written yet.
+    int64_t pending;
+    // The errno of the first failed write, 0 if ok.
+    int error;
+    // Whether the fd is closed by the I/O thread.
+    bool closed;
+public:
+    SrsAsyncFileState();
+    virtual ~SrsAsyncFileState();
+};
+
+// The I/O thread to write files, because ST has no async file I/O, so a slow disk
+// never blocks the ST thread, which serves all the streams.
+// @remark The I/O thread never calls any ST function.
+class SrsAsyncFileWorker
+{
+private:
+    static SrsAsyncFileWorker* _instance;
+private:
+    bool started;
+    pthread_t tid;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    std::deque<SrsAsyncFileJob*> jobs;
+public:
+    SrsAsyncFileWorker();
+    virtual ~SrsAsyncFileWorker();
+public:
+    static SrsAsyncFileWorker* instance();
+public:
+    // Start the I/O thread, ignore if started.
+    virtual srs_error_t start();
+    // Submit the job to I/O thread, which frees it when done.
+    virtual void submit(SrsAsyncFileJob* job);
+    // Read the state of file, which is updated by I/O thread.
+    virtual void fetch(SrsAsyncFileState* state, SrsAsyncFileState& v);
+private:
+    static void* pfn(void* arg);
+    virtual void cycle();
+    virtual void execute(SrsAsyncFileJob* job);
+};
+
+// The file writer which buffers the writes, and writes by the I/O thread at the offset,
+// so the seek and tell never touch the disk. The ST thread only waits when the pending
+// bytes exceeds the max, and when close the file to wait for all bytes written.
+class SrsAsyncFileWriter : public SrsFileWriter
+{
+private:
+    SrsAsyncFileState* state;
+    // The max pending bytes, the writer waits when exceed.
+    int64_t max_pending;
+    // The current position and size of file.
+    int64_t offset;
+    int64_t size;
+    // The write-behind buffer, which starts at buffer_offset of file.
+    std::vector<char> buffer;
+    int64_t buffer_offset;
+public:
+    SrsAsyncFileWriter(int64_t max);
+    virtual ~SrsAsyncFileWriter();
+public:
+    virtual srs_error_t open(std::string p);
+    virtual srs_error_t open_append(std::string p);
+    // Wait for all bytes written, then close the file.
+    virtual void close();
+public:
+    virtual bool is_open();
+    virtual void seek2(int64_t offset);
+    virtual int64_t tellg();
+// Interface ISrsWriteSeeker
+public:
+    virtual srs_error_t write(void* buf, size_t count, ssize_t* pnwrite);
+    virtual srs_error_t lseek(off_t offset, int whence, off_t* seeked);
+private:
+    virtual srs_error_t do_open(std::string p, int flags);
+    // Submit the buffer to I/O thread, and wait when exceed the max pending bytes.
+    virtual srs_error_t flush();
+    virtual srs_error_t wait(int64_t max);
+};
+
+#endif
+
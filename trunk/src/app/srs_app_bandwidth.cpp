@@ -36,6 +36,7 @@ using namespace std;
 #include <srs_app_utility.hpp>
 #include <srs_protocol_kbps.hpp>
 #include <srs_app_st.hpp>
+#include <srs_kernel_flv.hpp>
 
 #define _SRS_BANDWIDTH_LIMIT_INTERVAL 100 * SRS_UTIME_MILLISECONDS
 
@@ -466,3 +467,137 @@ void SrsKbpsLimit::send_limit()
     }
 }
 
+SrsTokenBucket::SrsTokenBucket()
+{
+    rate = capacity = tokens = 0;
+    update_at = 0;
+}
+
+SrsTokenBucket::~SrsTokenBucket()
+{
+}
+
+void SrsTokenBucket::set_rate(int kbps, srs_utime_t burst)
+{
+    rate = (int64_t)kbps * 1000 / 8;
+    capacity = srs_max(rate * burst / SRS_UTIME_SECONDS, (int64_t)1);
+    
+    // The bucket is full when created, so the first batch is never delayed.
+    if (update_at == 0) {
+        tokens = capacity;
+        update_at = srs_update_system_time();
+    }
+    tokens = srs_min(tokens, capacity);
+}
+
+bool SrsTokenBucket::enabled()
+{
+    return rate > 0;
+}
+
+int64_t SrsTokenBucket::available()
+{
+    srs_utime_t now = srs_update_system_time();
+    if (now > update_at) {
+        tokens = srs_min(capacity, tokens + rate * (now - update_at) / SRS_UTIME_SECONDS);
+    }
+    update_at = now;
+    
+    return tokens;
+}
+
+void SrsTokenBucket::consume(int64_t bytes)
+{
+    tokens -= bytes;
+}
+
+srs_utime_t SrsTokenBucket::delay()
+{
+    int64_t v = available();
+    if (v > 0 || rate <= 0) {
+        return 0;
+    }
+    return (1 - v) * SRS_UTIME_SECONDS / rate;
+}
+
+std::map<std::string, SrsTokenBucket*> SrsPacer::vhosts;
+
+SrsPacer::SrsPacer()
+{
+    bucket = new SrsTokenBucket();
+    vhost = NULL;
+}
+
+SrsPacer::~SrsPacer()
+{
+    srs_freep(bucket);
+}
+
+SrsPacer* SrsPacer::create(string vhost)
+{
+    if (!_srs_config->get_pacing_enabled(vhost)) {
+        return NULL;
+    }
+    
+    srs_utime_t burst = _srs_config->get_pacing_burst(vhost);
+    
+    SrsPacer* pacer = new SrsPacer();
+    pacer->bucket->set_rate(_srs_config->get_pacing_kbps(vhost), burst);
+    
+    // The bucket of vhost is shared by all connections, and updated when config reloaded.
+    int vhost_kbps = _srs_config->get_pacing_vhost_kbps(vhost);
+    if (vhost_kbps > 0) {
+        SrsTokenBucket* b = NULL;
+        std::map<std::string, SrsTokenBucket*>::iterator it = vhosts.find(vhost);
+        if (it != vhosts.end()) {
+            b = it->second;
+        } else {
+            vhosts[vhost] = b = new SrsTokenBucket();
+        }
+        b->set_rate(vhost_kbps, burst);
+        pacer->vhost = b;
+    }
+    
+    return pacer;
+}
+
+int64_t SrsPacer::quota()
+{
+    int64_t v = -1;
+    if (bucket->enabled()) {
+        v = srs_max((int64_t)0, bucket->available());
+    }
+    if (vhost && vhost->enabled()) {
+        int64_t vv = srs_max((int64_t)0, vhost->available());
+        v = (v < 0)? vv : srs_min(v, vv);
+    }
+    return v;
+}
+
+void SrsPacer::consume(SrsSharedPtrMessage** msgs, int count)
+{
+    int64_t bytes = 0;
+    for (int i = 0; i < count; i++) {
+        bytes += msgs[i]->size;
+    }
+    
+    consume(bytes);
+}
+
+void SrsPacer::consume(int64_t bytes)
+{
+    bucket->consume(bytes);
+    if (vhost) {
+        vhost->consume(bytes);
+    }
+}
+
+srs_utime_t SrsPacer::delay()
+{
+    srs_utime_t v = bucket->delay();
+    if (vhost) {
+        v = srs_max(v, vhost->delay());
+    }
+    return v;
+}
+
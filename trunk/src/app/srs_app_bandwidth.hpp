@@ -27,6 +27,7 @@
 #include <srs_core.hpp>
 
 #include <string>
+#include <map>
 
 #include <srs_app_st.hpp>
 
@@ -35,6 +36,7 @@ class SrsRequest;
 class SrsRtmpServer;
 class SrsKbpsLimit;
 class ISrsProtocolStatistic;
+class SrsSharedPtrMessage;
 
 // The bandwidth check/test sample.
 class SrsBandwidthSample
@@ -180,4 +182,57 @@ public:
     virtual void send_limit();
 };
 
+// The token bucket to pace the bytes, refilled at the rate, and holds at most the
+// bytes of burst duration, so the burst is allowed only after idle.
+// @remark The tokens maybe negative, as a debt, because a message is sent entirely.
+class SrsTokenBucket
+{
+private:
+    // The rate in bytes per second, 0 for unlimited.
+    int64_t rate;
+    // The max tokens in bytes.
+    int64_t capacity;
+    int64_t tokens;
+    srs_utime_t update_at;
+public:
+    SrsTokenBucket();
+    virtual ~SrsTokenBucket();
+public:
+    // Set the rate in kbps and the burst duration, 0 kbps for unlimited.
+    virtual void set_rate(int kbps, srs_utime_t burst);
+    virtual bool enabled();
+    // Get the tokens in bytes, after refilled by the time elapsed.
+    virtual int64_t available();
+    // Consume the bytes sent.
+    virtual void consume(int64_t bytes);
+    // Get the duration to repay the debt, 0 if not in debt.
+    virtual srs_utime_t delay();
+};
+
+// The pacer of egress connection, for example, the player, forwarder and edge,
+// limited by the bucket of connection and the bucket shared by vhost.
+class SrsPacer
+{
+private:
+    static std::map<std::string, SrsTokenBucket*> vhosts;
+private:
+    SrsTokenBucket* bucket;
+    // The shared bucket of vhost, never free it.
+    SrsTokenBucket* vhost;
+public:
+    SrsPacer();
+    virtual ~SrsPacer();
+public:
+    // Create the pacer by the config of vhost, NULL if pacing disabled.
+    static SrsPacer* create(std::string vhost);
+public:
+    // Get the bytes allowed to send now, -1 for unlimited.
+    virtual int64_t quota();
+    // Consume the bytes of messages sent.
+    virtual void consume(SrsSharedPtrMessage** msgs, int count);
+    virtual void consume(int64_t bytes);
+    // Get the duration to wait for the quota.
+    virtual srs_utime_t delay();
+};
+
 #endif
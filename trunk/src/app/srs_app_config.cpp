@@ -1298,6 +1298,17 @@ srs_error_t SrsConfig::reload_vhost(SrsConfDirective* old_root)
                 srs_trace("vhost %s reload tcp_nodelay success.", vhost.c_str());
             }
             
+            // security, only one per vhost
+            if (!srs_directive_equals(new_vhost->get("security"), old_vhost->get("security"))) {
+                for (it = subscribes.begin(); it != subscribes.end(); ++it) {
+                    ISrsReloadHandler* subscribe = *it;
+                    if ((err = subscribe->on_reload_vhost_security(vhost)) != srs_success) {
+                        return srs_error_wrap(err, "vhost %s notify subscribes security failed", vhost.c_str());
+                    }
+                }
+                srs_trace("vhost %s reload security success.", vhost.c_str());
+            }
+            
             // min_latency, only one per vhost
             if (!srs_directive_equals(new_vhost->get("min_latency"), old_vhost->get("min_latency"))) {
                 for (it = subscribes.begin(); it != subscribes.end(); ++it) {
@@ -1467,8 +1478,7 @@ srs_error_t SrsConfig::reload_conf(SrsConfig* conf)
     //
     // always support reload without additional code:
     //      chunk_size, ff_log_dir,
-    //      bandcheck, http_hooks, heartbeat,
-    //      security
+    //      bandcheck, http_hooks, heartbeat
     
     // merge config: listen
     if (!srs_directive_equals(root->get("listen"), old_root->get("listen"))) {
@@ -2319,6 +2329,12 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 cluster->set("vhost", sdir->dumps_arg0_to_str());
             } else if (sdir->name == "debug_srs_upnode") {
                 cluster->set("debug_srs_upnode", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "balance") {
+                cluster->set("balance", sdir->dumps_arg0_to_str());
+            } else if (sdir->name == "prefetch") {
+                cluster->set("prefetch", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "prefetch_timeout") {
+                cluster->set("prefetch_timeout", sdir->dumps_arg0_to_integer());
             }
         }
     }
@@ -2361,6 +2377,16 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 play->set("gop_cache", sdir->dumps_arg0_to_boolean());
             } else if (sdir->name == "queue_length") {
                 play->set("queue_length", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "drop_policy") {
+                play->set("drop_policy", sdir->dumps_arg0_to_str());
+            } else if (sdir->name == "fast_join") {
+                play->set("fast_join", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "fast_join_latency") {
+                play->set("fast_join_latency", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "fast_join_accelerate") {
+                play->set("fast_join_accelerate", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "time_shift") {
+                play->set("time_shift", sdir->dumps_arg0_to_integer());
             } else if (sdir->name == "reduce_sequence_header") {
                 play->set("reduce_sequence_header", sdir->dumps_arg0_to_boolean());
             } else if (sdir->name == "send_min_interval") {
@@ -2429,6 +2455,26 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
         }
     }
     
+    // pacing
+    if ((dir = vhost->get("pacing")) != NULL) {
+        SrsJsonObject* pacing = SrsJsonAny::object();
+        obj->set("pacing", pacing);
+        
+        pacing->set("enabled", SrsJsonAny::boolean(get_pacing_enabled(vhost->name)));
+        
+        for (int i = 0; i < (int)dir->directives.size(); i++) {
+            SrsConfDirective* sdir = dir->directives.at(i);
+            
+            if (sdir->name == "kbps") {
+                pacing->set("kbps", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "vhost_kbps") {
+                pacing->set("vhost_kbps", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "burst") {
+                pacing->set("burst", sdir->dumps_arg0_to_integer());
+            }
+        }
+    }
+    
     // security
     if ((dir = vhost->get("security")) != NULL) {
         SrsJsonObject* security = SrsJsonAny::object();
@@ -2525,6 +2571,10 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 http_hooks->set("on_hls", sdir->dumps_args());
             } else if (sdir->name == "on_hls_notify") {
                 http_hooks->set("on_hls_notify", sdir->dumps_arg0_to_str());
+            } else if (sdir->name == "batch") {
+                http_hooks->set("batch", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "cache_ttl") {
+                http_hooks->set("cache_ttl", sdir->dumps_arg0_to_number());
             }
         }
     }
@@ -2551,6 +2601,10 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 hls->set("hls_on_error", sdir->dumps_arg0_to_str());
             } else if (sdir->name == "hls_storage") {
                 hls->set("hls_storage", sdir->dumps_arg0_to_str());
+            } else if (sdir->name == "hls_part") {
+                hls->set("hls_part", sdir->dumps_arg0_to_number());
+            } else if (sdir->name == "hls_fmp4") {
+                hls->set("hls_fmp4", sdir->dumps_arg0_to_boolean());
             } else if (sdir->name == "hls_path") {
                 hls->set("hls_path", sdir->dumps_arg0_to_str());
             } else if (sdir->name == "hls_m3u8_file") {
@@ -2577,6 +2631,8 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 hls->set("hls_dts_directly", sdir->dumps_arg0_to_boolean());
             } else if (sdir->name == "hls_wait_keyframe") {
                 hls->set("hls_wait_keyframe", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "hls_storage") {
+                hls->set("hls_storage", sdir->dumps_arg0_to_str());
             } else if (sdir->name == "hls_keys") {
                 hls->set("hls_keys", sdir->dumps_arg0_to_boolean());
             } else if (sdir->name == "hls_fragments_per_key") {
@@ -2631,6 +2687,14 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 dvr->set("dvr_duration", sdir->dumps_arg0_to_number());
             } else if (sdir->name == "dvr_wait_keyframe") {
                 dvr->set("dvr_wait_keyframe", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "dvr_async") {
+                dvr->set("dvr_async", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "dvr_async_buffer") {
+                dvr->set("dvr_async_buffer", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "dvr_mp4_fragment") {
+                dvr->set("dvr_mp4_fragment", sdir->dumps_arg0_to_number());
+            } else if (sdir->name == "dvr_mp4_finalize") {
+                dvr->set("dvr_mp4_finalize", sdir->dumps_arg0_to_boolean());
             } else if (sdir->name == "time_jitter") {
                 dvr->set("time_jitter", sdir->dumps_arg0_to_str());
             }
@@ -3489,7 +3553,7 @@ srs_error_t SrsConfig::check_normal_config()
             && n != "utc_time" && n != "work_dir" && n != "asprocess"
             && n != "ff_log_level" && n != "grace_final_wait" && n != "force_grace_quit"
             && n != "grace_start_wait" && n != "empty_ip_ok" && n != "disable_daemon_for_docker"
-            && n != "inotify_auto_reload" && n != "auto_reload_for_docker"
+            && n != "inotify_auto_reload" && n != "auto_reload_for_docker" && n != "workers"
             ) {
             return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal directive %s", n.c_str());
         }
@@ -3532,6 +3596,15 @@ srs_error_t SrsConfig::check_normal_config()
             }
         }
     }
+    if (true) {
+        SrsConfDirective* conf = root->get("workers");
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "enabled" && n != "count" && n != "relay_port") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal workers.%s", n.c_str());
+            }
+        }
+    }
     if (true) {
         SrsConfDirective* conf = get_stats();
         for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
@@ -3654,7 +3727,7 @@ srs_error_t SrsConfig::check_normal_config()
             string n = conf->name;
             if (n != "enabled" && n != "chunk_size" && n != "min_latency" && n != "tcp_nodelay"
                 && n != "dvr" && n != "ingest" && n != "hls" && n != "http_hooks"
-                && n != "refer" && n != "forward" && n != "transcode" && n != "bandcheck"
+                && n != "refer" && n != "forward" && n != "transcode" && n != "bandcheck" && n != "pacing"
                 && n != "play" && n != "publish" && n != "cluster"
                 && n != "security" && n != "http_remux" && n != "dash"
                 && n != "http_static" && n != "hds" && n != "exec"
@@ -3666,7 +3739,9 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "enabled"  && m != "dvr_apply" && m != "dvr_path" && m != "dvr_plan"
-                        && m != "dvr_duration" && m != "dvr_wait_keyframe" && m != "time_jitter") {
+                        && m != "dvr_duration" && m != "dvr_wait_keyframe" && m != "time_jitter"
+                        && m != "dvr_async" && m != "dvr_async_buffer" && m != "dvr_mp4_fragment"
+                        && m != "dvr_mp4_finalize") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.dvr.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -3688,7 +3763,9 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "time_jitter" && m != "mix_correct" && m != "atc" && m != "atc_auto" && m != "mw_latency"
-                        && m != "gop_cache" && m != "queue_length" && m != "send_min_interval" && m != "reduce_sequence_header") {
+                        && m != "gop_cache" && m != "queue_length" && m != "send_min_interval" && m != "reduce_sequence_header"
+                        && m != "drop_policy" && m != "fast_join" && m != "fast_join_latency" && m != "fast_join_accelerate"
+                        && m != "time_shift") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.play.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -3696,7 +3773,7 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "mode" && m != "origin" && m != "token_traverse" && m != "vhost" && m != "debug_srs_upnode" && m != "coworkers"
-                        && m != "origin_cluster") {
+                        && m != "origin_cluster" && m != "balance" && m != "prefetch" && m != "prefetch_timeout") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.cluster.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -3742,7 +3819,7 @@ srs_error_t SrsConfig::check_normal_config()
                     if (m != "enabled" && m != "hls_entry_prefix" && m != "hls_path" && m != "hls_fragment" && m != "hls_window" && m != "hls_on_error"
                         && m != "hls_storage" && m != "hls_mount" && m != "hls_td_ratio" && m != "hls_aof_ratio" && m != "hls_acodec" && m != "hls_vcodec"
                         && m != "hls_m3u8_file" && m != "hls_ts_file" && m != "hls_ts_floor" && m != "hls_cleanup" && m != "hls_nb_notify"
-                        && m != "hls_wait_keyframe" && m != "hls_dispose" && m != "hls_keys" && m != "hls_fragments_per_key" && m != "hls_key_file"
+                        && m != "hls_wait_keyframe" && m != "hls_dispose" && m != "hls_part" && m != "hls_fmp4" && m != "hls_keys" && m != "hls_fragments_per_key" && m != "hls_key_file"
                         && m != "hls_key_file_path" && m != "hls_key_url" && m != "hls_dts_directly") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.hls.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
@@ -3757,7 +3834,8 @@ srs_error_t SrsConfig::check_normal_config()
                     string m = conf->at(j)->name;
                     if (m != "enabled" && m != "on_connect" && m != "on_close" && m != "on_publish"
                         && m != "on_unpublish" && m != "on_play" && m != "on_stop"
-                        && m != "on_dvr" && m != "on_hls" && m != "on_hls_notify") {
+                        && m != "on_dvr" && m != "on_hls" && m != "on_hls_notify"
+                        && m != "batch" && m != "cache_ttl") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.http_hooks.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -3804,6 +3882,13 @@ srs_error_t SrsConfig::check_normal_config()
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.bandcheck.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
+            } else if (n == "pacing") {
+                for (int j = 0; j < (int)conf->directives.size(); j++) {
+                    string m = conf->at(j)->name;
+                    if (m != "enabled" && m != "kbps" && m != "vhost_kbps" && m != "burst") {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.pacing.%s of %s", m.c_str(), vhost->arg0().c_str());
+                    }
+                }
             }
         }
     }
@@ -4136,6 +4221,57 @@ bool SrsConfig::auto_reload_for_docker()
     return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
+bool SrsConfig::get_workers_enabled()
+{
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = root->get("workers");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+int SrsConfig::get_workers_count()
+{
+    static int DEFAULT = 0;
+
+    SrsConfDirective* conf = root->get("workers");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("count");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_workers_relay_port()
+{
+    static int DEFAULT = 19350;
+
+    SrsConfDirective* conf = root->get("workers");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("relay_port");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
 vector<SrsConfDirective*> SrsConfig::get_stream_casters()
 {
     srs_assert(root);
@@ -4466,6 +4602,116 @@ srs_utime_t SrsConfig::get_queue_length(string vhost)
     return srs_utime_t(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
 }
 
+string SrsConfig::get_drop_policy(string vhost)
+{
+    static string DEFAULT = "gop";
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("drop_policy");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+bool SrsConfig::get_fast_join(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("fast_join");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_fast_join_latency(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("fast_join_latency");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
+}
+
+bool SrsConfig::get_fast_join_accelerate(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("fast_join_accelerate");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_time_shift(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("time_shift");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
 bool SrsConfig::get_refer_enabled(string vhost)
 {
     static bool DEFAULT = false;
@@ -4971,6 +5217,40 @@ SrsConfDirective* SrsConfig::get_vhost_on_hls_notify(string vhost)
     return conf->get("on_hls_notify");
 }
 
+bool SrsConfig::get_vhost_http_hooks_batch(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("batch");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_vhost_http_hooks_cache_ttl(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cache_ttl");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
 bool SrsConfig::get_bw_check_enabled(string vhost)
 {
     static bool DEFAULT = false;
@@ -5059,6 +5339,94 @@ int SrsConfig::get_bw_check_limit_kbps(string vhost)
     return ::atoi(conf->arg0().c_str());
 }
 
+bool SrsConfig::get_pacing_enabled(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("pacing");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+int SrsConfig::get_pacing_kbps(string vhost)
+{
+    static int DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("pacing");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("kbps");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_pacing_vhost_kbps(string vhost)
+{
+    static int DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("pacing");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("vhost_kbps");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+srs_utime_t SrsConfig::get_pacing_burst(string vhost)
+{
+    static srs_utime_t DEFAULT = 1000 * SRS_UTIME_MILLISECONDS;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("pacing");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("burst");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
+}
+
 bool SrsConfig::get_vhost_is_edge(string vhost)
 {
     SrsConfDirective* conf = get_vhost(vhost);
@@ -5146,6 +5514,72 @@ string SrsConfig::get_vhost_edge_transform_vhost(string vhost)
     return conf->arg0();
 }
 
+string SrsConfig::get_vhost_edge_balance(string vhost)
+{
+    static string DEFAULT = "round_robin";
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("balance");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+int SrsConfig::get_vhost_edge_prefetch(string vhost)
+{
+    static int DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("prefetch");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+srs_utime_t SrsConfig::get_vhost_edge_prefetch_timeout(string vhost)
+{
+    static srs_utime_t DEFAULT = 60 * SRS_UTIME_SECONDS;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("prefetch_timeout");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
 bool SrsConfig::get_vhost_origin_cluster(string vhost)
 {
     static bool DEFAULT = false;
@@ -6286,6 +6720,62 @@ srs_utime_t SrsConfig::get_hls_dispose(string vhost)
     return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
 }
 
+string SrsConfig::get_hls_storage(string vhost)
+{
+    static string DEFAULT = "disk";
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_storage");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    string v = conf->arg0();
+    if (v != "disk" && v != "ram" && v != "both") {
+        return DEFAULT;
+    }
+    
+    return v;
+}
+
+srs_utime_t SrsConfig::get_hls_part(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_part");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+bool SrsConfig::get_hls_fmp4(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_fmp4");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
 bool SrsConfig::get_hls_wait_keyframe(string vhost)
 {
     static bool DEFAULT = true;
@@ -6580,6 +7070,74 @@ bool SrsConfig::get_dvr_wait_keyframe(string vhost)
     return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
+bool SrsConfig::get_dvr_async(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dvr_async");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+int64_t SrsConfig::get_dvr_async_buffer(string vhost)
+{
+    static int64_t DEFAULT = 8 * 1024 * 1024;
+    
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dvr_async_buffer");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoll(conf->arg0().c_str()) * 1024;
+}
+
+srs_utime_t SrsConfig::get_dvr_mp4_fragment(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dvr_mp4_fragment");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+bool SrsConfig::get_dvr_mp4_finalize(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dvr_mp4_finalize");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
 int SrsConfig::get_dvr_time_jitter(string vhost)
 {
     static string DEFAULT = "full";
@@ -482,6 +482,15 @@ public:
     virtual bool inotify_auto_reload();
     // Whether enable auto reload config for docker.
     virtual bool auto_reload_for_docker();
+// workers section
+public:
+    // Whether the multiple process workers mode is enabled.
+    // @remark Not support reload.
+    virtual bool get_workers_enabled();
+    // Get the number of workers, 0 to use the number of online CPUs.
+    virtual int get_workers_count();
+    // Get the base port of relay listener, worker N listens at 127.0.0.1:(relay_port+N).
+    virtual int get_workers_relay_port();
 // stream_caster section
 public:
     // Get all stream_caster in config file.
@@ -547,6 +556,21 @@ public:
     // when exceed the queue length, drop packet util I frame.
     // @remark, default 10s.
     virtual srs_utime_t get_queue_length(std::string vhost);
+    // Get the policy to drop messages when exceed the queue length, gop or frame.
+    // @remark, default gop.
+    virtual std::string get_drop_policy(std::string vhost);
+    // Whether fast join, start from the latest keyframe of gop cache and skip the frames not required.
+    // @remark, default off.
+    virtual bool get_fast_join(std::string vhost);
+    // The latency of fast join, the last frames of gop cache in it are dumped entirely.
+    // @remark, default 0.
+    virtual srs_utime_t get_fast_join_latency(std::string vhost);
+    // Whether accelerate the timestamp of frames before the latency for fast join.
+    // @remark, default off.
+    virtual bool get_fast_join_accelerate(std::string vhost);
+    // The duration of time-shift buffer, for player to start at an offset from live.
+    // @remark, default 0, disabled.
+    virtual srs_utime_t get_time_shift(std::string vhost);
     // Whether the refer hotlink-denial enabled.
     virtual bool get_refer_enabled(std::string vhost);
     // Get the refer hotlink-denial for all type.
@@ -638,6 +662,11 @@ public:
     // Get the on_hls_notify callbacks of vhost.
     // @return the on_hls_notify callback directive, the args is the url to callback.
     virtual SrsConfDirective* get_vhost_on_hls_notify(std::string vhost);
+    // Whether batch the notify hooks, such as on_close, on_stop, on_dvr and on_hls.
+    virtual bool get_vhost_http_hooks_batch(std::string vhost);
+    // Get the TTL to cache the result of auth hooks, such as on_connect, on_publish and on_play.
+    // @remark Never cache the result if 0.
+    virtual srs_utime_t get_vhost_http_hooks_cache_ttl(std::string vhost);
 // bwct(bandwidth check tool) section
 public:
     // Whether bw check enabled for vhost.
@@ -655,6 +684,16 @@ public:
     // If  exceed the kbps, server will slowdown the send-recv.
     // @remark this is used to protect the service bandwidth.
     virtual int get_bw_check_limit_kbps(std::string vhost);
+// vhost pacing section
+public:
+    // Whether pace the egress of vhost, to smooth the burst of gop cache and catch-up.
+    virtual bool get_pacing_enabled(std::string vhost);
+    // The max kbps of each egress connection, 0 for unlimited.
+    virtual int get_pacing_kbps(std::string vhost);
+    // The max kbps of all egress connections of vhost, 0 for unlimited.
+    virtual int get_pacing_vhost_kbps(std::string vhost);
+    // The burst of bucket, the bytes of this duration are sent without pacing.
+    virtual srs_utime_t get_pacing_burst(std::string vhost);
 // vhost cluster section
 public:
     // Whether vhost is edge mode.
@@ -676,6 +715,12 @@ public:
     // Get the transformed vhost for edge,
     // @see https://github.com/ossrs/srs/issues/372
     virtual std::string get_vhost_edge_transform_vhost(std::string vhost);
+    // Get the load balance algorithm of edge to select origin, round_robin or hash.
+    virtual std::string get_vhost_edge_balance(std::string vhost);
+    // Get the max number of hot streams to keep pulling from origin when no player.
+    virtual int get_vhost_edge_prefetch(std::string vhost);
+    // Get the duration to keep pulling a hot stream from origin when no player.
+    virtual srs_utime_t get_vhost_edge_prefetch_timeout(std::string vhost);
     // Whether enable the origin cluster.
     // @see https://github.com/ossrs/srs/wiki/v3_EN_OriginCluster
     virtual bool get_vhost_origin_cluster(std::string vhost);
@@ -855,6 +900,12 @@ public:
     virtual bool get_hls_cleanup(std::string vhost);
     // The timeout in srs_utime_t to dispose the hls.
     virtual srs_utime_t get_hls_dispose(std::string vhost);
+    // The storage of hls, disk, ram or both.
+    virtual std::string get_hls_storage(std::string vhost);
+    // The target duration in srs_utime_t of LL-HLS part, 0 to disable.
+    virtual srs_utime_t get_hls_part(std::string vhost);
+    // Whether use the FMP4 of DASH for hls, instead of ts.
+    virtual bool get_hls_fmp4(std::string vhost);
     // Whether reap the ts when got keyframe.
     virtual bool get_hls_wait_keyframe(std::string vhost);
     // encrypt ts or not
@@ -904,6 +955,14 @@ public:
     virtual srs_utime_t get_dvr_duration(std::string vhost);
     // Whether wait keyframe to reap segment.
     virtual bool get_dvr_wait_keyframe(std::string vhost);
+    // Whether write the dvr file by the I/O thread.
+    virtual bool get_dvr_async(std::string vhost);
+    // Get the max bytes written behind for async dvr.
+    virtual int64_t get_dvr_async_buffer(std::string vhost);
+    // Get the duration of fragment for mp4 dvr, 0 to write a regular mp4 when unpublish.
+    virtual srs_utime_t get_dvr_mp4_fragment(std::string vhost);
+    // Whether finalize the fragmented mp4 to a regular mp4 when unpublish.
+    virtual bool get_dvr_mp4_finalize(std::string vhost);
     // Get the time_jitter algorithm for dvr.
     virtual int get_dvr_time_jitter(std::string vhost);
 // http api section
@@ -207,4 +207,8 @@ void SrsConnection::expire()
     trd->interrupt();
 }
 
+void SrsConnection::dumps(SrsJsonObject* /*obj*/)
+{
+}
+
 
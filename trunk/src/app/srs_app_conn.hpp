@@ -35,6 +35,7 @@
 #include <srs_service_conn.hpp>
 
 class SrsWallClock;
+class SrsJsonObject;
 
 // The basic connection of SRS,
 // all connections accept from listener must extends from this base class,
@@ -97,6 +98,8 @@ public:
     virtual std::string remote_ip();
     // Set connection to expired.
     virtual void expire();
+    // Dumps the information of connection to the clients API, for example, the MW of player.
+    virtual void dumps(SrsJsonObject* obj);
 protected:
     // For concrete connection to do the cycle.
     virtual srs_error_t do_cycle() = 0;
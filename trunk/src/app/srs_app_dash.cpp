@@ -35,6 +35,7 @@
 #include <srs_kernel_mp4.hpp>
 
 #include <stdlib.h>
+#include <math.h>
 #include <sstream>
 using namespace std;
 
@@ -74,6 +75,7 @@ SrsFragmentedMp4::SrsFragmentedMp4()
 {
     fw = new SrsFileWriter();
     enc = new SrsMp4M2tsSegmentEncoder();
+    nb_bytes = 0;
 }
 
 SrsFragmentedMp4::~SrsFragmentedMp4()
@@ -150,6 +152,12 @@ srs_error_t SrsFragmentedMp4::reap(uint64_t& dts)
         return srs_error_wrap(err, "Flush encoder failed");
     }
     
+    off_t size = 0;
+    if ((err = fw->lseek(0, SEEK_END, &size)) != srs_success) {
+        return srs_error_wrap(err, "seek to end");
+    }
+    nb_bytes = (int64_t)size;
+    
     srs_freep(fw);
     
     if ((err = rename()) != srs_success) {
@@ -159,6 +167,11 @@ srs_error_t SrsFragmentedMp4::reap(uint64_t& dts)
     return err;
 }
 
+int64_t SrsFragmentedMp4::filesize()
+{
+    return nb_bytes;
+}
+
 SrsMpdWriter::SrsMpdWriter()
 {
     req = NULL;
@@ -297,9 +310,247 @@ srs_error_t SrsMpdWriter::get_fragment(bool video, std::string& home, std::strin
     return err;
 }
 
+SrsFmp4HlsTrack::SrsFmp4HlsTrack(string n)
+{
+    name = n;
+    sequence_no = 0;
+}
+
+SrsFmp4HlsTrack::~SrsFmp4HlsTrack()
+{
+}
+
+void SrsFmp4HlsTrack::append(string uri, srs_utime_t duration, int64_t size, srs_utime_t window)
+{
+    uris.push_back(uri);
+    durations.push_back(duration);
+    sizes.push_back(size);
+    
+    // Shrink the fragments out of window, but keep at least 3 fragments.
+    srs_utime_t total = 0;
+    for (int i = 0; i < (int)durations.size(); i++) {
+        total += durations.at(i);
+    }
+    
+    while (durations.size() > 3 && total - durations.front() >= window) {
+        total -= durations.front();
+        uris.erase(uris.begin());
+        durations.erase(durations.begin());
+        sizes.erase(sizes.begin());
+        sequence_no++;
+    }
+}
+
+bool SrsFmp4HlsTrack::empty()
+{
+    return uris.empty();
+}
+
+int64_t SrsFmp4HlsTrack::bandwidth()
+{
+    int64_t peak = 0;
+    for (int i = 0; i < (int)durations.size(); i++) {
+        srs_utime_t duration = durations.at(i);
+        if (duration > 0) {
+            peak = srs_max(peak, sizes.at(i) * 8 * SRS_UTIME_SECONDS / duration);
+        }
+    }
+    return peak;
+}
+
+void SrsFmp4HlsTrack::clear()
+{
+    uris.clear();
+    durations.clear();
+    sizes.clear();
+    sequence_no = 0;
+}
+
+string SrsFmp4HlsTrack::generate(srs_utime_t fragment)
+{
+    srs_utime_t max_duration = fragment;
+    for (int i = 0; i < (int)durations.size(); i++) {
+        max_duration = srs_max(max_duration, durations.at(i));
+    }
+    
+    stringstream ss;
+    ss << "#EXTM3U" << SRS_CONSTS_LF;
+    ss << "#EXT-X-VERSION:7" << SRS_CONSTS_LF;
+    ss << "#EXT-X-TARGETDURATION:" << (int)ceil(srsu2msi(max_duration) / 1000.0) << SRS_CONSTS_LF;
+    ss << "#EXT-X-MEDIA-SEQUENCE:" << sequence_no << SRS_CONSTS_LF;
+    ss << "#EXT-X-MAP:URI=\"" << name << "-init.mp4\"" << SRS_CONSTS_LF;
+    
+    ss.precision(3);
+    ss.setf(std::ios::fixed, std::ios::floatfield);
+    for (int i = 0; i < (int)uris.size(); i++) {
+        ss << "#EXTINF:" << srsu2msi(durations.at(i)) / 1000.0 << ", no desc" << SRS_CONSTS_LF;
+        ss << uris.at(i) << SRS_CONSTS_LF;
+    }
+    
+    return ss.str();
+}
+
+SrsFmp4M3u8Writer::SrsFmp4M3u8Writer()
+{
+    req = NULL;
+    fragment = window = 0;
+    peak_bandwidth = 0;
+    video = new SrsFmp4HlsTrack("video");
+    audio = new SrsFmp4HlsTrack("audio");
+}
+
+SrsFmp4M3u8Writer::~SrsFmp4M3u8Writer()
+{
+    srs_freep(video);
+    srs_freep(audio);
+}
+
+srs_error_t SrsFmp4M3u8Writer::initialize(SrsRequest* r)
+{
+    req = r;
+    return srs_success;
+}
+
+srs_error_t SrsFmp4M3u8Writer::on_publish()
+{
+    SrsRequest* r = req;
+    
+    fragment = _srs_config->get_dash_fragment(r->vhost);
+    window = _srs_config->get_hls_window(r->vhost);
+    
+    // The master playlist is the MPD path with .m3u8 extension, and the media playlists
+    // are in the home of fragments, which is the same as SrsMpdWriter.
+    string home = _srs_config->get_dash_path(r->vhost);
+    string mpd_path = srs_path_build_stream(_srs_config->get_dash_mpd_file(r->vhost), r->vhost, r->app, r->stream);
+    master = home + "/" + srs_path_filename(mpd_path) + ".m3u8";
+    media_home = home + "/" + srs_path_dirname(mpd_path) + "/" + r->stream;
+    
+    codecs = "";
+    peak_bandwidth = 0;
+    video->clear();
+    audio->clear();
+    
+    return srs_success;
+}
+
+void SrsFmp4M3u8Writer::on_unpublish()
+{
+}
+
+srs_error_t SrsFmp4M3u8Writer::on_fragment(bool is_video, SrsFragmentedMp4* fmp4, SrsFormat* format)
+{
+    srs_error_t err = srs_success;
+    
+    SrsFmp4HlsTrack* track = is_video? video : audio;
+    track->append(srs_path_basename(fmp4->fullpath()), fmp4->duration(), fmp4->filesize(), window);
+    
+    string path = media_home + "/" + (is_video? "video.m3u8" : "audio.m3u8");
+    if ((err = write_file(path, track->generate(fragment))) != srs_success) {
+        return srs_error_wrap(err, "write media playlist");
+    }
+    
+    if ((err = write_master(format)) != srs_success) {
+        return srs_error_wrap(err, "write master playlist");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsFmp4M3u8Writer::write_master(SrsFormat* format)
+{
+    srs_error_t err = srs_success;
+    
+    // Wait for all tracks to be ready.
+    if ((format->vcodec && video->empty()) || (format->acodec && audio->empty())) {
+        return err;
+    }
+    
+    // The codecs in RFC6381, for example, avc1.42e01e,mp4a.40.2
+    string vcodec, acodec;
+    if (format->vcodec) {
+        SrsVideoCodecConfig* c = format->vcodec;
+        char buf[16];
+        snprintf(buf, sizeof(buf), "avc1.%02x%02x%02x", (uint8_t)c->avc_profile, c->avc_profile_compatibility, (uint8_t)c->avc_level);
+        vcodec = buf;
+    }
+    if (format->acodec) {
+        acodec = "mp4a.40." + srs_int2str(format->acodec->aac_object);
+    }
+    
+    // The BANDWIDTH is the peak bitrate of stream, measured from the fragments in window,
+    // so we refresh the master playlist only when it grows.
+    int64_t bandwidth = 0;
+    if (!vcodec.empty()) {
+        bandwidth += video->bandwidth();
+    }
+    if (!acodec.empty()) {
+        bandwidth += audio->bandwidth();
+    }
+    
+    string v = vcodec + "," + acodec;
+    if (v == codecs && bandwidth <= peak_bandwidth) {
+        return err;
+    }
+    codecs = v;
+    peak_bandwidth = srs_max(peak_bandwidth, bandwidth);
+    
+    stringstream ss;
+    ss << "#EXTM3U" << SRS_CONSTS_LF;
+    ss << "#EXT-X-VERSION:7" << SRS_CONSTS_LF;
+    
+    if (!vcodec.empty() && !acodec.empty()) {
+        ss << "#EXT-X-MEDIA:TYPE=AUDIO,GROUP-ID=\"audio\",NAME=\"audio\",DEFAULT=YES,AUTOSELECT=YES,URI=\""
+            << req->stream << "/audio.m3u8\"" << SRS_CONSTS_LF;
+        ss << "#EXT-X-STREAM-INF:BANDWIDTH=" << peak_bandwidth << ",CODECS=\"" << vcodec << "," << acodec << "\",AUDIO=\"audio\"";
+        if (format->vcodec->width && format->vcodec->height) {
+            ss << ",RESOLUTION=" << format->vcodec->width << "x" << format->vcodec->height;
+        }
+        ss << SRS_CONSTS_LF << req->stream << "/video.m3u8" << SRS_CONSTS_LF;
+    } else if (!vcodec.empty()) {
+        ss << "#EXT-X-STREAM-INF:BANDWIDTH=" << peak_bandwidth << ",CODECS=\"" << vcodec << "\"" << SRS_CONSTS_LF;
+        ss << req->stream << "/video.m3u8" << SRS_CONSTS_LF;
+    } else {
+        ss << "#EXT-X-STREAM-INF:BANDWIDTH=" << peak_bandwidth << ",CODECS=\"" << acodec << "\"" << SRS_CONSTS_LF;
+        ss << req->stream << "/audio.m3u8" << SRS_CONSTS_LF;
+    }
+    
+    if ((err = write_file(master, ss.str())) != srs_success) {
+        return srs_error_wrap(err, "write %s", master.c_str());
+    }
+    
+    srs_trace("DASH: Refresh HLS master success, codecs=%s, bandwidth=%" PRId64 ", file=%s", codecs.c_str(), peak_bandwidth, master.c_str());
+    
+    return err;
+}
+
+srs_error_t SrsFmp4M3u8Writer::write_file(string path, string content)
+{
+    srs_error_t err = srs_success;
+    
+    SrsFileWriter* fw = new SrsFileWriter();
+    SrsAutoFree(SrsFileWriter, fw);
+    
+    string path_tmp = path + ".tmp";
+    if ((err = fw->open(path_tmp)) != srs_success) {
+        return srs_error_wrap(err, "Open m3u8 file=%s failed", path_tmp.c_str());
+    }
+    
+    if ((err = fw->write((void*)content.data(), content.length(), NULL)) != srs_success) {
+        return srs_error_wrap(err, "Write m3u8 file=%s failed", path_tmp.c_str());
+    }
+    
+    if (::rename(path_tmp.c_str(), path.c_str()) < 0) {
+        return srs_error_new(ERROR_DASH_WRITE_FAILED, "Rename %s to %s failed", path_tmp.c_str(), path.c_str());
+    }
+    
+    return err;
+}
+
 SrsDashController::SrsDashController()
 {
     req = NULL;
+    dash_enabled = hls_enabled = false;
+    m3u8 = new SrsFmp4M3u8Writer();
     video_tack_id = 0;
     audio_track_id = 1;
     mpd = new SrsMpdWriter();
@@ -312,6 +563,7 @@ SrsDashController::SrsDashController()
 SrsDashController::~SrsDashController()
 {
     srs_freep(mpd);
+    srs_freep(m3u8);
     srs_freep(vcurrent);
     srs_freep(acurrent);
     srs_freep(vfragments);
@@ -328,6 +580,10 @@ srs_error_t SrsDashController::initialize(SrsRequest* r)
         return srs_error_wrap(err, "mpd");
     }
     
+    if ((err = m3u8->initialize(r)) != srs_success) {
+        return srs_error_wrap(err, "m3u8");
+    }
+    
     return err;
 }
 
@@ -339,11 +595,17 @@ srs_error_t SrsDashController::on_publish()
 
     fragment = _srs_config->get_dash_fragment(r->vhost);
     home = _srs_config->get_dash_path(r->vhost);
+    dash_enabled = _srs_config->get_dash_enabled(r->vhost);
+    hls_enabled = _srs_config->get_hls_enabled(r->vhost) && _srs_config->get_hls_fmp4(r->vhost);
 
     if ((err = mpd->on_publish()) != srs_success) {
         return srs_error_wrap(err, "mpd");
     }
 
+    if (hls_enabled && (err = m3u8->on_publish()) != srs_success) {
+        return srs_error_wrap(err, "m3u8");
+    }
+
     srs_freep(vcurrent);
     vcurrent = new SrsFragmentedMp4();
     if ((err = vcurrent->initialize(req, true, mpd, video_tack_id)) != srs_success) {
@@ -362,6 +624,7 @@ srs_error_t SrsDashController::on_publish()
 void SrsDashController::on_unpublish()
 {
     mpd->on_unpublish();
+    m3u8->on_unpublish();
 
     srs_error_t err = srs_success;
 
@@ -392,11 +655,17 @@ srs_error_t SrsDashController::on_audio(SrsSharedPtrMessage* shared_audio, SrsFo
         }
         
         afragments->append(acurrent);
+        SrsFragmentedMp4* reaped = acurrent;
+        
         acurrent = new SrsFragmentedMp4();
         
         if ((err = acurrent->initialize(req, false, mpd, audio_track_id)) != srs_success) {
             return srs_error_wrap(err, "Initialize the audio fragment failed");
         }
+        
+        if (hls_enabled && (err = m3u8->on_fragment(false, reaped, format)) != srs_success) {
+            return srs_error_wrap(err, "m3u8 audio fragment");
+        }
     }
     
     if ((err = acurrent->write(shared_audio, format)) != srs_success) {
@@ -425,11 +694,17 @@ srs_error_t SrsDashController::on_video(SrsSharedPtrMessage* shared_video, SrsFo
         }
         
         vfragments->append(vcurrent);
+        SrsFragmentedMp4* reaped = vcurrent;
+        
         vcurrent = new SrsFragmentedMp4();
         
         if ((err = vcurrent->initialize(req, true, mpd, video_tack_id)) != srs_success) {
             return srs_error_wrap(err, "Initialize the video fragment failed");
         }
+        
+        if (hls_enabled && (err = m3u8->on_fragment(true, reaped, format)) != srs_success) {
+            return srs_error_wrap(err, "m3u8 video fragment");
+        }
     }
     
     if ((err = vcurrent->write(shared_video, format)) != srs_success) {
@@ -447,6 +722,10 @@ srs_error_t SrsDashController::refresh_mpd(SrsFormat* format)
 {
     srs_error_t err = srs_success;
     
+    if (!dash_enabled) {
+        return err;
+    }
+    
     // TODO: FIXME: Support pure audio streaming.
     if (!format->acodec || !format->vcodec) {
         return err;
@@ -537,7 +816,9 @@ srs_error_t SrsDash::on_publish()
         return err;
     }
     
-    if (!_srs_config->get_dash_enabled(req->vhost)) {
+    // The DASH muxer also generates the FMP4 for HLS.
+    bool hls_fmp4 = _srs_config->get_hls_enabled(req->vhost) && _srs_config->get_hls_fmp4(req->vhost);
+    if (!_srs_config->get_dash_enabled(req->vhost) && !hls_fmp4) {
         return err;
     }
     enabled = true;
@@ -60,6 +60,8 @@ class SrsFragmentedMp4 : public SrsFragment
 private:
     SrsFileWriter* fw;
     SrsMp4M2tsSegmentEncoder* enc;
+    // The size in bytes of fragment, available after reaped.
+    int64_t nb_bytes;
 public:
     SrsFragmentedMp4();
     virtual ~SrsFragmentedMp4();
@@ -70,6 +72,8 @@ public:
     virtual srs_error_t write(SrsSharedPtrMessage* shared_msg, SrsFormat* format);
     // Reap the fragment, close the fd and rename tmp to official file.
     virtual srs_error_t reap(uint64_t& dts);
+    // Get the size in bytes of reaped fragment.
+    virtual int64_t filesize();
 };
 
 // The writer to write MPD for DASH.
@@ -107,12 +111,73 @@ public:
     virtual srs_error_t get_fragment(bool video, std::string& home, std::string& filename, int64_t& sn, srs_utime_t& basetime);
 };
 
+// The HLS media playlist of a FMP4 track, see hls_fmp4.
+class SrsFmp4HlsTrack
+{
+private:
+    // The name of track, video or audio.
+    std::string name;
+    // The sequence number of the first fragment.
+    int64_t sequence_no;
+    std::vector<std::string> uris;
+    std::vector<srs_utime_t> durations;
+    std::vector<int64_t> sizes;
+public:
+    SrsFmp4HlsTrack(std::string n);
+    virtual ~SrsFmp4HlsTrack();
+public:
+    // Append a fragment, and remove the old fragments out of window.
+    virtual void append(std::string uri, srs_utime_t duration, int64_t size, srs_utime_t window);
+    virtual bool empty();
+    // Get the peak bitrate in bits per second of fragments in window, for BANDWIDTH of master playlist.
+    virtual int64_t bandwidth();
+    virtual void clear();
+    // Generate the media playlist with EXT-X-MAP for the init mp4.
+    virtual std::string generate(srs_utime_t fragment);
+};
+
+// The writer to write HLS m3u8 for the FMP4 of DASH, which shares the init mp4
+// and fragments with DASH, so the stream is muxed once for both DASH and HLS.
+class SrsFmp4M3u8Writer
+{
+private:
+    SrsRequest* req;
+    srs_utime_t fragment;
+    srs_utime_t window;
+    // The full path of master playlist.
+    std::string master;
+    // The full home of media playlists and fragments.
+    std::string media_home;
+    // The codecs in master playlist, empty if not written.
+    std::string codecs;
+    // The peak bitrate in bits per second in master playlist, which only grows while publishing.
+    int64_t peak_bandwidth;
+    SrsFmp4HlsTrack* video;
+    SrsFmp4HlsTrack* audio;
+public:
+    SrsFmp4M3u8Writer();
+    virtual ~SrsFmp4M3u8Writer();
+public:
+    virtual srs_error_t initialize(SrsRequest* r);
+    virtual srs_error_t on_publish();
+    virtual void on_unpublish();
+    // When reap a fragment, write the media playlist, and the master playlist if codecs changed or bitrate grows.
+    virtual srs_error_t on_fragment(bool is_video, SrsFragmentedMp4* fmp4, SrsFormat* format);
+private:
+    virtual srs_error_t write_master(SrsFormat* format);
+    virtual srs_error_t write_file(std::string path, std::string content);
+};
+
 // The controller for DASH, control the MPD and FMP4 generating system.
 class SrsDashController
 {
 private:
     SrsRequest* req;
     SrsMpdWriter* mpd;
+    SrsFmp4M3u8Writer* m3u8;
+    // Whether write the MPD for DASH, and the m3u8 for HLS.
+    bool dash_enabled;
+    bool hls_enabled;
 private:
     SrsFragmentedMp4* vcurrent;
     SrsFragmentWindow* vfragments;
@@ -42,6 +42,7 @@ using namespace std;
 #include <srs_app_utility.hpp>
 #include <srs_kernel_mp4.hpp>
 #include <srs_app_fragment.hpp>
+#include <srs_app_async_file.hpp>
 
 SrsDvrSegmenter::SrsDvrSegmenter()
 {
@@ -73,6 +74,12 @@ srs_error_t SrsDvrSegmenter::initialize(SrsDvrPlan* p, SrsRequest* r)
     jitter_algorithm = (SrsRtmpJitterAlgorithm)_srs_config->get_dvr_time_jitter(req->vhost);
     wait_keyframe = _srs_config->get_dvr_wait_keyframe(req->vhost);
     
+    // Write by the I/O thread, for the slow disk never blocks the ST thread.
+    if (_srs_config->get_dvr_async(req->vhost)) {
+        srs_freep(fs);
+        fs = new SrsAsyncFileWriter(_srs_config->get_dvr_async_buffer(req->vhost));
+    }
+    
     return srs_success;
 }
 
@@ -454,6 +461,20 @@ srs_error_t SrsDvrMp4Segmenter::open_encoder()
     srs_error_t err = srs_success;
     
     srs_freep(enc);
+    
+    // Write the fragmented mp4, to limit the memory of long recording.
+    srs_utime_t duration = _srs_config->get_dvr_mp4_fragment(req->vhost);
+    if (duration > 0) {
+        SrsMp4FragmentEncoder* fenc = new SrsMp4FragmentEncoder();
+        enc = fenc;
+        
+        if ((err = fenc->initialize(fs, duration, _srs_config->get_dvr_mp4_finalize(req->vhost))) != srs_success) {
+            return srs_error_wrap(err, "init fragment encoder");
+        }
+        
+        return err;
+    }
+    
     enc = new SrsMp4Encoder();
     
     if ((err = enc->initialize(fs)) != srs_success) {
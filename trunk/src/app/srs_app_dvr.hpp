@@ -59,8 +59,8 @@ protected:
     bool wait_keyframe;
     // The FLV/MP4 fragment file.
     SrsFragment* fragment;
-private:
     SrsRequest* req;
+private:
     SrsDvrPlan* plan;
 private:
     SrsRtmpJitter* jitter;
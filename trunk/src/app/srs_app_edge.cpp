@@ -46,6 +46,9 @@ using namespace std;
 #include <srs_kernel_utility.hpp>
 #include <srs_kernel_balance.hpp>
 #include <srs_app_rtmp_conn.hpp>
+#include <srs_app_workers.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_app_bandwidth.hpp>
 
 // when edge timeout, retry next.
 #define SRS_EDGE_INGESTER_TIMEOUT (5 * SRS_UTIME_SECONDS)
@@ -53,6 +56,152 @@ using namespace std;
 // when edge error, wait for quit
 #define SRS_EDGE_FORWARDER_TIMEOUT (150 * SRS_UTIME_MILLISECONDS)
 
+SrsLbHealth* _srs_origin_health = new SrsLbHealth();
+
+// Create the load balancer to select origin of vhost.
+ISrsLoadBalancer* srs_edge_create_balancer(string vhost)
+{
+    if (_srs_config->get_vhost_edge_balance(vhost) == "hash") {
+        return new SrsLbConsistentHash(_srs_origin_health);
+    }
+    return new SrsLbRoundRobin();
+}
+
+// The max idle connections to an origin app in pool.
+#define SRS_EDGE_POOL_MAX_IDLES 8
+// The idle connection in pool is closed when exceed this duration,
+// which must be less than the timeout of origin for closed stream.
+#define SRS_EDGE_POOL_IDLE_TIMEOUT (30 * SRS_UTIME_SECONDS)
+// The idle connection is reused after this duration, for origin to stop the closed stream.
+#define SRS_EDGE_POOL_COOLDOWN (1 * SRS_UTIME_SECONDS)
+// The timeout to create stream on pooled connection, fail fast to connect a new one.
+#define SRS_EDGE_POOL_REUSE_TIMEOUT (1 * SRS_UTIME_SECONDS)
+
+SrsEdgeIdleUpstream::SrsEdgeIdleUpstream(string k, SrsSimpleRtmpClient* c)
+{
+    key = k;
+    sdk = c;
+    starttime = srs_get_system_time();
+}
+
+SrsEdgeIdleUpstream::~SrsEdgeIdleUpstream()
+{
+    srs_freep(sdk);
+}
+
+SrsEdgeUpstreamPool* SrsEdgeUpstreamPool::_instance = NULL;
+
+SrsEdgeUpstreamPool::SrsEdgeUpstreamPool()
+{
+    nn_reused = 0;
+    nn_recycled = 0;
+}
+
+SrsEdgeUpstreamPool::~SrsEdgeUpstreamPool()
+{
+    std::vector<SrsEdgeIdleUpstream*>::iterator it;
+    for (it = idles.begin(); it != idles.end(); ++it) {
+        SrsEdgeIdleUpstream* idle = *it;
+        srs_freep(idle);
+    }
+    idles.clear();
+}
+
+SrsEdgeUpstreamPool* SrsEdgeUpstreamPool::instance()
+{
+    if (!_instance) {
+        _instance = new SrsEdgeUpstreamPool();
+    }
+    return _instance;
+}
+
+string SrsEdgeUpstreamPool::generate_key(string server, int port, SrsRequest* req, string vhost)
+{
+    return srs_generate_rtmp_url(server, port, req->host, vhost, req->app, "", req->param);
+}
+
+SrsSimpleRtmpClient* SrsEdgeUpstreamPool::take(string key)
+{
+    expire();
+    
+    srs_utime_t now = srs_get_system_time();
+    
+    // Take the oldest connection, which is most likely stopped by origin.
+    std::vector<SrsEdgeIdleUpstream*>::iterator it;
+    for (it = idles.begin(); it != idles.end(); ++it) {
+        SrsEdgeIdleUpstream* idle = *it;
+        if (idle->key != key || now - idle->starttime < SRS_EDGE_POOL_COOLDOWN) {
+            continue;
+        }
+        
+        SrsSimpleRtmpClient* sdk = idle->sdk;
+        idle->sdk = NULL;
+        
+        idles.erase(it);
+        srs_freep(idle);
+        
+        nn_reused++;
+        return sdk;
+    }
+    
+    return NULL;
+}
+
+void SrsEdgeUpstreamPool::give(string key, SrsSimpleRtmpClient* sdk)
+{
+    expire();
+    
+    // Drop the oldest connection when exceed the max idles of key.
+    int nn_idles = 0;
+    std::vector<SrsEdgeIdleUpstream*>::iterator it;
+    for (it = idles.begin(); it != idles.end(); ++it) {
+        SrsEdgeIdleUpstream* idle = *it;
+        if (idle->key == key) {
+            nn_idles++;
+        }
+    }
+    
+    for (it = idles.begin(); nn_idles >= SRS_EDGE_POOL_MAX_IDLES && it != idles.end();) {
+        SrsEdgeIdleUpstream* idle = *it;
+        if (idle->key != key) {
+            ++it;
+            continue;
+        }
+        
+        it = idles.erase(it);
+        srs_freep(idle);
+        nn_idles--;
+    }
+    
+    idles.push_back(new SrsEdgeIdleUpstream(key, sdk));
+    nn_recycled++;
+    
+    srs_trace("edge pool: recycle %s, idles=%d, recycled=%" PRId64 ", reused=%" PRId64,
+        key.c_str(), (int)idles.size(), nn_recycled, nn_reused);
+}
+
+int SrsEdgeUpstreamPool::size()
+{
+    return (int)idles.size();
+}
+
+void SrsEdgeUpstreamPool::expire()
+{
+    srs_utime_t now = srs_get_system_time();
+    
+    std::vector<SrsEdgeIdleUpstream*>::iterator it;
+    for (it = idles.begin(); it != idles.end();) {
+        SrsEdgeIdleUpstream* idle = *it;
+        if (now - idle->starttime < SRS_EDGE_POOL_IDLE_TIMEOUT) {
+            ++it;
+            continue;
+        }
+        
+        it = idles.erase(it);
+        srs_freep(idle);
+    }
+}
+
 SrsEdgeUpstream::SrsEdgeUpstream()
 {
 }
@@ -65,6 +214,7 @@ SrsEdgeRtmpUpstream::SrsEdgeRtmpUpstream(string r)
 {
     redirect = r;
     sdk = NULL;
+    playing = false;
 }
 
 SrsEdgeRtmpUpstream::~SrsEdgeRtmpUpstream()
@@ -72,28 +222,46 @@ SrsEdgeRtmpUpstream::~SrsEdgeRtmpUpstream()
     close();
 }
 
-srs_error_t SrsEdgeRtmpUpstream::connect(SrsRequest* r, SrsLbRoundRobin* lb)
+srs_error_t SrsEdgeRtmpUpstream::connect(SrsRequest* r, ISrsLoadBalancer* lb)
 {
     srs_error_t err = srs_success;
     
     SrsRequest* req = r;
     
+    // The selected origin, empty if redirect.
+    std::string origin;
     std::string url;
     if (true) {
-        SrsConfDirective* conf = _srs_config->get_vhost_edge_origin(req->vhost);
+        // For workers mode, pull from the worker which owns the stream.
+        SrsWorkers* workers = SrsWorkers::instance();
+        bool relay = workers->should_relay(req);
         
-        // @see https://github.com/ossrs/srs/issues/79
-        // when origin is error, for instance, server is shutdown,
-        // then user remove the vhost then reload, the conf is empty.
-        if (!conf) {
-            return srs_error_new(ERROR_EDGE_VHOST_REMOVED, "vhost %s removed", req->vhost.c_str());
+        std::vector<std::string> origins;
+        if (relay) {
+            origins.push_back(workers->relay_endpoint(workers->owner(req)));
+        } else {
+            SrsConfDirective* conf = _srs_config->get_vhost_edge_origin(req->vhost);
+            
+            // @see https://github.com/ossrs/srs/issues/79
+            // when origin is error, for instance, server is shutdown,
+            // then user remove the vhost then reload, the conf is empty.
+            if (!conf) {
+                return srs_error_new(ERROR_EDGE_VHOST_REMOVED, "vhost %s removed", req->vhost.c_str());
+            }
+            origins = conf->args;
         }
         
         // select the origin.
-        std::string server = lb->select(conf->args);
+        origin = lb->select(origins, req->get_stream_url());
+        std::string server = origin;
         int port = SRS_CONSTS_RTMP_DEFAULT_PORT;
         srs_parse_hostport(server, server, port);
         
+        // override the origin info by redirect, which is not the origin to update health.
+        if (!redirect.empty()) {
+            origin = "";
+        }
+        
         // override the origin info by redirect.
         if (!redirect.empty()) {
             int _port;
@@ -110,24 +278,59 @@ srs_error_t SrsEdgeRtmpUpstream::connect(SrsRequest* r, SrsLbRoundRobin* lb)
         
         // support vhost tranform for edge,
         // @see https://github.com/ossrs/srs/issues/372
-        std::string vhost = _srs_config->get_vhost_edge_transform_vhost(req->vhost);
-        vhost = srs_string_replace(vhost, "[vhost]", req->vhost);
+        std::string vhost = req->vhost;
+        if (!relay) {
+            vhost = _srs_config->get_vhost_edge_transform_vhost(req->vhost);
+            vhost = srs_string_replace(vhost, "[vhost]", req->vhost);
+        }
         
         url = srs_generate_rtmp_url(server, port, req->host, vhost, req->app, req->stream, req->param);
+        key = SrsEdgeUpstreamPool::generate_key(server, port, req, vhost);
+    }
+    
+    close();
+    
+    // Pull over an idle connection to the origin app if possible.
+    sdk = SrsEdgeUpstreamPool::instance()->take(key);
+    if (sdk) {
+        sdk->set_recv_timeout(SRS_EDGE_POOL_REUSE_TIMEOUT);
+        if ((err = sdk->recreate_stream(url)) == srs_success) {
+            err = sdk->play(_srs_config->get_chunk_size(req->vhost));
+        }
+        
+        if (err == srs_success) {
+            playing = true;
+            srs_trace("edge pull %s over pooled connection", url.c_str());
+            return err;
+        }
+        
+        srs_warn("edge pool: ignore reuse err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+        srs_freep(sdk);
     }
     
-    srs_freep(sdk);
     srs_utime_t cto = SRS_EDGE_INGESTER_TIMEOUT;
     srs_utime_t sto = SRS_CONSTS_RTMP_PULSE;
     sdk = new SrsSimpleRtmpClient(url, cto, sto);
     
+    // Hint the origin to flush the gop cache immediately, for the fast startup of edge.
+    sdk->set_connect_arg("srs_gop_flush", SrsAmf0Any::boolean(true));
+    
+    srs_utime_t starttime = srs_update_system_time();
     if ((err = sdk->connect()) != srs_success) {
+        if (!origin.empty()) {
+            _srs_origin_health->on_failure(origin);
+        }
         return srs_error_wrap(err, "edge pull %s failed, cto=%dms, sto=%dms.", url.c_str(), srsu2msi(cto), srsu2msi(sto));
     }
+    if (!origin.empty()) {
+        _srs_origin_health->on_success(origin, srs_update_system_time() - starttime);
+    }
     
     if ((err = sdk->play(_srs_config->get_chunk_size(req->vhost))) != srs_success) {
         return srs_error_wrap(err, "edge pull %s stream failed", url.c_str());
     }
+    playing = true;
     
     return err;
 }
@@ -144,9 +347,32 @@ srs_error_t SrsEdgeRtmpUpstream::decode_message(SrsCommonMessage* msg, SrsPacket
 
 void SrsEdgeRtmpUpstream::close()
 {
+    playing = false;
     srs_freep(sdk);
 }
 
+void SrsEdgeRtmpUpstream::recycle()
+{
+    srs_error_t err = srs_success;
+    
+    // Only reuse the connection which plays stream and stops at message boundary.
+    if (!sdk || !playing || !sdk->is_message_boundary()) {
+        close();
+        return;
+    }
+    
+    if ((err = sdk->close_stream()) != srs_success) {
+        srs_warn("edge pool: ignore close stream err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+        close();
+        return;
+    }
+    
+    playing = false;
+    SrsEdgeUpstreamPool::instance()->give(key, sdk);
+    sdk = NULL;
+}
+
 void SrsEdgeRtmpUpstream::selected(string& server, int& port)
 {
     server = selected_ip;
@@ -170,7 +396,7 @@ SrsEdgeIngester::SrsEdgeIngester()
     req = NULL;
     
     upstream = new SrsEdgeRtmpUpstream("");
-    lb = new SrsLbRoundRobin();
+    lb = NULL;
     trd = new SrsDummyCoroutine();
 }
 
@@ -189,6 +415,9 @@ srs_error_t SrsEdgeIngester::initialize(SrsSource* s, SrsPlayEdge* e, SrsRequest
     edge = e;
     req = r;
     
+    srs_freep(lb);
+    lb = srs_edge_create_balancer(req->vhost);
+    
     return srs_success;
 }
 
@@ -213,7 +442,9 @@ srs_error_t SrsEdgeIngester::start()
 void SrsEdgeIngester::stop()
 {
     trd->stop();
-    upstream->close();
+    
+    // The upstream is reused when all clients stopped, for the connection is still alive.
+    upstream->recycle();
     
     // notice to unpublish.
     if (source) {
@@ -223,7 +454,7 @@ void SrsEdgeIngester::stop()
 
 string SrsEdgeIngester::get_curr_origin()
 {
-    return lb->selected();
+    return lb? lb->selected() : "";
 }
 
 // when error, edge ingester sleep for a while and retry.
@@ -245,6 +476,11 @@ srs_error_t SrsEdgeIngester::cycle()
             srs_freep(err);
         }
 
+        // Quit without sleep when stopped, for the edge stops in the server cycle.
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "edge ingester");
+        }
+
         srs_usleep(SRS_EDGE_INGESTER_CIMS);
     }
     
@@ -281,6 +517,15 @@ srs_error_t SrsEdgeIngester::do_cycle()
         
         err = ingest(redirect);
         
+        // Never reuse the upstream which fails, unless the ingester is stopping.
+        if (true) {
+            srs_error_t r0 = trd->pull();
+            if (r0 == srs_success) {
+                upstream->close();
+            }
+            srs_freep(r0);
+        }
+        
         // retry for rtmp 302 immediately.
         if (srs_error_code(err) == ERROR_CONTROL_REDIRECT) {
             int port;
@@ -442,9 +687,10 @@ SrsEdgeForwarder::SrsEdgeForwarder()
     send_error_code = ERROR_SUCCESS;
     
     sdk = NULL;
-    lb = new SrsLbRoundRobin();
+    lb = NULL;
     trd = new SrsDummyCoroutine();
     queue = new SrsMessageQueue();
+    pacer = NULL;
 }
 
 SrsEdgeForwarder::~SrsEdgeForwarder()
@@ -454,6 +700,7 @@ SrsEdgeForwarder::~SrsEdgeForwarder()
     srs_freep(lb);
     srs_freep(trd);
     srs_freep(queue);
+    srs_freep(pacer);
 }
 
 void SrsEdgeForwarder::set_queue_size(srs_utime_t queue_size)
@@ -467,6 +714,12 @@ srs_error_t SrsEdgeForwarder::initialize(SrsSource* s, SrsPublishEdge* e, SrsReq
     edge = e;
     req = r;
     
+    srs_freep(lb);
+    lb = srs_edge_create_balancer(req->vhost);
+    
+    srs_freep(pacer);
+    pacer = SrsPacer::create(req->vhost);
+    
     return srs_success;
 }
 
@@ -477,20 +730,35 @@ srs_error_t SrsEdgeForwarder::start()
     // reset the error code.
     send_error_code = ERROR_SUCCESS;
     
+    std::string origin;
     std::string url;
     if (true) {
-        SrsConfDirective* conf = _srs_config->get_vhost_edge_origin(req->vhost);
-        srs_assert(conf);
+        // For workers mode, publish to the worker which owns the stream.
+        SrsWorkers* workers = SrsWorkers::instance();
+        bool relay = workers->should_relay(req);
+        
+        std::vector<std::string> origins;
+        if (relay) {
+            origins.push_back(workers->relay_endpoint(workers->owner(req)));
+        } else {
+            SrsConfDirective* conf = _srs_config->get_vhost_edge_origin(req->vhost);
+            srs_assert(conf);
+            origins = conf->args;
+        }
         
         // select the origin.
-        std::string server = lb->select(conf->args);
+        origin = lb->select(origins, req->get_stream_url());
+        std::string server = origin;
         int port = SRS_CONSTS_RTMP_DEFAULT_PORT;
         srs_parse_hostport(server, server, port);
         
         // support vhost tranform for edge,
         // @see https://github.com/ossrs/srs/issues/372
-        std::string vhost = _srs_config->get_vhost_edge_transform_vhost(req->vhost);
-        vhost = srs_string_replace(vhost, "[vhost]", req->vhost);
+        std::string vhost = req->vhost;
+        if (!relay) {
+            vhost = _srs_config->get_vhost_edge_transform_vhost(req->vhost);
+            vhost = srs_string_replace(vhost, "[vhost]", req->vhost);
+        }
         
         url = srs_generate_rtmp_url(server, port, req->host, vhost, req->app, req->stream, req->param);
     }
@@ -501,9 +769,12 @@ srs_error_t SrsEdgeForwarder::start()
     srs_utime_t sto = SRS_CONSTS_RTMP_TIMEOUT;
     sdk = new SrsSimpleRtmpClient(url, cto, sto);
     
+    srs_utime_t starttime = srs_update_system_time();
     if ((err = sdk->connect()) != srs_success) {
+        _srs_origin_health->on_failure(origin);
         return srs_error_wrap(err, "sdk connect %s failed, cto=%dms, sto=%dms.", url.c_str(), srsu2msi(cto), srsu2msi(sto));
     }
+    _srs_origin_health->on_success(origin, srs_update_system_time() - starttime);
     
     if ((err = sdk->publish(_srs_config->get_chunk_size(req->vhost))) != srs_success) {
         return srs_error_wrap(err, "sdk publish");
@@ -593,10 +864,15 @@ srs_error_t SrsEdgeForwarder::do_cycle()
         
         // forward all messages.
         // each msg in msgs.msgs must be free, for the SrsMessageArray never free them.
+        // the burst after reconnect is paced, as the queue is not consumed.
         int count = 0;
-        if ((err = queue->dump_packets(msgs.max, msgs.msgs, count)) != srs_success) {
+        int64_t quota = pacer? pacer->quota() : -1;
+        if (quota != 0 && (err = queue->dump_packets(msgs.max, msgs.msgs, count, quota)) != srs_success) {
             return srs_error_wrap(err, "queue dumps packets");
         }
+        if (pacer) {
+            pacer->consume(msgs.msgs, count);
+        }
         
         pprint->elapse();
         
@@ -654,6 +930,8 @@ SrsPlayEdge::SrsPlayEdge()
 {
     state = SrsEdgeStateInit;
     ingester = new SrsEdgeIngester();
+    req = NULL;
+    idle_at = 0;
 }
 
 SrsPlayEdge::~SrsPlayEdge()
@@ -661,10 +939,12 @@ SrsPlayEdge::~SrsPlayEdge()
     srs_freep(ingester);
 }
 
-srs_error_t SrsPlayEdge::initialize(SrsSource* source, SrsRequest* req)
+srs_error_t SrsPlayEdge::initialize(SrsSource* source, SrsRequest* r)
 {
     srs_error_t err = srs_success;
     
+    req = r;
+    
     if ((err = ingester->initialize(source, this, req)) != srs_success) {
         return srs_error_wrap(err, "ingester(pull)");
     }
@@ -676,6 +956,9 @@ srs_error_t SrsPlayEdge::on_client_play()
 {
     srs_error_t err = srs_success;
     
+    // the hot stream is still ingesting, reuse it.
+    idle_at = 0;
+    
     // start ingest when init state.
     if (state == SrsEdgeStateInit) {
         state = SrsEdgeStatePlay;
@@ -690,13 +973,14 @@ void SrsPlayEdge::on_all_client_stop()
     // when all client disconnected,
     // and edge is ingesting origin stream, abort it.
     if (state == SrsEdgeStatePlay || state == SrsEdgeStateIngestConnected) {
-        ingester->stop();
-        
-        SrsEdgeState pstate = state;
-        state = SrsEdgeStateInit;
-        srs_trace("edge change from %d to state %d (init).", pstate, state);
+        // keep the hot stream warm for the next player.
+        if (is_hot()) {
+            idle_at = srs_get_system_time();
+            srs_trace("edge keep pulling hot stream %s", req->get_stream_url().c_str());
+            return;
+        }
         
-        return;
+        stop_ingest();
     }
 }
 
@@ -705,6 +989,23 @@ string SrsPlayEdge::get_curr_origin()
     return ingester->get_curr_origin();
 }
 
+srs_error_t SrsPlayEdge::cycle()
+{
+    if (idle_at == 0) {
+        return srs_success;
+    }
+    
+    srs_utime_t timeout = _srs_config->get_vhost_edge_prefetch_timeout(req->vhost);
+    if (srs_get_system_time() - idle_at < timeout && is_hot()) {
+        return srs_success;
+    }
+    
+    srs_trace("edge stop pulling idle stream %s", req->get_stream_url().c_str());
+    stop_ingest();
+    
+    return srs_success;
+}
+
 srs_error_t SrsPlayEdge::on_ingest_play()
 {
     srs_error_t err = srs_success;
@@ -723,6 +1024,27 @@ srs_error_t SrsPlayEdge::on_ingest_play()
     return err;
 }
 
+bool SrsPlayEdge::is_hot()
+{
+    int prefetch = _srs_config->get_vhost_edge_prefetch(req->vhost);
+    if (prefetch <= 0) {
+        return false;
+    }
+    
+    srs_utime_t timeout = _srs_config->get_vhost_edge_prefetch_timeout(req->vhost);
+    return SrsStatistic::instance()->is_hot(req, prefetch, timeout);
+}
+
+void SrsPlayEdge::stop_ingest()
+{
+    idle_at = 0;
+    ingester->stop();
+    
+    SrsEdgeState pstate = state;
+    state = SrsEdgeStateInit;
+    srs_trace("edge change from %d to state %d (init).", pstate, state);
+}
+
 SrsPublishEdge::SrsPublishEdge()
 {
     state = SrsEdgeStateInit;
@@ -802,4 +1124,3 @@ void SrsPublishEdge::on_proxy_unpublish()
     state = SrsEdgeStateInit;
     srs_trace("edge change from %d to state %d (init).", pstate, state);
 }
-
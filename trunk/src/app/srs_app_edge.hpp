@@ -30,6 +30,7 @@
 #include <srs_app_thread.hpp>
 
 #include <string>
+#include <vector>
 
 class SrsStSocket;
 class SrsRtmpServer;
@@ -40,13 +41,18 @@ class SrsPublishEdge;
 class SrsRtmpClient;
 class SrsCommonMessage;
 class SrsMessageQueue;
+class SrsPacer;
 class ISrsProtocolReadWriter;
 class SrsKbps;
-class SrsLbRoundRobin;
+class ISrsLoadBalancer;
+class SrsLbHealth;
 class SrsTcpClient;
 class SrsSimpleRtmpClient;
 class SrsPacket;
 
+// The health of origins, shared by edge to select origin.
+extern SrsLbHealth* _srs_origin_health;
+
 // The state of edge, auto machine
 enum SrsEdgeState
 {
@@ -68,6 +74,51 @@ enum SrsEdgeUserState
     SrsEdgeUserStateReloading = 100,
 };
 
+// The idle connection to origin, which stopped a stream and is waiting for the next one.
+class SrsEdgeIdleUpstream
+{
+public:
+    // The origin and app of connection, see SrsEdgeUpstreamPool::generate_key.
+    std::string key;
+    SrsSimpleRtmpClient* sdk;
+    // When the connection is put into pool.
+    srs_utime_t starttime;
+public:
+    SrsEdgeIdleUpstream(std::string k, SrsSimpleRtmpClient* c);
+    virtual ~SrsEdgeIdleUpstream();
+};
+
+// The pool of idle RTMP connections of edge to origins, to pull another stream of the same
+// vhost and app over an existing connection, without the TCP connect, handshake and connect app.
+// @remark Each connection of origin serves one stream at a time, so the connection is reused
+//      after the stream is closed, instead of multiplexing streams in one connection.
+class SrsEdgeUpstreamPool
+{
+private:
+    static SrsEdgeUpstreamPool* _instance;
+private:
+    std::vector<SrsEdgeIdleUpstream*> idles;
+    // The number of connections reused and put back to pool.
+    int64_t nn_reused;
+    int64_t nn_recycled;
+public:
+    SrsEdgeUpstreamPool();
+    virtual ~SrsEdgeUpstreamPool();
+public:
+    static SrsEdgeUpstreamPool* instance();
+    // Generate the key of connection, which is the origin, vhost and app of url.
+    static std::string generate_key(std::string server, int port, SrsRequest* req, std::string vhost);
+public:
+    // Take an idle connection for key, NULL if no one, user must free it.
+    virtual SrsSimpleRtmpClient* take(std::string key);
+    // Put the connection to pool, which is closed stream, the pool owns it.
+    virtual void give(std::string key, SrsSimpleRtmpClient* sdk);
+    virtual int size();
+private:
+    // Free the connections which is idle for too long.
+    virtual void expire();
+};
+
 // The upstream of edge, can be rtmp or http.
 class SrsEdgeUpstream
 {
@@ -75,10 +126,12 @@ public:
     SrsEdgeUpstream();
     virtual ~SrsEdgeUpstream();
 public:
-    virtual srs_error_t connect(SrsRequest* r, SrsLbRoundRobin* lb) = 0;
+    virtual srs_error_t connect(SrsRequest* r, ISrsLoadBalancer* lb) = 0;
     virtual srs_error_t recv_message(SrsCommonMessage** pmsg) = 0;
     virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket) = 0;
     virtual void close() = 0;
+    // Stop the stream and keep the connection for another stream, or close it if not reusable.
+    virtual void recycle() = 0;
 public:
     virtual void selected(std::string& server, int& port) = 0;
     virtual void set_recv_timeout(srs_utime_t tm) = 0;
@@ -92,6 +145,9 @@ private:
     // use this <ip[:port]> as upstream.
     std::string redirect;
     SrsSimpleRtmpClient* sdk;
+    // The key in pool of the connection, and whether the stream is played.
+    std::string key;
+    bool playing;
 private:
     // Current selected server, the ip:port.
     std::string selected_ip;
@@ -101,10 +157,11 @@ public:
     SrsEdgeRtmpUpstream(std::string r);
     virtual ~SrsEdgeRtmpUpstream();
 public:
-    virtual srs_error_t connect(SrsRequest* r, SrsLbRoundRobin* lb);
+    virtual srs_error_t connect(SrsRequest* r, ISrsLoadBalancer* lb);
     virtual srs_error_t recv_message(SrsCommonMessage** pmsg);
     virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket);
     virtual void close();
+    virtual void recycle();
 public:
     virtual void selected(std::string& server, int& port);
     virtual void set_recv_timeout(srs_utime_t tm);
@@ -119,7 +176,7 @@ private:
     SrsPlayEdge* edge;
     SrsRequest* req;
     SrsCoroutine* trd;
-    SrsLbRoundRobin* lb;
+    ISrsLoadBalancer* lb;
     SrsEdgeUpstream* upstream;
 public:
     SrsEdgeIngester();
@@ -148,12 +205,14 @@ private:
     SrsRequest* req;
     SrsCoroutine* trd;
     SrsSimpleRtmpClient* sdk;
-    SrsLbRoundRobin* lb;
+    ISrsLoadBalancer* lb;
     // we must ensure one thread one fd principle,
     // that is, a fd must be write/read by the one thread.
     // The publish service thread will proxy(msg), and the edge forward thread
     // will cycle(), so we use queue for cycle to send the msg of proxy.
     SrsMessageQueue* queue;
+    // The pacer of egress, NULL if disabled.
+    SrsPacer* pacer;
     // error code of send, for edge proxy thread to query.
     int send_error_code;
 public:
@@ -180,6 +239,9 @@ class SrsPlayEdge
 private:
     SrsEdgeState state;
     SrsEdgeIngester* ingester;
+    SrsRequest* req;
+    // When all clients stopped, for hot stream to keep pulling from origin, 0 if not.
+    srs_utime_t idle_at;
 public:
     SrsPlayEdge();
     virtual ~SrsPlayEdge();
@@ -191,11 +253,17 @@ public:
     // When client play stream on edge.
     virtual srs_error_t on_client_play();
     // When all client stopped play, disconnect to origin.
+    // @remark The hot stream keeps pulling from origin for a while, see prefetch of vhost.
     virtual void on_all_client_stop();
     virtual std::string get_curr_origin();
+    // Stop pulling the hot stream, when it's idle for too long or not hot.
+    virtual srs_error_t cycle();
 public:
     // When ingester start to play stream.
     virtual srs_error_t on_ingest_play();
+private:
+    virtual bool is_hot();
+    virtual void stop_ingest();
 };
 
 // The publish edge control service.
@@ -46,6 +46,7 @@ using namespace std;
 #include <srs_core_autofree.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_app_rtmp_conn.hpp>
+#include <srs_app_bandwidth.hpp>
 
 SrsForwarder::SrsForwarder(SrsOriginHub* h)
 {
@@ -58,6 +59,7 @@ SrsForwarder::SrsForwarder(SrsOriginHub* h)
     trd = new SrsDummyCoroutine();
     queue = new SrsMessageQueue();
     jitter = new SrsRtmpJitter();
+    pacer = NULL;
 }
 
 SrsForwarder::~SrsForwarder()
@@ -66,6 +68,7 @@ SrsForwarder::~SrsForwarder()
     srs_freep(trd);
     srs_freep(queue);
     srs_freep(jitter);
+    srs_freep(pacer);
     
     srs_freep(sh_video);
     srs_freep(sh_audio);
@@ -82,6 +85,9 @@ srs_error_t SrsForwarder::initialize(SrsRequest* r, string ep)
     // the ep(endpoint) to forward to
     ep_forward = ep;
     
+    srs_freep(pacer);
+    pacer = SrsPacer::create(req->vhost);
+    
     return err;
 }
 
@@ -285,10 +291,15 @@ srs_error_t SrsForwarder::forward()
         
         // forward all messages.
         // each msg in msgs.msgs must be free, for the SrsMessageArray never free them.
+        // the burst after reconnect is paced, as the queue is not consumed.
         int count = 0;
-        if ((err = queue->dump_packets(msgs.max, msgs.msgs, count)) != srs_success) {
+        int64_t quota = pacer? pacer->quota() : -1;
+        if (quota != 0 && (err = queue->dump_packets(msgs.max, msgs.msgs, count, quota)) != srs_success) {
             return srs_error_wrap(err, "dump packets");
         }
+        if (pacer) {
+            pacer->consume(msgs.msgs, count);
+        }
         
         // pithy print
         if (pprint->can_print()) {
@@ -35,6 +35,7 @@ class ISrsProtocolReadWriter;
 class SrsSharedPtrMessage;
 class SrsOnMetaDataPacket;
 class SrsMessageQueue;
+class SrsPacer;
 class SrsRtmpJitter;
 class SrsRtmpClient;
 class SrsRequest;
@@ -57,6 +58,8 @@ private:
     SrsSimpleRtmpClient* sdk;
     SrsRtmpJitter* jitter;
     SrsMessageQueue* queue;
+    // The pacer of egress, NULL if disabled.
+    SrsPacer* pacer;
     // Cache the sequence header for retry when slave is failed.
     // @see https://github.com/ossrs/srs/issues/150
     SrsSharedPtrMessage* sh_audio;
@@ -51,6 +51,8 @@ using namespace std;
 #include <srs_app_utility.hpp>
 #include <srs_app_http_hooks.hpp>
 #include <srs_protocol_format.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_app_st.hpp>
 #include <openssl/rand.h>
 
 // drop the segment when duration of ts too small.
@@ -62,9 +64,353 @@ using namespace std;
 // reset the piece id when deviation overflow this.
 #define SRS_JUMP_WHEN_PIECE_DEVIATION 20
 
+// The number of latest segments to keep the LL-HLS parts in m3u8.
+#define SRS_HLS_PART_SEGMENTS 3
+
+SrsHlsMemoryFile::SrsHlsMemoryFile()
+{
+    content = NULL;
+    mtime = 0;
+    msn = part = -1;
+}
+
+SrsHlsMemoryFile::~SrsHlsMemoryFile()
+{
+    srs_freep(content);
+}
+
+srs_error_t SrsHlsMemoryFile::create(char* data, int size)
+{
+    srs_error_t err = srs_success;
+    
+    srs_assert(!content);
+    content = new SrsSharedPtrMessage();
+    if ((err = content->create(NULL, data, size)) != srs_success) {
+        srs_freepa(data);
+        return srs_error_wrap(err, "create content");
+    }
+    
+    mtime = srs_get_system_time();
+    
+    // The ETag is generated from the mtime and size, like nginx.
+    char buf[64];
+    snprintf(buf, sizeof(buf), "\"%" PRIx64 "-%x\"", (int64_t)mtime, size);
+    etag = buf;
+    
+    time_t seconds = (time_t)(mtime / SRS_UTIME_SECONDS);
+    struct tm tm;
+    if (gmtime_r(&seconds, &tm) && strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm) > 0) {
+        last_modified = buf;
+    }
+    
+    return err;
+}
+
+SrsHlsMemoryFile* SrsHlsMemoryFile::copy()
+{
+    SrsHlsMemoryFile* file = new SrsHlsMemoryFile();
+    file->content = content->copy();
+    file->mtime = mtime;
+    file->etag = etag;
+    file->last_modified = last_modified;
+    file->msn = msn;
+    file->part = part;
+    return file;
+}
+
+SrsHlsMemoryWaiter::SrsHlsMemoryWaiter()
+{
+    cond = srs_cond_new();
+    nn_waiters = 0;
+}
+
+SrsHlsMemoryWaiter::~SrsHlsMemoryWaiter()
+{
+    srs_cond_destroy(cond);
+}
+
+SrsHlsMemoryStore* _srs_hls_store = new SrsHlsMemoryStore();
+
+SrsHlsMemoryStore::SrsHlsMemoryStore()
+{
+    nb_bytes = 0;
+}
+
+SrsHlsMemoryStore::~SrsHlsMemoryStore()
+{
+    std::map<std::string, SrsHlsMemoryFile*>::iterator it;
+    for (it = files.begin(); it != files.end(); ++it) {
+        SrsHlsMemoryFile* file = it->second;
+        srs_freep(file);
+    }
+    files.clear();
+    
+    std::map<std::string, SrsHlsMemoryWaiter*>::iterator it2;
+    for (it2 = waiters.begin(); it2 != waiters.end(); ++it2) {
+        SrsHlsMemoryWaiter* waiter = it2->second;
+        srs_freep(waiter);
+    }
+    waiters.clear();
+}
+
+srs_error_t SrsHlsMemoryStore::update(string path, char* data, int size)
+{
+    return update(path, data, size, -1, -1);
+}
+
+srs_error_t SrsHlsMemoryStore::update(string path, char* data, int size, int msn, int part)
+{
+    srs_error_t err = srs_success;
+    
+    SrsHlsMemoryFile* file = new SrsHlsMemoryFile();
+    if ((err = file->create(data, size)) != srs_success) {
+        srs_freep(file);
+        return srs_error_wrap(err, "create %s", path.c_str());
+    }
+    file->msn = msn;
+    file->part = part;
+    
+    remove(path);
+    
+    files[path] = file;
+    nb_bytes += size;
+    
+    // Wakeup the coroutines waiting for the file.
+    std::map<std::string, SrsHlsMemoryWaiter*>::iterator it = waiters.find(path);
+    if (it != waiters.end()) {
+        srs_cond_broadcast(it->second->cond);
+    }
+    
+    return err;
+}
+
+void SrsHlsMemoryStore::remove(string path)
+{
+    hints.erase(path);
+    
+    std::map<std::string, SrsHlsMemoryFile*>::iterator it = files.find(path);
+    if (it == files.end()) {
+        return;
+    }
+    
+    SrsHlsMemoryFile* file = it->second;
+    nb_bytes -= file->content->size;
+    files.erase(it);
+    
+    // The content is freed when all connections serving it are done.
+    srs_freep(file);
+}
+
+SrsHlsMemoryFile* SrsHlsMemoryStore::fetch(string path)
+{
+    std::map<std::string, SrsHlsMemoryFile*>::iterator it = files.find(path);
+    if (it == files.end()) {
+        return NULL;
+    }
+    
+    return it->second->copy();
+}
+
+void SrsHlsMemoryStore::hint(string path)
+{
+    if (files.find(path) == files.end()) {
+        hints.insert(path);
+    }
+}
+
+bool SrsHlsMemoryStore::is_hinted(string path)
+{
+    return hints.find(path) != hints.end();
+}
+
+void SrsHlsMemoryStore::wait(string path, srs_utime_t timeout)
+{
+    SrsHlsMemoryWaiter* waiter = NULL;
+    
+    std::map<std::string, SrsHlsMemoryWaiter*>::iterator it = waiters.find(path);
+    if (it != waiters.end()) {
+        waiter = it->second;
+    } else {
+        waiter = waiters[path] = new SrsHlsMemoryWaiter();
+    }
+    
+    waiter->nn_waiters++;
+    srs_cond_timedwait(waiter->cond, timeout);
+    waiter->nn_waiters--;
+    
+    // Free the waiter by the last coroutine.
+    if (waiter->nn_waiters <= 0) {
+        waiters.erase(path);
+        srs_freep(waiter);
+    }
+}
+
+int SrsHlsMemoryStore::size()
+{
+    return (int)files.size();
+}
+
+int64_t SrsHlsMemoryStore::bytes()
+{
+    return nb_bytes;
+}
+
+SrsHlsMemoryWriter::SrsHlsMemoryWriter()
+{
+    opened = false;
+    buf = NULL;
+    nb_buf = 0;
+    capacity = 0;
+}
+
+SrsHlsMemoryWriter::~SrsHlsMemoryWriter()
+{
+    srs_freepa(buf);
+}
+
+srs_error_t SrsHlsMemoryWriter::open(string p)
+{
+    srs_error_t err = srs_success;
+    
+    if (opened) {
+        return srs_error_new(ERROR_SYSTEM_FILE_ALREADY_OPENED, "file %s already opened", filepath.c_str());
+    }
+    
+    filepath = p;
+    opened = true;
+    nb_buf = 0;
+    
+    return err;
+}
+
+srs_error_t SrsHlsMemoryWriter::open_append(string p)
+{
+    srs_error_t err = srs_success;
+    
+    if (opened) {
+        return srs_error_new(ERROR_SYSTEM_FILE_ALREADY_OPENED, "file %s already opened", filepath.c_str());
+    }
+    
+    filepath = p;
+    opened = true;
+    
+    return err;
+}
+
+void SrsHlsMemoryWriter::close()
+{
+    opened = false;
+}
+
+void SrsHlsMemoryWriter::detach(char** pdata, int* psize)
+{
+    *pdata = buf;
+    *psize = nb_buf;
+    
+    buf = NULL;
+    nb_buf = capacity = 0;
+}
+
+char* SrsHlsMemoryWriter::data()
+{
+    return buf;
+}
+
+bool SrsHlsMemoryWriter::is_open()
+{
+    return opened;
+}
+
+void SrsHlsMemoryWriter::seek2(int64_t offset)
+{
+    // The memory writer is append only, for ts never seek.
+    srs_assert(offset == nb_buf);
+}
+
+int64_t SrsHlsMemoryWriter::tellg()
+{
+    return nb_buf;
+}
+
+srs_error_t SrsHlsMemoryWriter::write(void* data, size_t count, ssize_t* pnwrite)
+{
+    srs_error_t err = srs_success;
+    
+    // Grow the buffer by double, the ts segment is about 1MB for 1Mbps 10s.
+    if (nb_buf + (int)count > capacity) {
+        int nb_capacity = srs_max(srs_max(capacity * 2, 64 * 1024), nb_buf + (int)count);
+        char* p = new char[nb_capacity];
+        if (nb_buf > 0) {
+            memcpy(p, buf, nb_buf);
+        }
+        srs_freepa(buf);
+        buf = p;
+        capacity = nb_capacity;
+    }
+    
+    memcpy(buf + nb_buf, data, count);
+    nb_buf += (int)count;
+    
+    if (pnwrite) {
+        *pnwrite = count;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHlsMemoryWriter::writev(const iovec* iov, int iovcnt, ssize_t* pnwrite)
+{
+    srs_error_t err = srs_success;
+    
+    ssize_t nwrite = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        const iovec* piov = iov + i;
+        if ((err = write(piov->iov_base, piov->iov_len, NULL)) != srs_success) {
+            return srs_error_wrap(err, "write");
+        }
+        nwrite += piov->iov_len;
+    }
+    
+    if (pnwrite) {
+        *pnwrite = nwrite;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHlsMemoryWriter::lseek(off_t offset, int whence, off_t* seeked)
+{
+    off_t pos = offset;
+    if (whence == SEEK_CUR || whence == SEEK_END) {
+        pos += nb_buf;
+    }
+    
+    // The memory writer is append only, for ts never seek.
+    if (pos != nb_buf) {
+        return srs_error_new(ERROR_SYSTEM_FILE_SEEK, "seek %d in %d", (int)pos, nb_buf);
+    }
+    
+    if (seeked) {
+        *seeked = pos;
+    }
+    
+    return srs_success;
+}
+
+SrsHlsPart::SrsHlsPart()
+{
+    duration = 0;
+    independent = false;
+}
+
+SrsHlsPart::~SrsHlsPart()
+{
+}
+
 SrsHlsSegment::SrsHlsSegment(SrsTsContext* c, SrsAudioCodecId ac, SrsVideoCodecId vc, SrsFileWriter* w)
 {
     sequence_no = 0;
+    memory = false;
     writer = w;
     tscw = new SrsTsContextWriter(writer, c, ac, vc);
 }
@@ -72,6 +418,13 @@ SrsHlsSegment::SrsHlsSegment(SrsTsContext* c, SrsAudioCodecId ac, SrsVideoCodecI
 SrsHlsSegment::~SrsHlsSegment()
 {
     srs_freep(tscw);
+    
+    // The memory segment is expired when freed, whatever cleanup or not.
+    if (memory) {
+        _srs_hls_store->remove(fullpath());
+    }
+    
+    clear_parts();
 }
 
 void SrsHlsSegment::config_cipher(unsigned char* key,unsigned char* iv)
@@ -82,6 +435,124 @@ void SrsHlsSegment::config_cipher(unsigned char* key,unsigned char* iv)
     fw->config_cipher(key, iv);
 }
 
+// Generate the part name from segment name, for example, livestream-3.ts to livestream-3.0.ts
+string srs_hls_part_name(string name, int index)
+{
+    name = srs_string_replace(name, "[duration]", "part");
+    
+    size_t pos = name.rfind(".");
+    if (pos == string::npos || name.find("/", pos) != string::npos) {
+        return name + "." + srs_int2str(index);
+    }
+    return name.substr(0, pos) + "." + srs_int2str(index) + name.substr(pos);
+}
+
+string SrsHlsSegment::part_uri(int index)
+{
+    return srs_hls_part_name(uri, index);
+}
+
+string SrsHlsSegment::part_path(int index)
+{
+    return srs_hls_part_name(fullpath(), index);
+}
+
+void SrsHlsSegment::clear_parts()
+{
+    std::vector<SrsHlsPart*>::iterator it;
+    for (it = parts.begin(); it != parts.end(); ++it) {
+        SrsHlsPart* part = *it;
+        _srs_hls_store->remove(part->path);
+        srs_freep(part);
+    }
+    parts.clear();
+    
+    if (!hint.empty()) {
+        _srs_hls_store->remove(hint);
+        hint = "";
+    }
+}
+
+srs_error_t SrsHlsSegment::unlink_file()
+{
+    if (memory) {
+        _srs_hls_store->remove(fullpath());
+        
+        // For hls_storage both, the file is also persisted to disk, ignore any error.
+        srs_error_t err = SrsFragment::unlink_file();
+        srs_freep(err);
+        return srs_success;
+    }
+    
+    return SrsFragment::unlink_file();
+}
+
+srs_error_t SrsHlsSegment::unlink_tmpfile()
+{
+    // The memory segment never writes the tmp file.
+    if (memory) {
+        return srs_success;
+    }
+    
+    return SrsFragment::unlink_tmpfile();
+}
+
+srs_error_t SrsHlsSegment::rename()
+{
+    if (!memory) {
+        return SrsFragment::rename();
+    }
+    
+    // Only update the final path, the data is stored by muxer.
+    std::stringstream ss;
+    ss << srsu2msi(duration());
+    set_path(srs_string_replace(fullpath(), "[duration]", ss.str()));
+    
+    return srs_success;
+}
+
+SrsHlsAsyncCallPersist::SrsHlsAsyncCallPersist(string p, SrsHlsMemoryFile* f)
+{
+    path = p;
+    file = f;
+}
+
+SrsHlsAsyncCallPersist::~SrsHlsAsyncCallPersist()
+{
+    srs_freep(file);
+}
+
+srs_error_t SrsHlsAsyncCallPersist::call()
+{
+    srs_error_t err = srs_success;
+    
+    // Write to the temp file then rename, so the reader never got a partial file.
+    std::string tmp_file = path + ".tmp";
+    
+    SrsFileWriter fw;
+    if ((err = fw.open(tmp_file)) != srs_success) {
+        return srs_error_wrap(err, "open %s", tmp_file.c_str());
+    }
+    
+    err = fw.write(file->content->payload, file->content->size, NULL);
+    fw.close();
+    
+    if (err != srs_success) {
+        return srs_error_wrap(err, "write %s", tmp_file.c_str());
+    }
+    
+    if (::rename(tmp_file.c_str(), path.c_str()) < 0) {
+        return srs_error_new(ERROR_HLS_WRITE_FAILED, "rename %s to %s", tmp_file.c_str(), path.c_str());
+    }
+    
+    return err;
+}
+
+string SrsHlsAsyncCallPersist::to_string()
+{
+    return "persist: " + path;
+}
+
 SrsDvrAsyncCallOnHls::SrsDvrAsyncCallOnHls(int c, SrsRequest* r, string p, string t, string m, string mu, int s, srs_utime_t d)
 {
     req = r->copy();
@@ -204,6 +675,12 @@ SrsHlsMuxer::SrsHlsMuxer()
     current = NULL;
     hls_keys = false;
     hls_fragments_per_key = 0;
+    hls_storage = "disk";
+    hls_part = 0;
+    part_offset = 0;
+    part_start_dts = -1;
+    part_independent = false;
+    writer = NULL;
     async = new SrsAsyncCallWorker();
     context = new SrsTsContext();
     segments = new SrsFragmentWindow();
@@ -215,10 +692,15 @@ SrsHlsMuxer::SrsHlsMuxer()
 SrsHlsMuxer::~SrsHlsMuxer()
 {
     srs_freep(current);
+    srs_freep(segments);
     srs_freep(req);
     srs_freep(async);
     srs_freep(context);
     srs_freep(writer);
+    
+    if (hls_storage != "disk") {
+        _srs_hls_store->remove(m3u8);
+    }
 }
 
 void SrsHlsMuxer::dispose()
@@ -235,7 +717,11 @@ void SrsHlsMuxer::dispose()
         srs_freep(current);
     }
     
-    if (unlink(m3u8.c_str()) < 0) {
+    if (hls_storage != "disk") {
+        _srs_hls_store->remove(m3u8);
+    }
+    
+    if (hls_storage != "ram" && unlink(m3u8.c_str()) < 0) {
         srs_warn("dispose unlink path failed. file=%s", m3u8.c_str());
     }
     
@@ -317,6 +803,18 @@ srs_error_t SrsHlsMuxer::update_config(SrsRequest* r, string entry_prefix,
     hls_key_file = key_file;
     hls_key_file_path = key_file_path;
     hls_key_url = key_url;
+    
+    hls_storage = _srs_config->get_hls_storage(r->vhost);
+    if (hls_storage != "disk" && hls_keys) {
+        srs_warn("hls: ignore hls_storage %s for hls_keys, use disk", hls_storage.c_str());
+        hls_storage = "disk";
+    }
+    
+    hls_part = _srs_config->get_hls_part(r->vhost);
+    if (hls_part > 0 && hls_storage == "disk") {
+        srs_warn("hls: ignore hls_part for hls_storage disk");
+        hls_part = 0;
+    }
    
     // generate the m3u8 dir and path.
     m3u8_url = srs_path_build_stream(m3u8_file, req->vhost, req->app, req->stream);
@@ -340,8 +838,11 @@ srs_error_t SrsHlsMuxer::update_config(SrsRequest* r, string entry_prefix,
         }
     }
 
+    srs_freep(writer);
     if(hls_keys) {
         writer = new SrsEncFileWriter();
+    } else if (hls_storage != "disk") {
+        writer = new SrsHlsMemoryWriter();
     } else {
         writer = new SrsFileWriter();
     }
@@ -392,6 +893,7 @@ srs_error_t SrsHlsMuxer::segment_open()
     // new segment.
     current = new SrsHlsSegment(context, default_acodec, default_vcodec, writer);
     current->sequence_no = _sequence_no++;
+    current->memory = (hls_storage != "disk");
 
     if ((err = write_hls_key()) != srs_success) {
         return srs_error_wrap(err, "write hls key");
@@ -477,6 +979,16 @@ srs_error_t SrsHlsMuxer::segment_open()
     // reset the context for a new ts start.
     context->reset();
     
+    // the segment always starts a new part, with keyframe.
+    part_offset = 0;
+    part_start_dts = -1;
+    part_independent = true;
+    
+    // update the m3u8 to hint the first part of segment.
+    if (hls_part > 0 && (err = refresh_m3u8()) != srs_success) {
+        return srs_error_wrap(err, "hls: refresh m3u8");
+    }
+    
     return err;
 }
 
@@ -549,6 +1061,10 @@ srs_error_t SrsHlsMuxer::flush_audio(SrsTsMessageCache* cache)
     // update the duration of segment.
     current->append(cache->audio->pts / 90);
     
+    if (part_start_dts < 0) {
+        part_start_dts = cache->audio->pts / 90;
+    }
+    
     if ((err = current->tscw->write_audio(cache->audio)) != srs_success) {
         return srs_error_wrap(err, "hls: write audio");
     }
@@ -578,6 +1094,10 @@ srs_error_t SrsHlsMuxer::flush_video(SrsTsMessageCache* cache)
     // update the duration of segment.
     current->append(cache->video->dts / 90);
     
+    if (part_start_dts < 0) {
+        part_start_dts = cache->video->dts / 90;
+    }
+    
     if ((err = current->tscw->write_video(cache->video)) != srs_success) {
         return srs_error_wrap(err, "hls: write video");
     }
@@ -588,6 +1108,67 @@ srs_error_t SrsHlsMuxer::flush_video(SrsTsMessageCache* cache)
     return err;
 }
 
+srs_error_t SrsHlsMuxer::reap_part(int64_t dts, bool keyframe)
+{
+    srs_error_t err = srs_success;
+    
+    if (hls_part <= 0 || !current) {
+        return err;
+    }
+    
+    // ignore the empty part.
+    if (part_start_dts < 0 || current->writer->tellg() <= part_offset) {
+        return err;
+    }
+    
+    srs_utime_t duration = (dts - part_start_dts) * SRS_UTIME_MILLISECONDS;
+    if (duration <= 0 || (!keyframe && duration < hls_part)) {
+        return err;
+    }
+    
+    if ((err = do_reap_part(duration)) != srs_success) {
+        return srs_error_wrap(err, "reap part");
+    }
+    
+    // the next part starts with the frame.
+    part_independent = keyframe || pure_audio();
+    
+    if ((err = refresh_m3u8()) != srs_success) {
+        return srs_error_wrap(err, "hls: refresh m3u8");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHlsMuxer::do_reap_part(srs_utime_t duration)
+{
+    srs_error_t err = srs_success;
+    
+    SrsHlsMemoryWriter* mw = dynamic_cast<SrsHlsMemoryWriter*>(current->writer);
+    srs_assert(mw);
+    
+    int size = (int)(mw->tellg() - part_offset);
+    char* data = new char[size];
+    memcpy(data, mw->data() + part_offset, size);
+    
+    SrsHlsPart* part = new SrsHlsPart();
+    part->uri = current->part_uri((int)current->parts.size());
+    part->path = current->part_path((int)current->parts.size());
+    part->duration = duration;
+    part->independent = part_independent;
+    current->parts.push_back(part);
+    
+    // the parts are always in memory, never persist.
+    if ((err = _srs_hls_store->update(part->path, data, size)) != srs_success) {
+        return srs_error_wrap(err, "store part %s", part->path.c_str());
+    }
+    
+    part_offset = mw->tellg();
+    part_start_dts = -1;
+    
+    return err;
+}
+
 srs_error_t SrsHlsMuxer::segment_close()
 {
     srs_error_t err = do_segment_close();
@@ -633,6 +1214,18 @@ srs_error_t SrsHlsMuxer::do_segment_close()
             return srs_error_wrap(err, "segment close");
         }
         
+        // reap the last part of segment, before the path is renamed.
+        if (hls_part > 0 && current->writer->tellg() > part_offset) {
+            srs_utime_t duration = current->duration();
+            for (int i = 0; i < (int)current->parts.size(); i++) {
+                duration -= current->parts.at(i)->duration;
+            }
+            
+            if ((err = do_reap_part(srs_max(0, duration))) != srs_success) {
+                return srs_error_wrap(err, "reap part");
+            }
+        }
+        
         // close the muxer of finished segment.
         srs_freep(current->tscw);
         
@@ -641,8 +1234,26 @@ srs_error_t SrsHlsMuxer::do_segment_close()
             return srs_error_wrap(err, "rename");
         }
         
+        // move the data of segment to memory store.
+        if (current->memory) {
+            char* data = NULL;
+            int size = 0;
+            SrsHlsMemoryWriter* mw = dynamic_cast<SrsHlsMemoryWriter*>(current->writer);
+            mw->detach(&data, &size);
+            
+            if ((err = store_file(current->fullpath(), data, size, -1, -1)) != srs_success) {
+                return srs_error_wrap(err, "store segment");
+            }
+        }
+        
         segments->append(current);
         current = NULL;
+        
+        // only keep the parts of latest segments.
+        if (segments->size() > SRS_HLS_PART_SEGMENTS) {
+            SrsHlsSegment* segment = dynamic_cast<SrsHlsSegment*>(segments->at(segments->size() - 1 - SRS_HLS_PART_SEGMENTS));
+            segment->clear_parts();
+        }
     } else {
         // reuse current segment index.
         _sequence_no--;
@@ -650,6 +1261,9 @@ srs_error_t SrsHlsMuxer::do_segment_close()
         srs_trace("Drop ts segment, sequence_no=%d, uri=%s, duration=%dms",
             current->sequence_no, current->uri.c_str(), srsu2msi(current->duration()));
         
+        // the parts of dropped segment are never available.
+        current->clear_parts();
+        
         // rename from tmp to real path
         if ((err = current->unlink_tmpfile()) != srs_success) {
             return srs_error_wrap(err, "rename");
@@ -714,15 +1328,48 @@ srs_error_t SrsHlsMuxer::refresh_m3u8()
     srs_error_t err = srs_success;
     
     // no segments, also no m3u8, return.
-    if (segments->empty()) {
+    if (segments->empty() && (hls_part <= 0 || !current || current->parts.empty())) {
         return err;
     }
     
+    std::string content;
+    if ((err = _refresh_m3u8(content)) != srs_success) {
+        return srs_error_wrap(err, "hls: generate m3u8");
+    }
+    
+    // For LL-HLS, the next part to publish, to hint and hold the blocking request.
+    int msn = -1, part = -1;
+    if (hls_part > 0) {
+        msn = current? current->sequence_no : _sequence_no;
+        part = current? (int)current->parts.size() : 0;
+        
+        if (current) {
+            current->hint = current->part_path(part);
+            _srs_hls_store->hint(current->hint);
+        }
+    }
+    
+    // For memory store, the m3u8 is updated atomically.
+    if (hls_storage != "disk") {
+        char* data = new char[content.length()];
+        memcpy(data, content.data(), content.length());
+        return store_file(m3u8, data, (int)content.length(), msn, part);
+    }
+    
     std::string temp_m3u8 = m3u8 + ".temp";
-    if ((err = _refresh_m3u8(temp_m3u8)) == srs_success) {
-        if (rename(temp_m3u8.c_str(), m3u8.c_str()) < 0) {
-            err = srs_error_new(ERROR_HLS_WRITE_FAILED, "hls: rename m3u8 file failed. %s => %s", temp_m3u8.c_str(), m3u8.c_str());
+    if (true) {
+        SrsFileWriter writer;
+        if ((err = writer.open(temp_m3u8)) != srs_success) {
+            return srs_error_wrap(err, "hls: open m3u8 file %s", temp_m3u8.c_str());
         }
+        
+        err = writer.write((char*)content.data(), (int)content.length(), NULL);
+    }
+    
+    if (err != srs_success) {
+        err = srs_error_wrap(err, "hls: write m3u8");
+    } else if (rename(temp_m3u8.c_str(), m3u8.c_str()) < 0) {
+        err = srs_error_new(ERROR_HLS_WRITE_FAILED, "hls: rename m3u8 file failed. %s => %s", temp_m3u8.c_str(), m3u8.c_str());
     }
     
     // remove the temp file.
@@ -735,28 +1382,58 @@ srs_error_t SrsHlsMuxer::refresh_m3u8()
     return err;
 }
 
-srs_error_t SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
+void SrsHlsMuxer::write_parts(std::stringstream& ss, SrsHlsSegment* segment)
+{
+    ss.precision(3);
+    ss.setf(std::ios::fixed, std::ios::floatfield);
+    
+    // #EXT-X-PART:DURATION=0.500,URI="livestream-3.0.ts",INDEPENDENT=YES\n
+    for (int i = 0; i < (int)segment->parts.size(); i++) {
+        SrsHlsPart* part = segment->parts.at(i);
+        ss << "#EXT-X-PART:DURATION=" << srsu2msi(part->duration) / 1000.0 << ",URI=\"" << part->uri << "\"";
+        if (part->independent) {
+            ss << ",INDEPENDENT=YES";
+        }
+        ss << SRS_CONSTS_LF;
+    }
+}
+
+srs_error_t SrsHlsMuxer::store_file(string path, char* data, int size, int msn, int part)
 {
     srs_error_t err = srs_success;
     
-    // no segments, return.
-    if (segments->empty()) {
-        return err;
+    if ((err = _srs_hls_store->update(path, data, size, msn, part)) != srs_success) {
+        return srs_error_wrap(err, "update %s", path.c_str());
     }
     
-    SrsFileWriter writer;
-    if ((err = writer.open(m3u8_file)) != srs_success) {
-        return srs_error_wrap(err, "hls: open m3u8 file %s", m3u8_file.c_str());
+    // For hls_storage both, persist to disk in order, so the ts is always ready before m3u8.
+    if (hls_storage == "both") {
+        SrsHlsMemoryFile* file = _srs_hls_store->fetch(path);
+        if ((err = async->execute(new SrsHlsAsyncCallPersist(path, file))) != srs_success) {
+            return srs_error_wrap(err, "persist %s", path.c_str());
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHlsMuxer::_refresh_m3u8(string& content)
+{
+    srs_error_t err = srs_success;
+    
+    // no segments, return.
+    if (segments->empty() && (hls_part <= 0 || !current)) {
+        return err;
     }
     
     // #EXTM3U\n
     // #EXT-X-VERSION:3\n
     std::stringstream ss;
     ss << "#EXTM3U" << SRS_CONSTS_LF;
-    ss << "#EXT-X-VERSION:3" << SRS_CONSTS_LF;
+    ss << "#EXT-X-VERSION:" << (hls_part > 0? 6 : 3) << SRS_CONSTS_LF;
     
     // #EXT-X-MEDIA-SEQUENCE:4294967295\n
-    SrsHlsSegment* first = dynamic_cast<SrsHlsSegment*>(segments->first());
+    SrsHlsSegment* first = segments->empty()? current : dynamic_cast<SrsHlsSegment*>(segments->first());
     ss << "#EXT-X-MEDIA-SEQUENCE:" << first->sequence_no << SRS_CONSTS_LF;
     
     // iterator shared for td generation and segemnts wrote.
@@ -777,6 +1454,15 @@ srs_error_t SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
     
     ss << "#EXT-X-TARGETDURATION:" << target_duration << SRS_CONSTS_LF;
     
+    // #EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=1.500\n
+    // #EXT-X-PART-INF:PART-TARGET=0.500\n
+    if (hls_part > 0) {
+        ss.precision(3);
+        ss.setf(std::ios::fixed, std::ios::floatfield);
+        ss << "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=" << 3 * srsu2msi(hls_part) / 1000.0 << SRS_CONSTS_LF;
+        ss << "#EXT-X-PART-INF:PART-TARGET=" << srsu2msi(hls_part) / 1000.0 << SRS_CONSTS_LF;
+    }
+    
     // write all segments
     for (int i = 0; i < segments->size(); i++) {
         SrsHlsSegment* segment = dynamic_cast<SrsHlsSegment*>(segments->at(i));
@@ -803,6 +1489,11 @@ srs_error_t SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
             ss << "#EXT-X-KEY:METHOD=AES-128,URI=" << "\"" << key_path << "\",IV=0x" << hexiv << SRS_CONSTS_LF;
         }
         
+        // the parts of latest segments.
+        if (hls_part > 0 && i >= segments->size() - SRS_HLS_PART_SEGMENTS) {
+            write_parts(ss, segment);
+        }
+        
         // "#EXTINF:4294967295.208,\n"
         ss.precision(3);
         ss.setf(std::ios::fixed, std::ios::floatfield);
@@ -819,12 +1510,20 @@ srs_error_t SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
         ss << seg_uri << SRS_CONSTS_LF;
     }
     
-    // write m3u8 to writer.
-    std::string m3u8 = ss.str();
-    if ((err = writer.write((char*)m3u8.c_str(), (int)m3u8.length(), NULL)) != srs_success) {
-        return srs_error_wrap(err, "hls: write m3u8");
+    // the parts of current segment, and hint the next part.
+    if (hls_part > 0 && current) {
+        if (current->is_sequence_header()) {
+            ss << "#EXT-X-DISCONTINUITY" << SRS_CONSTS_LF;
+        }
+        
+        write_parts(ss, current);
+        
+        // #EXT-X-PRELOAD-HINT:TYPE=PART,URI="livestream-3.2.ts"\n
+        ss << "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"" << current->part_uri((int)current->parts.size()) << "\"" << SRS_CONSTS_LF;
     }
     
+    content = ss.str();
+    
     return err;
 }
 
@@ -994,6 +1693,11 @@ srs_error_t SrsHlsController::write_audio(SrsAudioFrame* frame, int64_t pts)
         }
     }
     
+    // for LL-HLS, reap the part before the audio.
+    if (tsmc->audio && (err = muxer->reap_part(tsmc->audio->pts / 90, false)) != srs_success) {
+        return srs_error_wrap(err, "hls: reap part");
+    }
+    
     // directly write the audio frame by frame to ts,
     // it's ok for the hls overload, or maybe cause the audio corrupt,
     // which introduced by aggregate the audios to a big one.
@@ -1027,6 +1731,11 @@ srs_error_t SrsHlsController::write_video(SrsVideoFrame* frame, int64_t dts)
         }
     }
     
+    // for LL-HLS, reap the part before the video, always start part with keyframe.
+    if ((err = muxer->reap_part(dts / 90, frame->frame_type == SrsVideoAvcFrameTypeKeyFrame)) != srs_success) {
+        return srs_error_wrap(err, "hls: reap part");
+    }
+    
     // flush video when got one
     if ((err = muxer->flush_video(tsmc)) != srs_success) {
         return srs_error_wrap(err, "hls: flush video");
@@ -1178,6 +1887,12 @@ srs_error_t SrsHls::on_publish()
         return err;
     }
     
+    // The FMP4 hls is generated by DASH muxer, @see SrsFmp4M3u8Writer
+    if (_srs_config->get_hls_fmp4(req->vhost)) {
+        srs_trace("hls: use fmp4 of dash for %s", req->get_stream_url().c_str());
+        return err;
+    }
+    
     if ((err = controller->on_publish(req)) != srs_success) {
         return srs_error_wrap(err, "hls: on publish");
     }
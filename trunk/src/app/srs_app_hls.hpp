@@ -28,6 +28,9 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <set>
+#include <sstream>
 
 #include <srs_kernel_codec.hpp>
 #include <srs_kernel_file.hpp>
@@ -50,6 +53,130 @@ class SrsTsMessageCache;
 class SrsHlsSegment;
 class SrsTsContext;
 
+// The HLS file in memory, such as ts or m3u8, for hls_storage ram or both.
+// @remark The content is shared by the store and the http connections serving it,
+//      so an expired segment is still safe to be served by the connections.
+class SrsHlsMemoryFile
+{
+public:
+    // The shared content of file.
+    SrsSharedPtrMessage* content;
+    // The time when file is updated, in srs_utime_t.
+    srs_utime_t mtime;
+    // The http ETag and Last-Modified of file.
+    std::string etag;
+    std::string last_modified;
+    // For LL-HLS m3u8, the next part to publish, which is the part index in segment of msn.
+    // @remark The segment msn-1 is complete, -1 if not LL-HLS.
+    int msn;
+    int part;
+public:
+    SrsHlsMemoryFile();
+    virtual ~SrsHlsMemoryFile();
+public:
+    // Create the file, which attach the data, user should never use or free it.
+    // @remark The data must be allocated by new char[].
+    virtual srs_error_t create(char* data, int size);
+    // Copy the file, which shares the content.
+    virtual SrsHlsMemoryFile* copy();
+};
+
+// The coroutines waiting for a file in memory store, for LL-HLS blocking request.
+class SrsHlsMemoryWaiter
+{
+public:
+    srs_cond_t cond;
+    int nn_waiters;
+public:
+    SrsHlsMemoryWaiter();
+    virtual ~SrsHlsMemoryWaiter();
+};
+
+// The store of HLS files in memory, keyed by the full path of file, which is the same
+// path as on disk, so the http static server could serve it by the path of request.
+class SrsHlsMemoryStore
+{
+private:
+    std::map<std::string, SrsHlsMemoryFile*> files;
+    // The total bytes of files in store.
+    int64_t nb_bytes;
+    // The files which will be available soon, for LL-HLS EXT-X-PRELOAD-HINT.
+    std::set<std::string> hints;
+    // The coroutines waiting for files to update, for LL-HLS blocking request.
+    std::map<std::string, SrsHlsMemoryWaiter*> waiters;
+public:
+    SrsHlsMemoryStore();
+    virtual ~SrsHlsMemoryStore();
+public:
+    // Update the file of path, which attach the data, user should never use or free it.
+    virtual srs_error_t update(std::string path, char* data, int size);
+    // Update the LL-HLS m3u8 of path, with the next part to publish.
+    virtual srs_error_t update(std::string path, char* data, int size, int msn, int part);
+    // Remove the file or hint of path, ignore if not exists.
+    virtual void remove(std::string path);
+    // Hint the file of path, which will be available soon.
+    virtual void hint(std::string path);
+    virtual bool is_hinted(std::string path);
+    // Wait for the file of path to update, or timeout.
+    virtual void wait(std::string path, srs_utime_t timeout);
+    // Fetch a copy of file of path, user must free it.
+    // @return NULL if not exists.
+    virtual SrsHlsMemoryFile* fetch(std::string path);
+public:
+    virtual int size();
+    virtual int64_t bytes();
+};
+
+// The global HLS memory store.
+extern SrsHlsMemoryStore* _srs_hls_store;
+
+// The writer to write ts segment to memory, for hls_storage ram or both.
+class SrsHlsMemoryWriter : public SrsFileWriter
+{
+private:
+    std::string filepath;
+    bool opened;
+    char* buf;
+    int nb_buf;
+    int capacity;
+public:
+    SrsHlsMemoryWriter();
+    virtual ~SrsHlsMemoryWriter();
+public:
+    virtual srs_error_t open(std::string p);
+    virtual srs_error_t open_append(std::string p);
+    virtual void close();
+    // Detach the written data, user must free it by delete[].
+    virtual void detach(char** pdata, int* psize);
+    // Get the written data, which is valid before next write.
+    virtual char* data();
+public:
+    virtual bool is_open();
+    virtual void seek2(int64_t offset);
+    virtual int64_t tellg();
+// Interface ISrsWriteSeeker
+public:
+    virtual srs_error_t write(void* buf, size_t count, ssize_t* pnwrite);
+    virtual srs_error_t writev(const iovec* iov, int iovcnt, ssize_t* pnwrite);
+    virtual srs_error_t lseek(off_t offset, int whence, off_t* seeked);
+};
+
+// The partial segment of LL-HLS, see EXT-X-PART.
+class SrsHlsPart
+{
+public:
+    // The part uri in m3u8.
+    std::string uri;
+    // The full path of part in memory store.
+    std::string path;
+    srs_utime_t duration;
+    // Whether the part starts with a keyframe.
+    bool independent;
+public:
+    SrsHlsPart();
+    virtual ~SrsHlsPart();
+};
+
 // The wrapper of m3u8 segment from specification:
 //
 // 3.3.2.  EXTINF
@@ -69,11 +196,40 @@ public:
     unsigned char iv[16];
     // The full key path.
     std::string keypath;
+    // Whether the segment is stored in memory, never write the tmp file.
+    bool memory;
+    // The LL-HLS parts of segment, and the hinted next part.
+    std::vector<SrsHlsPart*> parts;
+    std::string hint;
 public:
     SrsHlsSegment(SrsTsContext* c, SrsAudioCodecId ac, SrsVideoCodecId vc, SrsFileWriter* w);
     virtual ~SrsHlsSegment();
 public:
     void config_cipher(unsigned char* key,unsigned char* iv);
+    // Get the uri and path of part by index.
+    virtual std::string part_uri(int index);
+    virtual std::string part_path(int index);
+    // Remove the parts from memory store.
+    virtual void clear_parts();
+// Interface SrsFragment
+public:
+    virtual srs_error_t unlink_file();
+    virtual srs_error_t unlink_tmpfile();
+    virtual srs_error_t rename();
+};
+
+// The hls async call: persist the memory file to disk, for hls_storage both.
+class SrsHlsAsyncCallPersist : public ISrsAsyncCallTask
+{
+private:
+    std::string path;
+    SrsHlsMemoryFile* file;
+public:
+    SrsHlsAsyncCallPersist(std::string p, SrsHlsMemoryFile* f);
+    virtual ~SrsHlsAsyncCallPersist();
+public:
+    virtual srs_error_t call();
+    virtual std::string to_string();
 };
 
 // The hls async call: on_hls
@@ -134,6 +290,15 @@ private:
     srs_utime_t hls_fragment;
     srs_utime_t hls_window;
     SrsAsyncCallWorker* async;
+    // The storage of hls, disk, ram or both.
+    std::string hls_storage;
+    // The LL-HLS part target duration, 0 to disable.
+    srs_utime_t hls_part;
+    // The current part, the start offset in segment, the start dts in ms,
+    // and whether start with keyframe.
+    int64_t part_offset;
+    int64_t part_start_dts;
+    bool part_independent;
 private:
     // Whether use floor algorithm for timestamp.
     bool hls_ts_floor;
@@ -211,13 +376,20 @@ public:
     virtual bool pure_audio();
     virtual srs_error_t flush_audio(SrsTsMessageCache* cache);
     virtual srs_error_t flush_video(SrsTsMessageCache* cache);
+    // For LL-HLS, reap the part before the frame of dts in ms, when got keyframe or part overflow.
+    virtual srs_error_t reap_part(int64_t dts, bool keyframe);
     // Close segment(ts).
     virtual srs_error_t segment_close();
 private:
     virtual srs_error_t do_segment_close();
+    virtual srs_error_t do_reap_part(srs_utime_t duration);
     virtual srs_error_t write_hls_key();
     virtual srs_error_t refresh_m3u8();
-    virtual srs_error_t _refresh_m3u8(std::string m3u8_file);
+    virtual srs_error_t _refresh_m3u8(std::string& content);
+    virtual void write_parts(std::stringstream& ss, SrsHlsSegment* segment);
+    // Write the file to memory store, and persist to disk async for hls_storage both.
+    // @param msn, part The next LL-HLS part for m3u8, -1 for others.
+    virtual srs_error_t store_file(std::string path, char* data, int size, int msn, int part);
 };
 
 // The hls stream cache,
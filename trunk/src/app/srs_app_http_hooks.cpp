@@ -48,6 +48,301 @@ using namespace std;
 // the timeout for hls notify, in srs_utime_t.
 #define SRS_HLS_NOTIFY_TIMEOUT (10 * SRS_UTIME_SECONDS)
 
+// The max idle clients of each hook server.
+#define SRS_HTTP_HOOK_POOL_MAX 8
+// The interval to post the batch of notify hooks, in srs_utime_t.
+#define SRS_HTTP_HOOK_BATCH_INTERVAL (1 * SRS_UTIME_SECONDS)
+// The max events in the batch, drop the event when overflow.
+#define SRS_HTTP_HOOK_BATCH_MAX 4096
+// The timeout to wait for the auth hook in flight, in srs_utime_t.
+#define SRS_HTTP_HOOK_CACHE_TIMEOUT (30 * SRS_UTIME_SECONDS)
+
+SrsHttpHookPool::SrsHttpHookPool()
+{
+}
+
+SrsHttpHookPool::~SrsHttpHookPool()
+{
+    std::map<std::string, std::vector<SrsHttpClient*> >::iterator it;
+    for (it = clients.begin(); it != clients.end(); ++it) {
+        std::vector<SrsHttpClient*>& hcs = it->second;
+        for (int i = 0; i < (int)hcs.size(); i++) {
+            SrsHttpClient* hc = hcs.at(i);
+            srs_freep(hc);
+        }
+    }
+    clients.clear();
+}
+
+srs_error_t SrsHttpHookPool::fetch(string host, int port, SrsHttpClient** pclient, bool& reused)
+{
+    srs_error_t err = srs_success;
+    
+    std::vector<SrsHttpClient*>& hcs = clients[host + ":" + srs_int2str(port)];
+    if (!hcs.empty()) {
+        *pclient = hcs.back();
+        hcs.pop_back();
+        reused = true;
+        return err;
+    }
+    
+    reused = false;
+    return create(host, port, pclient);
+}
+
+srs_error_t SrsHttpHookPool::create(string host, int port, SrsHttpClient** pclient)
+{
+    srs_error_t err = srs_success;
+    
+    SrsHttpClient* hc = new SrsHttpClient();
+    if ((err = hc->initialize(host, port)) != srs_success) {
+        srs_freep(hc);
+        return srs_error_wrap(err, "http: init client for %s:%d", host.c_str(), port);
+    }
+    
+    *pclient = hc;
+    
+    return err;
+}
+
+void SrsHttpHookPool::release(string host, int port, SrsHttpClient* client)
+{
+    std::vector<SrsHttpClient*>& hcs = clients[host + ":" + srs_int2str(port)];
+    if ((int)hcs.size() >= SRS_HTTP_HOOK_POOL_MAX) {
+        srs_freep(client);
+        return;
+    }
+    
+    hcs.push_back(client);
+}
+
+int SrsHttpHookPool::size(string host, int port)
+{
+    std::map<std::string, std::vector<SrsHttpClient*> >::iterator it = clients.find(host + ":" + srs_int2str(port));
+    if (it == clients.end()) {
+        return 0;
+    }
+    return (int)it->second.size();
+}
+
+SrsHttpHookResult::SrsHttpHookResult()
+{
+    pending = false;
+    nn_waiters = 0;
+    cond = srs_cond_new();
+    expire = 0;
+    err = srs_success;
+}
+
+SrsHttpHookResult::~SrsHttpHookResult()
+{
+    srs_cond_destroy(cond);
+    srs_freep(err);
+}
+
+SrsHttpHookCache::SrsHttpHookCache()
+{
+}
+
+SrsHttpHookCache::~SrsHttpHookCache()
+{
+    std::map<std::string, SrsHttpHookResult*>::iterator it;
+    for (it = results.begin(); it != results.end(); ++it) {
+        SrsHttpHookResult* result = it->second;
+        srs_freep(result);
+    }
+    results.clear();
+}
+
+bool SrsHttpHookCache::fetch(string key, srs_error_t* perr)
+{
+    std::map<std::string, SrsHttpHookResult*>::iterator it = results.find(key);
+    if (it == results.end()) {
+        return false;
+    }
+    
+    // Wait for the request in flight, then use its result.
+    SrsHttpHookResult* result = it->second;
+    if (result->pending) {
+        result->nn_waiters++;
+        srs_cond_timedwait(result->cond, SRS_HTTP_HOOK_CACHE_TIMEOUT);
+        result->nn_waiters--;
+    }
+    
+    if (result->pending || result->expire <= srs_get_system_time()) {
+        return false;
+    }
+    
+    *perr = srs_error_copy(result->err);
+    return true;
+}
+
+void SrsHttpHookCache::start(string key)
+{
+    SrsHttpHookResult* result = NULL;
+    
+    std::map<std::string, SrsHttpHookResult*>::iterator it = results.find(key);
+    if (it == results.end()) {
+        result = new SrsHttpHookResult();
+        results[key] = result;
+    } else {
+        result = it->second;
+    }
+    
+    result->pending = true;
+}
+
+void SrsHttpHookCache::update(string key, srs_error_t err, srs_utime_t ttl)
+{
+    srs_utime_t now = srs_get_system_time();
+    
+    std::map<std::string, SrsHttpHookResult*>::iterator it = results.find(key);
+    if (it != results.end()) {
+        SrsHttpHookResult* result = it->second;
+        
+        srs_freep(result->err);
+        result->err = srs_error_copy(err);
+        result->expire = now + ttl;
+        result->pending = false;
+        
+        srs_cond_broadcast(result->cond);
+    }
+    
+    // Remove the expired results, except the one in flight or waited by others.
+    for (it = results.begin(); it != results.end();) {
+        SrsHttpHookResult* result = it->second;
+        if (result->pending || result->nn_waiters > 0 || result->expire > now) {
+            ++it;
+            continue;
+        }
+        
+        srs_freep(result);
+        results.erase(it++);
+    }
+}
+
+SrsHttpHookBatch::SrsHttpHookBatch()
+{
+    trd = NULL;
+    nn_events = 0;
+}
+
+SrsHttpHookBatch::~SrsHttpHookBatch()
+{
+    srs_freep(trd);
+}
+
+srs_error_t SrsHttpHookBatch::notify(string url, string data)
+{
+    srs_error_t err = srs_success;
+    
+    if (nn_events >= SRS_HTTP_HOOK_BATCH_MAX) {
+        return srs_error_new(ERROR_HTTP_HOOKS_OVERFLOW, "batch overflow, events=%d", nn_events);
+    }
+    
+    // Start the coroutine when the first event comes.
+    if (!trd) {
+        trd = new SrsSTCoroutine("hooks", this);
+        if ((err = trd->start()) != srs_success) {
+            srs_freep(trd);
+            return srs_error_wrap(err, "start coroutine");
+        }
+    }
+    
+    events[url].push_back(data);
+    nn_events++;
+    
+    return err;
+}
+
+void SrsHttpHookBatch::flush()
+{
+    std::vector<std::string> urls;
+    
+    std::map<std::string, std::vector<std::string> >::iterator it;
+    for (it = events.begin(); it != events.end(); ++it) {
+        if (!it->second.empty()) {
+            urls.push_back(it->first);
+        }
+    }
+    
+    for (int i = 0; i < (int)urls.size(); i++) {
+        std::string url = urls.at(i);
+        std::string data = dumps(url);
+        
+        int status_code;
+        std::string res;
+        srs_error_t err = SrsHttpHooks::do_post(url, data, status_code, res);
+        if (err != srs_success) {
+            srs_warn("http: ignore batch failed, url=%s, request=%s, response=%s, code=%d, err=%s",
+                url.c_str(), data.c_str(), res.c_str(), status_code, srs_error_desc(err).c_str());
+            srs_freep(err);
+            continue;
+        }
+        
+        srs_trace("http: batch ok, url=%s, request=%s, response=%s", url.c_str(), data.c_str(), res.c_str());
+    }
+}
+
+string SrsHttpHookBatch::dumps(string url)
+{
+    std::map<std::string, std::vector<std::string> >::iterator it = events.find(url);
+    if (it == events.end()) {
+        return "[]";
+    }
+    
+    std::vector<std::string>& datas = it->second;
+    nn_events -= (int)datas.size();
+    
+    std::stringstream ss;
+    ss << "[";
+    for (int i = 0; i < (int)datas.size(); i++) {
+        ss << (i? ",":"") << datas.at(i);
+    }
+    ss << "]";
+    events.erase(it);
+    
+    string data = ss.str();
+    
+    return data;
+}
+
+srs_error_t SrsHttpHookBatch::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "batch");
+        }
+        
+        srs_usleep(SRS_HTTP_HOOK_BATCH_INTERVAL);
+        
+        flush();
+    }
+    
+    return err;
+}
+
+// The pool, cache and batch of hooks, created when used, and never freed.
+static SrsHttpHookPool* hook_pool()
+{
+    static SrsHttpHookPool* pool = new SrsHttpHookPool();
+    return pool;
+}
+
+static SrsHttpHookCache* hook_cache()
+{
+    static SrsHttpHookCache* cache = new SrsHttpHookCache();
+    return cache;
+}
+
+static SrsHttpHookBatch* hook_batch()
+{
+    static SrsHttpHookBatch* batch = new SrsHttpHookBatch();
+    return batch;
+}
+
 SrsHttpHooks::SrsHttpHooks()
 {
 }
@@ -77,8 +372,7 @@ srs_error_t SrsHttpHooks::on_connect(string url, SrsRequest* req)
     std::string res;
     int status_code;
     
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
+    if ((err = do_auth(url, req, "on_connect", data, status_code, res)) != srs_success) {
         return srs_error_wrap(err, "http: on_connect failed, client_id=%d, url=%s, request=%s, response=%s, code=%d",
             client_id, url.c_str(), data.c_str(), res.c_str(), status_code);
     }
@@ -110,8 +404,7 @@ void SrsHttpHooks::on_close(string url, SrsRequest* req, int64_t send_bytes, int
     std::string res;
     int status_code;
     
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
+    if ((err = do_notify(url, req, data, status_code, res)) != srs_success) {
         int ret = srs_error_code(err);
         srs_freep(err);
         srs_warn("http: ignore on_close failed, client_id=%d, url=%s, request=%s, response=%s, code=%d, ret=%d",
@@ -147,8 +440,7 @@ srs_error_t SrsHttpHooks::on_publish(string url, SrsRequest* req)
     std::string res;
     int status_code;
     
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
+    if ((err = do_auth(url, req, "on_publish", data, status_code, res)) != srs_success) {
         return srs_error_wrap(err, "http: on_publish failed, client_id=%d, url=%s, request=%s, response=%s, code=%d",
             client_id, url.c_str(), data.c_str(), res.c_str(), status_code);
     }
@@ -180,8 +472,7 @@ void SrsHttpHooks::on_unpublish(string url, SrsRequest* req)
     std::string res;
     int status_code;
     
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
+    if ((err = do_post(url, data, status_code, res)) != srs_success) {
         int ret = srs_error_code(err);
         srs_freep(err);
         srs_warn("http: ignore on_unpublish failed, client_id=%d, url=%s, request=%s, response=%s, status=%d, ret=%d",
@@ -217,8 +508,7 @@ srs_error_t SrsHttpHooks::on_play(string url, SrsRequest* req)
     std::string res;
     int status_code;
     
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
+    if ((err = do_auth(url, req, "on_play", data, status_code, res)) != srs_success) {
         return srs_error_wrap(err, "http: on_play failed, client_id=%d, url=%s, request=%s, response=%s, status=%d",
             client_id, url.c_str(), data.c_str(), res.c_str(), status_code);
     }
@@ -250,8 +540,7 @@ void SrsHttpHooks::on_stop(string url, SrsRequest* req)
     std::string res;
     int status_code;
     
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
+    if ((err = do_notify(url, req, data, status_code, res)) != srs_success) {
         int ret = srs_error_code(err);
         srs_freep(err);
         srs_warn("http: ignore on_stop failed, client_id=%d, url=%s, request=%s, response=%s, code=%d, ret=%d",
@@ -289,8 +578,7 @@ srs_error_t SrsHttpHooks::on_dvr(int cid, string url, SrsRequest* req, string fi
     std::string res;
     int status_code;
     
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
+    if ((err = do_notify(url, req, data, status_code, res)) != srs_success) {
         return srs_error_wrap(err, "http post on_dvr uri failed, client_id=%d, url=%s, request=%s, response=%s, code=%d",
             client_id, url.c_str(), data.c_str(), res.c_str(), status_code);
     }
@@ -336,8 +624,7 @@ srs_error_t SrsHttpHooks::on_hls(int cid, string url, SrsRequest* req, string fi
     std::string res;
     int status_code;
     
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
+    if ((err = do_notify(url, req, data, status_code, res)) != srs_success) {
         return srs_error_wrap(err, "http: post %s with %s, status=%d, res=%s", url.c_str(), data.c_str(), status_code, res.c_str());
     }
     
@@ -421,8 +708,7 @@ srs_error_t SrsHttpHooks::discover_co_workers(string url, string& host, int& por
     std::string res;
     int status_code;
     
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, "", status_code, res)) != srs_success) {
+    if ((err = do_post(url, "", status_code, res)) != srs_success) {
         return srs_error_wrap(err, "http: post %s, status=%d, res=%s", url.c_str(), status_code, res.c_str());
     }
     
@@ -469,24 +755,108 @@ srs_error_t SrsHttpHooks::discover_co_workers(string url, string& host, int& por
     return err;
 }
 
-srs_error_t SrsHttpHooks::do_post(SrsHttpClient* hc, std::string url, std::string req, int& code, string& res)
+srs_error_t SrsHttpHooks::do_auth(string url, SrsRequest* req, string action, string data, int& code, string& res)
+{
+    srs_error_t err = srs_success;
+    
+    srs_utime_t ttl = _srs_config->get_vhost_http_hooks_cache_ttl(req->vhost);
+    if (ttl <= 0) {
+        return do_post(url, data, code, res);
+    }
+    
+    // The key is the request except the client_id, which is different for each client.
+    std::stringstream ss;
+    ss << url << "|" << action << "|" << req->ip << "|" << req->vhost << "|" << req->app
+        << "|" << req->stream << "|" << req->param << "|" << req->tcUrl << "|" << req->pageUrl;
+    string key = ss.str();
+    
+    SrsHttpHookCache* cache = hook_cache();
+    if (cache->fetch(key, &err)) {
+        code = 0;
+        res = "cached";
+        return err;
+    }
+    
+    cache->start(key);
+    err = do_post(url, data, code, res);
+    
+    // Only cache the result responded by server, not the error of network.
+    cache->update(key, err, code? ttl : 0);
+    
+    return err;
+}
+
+srs_error_t SrsHttpHooks::do_notify(string url, SrsRequest* req, string data, int& code, string& res)
+{
+    if (!_srs_config->get_vhost_http_hooks_batch(req->vhost)) {
+        return do_post(url, data, code, res);
+    }
+    
+    code = 0;
+    res = "batch";
+    return hook_batch()->notify(url, data);
+}
+
+srs_error_t SrsHttpHooks::do_post(string url, string req, int& code, string& res)
 {
     srs_error_t err = srs_success;
     
+    code = 0;
+    
     SrsHttpUri uri;
     if ((err = uri.initialize(url)) != srs_success) {
         return srs_error_wrap(err, "http: post failed. url=%s", url.c_str());
     }
     
-    if ((err = hc->initialize(uri.get_host(), uri.get_port())) != srs_success) {
-        return srs_error_wrap(err, "http: init client");
-    }
+    string host = uri.get_host();
+    int port = uri.get_port();
     
     string path = uri.get_path();
     if (!uri.get_query().empty()) {
         path += "?" + uri.get_query();
     }
     
+    SrsHttpHookPool* pool = hook_pool();
+    SrsHttpClient* hc = NULL;
+    bool reused = false;
+    if ((err = pool->fetch(host, port, &hc, reused)) != srs_success) {
+        return srs_error_wrap(err, "http: init client");
+    }
+    
+    int64_t nn_recv = hc->get_recv_bytes();
+    bool keep_alive = false;
+    err = do_post(hc, path, req, code, res, keep_alive);
+    
+    // The idle client may be closed by server, retry once with a new client, only when the request
+    // is never processed, that is, write failed, or server closed it before any response byte.
+    // @remark Never retry for timeout, because the hook maybe processed by server.
+    if (err != srs_success && reused) {
+        int ec = srs_error_code(err);
+        if (ec == ERROR_SOCKET_WRITE || (ec == ERROR_SOCKET_READ && hc->get_recv_bytes() == nn_recv)) {
+            srs_warn("http: retry for idle client closed, url=%s, err=%s", url.c_str(), srs_error_desc(err).c_str());
+            srs_freep(hc);
+            srs_error_reset(err);
+            
+            if ((err = pool->create(host, port, &hc)) != srs_success) {
+                return srs_error_wrap(err, "http: init client");
+            }
+            err = do_post(hc, path, req, code, res, keep_alive);
+        }
+    }
+    
+    if (keep_alive) {
+        pool->release(host, port, hc);
+    } else {
+        srs_freep(hc);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHttpHooks::do_post(SrsHttpClient* hc, string path, string req, int& code, string& res, bool& keep_alive)
+{
+    srs_error_t err = srs_success;
+    
     ISrsHttpMessage* msg = NULL;
     if ((err = hc->post(path, req, &msg)) != srs_success) {
         return srs_error_wrap(err, "http: client post");
@@ -498,6 +868,9 @@ srs_error_t SrsHttpHooks::do_post(SrsHttpClient* hc, std::string url, std::strin
         return srs_error_wrap(err, "http: body read");
     }
     
+    // Reuse the client when the whole response is read.
+    keep_alive = msg->is_keep_alive();
+    
     // ensure the http status is ok.
     // https://github.com/ossrs/srs/issues/158
     if (code != SRS_CONSTS_HTTP_OK && code != SRS_CONSTS_HTTP_Created) {
@@ -27,6 +27,10 @@
 #include <srs_core.hpp>
 
 #include <string>
+#include <map>
+#include <vector>
+
+#include <srs_app_st.hpp>
 
 class SrsHttpUri;
 class SrsStSocket;
@@ -34,6 +38,85 @@ class SrsRequest;
 class SrsHttpParser;
 class SrsHttpClient;
 
+// The pool of keep-alive HTTP clients to the hook servers, keyed by host and port.
+class SrsHttpHookPool
+{
+private:
+    std::map<std::string, std::vector<SrsHttpClient*> > clients;
+public:
+    SrsHttpHookPool();
+    virtual ~SrsHttpHookPool();
+public:
+    // Fetch an idle client of server, or create a new one when no idle client.
+    // @param reused Whether the client is reused, which may be closed by server.
+    virtual srs_error_t fetch(std::string host, int port, SrsHttpClient** pclient, bool& reused);
+    // Create a new client of server, never reuse the idle one.
+    virtual srs_error_t create(std::string host, int port, SrsHttpClient** pclient);
+    // Release the client to pool, which is freed when the pool of server is full.
+    virtual void release(std::string host, int port, SrsHttpClient* client);
+    // Get the number of idle clients of server.
+    virtual int size(std::string host, int port);
+};
+
+// The cached result of an auth hook.
+class SrsHttpHookResult
+{
+public:
+    // Whether the request is in flight, the others wait for its result.
+    bool pending;
+    int nn_waiters;
+    srs_cond_t cond;
+    srs_utime_t expire;
+    // The result of hook, srs_success if allowed.
+    srs_error_t err;
+public:
+    SrsHttpHookResult();
+    virtual ~SrsHttpHookResult();
+};
+
+// The cache of auth hooks, such as on_connect, on_publish and on_play, so the same
+// requests are sent once in the TTL, even when a storm of clients connect together.
+class SrsHttpHookCache
+{
+private:
+    std::map<std::string, SrsHttpHookResult*> results;
+public:
+    SrsHttpHookCache();
+    virtual ~SrsHttpHookCache();
+public:
+    // Fetch the result of key, wait if the request is in flight.
+    // @return true if hit, and the perr is the cached error, user must free it.
+    virtual bool fetch(std::string key, srs_error_t* perr);
+    // Mark the request of key is in flight.
+    virtual void start(std::string key);
+    // Update the result of key, which expires after ttl, and wakeup the waiters.
+    virtual void update(std::string key, srs_error_t err, srs_utime_t ttl);
+};
+
+// The batch of notify hooks, such as on_close, on_stop, on_dvr and on_hls, which
+// posts the events to each url in a json array every interval.
+class SrsHttpHookBatch : public ISrsCoroutineHandler
+{
+private:
+    SrsCoroutine* trd;
+    // The events in json of each url.
+    std::map<std::string, std::vector<std::string> > events;
+    int nn_events;
+public:
+    SrsHttpHookBatch();
+    virtual ~SrsHttpHookBatch();
+public:
+    // Append the event to url, which is posted in next batch.
+    virtual srs_error_t notify(std::string url, std::string data);
+    // Post all events to each url.
+    virtual void flush();
+    // Dump the events of url in a json array, and remove them.
+    virtual std::string dumps(std::string url);
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+};
+
 // the http hooks, http callback api,
 // for some event, such as on_connect, call
 // a http api(hooks).
@@ -97,7 +180,15 @@ public:
     // Discover co-workers for origin cluster.
     static srs_error_t discover_co_workers(std::string url, std::string& host, int& port);
 private:
-    static srs_error_t do_post(SrsHttpClient* hc, std::string url, std::string req, int& code, std::string& res);
+    // Post the auth request, use the cached result in TTL.
+    static srs_error_t do_auth(std::string url, SrsRequest* req, std::string action, std::string data, int& code, std::string& res);
+    // Post the notify request, append to batch if enabled.
+    static srs_error_t do_notify(std::string url, SrsRequest* req, std::string data, int& code, std::string& res);
+public:
+    // Post the request to url, by the keep-alive client in pool.
+    static srs_error_t do_post(std::string url, std::string req, int& code, std::string& res);
+private:
+    static srs_error_t do_post(SrsHttpClient* hc, std::string path, std::string req, int& code, std::string& res, bool& keep_alive);
 };
 
 #endif
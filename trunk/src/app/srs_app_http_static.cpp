@@ -50,6 +50,10 @@ using namespace std;
 #include <srs_app_pithy_print.hpp>
 #include <srs_app_source.hpp>
 #include <srs_app_server.hpp>
+#include <srs_app_hls.hpp>
+
+// The max time to hold the LL-HLS blocking request.
+#define SRS_HLS_BLOCKING_RELOAD_TIMEOUT (6 * SRS_UTIME_SECONDS)
 
 SrsVodStream::SrsVodStream(string root_dir) : SrsHttpFileServer(root_dir)
 {
@@ -59,6 +63,121 @@ SrsVodStream::~SrsVodStream()
 {
 }
 
+srs_error_t SrsVodStream::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_assert(entry);
+    
+    // Serve the hls file in memory first, then the file on disk.
+    string fullpath = srs_http_fs_fullpath(dir, entry->pattern, r->path());
+    
+    int code = SRS_CONSTS_HTTP_OK;
+    SrsHlsMemoryFile* file = fetch_memory_file(r, fullpath, code);
+    SrsAutoFree(SrsHlsMemoryFile, file);
+    
+    if (code != SRS_CONSTS_HTTP_OK) {
+        return srs_go_http_error(w, code);
+    }
+    
+    if (!file) {
+        return SrsHttpFileServer::serve_http(w, r);
+    }
+    
+    return serve_memory_file(w, r, file, fullpath);
+}
+
+SrsHlsMemoryFile* SrsVodStream::fetch_memory_file(ISrsHttpMessage* r, string fullpath, int& code)
+{
+    // For LL-HLS blocking playlist reload, the _HLS_msn and _HLS_part to wait for.
+    std::string msn_str = r->query_get("_HLS_msn");
+    std::string part_str = r->query_get("_HLS_part");
+    int msn = msn_str.empty()? -1 : ::atoi(msn_str.c_str());
+    int part = part_str.empty()? -1 : ::atoi(part_str.c_str());
+    
+    srs_utime_t deadline = srs_get_system_time() + SRS_HLS_BLOCKING_RELOAD_TIMEOUT;
+    while (true) {
+        SrsHlsMemoryFile* file = _srs_hls_store->fetch(fullpath);
+        
+        // The file is ready, or not LL-HLS blocking request.
+        if (file && (msn < 0 || file->msn < 0)) {
+            return file;
+        }
+        
+        // Not found, and not the preload hint part.
+        if (!file && !_srs_hls_store->is_hinted(fullpath)) {
+            return NULL;
+        }
+        
+        if (file) {
+            // The request is too far in future, @see rfc8216bis 6.2.5.2
+            if (msn > file->msn + 2) {
+                srs_freep(file);
+                code = SRS_CONSTS_HTTP_BadRequest;
+                return NULL;
+            }
+            
+            // The segment msn is complete, or the part is published.
+            if (msn < file->msn || (msn == file->msn && part >= 0 && part < file->part)) {
+                return file;
+            }
+            srs_freep(file);
+        }
+        
+        srs_utime_t now = srs_get_system_time();
+        if (now >= deadline) {
+            code = SRS_CONSTS_HTTP_ServiceUnavailable;
+            return NULL;
+        }
+        
+        _srs_hls_store->wait(fullpath, deadline - now);
+    }
+    
+    return NULL;
+}
+
+srs_error_t SrsVodStream::serve_memory_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, SrsHlsMemoryFile* file, string fullpath)
+{
+    srs_error_t err = srs_success;
+    
+    w->header()->set("ETag", file->etag);
+    w->header()->set("Last-Modified", file->last_modified);
+    
+    // The m3u8 is always changing, client should always revalidate it.
+    if (srs_string_ends_with(fullpath, ".m3u8")) {
+        w->header()->set("Cache-Control", "no-cache");
+    }
+    
+    // Response 304 when the client has the same file, @see RFC7232.
+    std::string inm = r->header()->get("If-None-Match");
+    std::string ims = r->header()->get("If-Modified-Since");
+    if ((!inm.empty() && inm == file->etag) || (inm.empty() && !ims.empty() && ims == file->last_modified)) {
+        w->header()->set_content_length(0);
+        w->write_header(SRS_CONSTS_HTTP_NotModified);
+        return w->final_request();
+    }
+    
+    if (srs_string_ends_with(fullpath, ".m3u8")) {
+        w->header()->set_content_type("application/vnd.apple.mpegurl");
+    } else if (srs_string_ends_with(fullpath, ".ts")) {
+        w->header()->set_content_type("video/MP2T");
+    } else {
+        w->header()->set_content_type("application/octet-stream");
+    }
+    
+    SrsSharedPtrMessage* content = file->content;
+    w->header()->set_content_length(content->size);
+    w->write_header(SRS_CONSTS_HTTP_OK);
+    
+    if ((err = w->write(content->payload, content->size)) != srs_success) {
+        return srs_error_wrap(err, "write %s size=%d", fullpath.c_str(), content->size);
+    }
+    
+    if ((err = w->final_request()) != srs_success) {
+        return srs_error_wrap(err, "final request");
+    }
+    
+    return err;
+}
+
 srs_error_t SrsVodStream::serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, int offset)
 {
     srs_error_t err = srs_success;
@@ -28,6 +28,8 @@
 
 #include <srs_app_http_conn.hpp>
 
+class SrsHlsMemoryFile;
+
 // The flv vod stream supports flv?start=offset-bytes.
 // For example, http://server/file.flv?start=10240
 // server will write flv header and sequence header,
@@ -37,6 +39,16 @@ class SrsVodStream : public SrsHttpFileServer
 public:
     SrsVodStream(std::string root_dir);
     virtual ~SrsVodStream();
+// Interface ISrsHttpHandler
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+private:
+    // Fetch the hls file in memory, hold the LL-HLS blocking request until it's ready.
+    // @param code The http status code when fail.
+    // @return The file which user must free, NULL if not in memory.
+    virtual SrsHlsMemoryFile* fetch_memory_file(ISrsHttpMessage* r, std::string fullpath, int& code);
+    // Serve the hls file in memory, for hls_storage ram or both.
+    virtual srs_error_t serve_memory_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, SrsHlsMemoryFile* file, std::string fullpath);
 protected:
     virtual srs_error_t serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int offset);
     virtual srs_error_t serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int start, int end);
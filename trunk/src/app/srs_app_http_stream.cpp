@@ -55,6 +55,8 @@ using namespace std;
 #include <srs_app_statistic.hpp>
 #include <srs_app_recv_thread.hpp>
 #include <srs_app_http_hooks.hpp>
+#include <srs_app_pipeline.hpp>
+#include <srs_app_bandwidth.hpp>
 
 SrsBufferCache::SrsBufferCache(SrsSource* s, SrsRequest* r)
 {
@@ -550,44 +552,77 @@ srs_error_t SrsLiveStream::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage
 
 srs_error_t SrsLiveStream::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
 {
-    srs_error_t err = srs_success;
-    
     string enc_desc;
-    ISrsBufferEncoder* enc = NULL;
+    SrsPipelineOutput* output = NULL;
+    SrsMuxPipeline* pipeline = source->mux_pipeline();
     
     srs_assert(entry);
     if (srs_string_ends_with(entry->pattern, ".flv")) {
         w->header()->set_content_type("video/x-flv");
         enc_desc = "FLV";
-        enc = new SrsFlvStreamEncoder();
+        output = pipeline->flv_output();
     } else if (srs_string_ends_with(entry->pattern, ".aac")) {
         w->header()->set_content_type("audio/x-aac");
         enc_desc = "AAC";
-        enc = new SrsAacStreamEncoder();
+        output = pipeline->aac_output();
     } else if (srs_string_ends_with(entry->pattern, ".mp3")) {
         w->header()->set_content_type("audio/mpeg");
         enc_desc = "MP3";
-        enc = new SrsMp3StreamEncoder();
+        output = pipeline->mp3_output();
     } else if (srs_string_ends_with(entry->pattern, ".ts")) {
         w->header()->set_content_type("video/MP2T");
         enc_desc = "TS";
-        enc = new SrsTsStreamEncoder();
+        output = pipeline->ts_output();
     } else {
         return srs_error_new(ERROR_HTTP_LIVE_STREAM_EXT, "invalid pattern=%s", entry->pattern.c_str());
     }
+    
+    // The time-shift player starts at an offset from live, for example, ?start=-60s,
+    // which is served by consumer, because the shared output is always at live.
+    srs_utime_t shift = srs_time_shift_parse(r->query_get("start"));
+    if (shift > 0) {
+        return do_serve_consumer(w, r, enc_desc, shift);
+    }
+    
+#ifdef SRS_PERF_SHARED_HTTP_STREAM
+    return do_serve_shared(w, r, output, enc_desc);
+#else
+    return do_serve_consumer(w, r, enc_desc, 0);
+#endif
+}
+
+srs_error_t SrsLiveStream::do_serve_consumer(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string enc_desc, srs_utime_t shift)
+{
+    srs_error_t err = srs_success;
+    
+    ISrsBufferEncoder* enc = NULL;
+    if (enc_desc == "FLV") {
+        enc = new SrsFlvStreamEncoder();
+    } else if (enc_desc == "AAC") {
+        enc = new SrsAacStreamEncoder();
+    } else if (enc_desc == "MP3") {
+        enc = new SrsMp3StreamEncoder();
+    } else {
+        enc = new SrsTsStreamEncoder();
+    }
     SrsAutoFree(ISrsBufferEncoder, enc);
 
     // Enter chunked mode, because we didn't set the content-length.
     w->write_header(SRS_CONSTS_HTTP_OK);
     
     // create consumer of souce, ignore gop cache, use the audio gop cache.
+    // For time-shift, the audio is also in the time-shift buffer.
+    bool use_cache = enc->has_cache() && shift == 0;
     SrsConsumer* consumer = NULL;
-    if ((err = source->create_consumer(NULL, consumer, true, true, !enc->has_cache())) != srs_success) {
+    if ((err = source->create_consumer(NULL, consumer, true, true, !use_cache, shift)) != srs_success) {
         return srs_error_wrap(err, "create consumer");
     }
     SrsAutoFree(SrsConsumer, consumer);
     srs_verbose("http: consumer created success.");
     
+    // Pace the gop cache and catch-up burst to viewer.
+    consumer->enable_pacing(req->vhost);
+    
     SrsPithyPrint* pprint = SrsPithyPrint::create_http_stream();
     SrsAutoFree(SrsPithyPrint, pprint);
     
@@ -611,7 +646,7 @@ srs_error_t SrsLiveStream::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
     }
     
     // if gop cache enabled for encoder, dump to consumer.
-    if (enc->has_cache()) {
+    if (use_cache) {
         if ((err = enc->dump_cache(consumer, source->jitter())) != srs_success) {
             return srs_error_wrap(err, "encoder dump cache");
         }
@@ -696,6 +731,162 @@ srs_error_t SrsLiveStream::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
     return srs_error_new(ERROR_HTTP_STREAM_EOF, "Stream EOF");
 }
 
+srs_error_t SrsLiveStream::do_serve_shared(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, SrsPipelineOutput* output, string enc_desc)
+{
+    srs_error_t err = srs_success;
+    
+    // Enter chunked mode, because we didn't set the content-length.
+    w->write_header(SRS_CONSTS_HTTP_OK);
+    
+    // Use receive thread to accept the close event to avoid FD leak.
+    // @see https://github.com/ossrs/srs/issues/636#issuecomment-298208427
+    SrsHttpMessage* hr = dynamic_cast<SrsHttpMessage*>(r);
+    SrsResponseOnlyHttpConn* hc = dynamic_cast<SrsResponseOnlyHttpConn*>(hr->connection());
+    
+    // update the statistic when source disconveried.
+    SrsStatistic* stat = SrsStatistic::instance();
+    if ((err = stat->on_client(_srs_context->get_id(), req, hc, SrsRtmpConnPlay)) != srs_success) {
+        return srs_error_wrap(err, "stat on client");
+    }
+    
+    // Set the socket options for transport.
+    bool tcp_nodelay = _srs_config->get_tcp_nodelay(req->vhost);
+    if (tcp_nodelay) {
+        if ((err = hc->set_tcp_nodelay(tcp_nodelay)) != srs_success) {
+            return srs_error_wrap(err, "set tcp nodelay");
+        }
+    }
+    
+    srs_utime_t mw_sleep = _srs_config->get_mw_sleep(req->vhost);
+    if ((err = hc->set_socket_buffer(mw_sleep)) != srs_success) {
+        return srs_error_wrap(err, "set mw_sleep %" PRId64, mw_sleep);
+    }
+    
+    SrsHttpRecvThread* trd = new SrsHttpRecvThread(hc);
+    SrsAutoFree(SrsHttpRecvThread, trd);
+    
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start recv thread");
+    }
+    
+    // The FLV and TS start at the last keyframe if gop cache enabled, while the pure audio
+    // starts at the fast cache.
+    SrsPipelineViewer viewer;
+    if (enc_desc == "AAC" || enc_desc == "MP3") {
+        viewer.gop = false;
+        viewer.fast_cache = _srs_config->get_vhost_http_remux_fast_cache(req->vhost);
+    } else {
+        viewer.gop = _srs_config->get_gop_cache(req->vhost);
+    }
+    
+    srs_trace("FLV %s, encoder=%s, shared=1, nodelay=%d, mw_sleep=%dms, gop=%d, fast_cache=%dms, msgs=%d",
+        entry->pattern.c_str(), enc_desc.c_str(), tcp_nodelay, srsu2msi(mw_sleep), viewer.gop,
+        srsu2msi(viewer.fast_cache), SRS_PERF_MW_MSGS);
+    
+    // The stream is muxed once by the pipeline of source, and the viewer only sends the chunks.
+    if ((err = source->on_shared_play()) != srs_success) {
+        source->on_shared_stop();
+        return srs_error_wrap(err, "shared play");
+    }
+    
+    output->attach(&viewer);
+    err = streaming_send_shared(w, output, &viewer, trd, mw_sleep);
+    output->detach(&viewer);
+    
+    source->on_shared_stop();
+    
+    return err;
+}
+
+srs_error_t SrsLiveStream::streaming_send_shared(ISrsHttpResponseWriter* w, SrsPipelineOutput* output, SrsPipelineViewer* viewer, SrsHttpRecvThread* trd, srs_utime_t mw_sleep)
+{
+    srs_error_t err = srs_success;
+    
+    SrsPithyPrint* pprint = SrsPithyPrint::create_http_stream();
+    SrsAutoFree(SrsPithyPrint, pprint);
+    
+    // The chunks of headers are fetched with the join point, so there may be more
+    // chunks than SRS_PERF_MW_MSGS.
+    int nb_iovs = SRS_PERF_MW_MSGS * SRS_PIPELINE_CHUNK_IOVS;
+    iovec* iovs = new iovec[nb_iovs];
+    SrsAutoFreeA(iovec, iovs);
+    
+    vector<SrsPipelineChunk*> msgs;
+    
+    // The pacer of egress, NULL if disabled.
+    SrsPacer* pacer = SrsPacer::create(req->vhost);
+    SrsAutoFree(SrsPacer, pacer);
+    
+    while (entry->enabled) {
+        // Whether client closed the FD.
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "recv thread");
+        }
+        
+        pprint->elapse();
+        
+        // Wait for the quota of pacer, the chunks are ready to send.
+        srs_utime_t delay = pacer? pacer->delay() : 0;
+        if (delay > 0) {
+            srs_usleep(srs_min(delay, SRS_CONSTS_RTMP_PULSE));
+            continue;
+        }
+        
+        // Each chunk in msgs is a copy, which must be free.
+        // The bytes allowed by pacer, the burst such as gop cache is sent in the rate.
+        msgs.clear();
+        int64_t quota = pacer? pacer->quota() : -1;
+        if ((err = output->fetch(viewer, msgs, SRS_PERF_MW_MSGS, quota)) != srs_success) {
+            return srs_error_wrap(err, "fetch chunks");
+        }
+        
+        int count = (int)msgs.size();
+        if (count <= 0) {
+            srs_usleep(mw_sleep);
+            continue;
+        }
+        
+        if (pprint->can_print()) {
+            srs_trace("-> " SRS_CONSTS_LOG_HTTP_STREAM " http: got %d chunks, age=%d, cursor=%" PRId64 ", mw=%d",
+                count, pprint->age(), viewer->cursor, srsu2msi(mw_sleep));
+        }
+        
+        if (nb_iovs < count * SRS_PIPELINE_CHUNK_IOVS) {
+            nb_iovs = count * SRS_PIPELINE_CHUNK_IOVS;
+            srs_freepa(iovs);
+            iovs = new iovec[nb_iovs];
+        }
+        
+        int iovcnt = 0;
+        int64_t nb_bytes = 0;
+        for (int i = 0; i < count; i++) {
+            SrsPipelineChunk* chunk = msgs[i];
+            iovcnt += chunk->to_iovs(iovs + iovcnt);
+            nb_bytes += chunk->size();
+        }
+        
+        if (pacer) {
+            pacer->consume(nb_bytes);
+        }
+        
+        // Send all chunks in one HTTP chunk.
+        err = w->writev(iovs, iovcnt, NULL);
+        
+        for (int i = 0; i < count; i++) {
+            SrsPipelineChunk* chunk = msgs[i];
+            srs_freep(chunk);
+        }
+        
+        if (err != srs_success) {
+            return srs_error_wrap(err, "send chunks");
+        }
+    }
+    
+    // Here, the entry is disabled by encoder un-publishing or reloading,
+    // so we must return a io.EOF error to disconnect the client, or the client will never quit.
+    return srs_error_new(ERROR_HTTP_STREAM_EOF, "Stream EOF");
+}
+
 srs_error_t SrsLiveStream::http_hooks_on_play(ISrsHttpMessage* r)
 {
     srs_error_t err = srs_success;
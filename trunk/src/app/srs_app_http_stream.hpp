@@ -32,6 +32,9 @@ class SrsAacTransmuxer;
 class SrsMp3Transmuxer;
 class SrsFlvTransmuxer;
 class SrsTsTransmuxer;
+class SrsPipelineOutput;
+class SrsPipelineViewer;
+class SrsHttpRecvThread;
 
 // A cache for HTTP Live Streaming encoder, to make android(weixin) happy.
 class SrsBufferCache : public ISrsCoroutineHandler
@@ -193,6 +196,12 @@ public:
     virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
 private:
     virtual srs_error_t do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+    // Serve the stream by a consumer and encoder of each viewer.
+    // @param shift The offset from live to start at in time-shift buffer, 0 for live.
+    virtual srs_error_t do_serve_consumer(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string enc_desc, srs_utime_t shift);
+    // Serve the stream muxed once by pipeline of source, shared by all viewers.
+    virtual srs_error_t do_serve_shared(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, SrsPipelineOutput* output, std::string enc_desc);
+    virtual srs_error_t streaming_send_shared(ISrsHttpResponseWriter* w, SrsPipelineOutput* output, SrsPipelineViewer* viewer, SrsHttpRecvThread* trd, srs_utime_t mw_sleep);
     virtual srs_error_t http_hooks_on_play(ISrsHttpMessage* r);
     virtual void http_hooks_on_stop(ISrsHttpMessage* r);
     virtual srs_error_t streaming_send_messages(ISrsBufferEncoder* enc, SrsSharedPtrMessage** msgs, int nb_msgs);
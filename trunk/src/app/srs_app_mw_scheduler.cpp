@@ -0,0 +1,164 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_mw_scheduler.hpp>
+
+using namespace std;
+
+#include <srs_core_performance.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_kernel_utility.hpp>
+
+// The max duration of batch for low latency, and the min for normal.
+#define SRS_MW_LOW_LATENCY (100 * SRS_UTIME_MILLISECONDS)
+// The max duration of batch for bulk.
+#define SRS_MW_BULK_LATENCY (1000 * SRS_UTIME_MILLISECONDS)
+// The min elapsed of write, to think the socket is blocked, and measure the drain rate.
+#define SRS_MW_BLOCKED_ELAPSED (1 * SRS_UTIME_MILLISECONDS)
+
+SrsMwLatencyClass srs_mw_latency_parse(string v)
+{
+    if (v == "low") {
+        return SrsMwLatencyLow;
+    } else if (v == "bulk") {
+        return SrsMwLatencyBulk;
+    }
+    return SrsMwLatencyNormal;
+}
+
+string srs_mw_latency_string(SrsMwLatencyClass v)
+{
+    switch (v) {
+        case SrsMwLatencyLow: return "low";
+        case SrsMwLatencyBulk: return "bulk";
+        default: return "normal";
+    }
+}
+
+// Smooth the value by 1/8 of the new sample, like TCP srtt.
+static int64_t srs_mw_smooth(int64_t v, int64_t sample)
+{
+    return v? (v * 7 + sample) / 8 : sample;
+}
+
+SrsMwScheduler::SrsMwScheduler()
+{
+    latency = SrsMwLatencyNormal;
+    sleep = SRS_PERF_MW_SLEEP;
+    msgs = SRS_PERF_MW_MIN_MSGS;
+    bitrate = 0;
+    drain = 0;
+    msg_rate = 0;
+    nn_batches = 0;
+    nn_msgs = 0;
+    nn_bytes = 0;
+}
+
+SrsMwScheduler::~SrsMwScheduler()
+{
+}
+
+void SrsMwScheduler::set_latency(SrsMwLatencyClass v)
+{
+    latency = v;
+}
+
+SrsMwLatencyClass SrsMwScheduler::latency_class()
+{
+    return latency;
+}
+
+void SrsMwScheduler::schedule(bool realtime, srs_utime_t mw_sleep)
+{
+    SrsMwLatencyClass c = realtime? SrsMwLatencyLow : latency;
+    
+    // The range of batch duration for latency class.
+    srs_utime_t lo = 0, hi = 0;
+    if (c == SrsMwLatencyLow) {
+        lo = 0;
+        hi = srs_min(mw_sleep, SRS_MW_LOW_LATENCY);
+        msgs = 0;
+    } else if (c == SrsMwLatencyNormal) {
+        lo = srs_min(mw_sleep, SRS_MW_LOW_LATENCY);
+        hi = mw_sleep;
+        msgs = SRS_PERF_MW_MIN_MSGS;
+    } else {
+        lo = mw_sleep;
+        hi = srs_max(mw_sleep, SRS_MW_BULK_LATENCY);
+        msgs = SRS_PERF_MW_MIN_MSGS;
+    }
+    
+    // The load of socket, in [0, 1], the middle if not measured.
+    double load = 0.5;
+    if (drain > 0) {
+        load = srs_min(1.0, (double)bitrate / drain);
+    }
+    sleep = lo + (srs_utime_t)((hi - lo) * load);
+    
+    // Limit the batch in the max messages to send in a writev.
+    if (msg_rate > 0) {
+        srs_utime_t full = SRS_PERF_MW_MSGS * SRS_UTIME_SECONDS / msg_rate;
+        sleep = srs_max(lo, srs_min(sleep, full));
+    }
+}
+
+void SrsMwScheduler::on_send(int nb_msgs, int64_t nb_bytes, srs_utime_t duration, srs_utime_t elapsed)
+{
+    nn_batches++;
+    nn_msgs += nb_msgs;
+    nn_bytes += nb_bytes;
+    
+    if (duration > 0) {
+        bitrate = srs_mw_smooth(bitrate, nb_bytes * 8 * SRS_UTIME_SECONDS / duration);
+        msg_rate = srs_mw_smooth(msg_rate, nb_msgs * SRS_UTIME_SECONDS / duration);
+    }
+    
+    // The write returns in some microseconds when socket buffer is not full, which is not
+    // the drain rate, so only measure it when blocked, or the load is neutral if never blocked.
+    if (elapsed > SRS_MW_BLOCKED_ELAPSED) {
+        drain = srs_mw_smooth(drain, nb_bytes * 8 * SRS_UTIME_SECONDS / elapsed);
+    }
+}
+
+srs_utime_t SrsMwScheduler::duration()
+{
+    return sleep;
+}
+
+int SrsMwScheduler::min_msgs()
+{
+    return msgs;
+}
+
+void SrsMwScheduler::dumps(SrsJsonObject* obj)
+{
+    obj->set("latency", SrsJsonAny::str(srs_mw_latency_string(latency).c_str()));
+    obj->set("sleep", SrsJsonAny::integer(srsu2ms(sleep)));
+    obj->set("msgs", SrsJsonAny::integer(msgs));
+    obj->set("bitrate", SrsJsonAny::integer(bitrate / 1000));
+    obj->set("drain", SrsJsonAny::integer(drain / 1000));
+    obj->set("batches", SrsJsonAny::integer(nn_batches));
+    obj->set("batch_msgs", SrsJsonAny::integer(nn_batches? nn_msgs / nn_batches : 0));
+    obj->set("batch_bytes", SrsJsonAny::integer(nn_batches? nn_bytes / nn_batches : 0));
+}
+
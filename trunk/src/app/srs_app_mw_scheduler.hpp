@@ -0,0 +1,92 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_MW_SCHEDULER_HPP
+#define SRS_APP_MW_SCHEDULER_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+
+class SrsJsonObject;
+
+// The latency class of player, to schedule the MW(merged-write).
+enum SrsMwLatencyClass
+{
+    // For realtime player, sends the messages as soon as possible.
+    SrsMwLatencyLow = 0,
+    // For normal player, batches messages in the mw_latency.
+    SrsMwLatencyNormal,
+    // For bulk player, for example, the edge server, batches messages as large as possible.
+    SrsMwLatencyBulk,
+};
+
+// Parse the latency class from string low, normal or bulk, default to normal.
+extern SrsMwLatencyClass srs_mw_latency_parse(std::string v);
+extern std::string srs_mw_latency_string(SrsMwLatencyClass v);
+
+// The adaptive MW(merged-write) scheduler of a player connection, which sizes the batch
+// by the drain rate of socket, the bitrate of stream and the latency class of player.
+// The load of socket is the bitrate over the drain rate, when the socket drains fast,
+// the batch is small for latency, while the socket drains slow, it's large for writev.
+class SrsMwScheduler
+{
+private:
+    SrsMwLatencyClass latency;
+    // The duration and min messages of batch, for consumer to wait.
+    srs_utime_t sleep;
+    int msgs;
+    // The smoothed bitrate of stream and drain rate of socket, in bps.
+    int64_t bitrate;
+    int64_t drain;
+    // The smoothed messages per second of stream.
+    int64_t msg_rate;
+private:
+    // The number of batches, messages and bytes sent.
+    int64_t nn_batches;
+    int64_t nn_msgs;
+    int64_t nn_bytes;
+public:
+    SrsMwScheduler();
+    virtual ~SrsMwScheduler();
+public:
+    virtual void set_latency(SrsMwLatencyClass v);
+    virtual SrsMwLatencyClass latency_class();
+    // Schedule the next batch.
+    // @param realtime Whether realtime, which always use the low latency class.
+    // @param mw_sleep The configured MW sleep, the base duration of batch.
+    virtual void schedule(bool realtime, srs_utime_t mw_sleep);
+    // Update by a batch sent.
+    // @param nb_msgs The number of messages in batch.
+    // @param nb_bytes The bytes of messages in batch.
+    // @param duration The duration of messages in batch, by the timestamp.
+    // @param elapsed The time spent to write the batch, only measure the drain rate when blocked.
+    virtual void on_send(int nb_msgs, int64_t nb_bytes, srs_utime_t duration, srs_utime_t elapsed);
+    // The duration and min messages for consumer to wait.
+    virtual srs_utime_t duration();
+    virtual int min_msgs();
+    virtual void dumps(SrsJsonObject* obj);
+};
+
+#endif
+
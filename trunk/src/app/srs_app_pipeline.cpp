@@ -0,0 +1,1000 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_pipeline.hpp>
+
+#include <string.h>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_ts.hpp>
+#include <srs_kernel_aac.hpp>
+#include <srs_kernel_mp3.hpp>
+#include <srs_kernel_file.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_protocol_json.hpp>
+
+// The max chunks of output, to limit the memory when the GOP is too large.
+#define SRS_PIPELINE_MAX_CHUNKS 4096
+
+// The min duration of chunks kept by output, for slow viewers to catch up.
+#define SRS_PIPELINE_RETENTION (3 * SRS_UTIME_SECONDS)
+
+// For pure audio stream, the interval to write PAT/PMT, for viewer to join.
+#define SRS_PIPELINE_AUDIO_JOIN_INTERVAL 1000
+
+// The writer to write the header of muxer to buffer, for example, the ID3 of MP3.
+class SrsPipelineFileWriter : public SrsFileWriter
+{
+public:
+    SrsSimpleStream buffer;
+public:
+    SrsPipelineFileWriter() {
+    }
+    virtual ~SrsPipelineFileWriter() {
+    }
+public:
+    virtual bool is_open() {
+        return true;
+    }
+    virtual srs_error_t write(void* buf, size_t count, ssize_t* pnwrite) {
+        buffer.append((const char*)buf, (int)count);
+        if (pnwrite) {
+            *pnwrite = count;
+        }
+        return srs_success;
+    }
+};
+
+static const char* _srs_pipeline_stage_names[] = {
+    "format", "hls", "dash", "dvr", "hds", "forward", "ts", "flv", "aac", "mp3",
+};
+
+SrsPipelineStage::SrsPipelineStage()
+{
+    name = NULL;
+    nn_frames = 0;
+    cost = max_cost = 0;
+}
+
+SrsPipelineStage::~SrsPipelineStage()
+{
+}
+
+void SrsPipelineStage::on_frame(srs_utime_t elapsed)
+{
+    // Ignore the time jump backward.
+    if (elapsed < 0) {
+        elapsed = 0;
+    }
+
+    nn_frames++;
+    cost += elapsed;
+    max_cost = srs_max(max_cost, elapsed);
+}
+
+void SrsPipelineStage::dumps(SrsJsonObject* obj)
+{
+    obj->set("frames", SrsJsonAny::integer(nn_frames));
+    obj->set("cost_us", SrsJsonAny::integer(cost));
+    obj->set("avg_us", SrsJsonAny::integer(nn_frames > 0 ? cost / nn_frames : 0));
+    obj->set("max_us", SrsJsonAny::integer(max_cost));
+}
+
+SrsPipelineChunk::SrsPipelineChunk()
+{
+    seq = 0;
+    timestamp = 0;
+    join = false;
+    nb_head = 0;
+    body = NULL;
+    offset = 0;
+    nb_tail = 0;
+}
+
+SrsPipelineChunk::~SrsPipelineChunk()
+{
+    srs_freep(body);
+}
+
+srs_error_t SrsPipelineChunk::create(char* data, int size)
+{
+    srs_error_t err = srs_success;
+
+    srs_assert(!body);
+    body = new SrsSharedPtrMessage();
+    if ((err = body->create(NULL, data, size)) != srs_success) {
+        srs_freepa(data);
+        return srs_error_wrap(err, "create body");
+    }
+
+    return err;
+}
+
+SrsPipelineChunk* SrsPipelineChunk::copy()
+{
+    SrsPipelineChunk* chunk = new SrsPipelineChunk();
+
+    chunk->seq = seq;
+    chunk->timestamp = timestamp;
+    chunk->join = join;
+
+    memcpy(chunk->head, head, nb_head);
+    chunk->nb_head = nb_head;
+    chunk->body = body? body->copy() : NULL;
+    chunk->offset = offset;
+    memcpy(chunk->tail, tail, nb_tail);
+    chunk->nb_tail = nb_tail;
+
+    return chunk;
+}
+
+int SrsPipelineChunk::size()
+{
+    int size = nb_head + nb_tail;
+    if (body) {
+        size += body->size - offset;
+    }
+    return size;
+}
+
+int SrsPipelineChunk::to_iovs(iovec* iovs)
+{
+    int nn = 0;
+
+    if (nb_head > 0) {
+        iovs[nn].iov_base = head;
+        iovs[nn++].iov_len = nb_head;
+    }
+
+    if (body && body->size > offset) {
+        iovs[nn].iov_base = body->payload + offset;
+        iovs[nn++].iov_len = body->size - offset;
+    }
+
+    if (nb_tail > 0) {
+        iovs[nn].iov_base = tail;
+        iovs[nn++].iov_len = nb_tail;
+    }
+
+    return nn;
+}
+
+SrsPipelineViewer::SrsPipelineViewer()
+{
+    cursor = 0;
+    joined = false;
+    gop = true;
+    fast_cache = 0;
+}
+
+SrsPipelineViewer::~SrsPipelineViewer()
+{
+}
+
+SrsPipelineOutput::SrsPipelineOutput()
+{
+    next_seq = 0;
+    retention = SRS_PIPELINE_RETENTION;
+    nn_viewers = 0;
+    nn_skipped = 0;
+}
+
+SrsPipelineOutput::~SrsPipelineOutput()
+{
+    clear();
+}
+
+srs_error_t SrsPipelineOutput::initialize()
+{
+    return reset();
+}
+
+srs_error_t SrsPipelineOutput::reset()
+{
+    clear();
+    return srs_success;
+}
+
+void SrsPipelineOutput::attach(SrsPipelineViewer* viewer)
+{
+    nn_viewers++;
+
+    // Join at the chunks from now on, or in cache.
+    viewer->cursor = next_seq;
+    viewer->joined = false;
+
+    retention = srs_max(retention, viewer->fast_cache);
+}
+
+void SrsPipelineOutput::detach(SrsPipelineViewer* /*viewer*/)
+{
+    nn_viewers--;
+    srs_assert(nn_viewers >= 0);
+
+    // Free the chunks when no viewer, and start at the next join point when attached.
+    if (nn_viewers == 0) {
+        clear();
+        retention = SRS_PIPELINE_RETENTION;
+    }
+}
+
+bool SrsPipelineOutput::active()
+{
+    return nn_viewers > 0;
+}
+
+srs_error_t SrsPipelineOutput::on_meta_data(SrsSharedPtrMessage* /*msg*/)
+{
+    return srs_success;
+}
+
+srs_error_t SrsPipelineOutput::fetch(SrsPipelineViewer* viewer, vector<SrsPipelineChunk*>& msgs, int max, int64_t max_bytes)
+{
+    srs_error_t err = srs_success;
+
+    if (chunks.empty()) {
+        return err;
+    }
+
+    // Join or skip to a join point, for viewer to start or catch up.
+    int64_t first = chunks.front()->seq;
+    if (!viewer->joined || viewer->cursor < first) {
+        SrsPipelineChunk* chunk = join_point(viewer);
+
+        // Wait for the join point.
+        if (!chunk) {
+            return err;
+        }
+
+        if (viewer->joined) {
+            nn_skipped += chunk->seq - viewer->cursor;
+            srs_warn("pipeline: viewer skip %d chunks, %" PRId64 " to %" PRId64,
+                (int)(chunk->seq - viewer->cursor), viewer->cursor, chunk->seq);
+        }
+
+        copy_headers(msgs, !viewer->joined, chunk->timestamp);
+        viewer->cursor = chunk->seq;
+        viewer->joined = true;
+    }
+
+    // The bytes of headers.
+    int64_t nb_bytes = 0;
+    for (size_t i = 0; i < msgs.size(); i++) {
+        nb_bytes += msgs[i]->size();
+    }
+
+    for (size_t i = (size_t)(viewer->cursor - first); i < chunks.size() && (int)msgs.size() < max; i++) {
+        if (max_bytes >= 0 && nb_bytes >= max_bytes) {
+            break;
+        }
+
+        SrsPipelineChunk* chunk = chunks[i]->copy();
+        nb_bytes += chunk->size();
+        msgs.push_back(chunk);
+        viewer->cursor++;
+    }
+
+    return err;
+}
+
+void SrsPipelineOutput::dumps(SrsJsonObject* obj)
+{
+    obj->set("viewers", SrsJsonAny::integer(nn_viewers));
+    obj->set("chunks", SrsJsonAny::integer((int)chunks.size()));
+    obj->set("skipped", SrsJsonAny::integer(nn_skipped));
+}
+
+void SrsPipelineOutput::append(SrsPipelineChunk* chunk)
+{
+    chunk->seq = next_seq++;
+    chunks.push_back(chunk);
+
+    // Keep the chunks from the previous join point, that is the last and current GOP,
+    // but not the chunks in retention duration.
+    if (chunk->join) {
+        int nn_joins = 0;
+        size_t pos = 0;
+        for (size_t i = chunks.size(); i > 0; i--) {
+            if (chunks[i - 1]->join && ++nn_joins == 2) {
+                pos = i - 1;
+                break;
+            }
+        }
+
+        int64_t deadline = chunk->timestamp - srsu2ms(retention);
+        while (pos > 0 && chunks.front()->timestamp < deadline) {
+            SrsPipelineChunk* front = chunks.front();
+            srs_freep(front);
+            chunks.pop_front();
+            pos--;
+        }
+    }
+
+    while (chunks.size() > SRS_PIPELINE_MAX_CHUNKS) {
+        SrsPipelineChunk* front = chunks.front();
+        srs_freep(front);
+        chunks.pop_front();
+    }
+}
+
+void SrsPipelineOutput::copy_headers(vector<SrsPipelineChunk*>& /*msgs*/, bool /*first*/, int64_t /*timestamp*/)
+{
+}
+
+SrsPipelineChunk* SrsPipelineOutput::join_point(SrsPipelineViewer* viewer)
+{
+    // For the skipped viewer, catch up at the last join point.
+    bool last = viewer->joined || (viewer->gop && viewer->fast_cache <= 0);
+    if (last) {
+        std::deque<SrsPipelineChunk*>::reverse_iterator it;
+        for (it = chunks.rbegin(); it != chunks.rend(); ++it) {
+            if ((*it)->join) {
+                return *it;
+            }
+        }
+        return NULL;
+    }
+
+    // Start at the first join point in fast cache, or from now on.
+    int64_t deadline = chunks.back()->timestamp - srsu2ms(viewer->fast_cache);
+    std::deque<SrsPipelineChunk*>::iterator it;
+    for (it = chunks.begin(); it != chunks.end(); ++it) {
+        SrsPipelineChunk* chunk = *it;
+        if (!chunk->join) {
+            continue;
+        }
+        if (viewer->fast_cache > 0 && chunk->timestamp >= deadline) {
+            return chunk;
+        }
+        if (viewer->fast_cache <= 0 && chunk->seq >= viewer->cursor) {
+            return chunk;
+        }
+    }
+
+    return NULL;
+}
+
+void SrsPipelineOutput::clear()
+{
+    std::deque<SrsPipelineChunk*>::iterator it;
+    for (it = chunks.begin(); it != chunks.end(); ++it) {
+        SrsPipelineChunk* chunk = *it;
+        srs_freep(chunk);
+    }
+    chunks.clear();
+}
+
+SrsPipelineTs::SrsPipelineTs()
+{
+    transmuxer = NULL;
+    buffer = new SrsSimpleStream();
+    has_video = false;
+    last_join = -1;
+}
+
+SrsPipelineTs::~SrsPipelineTs()
+{
+    srs_freep(transmuxer);
+    srs_freep(buffer);
+}
+
+srs_error_t SrsPipelineTs::reset()
+{
+    srs_error_t err = srs_success;
+
+    if ((err = SrsPipelineOutput::reset()) != srs_success) {
+        return srs_error_wrap(err, "reset");
+    }
+
+    buffer->erase(buffer->length());
+    has_video = false;
+    last_join = -1;
+
+    srs_freep(transmuxer);
+    transmuxer = new SrsTsTransmuxer();
+    if ((err = transmuxer->initialize(this)) != srs_success) {
+        return srs_error_wrap(err, "init transmuxer");
+    }
+
+    return err;
+}
+
+srs_error_t SrsPipelineTs::on_audio(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+
+    // Always feed the sequence header, for viewer to attach at any time.
+    bool is_sequence_header = SrsFlvAudio::sh(msg->payload, msg->size);
+    if (!is_sequence_header && !active()) {
+        return err;
+    }
+
+    // For pure audio, write PAT/PMT at interval, because there is no keyframe.
+    bool join = false;
+    if (!is_sequence_header && !has_video) {
+        join = last_join < 0 || msg->timestamp - last_join >= SRS_PIPELINE_AUDIO_JOIN_INTERVAL;
+    }
+    if (join) {
+        transmuxer->reset_context();
+    }
+
+    if ((err = transmuxer->write_audio(msg->timestamp, msg->payload, msg->size)) != srs_success) {
+        return srs_error_wrap(err, "ts: write audio");
+    }
+
+    return flush(msg->timestamp, join);
+}
+
+srs_error_t SrsPipelineTs::on_video(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+
+    bool is_sequence_header = SrsFlvVideo::sh(msg->payload, msg->size);
+    if (is_sequence_header) {
+        has_video = true;
+    }
+
+    if (!is_sequence_header && !active()) {
+        return err;
+    }
+
+    // Write PAT/PMT before keyframe, for viewer to start at it.
+    bool join = !is_sequence_header && SrsFlvVideo::keyframe(msg->payload, msg->size);
+    if (join) {
+        transmuxer->reset_context();
+    }
+
+    if ((err = transmuxer->write_video(msg->timestamp, msg->payload, msg->size)) != srs_success) {
+        return srs_error_wrap(err, "ts: write video");
+    }
+
+    return flush(msg->timestamp, join);
+}
+
+srs_error_t SrsPipelineTs::write(void* buf, size_t size, ssize_t* nwrite)
+{
+    if (size > 0) {
+        buffer->append((const char*)buf, (int)size);
+    }
+
+    if (nwrite) {
+        *nwrite = size;
+    }
+
+    return srs_success;
+}
+
+srs_error_t SrsPipelineTs::flush(int64_t timestamp, bool join)
+{
+    srs_error_t err = srs_success;
+
+    // Ignore the sequence header and info frame, which outputs nothing.
+    int size = buffer->length();
+    if (size <= 0) {
+        return err;
+    }
+
+    char* data = new char[size];
+    memcpy(data, buffer->bytes(), size);
+    buffer->erase(size);
+
+    SrsPipelineChunk* chunk = new SrsPipelineChunk();
+    if ((err = chunk->create(data, size)) != srs_success) {
+        srs_freep(chunk);
+        return srs_error_wrap(err, "create chunk");
+    }
+
+    chunk->timestamp = timestamp;
+    chunk->join = join;
+    append(chunk);
+
+    if (join) {
+        last_join = timestamp;
+    }
+
+    return err;
+}
+
+SrsPipelineFlv::SrsPipelineFlv()
+{
+    transmuxer = new SrsFlvTransmuxer();
+    meta = vsh = ash = NULL;
+    has_video = has_audio = false;
+}
+
+SrsPipelineFlv::~SrsPipelineFlv()
+{
+    srs_freep(transmuxer);
+    srs_freep(meta);
+    srs_freep(vsh);
+    srs_freep(ash);
+}
+
+srs_error_t SrsPipelineFlv::reset()
+{
+    srs_error_t err = srs_success;
+
+    if ((err = SrsPipelineOutput::reset()) != srs_success) {
+        return srs_error_wrap(err, "reset");
+    }
+
+    srs_freep(meta);
+    srs_freep(vsh);
+    srs_freep(ash);
+    has_video = has_audio = false;
+
+    return err;
+}
+
+srs_error_t SrsPipelineFlv::on_meta_data(SrsSharedPtrMessage* msg)
+{
+    srs_freep(meta);
+    meta = create_tag(msg);
+
+    if (active()) {
+        append(meta->copy());
+    }
+
+    return srs_success;
+}
+
+srs_error_t SrsPipelineFlv::on_audio(SrsSharedPtrMessage* msg)
+{
+    has_audio = true;
+
+    bool is_sequence_header = SrsFlvAudio::sh(msg->payload, msg->size);
+    if (!is_sequence_header && !active()) {
+        return srs_success;
+    }
+
+    SrsPipelineChunk* chunk = create_tag(msg);
+    if (is_sequence_header) {
+        srs_freep(ash);
+        ash = chunk->copy();
+    }
+
+    if (!active()) {
+        srs_freep(chunk);
+        return srs_success;
+    }
+
+    // For pure audio, each frame is a join point.
+    chunk->join = !has_video && !is_sequence_header;
+    append(chunk);
+
+    return srs_success;
+}
+
+srs_error_t SrsPipelineFlv::on_video(SrsSharedPtrMessage* msg)
+{
+    has_video = true;
+
+    bool is_sequence_header = SrsFlvVideo::sh(msg->payload, msg->size);
+    if (!is_sequence_header && !active()) {
+        return srs_success;
+    }
+
+    SrsPipelineChunk* chunk = create_tag(msg);
+    if (is_sequence_header) {
+        srs_freep(vsh);
+        vsh = chunk->copy();
+    }
+
+    if (!active()) {
+        srs_freep(chunk);
+        return srs_success;
+    }
+
+    chunk->join = !is_sequence_header && SrsFlvVideo::keyframe(msg->payload, msg->size);
+    append(chunk);
+
+    return srs_success;
+}
+
+void SrsPipelineFlv::copy_headers(vector<SrsPipelineChunk*>& msgs, bool first, int64_t timestamp)
+{
+    // The FLV header and PreviousTagSize0, only for the first join.
+    // @see https://github.com/ossrs/srs/issues/939
+    if (first) {
+        SrsPipelineChunk* chunk = new SrsPipelineChunk();
+        char flv_header[] = {
+            'F', 'L', 'V', // Signatures "FLV"
+            (char)0x01, // File version (for example, 0x01 for FLV version 1)
+            (char)0x00, // 4, audio; 1, video; 5 audio+video.
+            (char)0x00, (char)0x00, (char)0x00, (char)0x09, // DataOffset UI32 The length of this header in bytes
+            (char)0x00, (char)0x00, (char)0x00, (char)0x00 // PreviousTagSize0 UI32 Always 0
+        };
+        if (has_audio) {
+            flv_header[4] |= 0x04;
+        }
+        if (has_video) {
+            flv_header[4] |= 0x01;
+        }
+        memcpy(chunk->head, flv_header, sizeof(flv_header));
+        chunk->nb_head = sizeof(flv_header);
+        msgs.push_back(chunk);
+    }
+
+    // The metadata and sequence headers, at the timestamp of join point.
+    SrsPipelineChunk* headers[] = {meta, vsh, ash};
+    for (int i = 0; i < (int)(sizeof(headers) / sizeof(SrsPipelineChunk*)); i++) {
+        if (!headers[i]) {
+            continue;
+        }
+
+        SrsPipelineChunk* chunk = headers[i]->copy();
+        if (chunk != NULL && headers[i] != meta) {
+            // Timestamp UI24 and TimestampExtended UI8, in the tag header.
+            int32_t ts = (int32_t)(timestamp & 0x7fffffff);
+            chunk->head[4] = (char)(ts >> 16);
+            chunk->head[5] = (char)(ts >> 8);
+            chunk->head[6] = (char)ts;
+            chunk->head[7] = (char)(ts >> 24);
+            chunk->timestamp = timestamp;
+        }
+        msgs.push_back(chunk);
+    }
+}
+
+SrsPipelineChunk* SrsPipelineFlv::create_tag(SrsSharedPtrMessage* msg)
+{
+    SrsPipelineChunk* chunk = new SrsPipelineChunk();
+    chunk->timestamp = msg->timestamp;
+
+    if (msg->is_audio()) {
+        transmuxer->cache_audio(msg->timestamp, msg->payload, msg->size, chunk->head);
+    } else if (msg->is_video()) {
+        transmuxer->cache_video(msg->timestamp, msg->payload, msg->size, chunk->head);
+    } else {
+        transmuxer->cache_metadata(SrsFrameTypeScript, msg->payload, msg->size, chunk->head);
+    }
+    chunk->nb_head = SRS_FLV_TAG_HEADER_SIZE;
+
+    // The payload of message is the tag body, shared without copy.
+    chunk->body = msg->copy();
+
+    transmuxer->cache_pts(SRS_FLV_TAG_HEADER_SIZE + msg->size, chunk->tail);
+    chunk->nb_tail = SRS_FLV_PREVIOUS_TAG_SIZE;
+
+    return chunk;
+}
+
+SrsPipelineAac::SrsPipelineAac()
+{
+    transmuxer = NULL;
+}
+
+SrsPipelineAac::~SrsPipelineAac()
+{
+    srs_freep(transmuxer);
+}
+
+srs_error_t SrsPipelineAac::reset()
+{
+    srs_error_t err = srs_success;
+
+    if ((err = SrsPipelineOutput::reset()) != srs_success) {
+        return srs_error_wrap(err, "reset");
+    }
+
+    srs_freep(transmuxer);
+    transmuxer = new SrsAacTransmuxer();
+
+    return err;
+}
+
+srs_error_t SrsPipelineAac::on_audio(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+
+    // Ignore the audio which is not AAC.
+    if (msg->size < 2 || (SrsAudioCodecId)((msg->payload[0] >> 4) & 0x0f) != SrsAudioCodecIdAAC) {
+        return err;
+    }
+
+    // Always parse the sequence header, for viewer to attach at any time.
+    bool is_sequence_header = SrsFlvAudio::sh(msg->payload, msg->size);
+    if (!is_sequence_header && !active()) {
+        return err;
+    }
+
+    SrsPipelineChunk* chunk = new SrsPipelineChunk();
+    if ((err = transmuxer->encode_audio(msg->payload, msg->size, chunk->head, &chunk->offset)) != srs_success) {
+        srs_freep(chunk);
+        return srs_error_wrap(err, "aac: encode audio");
+    }
+
+    // Ignore the sequence header, which outputs nothing.
+    if (chunk->offset <= 0) {
+        srs_freep(chunk);
+        return err;
+    }
+
+    // The ADTS header and the raw frame in payload, each frame is a join point.
+    chunk->nb_head = 7;
+    chunk->body = msg->copy();
+    chunk->timestamp = msg->timestamp;
+    chunk->join = true;
+    append(chunk);
+
+    return err;
+}
+
+srs_error_t SrsPipelineAac::on_video(SrsSharedPtrMessage* /*msg*/)
+{
+    // aac ignore any flv video.
+    return srs_success;
+}
+
+SrsPipelineMp3::SrsPipelineMp3()
+{
+    id3 = NULL;
+}
+
+SrsPipelineMp3::~SrsPipelineMp3()
+{
+    srs_freep(id3);
+}
+
+srs_error_t SrsPipelineMp3::initialize()
+{
+    srs_error_t err = srs_success;
+
+    if ((err = SrsPipelineOutput::initialize()) != srs_success) {
+        return srs_error_wrap(err, "initialize");
+    }
+
+    // Write the ID3 header to the chunk, sent to each viewer when join.
+    SrsPipelineFileWriter writer;
+    SrsMp3Transmuxer transmuxer;
+    if ((err = transmuxer.initialize(&writer)) != srs_success) {
+        return srs_error_wrap(err, "init transmuxer");
+    }
+
+    if ((err = transmuxer.write_header()) != srs_success) {
+        return srs_error_wrap(err, "write id3");
+    }
+
+    int size = writer.buffer.length();
+    char* data = new char[size];
+    memcpy(data, writer.buffer.bytes(), size);
+
+    srs_freep(id3);
+    id3 = new SrsPipelineChunk();
+    if ((err = id3->create(data, size)) != srs_success) {
+        return srs_error_wrap(err, "create id3");
+    }
+
+    return err;
+}
+
+srs_error_t SrsPipelineMp3::on_audio(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+
+    if (!active()) {
+        return err;
+    }
+
+    // Ignore the audio which is not MP3.
+    if (msg->size < 2 || (SrsAudioCodecId)((msg->payload[0] >> 4) & 0x0f) != SrsAudioCodecIdMP3) {
+        return err;
+    }
+
+    // The mp3 frame in payload, each frame is a join point.
+    SrsPipelineChunk* chunk = new SrsPipelineChunk();
+    chunk->body = msg->copy();
+    chunk->offset = 1;
+    chunk->timestamp = msg->timestamp;
+    chunk->join = true;
+    append(chunk);
+
+    return err;
+}
+
+srs_error_t SrsPipelineMp3::on_video(SrsSharedPtrMessage* /*msg*/)
+{
+    // mp3 ignore any flv video.
+    return srs_success;
+}
+
+void SrsPipelineMp3::copy_headers(vector<SrsPipelineChunk*>& msgs, bool first, int64_t /*timestamp*/)
+{
+    if (first && id3) {
+        msgs.push_back(id3->copy());
+    }
+}
+
+SrsMuxPipeline::SrsMuxPipeline()
+{
+    for (int i = 0; i < SrsPipelineStageMax; i++) {
+        stages[i].name = _srs_pipeline_stage_names[i];
+    }
+
+    ts = new SrsPipelineTs();
+    flv = new SrsPipelineFlv();
+    aac = new SrsPipelineAac();
+    mp3 = new SrsPipelineMp3();
+}
+
+SrsMuxPipeline::~SrsMuxPipeline()
+{
+    srs_freep(ts);
+    srs_freep(flv);
+    srs_freep(aac);
+    srs_freep(mp3);
+}
+
+srs_error_t SrsMuxPipeline::initialize()
+{
+    srs_error_t err = srs_success;
+
+    for (int i = SrsPipelineStageTs; i <= SrsPipelineStageMp3; i++) {
+        SrsPipelineOutput* o = output((SrsPipelineStageId)i);
+        if ((err = o->initialize()) != srs_success) {
+            return srs_error_wrap(err, "init %s", stages[i].name);
+        }
+    }
+
+    return err;
+}
+
+srs_error_t SrsMuxPipeline::on_unpublish()
+{
+    srs_error_t err = srs_success;
+
+    for (int i = SrsPipelineStageTs; i <= SrsPipelineStageMp3; i++) {
+        SrsPipelineOutput* o = output((SrsPipelineStageId)i);
+        if ((err = o->reset()) != srs_success) {
+            return srs_error_wrap(err, "reset %s", stages[i].name);
+        }
+    }
+
+    return err;
+}
+
+srs_error_t SrsMuxPipeline::on_meta_data(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+
+    if ((err = flv->on_meta_data(msg)) != srs_success) {
+        return srs_error_wrap(err, "flv metadata");
+    }
+
+    return err;
+}
+
+srs_error_t SrsMuxPipeline::on_audio(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+
+    for (int i = SrsPipelineStageTs; i <= SrsPipelineStageMp3; i++) {
+        SrsPipelineOutput* o = output((SrsPipelineStageId)i);
+
+        bool active = o->active();
+        srs_utime_t starttime = active? srs_update_system_time() : 0;
+
+        if ((err = o->on_audio(msg)) != srs_success) {
+            return srs_error_wrap(err, "%s audio", stages[i].name);
+        }
+
+        if (active) {
+            on_stage((SrsPipelineStageId)i, starttime);
+        }
+    }
+
+    return err;
+}
+
+srs_error_t SrsMuxPipeline::on_video(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+
+    for (int i = SrsPipelineStageTs; i <= SrsPipelineStageFlv; i++) {
+        SrsPipelineOutput* o = output((SrsPipelineStageId)i);
+
+        bool active = o->active();
+        srs_utime_t starttime = active? srs_update_system_time() : 0;
+
+        if ((err = o->on_video(msg)) != srs_success) {
+            return srs_error_wrap(err, "%s video", stages[i].name);
+        }
+
+        if (active) {
+            on_stage((SrsPipelineStageId)i, starttime);
+        }
+    }
+
+    return err;
+}
+
+srs_utime_t SrsMuxPipeline::on_stage(SrsPipelineStageId id, srs_utime_t starttime)
+{
+    srs_utime_t now = srs_update_system_time();
+    stages[id].on_frame(now - starttime);
+    return now;
+}
+
+SrsPipelineStage* SrsMuxPipeline::stage(SrsPipelineStageId id)
+{
+    return &stages[id];
+}
+
+SrsPipelineOutput* SrsMuxPipeline::ts_output()
+{
+    return ts;
+}
+
+SrsPipelineOutput* SrsMuxPipeline::flv_output()
+{
+    return flv;
+}
+
+SrsPipelineOutput* SrsMuxPipeline::aac_output()
+{
+    return aac;
+}
+
+SrsPipelineOutput* SrsMuxPipeline::mp3_output()
+{
+    return mp3;
+}
+
+void SrsMuxPipeline::dumps(SrsJsonObject* obj)
+{
+    SrsJsonObject* ostages = SrsJsonAny::object();
+    obj->set("stages", ostages);
+
+    for (int i = 0; i < SrsPipelineStageMax; i++) {
+        SrsPipelineStage* stage = &stages[i];
+
+        SrsJsonObject* ostage = SrsJsonAny::object();
+        ostages->set(stage->name, ostage);
+        stage->dumps(ostage);
+    }
+
+    SrsJsonObject* outputs = SrsJsonAny::object();
+    obj->set("outputs", outputs);
+
+    for (int i = SrsPipelineStageTs; i <= SrsPipelineStageMp3; i++) {
+        SrsJsonObject* o = SrsJsonAny::object();
+        outputs->set(stages[i].name, o);
+        output((SrsPipelineStageId)i)->dumps(o);
+    }
+}
+
+SrsPipelineOutput* SrsMuxPipeline::output(SrsPipelineStageId id)
+{
+    switch (id) {
+        case SrsPipelineStageTs: return ts;
+        case SrsPipelineStageFlv: return flv;
+        case SrsPipelineStageAac: return aac;
+        case SrsPipelineStageMp3: return mp3;
+        default: return NULL;
+    }
+}
+
@@ -0,0 +1,293 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_PIPELINE_HPP
+#define SRS_APP_PIPELINE_HPP
+
+#include <srs_core.hpp>
+
+#include <deque>
+#include <vector>
+
+#include <srs_kernel_io.hpp>
+#include <srs_kernel_stream.hpp>
+
+class SrsSharedPtrMessage;
+class SrsTsTransmuxer;
+class SrsFlvTransmuxer;
+class SrsAacTransmuxer;
+class SrsJsonObject;
+
+// The max bytes of chunk head, for example, the 11bytes FLV tag header, or 7bytes ADTS header.
+#define SRS_PIPELINE_CHUNK_HEAD 16
+// The max bytes of chunk tail, for example, the 4bytes FLV previous tag size.
+#define SRS_PIPELINE_CHUNK_TAIL 4
+// The max iovs of chunk, that is the head, body and tail.
+#define SRS_PIPELINE_CHUNK_IOVS 3
+
+// The stages of the muxing pipeline of a stream, each frame goes through them in order.
+enum SrsPipelineStageId
+{
+    SrsPipelineStageFormat = 0,
+    SrsPipelineStageHls,
+    SrsPipelineStageDash,
+    SrsPipelineStageDvr,
+    SrsPipelineStageHds,
+    SrsPipelineStageForward,
+    SrsPipelineStageTs,
+    SrsPipelineStageFlv,
+    SrsPipelineStageAac,
+    SrsPipelineStageMp3,
+    SrsPipelineStageMax,
+};
+
+// The cost of a stage, in the wall clock of the server coroutine.
+class SrsPipelineStage
+{
+public:
+    const char* name;
+    // The number of frames passed through this stage.
+    int64_t nn_frames;
+    // The total and max cost of a frame.
+    srs_utime_t cost;
+    srs_utime_t max_cost;
+public:
+    SrsPipelineStage();
+    virtual ~SrsPipelineStage();
+public:
+    virtual void on_frame(srs_utime_t elapsed);
+    virtual void dumps(SrsJsonObject* obj);
+};
+
+// The bytes muxed from a frame, shared by all viewers of the output.
+// The chunk is the head, body and tail, where the body is generally the payload of
+// the frame itself, so the viewer sends it without copy.
+class SrsPipelineChunk
+{
+public:
+    // The sequence number of chunk in output, monotonically increasing.
+    int64_t seq;
+    // The timestamp of frame in ms.
+    int64_t timestamp;
+    // Whether viewer could start from this chunk, for example, the PAT/PMT and keyframe.
+    bool join;
+public:
+    char head[SRS_PIPELINE_CHUNK_HEAD];
+    int nb_head;
+    // The body is the bytes of message from offset.
+    SrsSharedPtrMessage* body;
+    int offset;
+    char tail[SRS_PIPELINE_CHUNK_TAIL];
+    int nb_tail;
+public:
+    SrsPipelineChunk();
+    virtual ~SrsPipelineChunk();
+public:
+    // Create the body by the bytes, which is owned by chunk.
+    virtual srs_error_t create(char* data, int size);
+    // Copy the chunk, which shares the body.
+    virtual SrsPipelineChunk* copy();
+    virtual int size();
+    // Fill the iovs, at most SRS_PIPELINE_CHUNK_IOVS, return the number of iovs.
+    virtual int to_iovs(iovec* iovs);
+};
+
+// The viewer of output, which sends the chunks from its cursor.
+class SrsPipelineViewer
+{
+public:
+    // The sequence of next chunk to send.
+    int64_t cursor;
+    // Whether joined the output, that the headers is sent.
+    bool joined;
+    // Whether start at the last join point in cache, for example, the gop cache.
+    // Or wait for the next join point.
+    bool gop;
+    // Start at the first join point in this duration, for example, the fast cache of audio.
+    srs_utime_t fast_cache;
+public:
+    SrsPipelineViewer();
+    virtual ~SrsPipelineViewer();
+};
+
+// The output of pipeline, a format muxed once for all viewers, to a ring of chunks.
+// @remark The output only mux the frames when there is a viewer attached.
+class SrsPipelineOutput
+{
+protected:
+    // The chunks of the last and current GOP, at least the retention duration.
+    std::deque<SrsPipelineChunk*> chunks;
+    int64_t next_seq;
+    srs_utime_t retention;
+    // The number of attached viewers.
+    int nn_viewers;
+    // The number of chunks dropped for slow viewers.
+    int64_t nn_skipped;
+public:
+    SrsPipelineOutput();
+    virtual ~SrsPipelineOutput();
+public:
+    virtual srs_error_t initialize();
+    // Reset the muxer and drop the chunks, when stream is unpublished.
+    virtual srs_error_t reset();
+    // Viewer attach to and detach from the output.
+    virtual void attach(SrsPipelineViewer* viewer);
+    virtual void detach(SrsPipelineViewer* viewer);
+    virtual bool active();
+public:
+    virtual srs_error_t on_meta_data(SrsSharedPtrMessage* msg);
+    virtual srs_error_t on_audio(SrsSharedPtrMessage* msg) = 0;
+    virtual srs_error_t on_video(SrsSharedPtrMessage* msg) = 0;
+    // Fetch at most max chunks for viewer, each chunk in chunks is a copy which must be freed.
+    // The viewer which is not joined or falls out of the chunks, starts from a join point,
+    // and the headers of output is sent before it.
+    // @param max_bytes The max bytes to fetch, -1 for unlimited, the chunk exceeds it is still fetched.
+    virtual srs_error_t fetch(SrsPipelineViewer* viewer, std::vector<SrsPipelineChunk*>& msgs, int max, int64_t max_bytes = -1);
+    virtual void dumps(SrsJsonObject* obj);
+protected:
+    // Append the chunk to output, and shrink the chunks.
+    virtual void append(SrsPipelineChunk* chunk);
+    // Copy the headers to start the stream for viewer, for example, the FLV header and sequence headers.
+    // @param first Whether the first join of viewer, or rejoin after chunks dropped.
+    // @param timestamp The timestamp of the join point.
+    virtual void copy_headers(std::vector<SrsPipelineChunk*>& msgs, bool first, int64_t timestamp);
+private:
+    virtual SrsPipelineChunk* join_point(SrsPipelineViewer* viewer);
+    virtual void clear();
+};
+
+// The TS output, the frame is muxed to TS packets, where PAT/PMT is written before
+// keyframe for viewer to join.
+class SrsPipelineTs : public SrsPipelineOutput, public ISrsStreamWriter
+{
+private:
+    SrsTsTransmuxer* transmuxer;
+    // The TS packets of current frame.
+    SrsSimpleStream* buffer;
+    // Whether the stream has video, for pure audio, join at interval.
+    bool has_video;
+    int64_t last_join;
+public:
+    SrsPipelineTs();
+    virtual ~SrsPipelineTs();
+public:
+    virtual srs_error_t reset();
+    virtual srs_error_t on_audio(SrsSharedPtrMessage* msg);
+    virtual srs_error_t on_video(SrsSharedPtrMessage* msg);
+// Interface ISrsStreamWriter
+public:
+    virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
+private:
+    virtual srs_error_t flush(int64_t timestamp, bool join);
+};
+
+// The FLV output, the chunk is the tag header and pts, and the payload of message.
+class SrsPipelineFlv : public SrsPipelineOutput
+{
+private:
+    SrsFlvTransmuxer* transmuxer;
+    // The metadata and sequence headers, sent to viewer when join.
+    SrsPipelineChunk* meta;
+    SrsPipelineChunk* vsh;
+    SrsPipelineChunk* ash;
+    bool has_video;
+    bool has_audio;
+public:
+    SrsPipelineFlv();
+    virtual ~SrsPipelineFlv();
+public:
+    virtual srs_error_t reset();
+    virtual srs_error_t on_meta_data(SrsSharedPtrMessage* msg);
+    virtual srs_error_t on_audio(SrsSharedPtrMessage* msg);
+    virtual srs_error_t on_video(SrsSharedPtrMessage* msg);
+protected:
+    virtual void copy_headers(std::vector<SrsPipelineChunk*>& msgs, bool first, int64_t timestamp);
+private:
+    virtual SrsPipelineChunk* create_tag(SrsSharedPtrMessage* msg);
+};
+
+// The AAC output, the chunk is the ADTS header and the raw frame in message.
+class SrsPipelineAac : public SrsPipelineOutput
+{
+private:
+    SrsAacTransmuxer* transmuxer;
+public:
+    SrsPipelineAac();
+    virtual ~SrsPipelineAac();
+public:
+    virtual srs_error_t reset();
+    virtual srs_error_t on_audio(SrsSharedPtrMessage* msg);
+    virtual srs_error_t on_video(SrsSharedPtrMessage* msg);
+};
+
+// The MP3 output, the chunk is the mp3 frame in message.
+class SrsPipelineMp3 : public SrsPipelineOutput
+{
+private:
+    // The ID3 header, sent to viewer when join.
+    SrsPipelineChunk* id3;
+public:
+    SrsPipelineMp3();
+    virtual ~SrsPipelineMp3();
+public:
+    virtual srs_error_t initialize();
+    virtual srs_error_t on_audio(SrsSharedPtrMessage* msg);
+    virtual srs_error_t on_video(SrsSharedPtrMessage* msg);
+protected:
+    virtual void copy_headers(std::vector<SrsPipelineChunk*>& msgs, bool first, int64_t timestamp);
+};
+
+// The muxing pipeline of a stream, to share the output formats between sinks,
+// and measure the cost of each stage.
+class SrsMuxPipeline
+{
+private:
+    SrsPipelineStage stages[SrsPipelineStageMax];
+    SrsPipelineTs* ts;
+    SrsPipelineFlv* flv;
+    SrsPipelineAac* aac;
+    SrsPipelineMp3* mp3;
+public:
+    SrsMuxPipeline();
+    virtual ~SrsMuxPipeline();
+public:
+    virtual srs_error_t initialize();
+    virtual srs_error_t on_unpublish();
+    virtual srs_error_t on_meta_data(SrsSharedPtrMessage* msg);
+    virtual srs_error_t on_audio(SrsSharedPtrMessage* msg);
+    virtual srs_error_t on_video(SrsSharedPtrMessage* msg);
+    // Update the stage by the time elapsed from starttime, return the current time,
+    // which is the starttime of next stage.
+    virtual srs_utime_t on_stage(SrsPipelineStageId id, srs_utime_t starttime);
+    virtual SrsPipelineStage* stage(SrsPipelineStageId id);
+    virtual SrsPipelineOutput* ts_output();
+    virtual SrsPipelineOutput* flv_output();
+    virtual SrsPipelineOutput* aac_output();
+    virtual SrsPipelineOutput* mp3_output();
+    virtual void dumps(SrsJsonObject* obj);
+private:
+    virtual SrsPipelineOutput* output(SrsPipelineStageId id);
+};
+
+#endif
+
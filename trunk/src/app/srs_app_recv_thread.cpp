@@ -430,6 +430,11 @@ void SrsPublishRecvThread::on_start()
         rtmp->set_merge_read(true, this);
     }
 #endif
+    
+#ifdef SRS_PERF_ZERO_COPY_READ
+    // the audio and video of publisher reference the receive buffer.
+    rtmp->set_zero_copy_read(true);
+#endif
 }
 
 void SrsPublishRecvThread::on_stop()
@@ -448,6 +453,10 @@ void SrsPublishRecvThread::on_stop()
         rtmp->set_merge_read(false, NULL);
     }
 #endif
+    
+#ifdef SRS_PERF_ZERO_COPY_READ
+    rtmp->set_zero_copy_read(false);
+#endif
 }
 
 #ifdef SRS_PERF_MERGED_READ
@@ -180,6 +180,11 @@ srs_error_t ISrsReloadHandler::on_reload_vhost_tcp_nodelay(string /*vhost*/)
     return srs_success;
 }
 
+srs_error_t ISrsReloadHandler::on_reload_vhost_security(string /*vhost*/)
+{
+    return srs_success;
+}
+
 srs_error_t ISrsReloadHandler::on_reload_vhost_realtime(string /*vhost*/)
 {
     return srs_success;
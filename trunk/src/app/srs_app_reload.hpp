@@ -70,6 +70,7 @@ public:
     virtual srs_error_t on_reload_vhost_dvr_apply(std::string vhost);
     virtual srs_error_t on_reload_vhost_publish(std::string vhost);
     virtual srs_error_t on_reload_vhost_tcp_nodelay(std::string vhost);
+    virtual srs_error_t on_reload_vhost_security(std::string vhost);
     virtual srs_error_t on_reload_vhost_realtime(std::string vhost);
     virtual srs_error_t on_reload_vhost_chunk_size(std::string vhost);
     virtual srs_error_t on_reload_vhost_transcode(std::string vhost);
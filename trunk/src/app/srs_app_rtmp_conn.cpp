@@ -55,6 +55,8 @@ using namespace std;
 #include <srs_app_statistic.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_protocol_json.hpp>
+#include <srs_app_workers.hpp>
+#include <srs_app_mw_scheduler.hpp>
 
 // the timeout in srs_utime_t to wait encoder to republish
 // if timeout, close the connection.
@@ -118,6 +120,8 @@ SrsRtmpConn::SrsRtmpConn(SrsServer* svr, srs_netfd_t c, string cip) : SrsConnect
     mw_sleep = SRS_PERF_MW_SLEEP;
     mw_enabled = false;
     realtime = SRS_PERF_MIN_LATENCY_ENABLED;
+    gop_flush = false;
+    mw_scheduler = new SrsMwScheduler();
     send_min_interval = 0;
     tcp_nodelay = false;
     info = new SrsClientInfo();
@@ -134,6 +138,7 @@ SrsRtmpConn::~SrsRtmpConn()
     srs_freep(refer);
     srs_freep(bandwidth);
     srs_freep(security);
+    srs_freep(mw_scheduler);
 }
 
 void SrsRtmpConn::dispose()
@@ -199,6 +204,9 @@ srs_error_t SrsRtmpConn::do_cycle()
         if ((prop = req->args->ensure_property_number("srs_id")) != NULL) {
             srs_id = (int)prop->to_number();
         }
+        if ((prop = req->args->get_property("srs_gop_flush")) != NULL && prop->is_boolean()) {
+            gop_flush = prop->to_boolean();
+        }
         
         if (srs_pid > 0) {
             srs_trace("edge-srs ip=%s, version=%s, pid=%d, id=%d",
@@ -332,6 +340,18 @@ void SrsRtmpConn::remark(int64_t* in, int64_t* out)
     kbps->remark(in, out);
 }
 
+void SrsRtmpConn::dumps(SrsJsonObject* obj)
+{
+    if (srs_client_type_is_publish(info->type)) {
+        return;
+    }
+    
+    SrsJsonObject* mw = SrsJsonAny::object();
+    obj->set("mw", mw);
+    
+    mw_scheduler->dumps(mw);
+}
+
 srs_error_t SrsRtmpConn::service_cycle()
 {
     srs_error_t err = srs_success;
@@ -469,9 +489,9 @@ srs_error_t SrsRtmpConn::stream_service_cycle()
     // do token traverse before serve it.
     // @see https://github.com/ossrs/srs/pull/239
     if (true) {
-        info->edge = _srs_config->get_vhost_is_edge(req->vhost);
+        info->edge = SrsWorkers::instance()->is_edge(req);
         bool edge_traverse = _srs_config->get_vhost_edge_token_traverse(req->vhost);
-        if (info->edge && edge_traverse) {
+        if (_srs_config->get_vhost_is_edge(req->vhost) && edge_traverse) {
             if ((err = check_edge_token_traverse_auth()) != srs_success) {
                 return srs_error_wrap(err, "rtmp: check token traverse");
             }
@@ -644,13 +664,26 @@ srs_error_t SrsRtmpConn::playing(SrsSource* source)
     // Set the socket options for transport.
     set_sock_options();
     
+    // The time-shift offset from live, for example, ?start=-60s
+    srs_utime_t shift = 0;
+    if (true) {
+        std::map<std::string, std::string> query;
+        srs_parse_query_string(srs_string_trim_start(req->param, "?"), query);
+        if (query.find("start") != query.end()) {
+            shift = srs_time_shift_parse(query["start"]);
+        }
+    }
+    
     // Create a consumer of source.
     SrsConsumer* consumer = NULL;
-    if ((err = source->create_consumer(this, consumer)) != srs_success) {
+    if ((err = source->create_consumer(this, consumer, true, true, true, shift)) != srs_success) {
         return srs_error_wrap(err, "rtmp: create consumer");
     }
     SrsAutoFree(SrsConsumer, consumer);
     
+    // Pace the gop cache and catch-up burst to player.
+    consumer->enable_pacing(req->vhost);
+    
     // Use receiving thread to receive packets from peer.
     // @see: https://github.com/ossrs/srs/issues/217
     SrsQueueRecvThread trd(consumer, rtmp, SRS_PERF_MW_SLEEP, _srs_context->get_id());
@@ -699,8 +732,24 @@ srs_error_t SrsRtmpConn::do_playing(SrsSource* source, SrsConsumer* consumer, Sr
     // initialize the send_min_interval
     send_min_interval = _srs_config->get_send_min_interval(req->vhost);
     
-    srs_trace("start play smi=%dms, mw_sleep=%d, mw_enabled=%d, realtime=%d, tcp_nodelay=%d",
-        srsu2msi(send_min_interval), srsu2msi(mw_sleep), mw_enabled, realtime, tcp_nodelay);
+    // setup the latency class of player by param, the edge is bulk.
+    if (true) {
+        std::map<std::string, std::string> query;
+        srs_parse_query_string(srs_string_trim_start(req->param, "?"), query);
+        
+        SrsMwLatencyClass latency = gop_flush? SrsMwLatencyBulk : SrsMwLatencyNormal;
+        if (query.find("latency") != query.end()) {
+            latency = srs_mw_latency_parse(query["latency"]);
+        }
+        mw_scheduler->set_latency(latency);
+    }
+    
+    srs_trace("start play smi=%dms, mw_sleep=%d, mw_enabled=%d, realtime=%d, tcp_nodelay=%d, gop_flush=%d, latency=%s",
+        srsu2msi(send_min_interval), srsu2msi(mw_sleep), mw_enabled, realtime, tcp_nodelay, gop_flush,
+        srs_mw_latency_string(mw_scheduler->latency_class()).c_str());
+    
+    // For edge, send the dumped gop cache without waiting for merged-write.
+    bool flush_now = gop_flush;
     
     while (true) {
         // when source is set to expired, disconnect it.
@@ -730,12 +779,13 @@ srs_error_t SrsRtmpConn::do_playing(SrsSource* source, SrsConsumer* consumer, Sr
         // wait for message to incoming.
         // @see https://github.com/ossrs/srs/issues/251
         // @see https://github.com/ossrs/srs/issues/257
-        if (realtime) {
-            // for realtime, min required msgs is 0, send when got one+ msgs.
-            consumer->wait(0, mw_sleep);
+        if (flush_now) {
+            flush_now = false;
         } else {
-            // for no-realtime, got some msgs then send.
-            consumer->wait(SRS_PERF_MW_MIN_MSGS, mw_sleep);
+            // the batch is sized by the scheduler, for realtime, min required msgs is 0,
+            // send when got one+ msgs, for no-realtime, got some msgs then send.
+            mw_scheduler->schedule(realtime, mw_sleep);
+            consumer->wait(mw_scheduler->min_msgs(), mw_scheduler->duration());
         }
 #endif
         
@@ -750,9 +800,10 @@ srs_error_t SrsRtmpConn::do_playing(SrsSource* source, SrsConsumer* consumer, Sr
         // reportable
         if (pprint->can_print()) {
             kbps->sample();
-            srs_trace("-> " SRS_CONSTS_LOG_PLAY " time=%d, msgs=%d, okbps=%d,%d,%d, ikbps=%d,%d,%d, mw=%d",
+            srs_trace("-> " SRS_CONSTS_LOG_PLAY " time=%d, msgs=%d, okbps=%d,%d,%d, ikbps=%d,%d,%d, mw=%d, drop=%d",
                 (int)pprint->age(), count, kbps->get_send_kbps(), kbps->get_send_kbps_30s(), kbps->get_send_kbps_5m(),
-                kbps->get_recv_kbps(), kbps->get_recv_kbps_30s(), kbps->get_recv_kbps_5m(), srsu2msi(mw_sleep));
+                kbps->get_recv_kbps(), kbps->get_recv_kbps_30s(), kbps->get_recv_kbps_5m(), srsu2msi(mw_scheduler->duration()),
+                (int)consumer->dropped()->total());
         }
         
         if (count <= 0) {
@@ -779,11 +830,20 @@ srs_error_t SrsRtmpConn::do_playing(SrsSource* source, SrsConsumer* consumer, Sr
             }
         }
         
+        // collect the batch for scheduler, before messages are freed.
+        int64_t nb_bytes = 0;
+        for (int i = 0; i < count; i++) {
+            nb_bytes += msgs.msgs[i]->size;
+        }
+        srs_utime_t batch_duration = (msgs.msgs[count - 1]->timestamp - msgs.msgs[0]->timestamp) * SRS_UTIME_MILLISECONDS;
+        srs_utime_t sendtime = srs_update_system_time();
+        
         // sendout messages, all messages are freed by send_and_free_messages().
         // no need to assert msg, for the rtmp will assert it.
         if (count > 0 && (err = rtmp->send_and_free_messages(msgs.msgs, count, info->res->stream_id)) != srs_success) {
             return srs_error_wrap(err, "rtmp: send %d messages", count);
         }
+        mw_scheduler->on_send(count, nb_bytes, batch_duration, srs_update_system_time() - sendtime);
         
         // if duration specified, and exceed it, stop play live.
         // @see: https://github.com/ossrs/srs/issues/45
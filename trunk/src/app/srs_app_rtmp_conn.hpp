@@ -54,6 +54,8 @@ class SrsSecurity;
 class ISrsWakable;
 class SrsCommonMessage;
 class SrsPacket;
+class SrsMwScheduler;
+class SrsJsonObject;
 
 // The simple rtmp client for SRS.
 class SrsSimpleRtmpClient : public SrsBasicRtmpClient
@@ -107,6 +109,10 @@ private:
     // For realtime
     // @see https://github.com/ossrs/srs/issues/257
     bool realtime;
+    // Whether flush the gop cache without merged-write, hinted by edge.
+    bool gop_flush;
+    // The adaptive MW(merged-write) scheduler for player.
+    SrsMwScheduler* mw_scheduler;
     // The minimal interval in srs_utime_t for delivery stream.
     srs_utime_t send_min_interval;
     // The publish 1st packet timeout in srs_utime_t
@@ -134,6 +140,8 @@ public:
 // Interface ISrsKbpsDelta
 public:
     virtual void remark(int64_t* in, int64_t* out);
+public:
+    virtual void dumps(SrsJsonObject* obj);
 private:
     // When valid and connected to vhost/app, service the client.
     virtual srs_error_t service_cycle();
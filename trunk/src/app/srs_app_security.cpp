@@ -23,135 +23,398 @@
 
 #include <srs_app_security.hpp>
 
+#include <arpa/inet.h>
+#include <string.h>
+#include <stdlib.h>
+using namespace std;
+
 #include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
 #include <srs_app_config.hpp>
 
-using namespace std;
+// Parse the ip or CIDR to IPv6 address and prefix length, where IPv4 is mapped to IPv6.
+static bool srs_parse_cidr(string cidr, uint8_t* addr, int& prefix)
+{
+    string ip = cidr;
+    int bits = -1;
+    
+    size_t pos = cidr.find("/");
+    if (pos != string::npos) {
+        ip = cidr.substr(0, pos);
+        
+        string v = cidr.substr(pos + 1);
+        if (v.empty() || v.length() > 3 || v.find_first_not_of("0123456789") != string::npos) {
+            return false;
+        }
+        bits = ::atoi(v.c_str());
+    }
+    
+    memset(addr, 0, 16);
+    
+    if (inet_pton(AF_INET, ip.c_str(), addr + 12) == 1) {
+        if (bits > 32) {
+            return false;
+        }
+        addr[10] = addr[11] = 0xff;
+        prefix = 96 + (bits < 0? 32 : bits);
+        return true;
+    }
+    
+    if (inet_pton(AF_INET6, ip.c_str(), addr) == 1) {
+        if (bits > 128) {
+            return false;
+        }
+        prefix = bits < 0? 128 : bits;
+        return true;
+    }
+    
+    return false;
+}
 
-SrsSecurity::SrsSecurity()
+SrsCidrNode::SrsCidrNode()
 {
+    children[0] = children[1] = 0;
+    rule = -1;
 }
 
-SrsSecurity::~SrsSecurity()
+SrsCidrNode::~SrsCidrNode()
 {
 }
 
-srs_error_t SrsSecurity::check(SrsRtmpConnType type, string ip, SrsRequest* req)
+SrsCidrTrie::SrsCidrTrie()
+{
+    nodes.push_back(SrsCidrNode());
+}
+
+SrsCidrTrie::~SrsCidrTrie()
+{
+}
+
+srs_error_t SrsCidrTrie::insert(string cidr, int rule)
 {
     srs_error_t err = srs_success;
+    
+    uint8_t addr[16];
+    int prefix = 0;
+    if (!srs_parse_cidr(cidr, addr, prefix)) {
+        return srs_error_new(ERROR_SYSTEM_SECURITY, "invalid cidr %s", cidr.c_str());
+    }
+    
+    int index = 0;
+    for (int i = 0; i < prefix; i++) {
+        int bit = (addr[i / 8] >> (7 - i % 8)) & 0x01;
+        if (!nodes[index].children[bit]) {
+            nodes.push_back(SrsCidrNode());
+            nodes[index].children[bit] = (int)nodes.size() - 1;
+        }
+        index = nodes[index].children[bit];
+    }
+    
+    // Keep the first rule of the same prefix.
+    if (nodes[index].rule < 0) {
+        nodes[index].rule = rule;
+    }
+    
+    return err;
+}
 
-    // allow all if security disabled.
-    if (!_srs_config->get_security_enabled(req->vhost)) {
-        return err; // OK
+int SrsCidrTrie::match(string ip)
+{
+    // The root matches all, even the ip is invalid.
+    if (nodes[0].rule >= 0) {
+        return nodes[0].rule;
     }
+    
+    uint8_t addr[16];
+    int prefix = 0;
+    if (!srs_parse_cidr(ip, addr, prefix)) {
+        return -1;
+    }
+    
+    int index = 0;
+    for (int i = 0; i < prefix; i++) {
+        int bit = (addr[i / 8] >> (7 - i % 8)) & 0x01;
+        if ((index = nodes[index].children[bit]) == 0) {
+            return -1;
+        }
+        if (nodes[index].rule >= 0) {
+            return nodes[index].rule;
+        }
+    }
+    
+    return -1;
+}
 
-    // rules to apply
-    SrsConfDirective* rules = _srs_config->get_security_rules(req->vhost);
-    return do_check(rules, type, ip, req);
+int SrsCidrTrie::size()
+{
+    return (int)nodes.size();
 }
 
-srs_error_t SrsSecurity::do_check(SrsConfDirective* rules, SrsRtmpConnType type, string ip, SrsRequest* req)
+SrsSecurityAcl::SrsSecurityAcl()
+{
+    enabled = false;
+    nn_allows = nn_denies = 0;
+    allow_play = new SrsCidrTrie();
+    allow_publish = new SrsCidrTrie();
+    deny_play = new SrsCidrTrie();
+    deny_publish = new SrsCidrTrie();
+}
+
+SrsSecurityAcl::~SrsSecurityAcl()
+{
+    srs_freep(allow_play);
+    srs_freep(allow_publish);
+    srs_freep(deny_play);
+    srs_freep(deny_publish);
+}
+
+srs_error_t SrsSecurityAcl::initialize(SrsConfDirective* conf)
 {
     srs_error_t err = srs_success;
+    
+    // Default deny all, if no rules.
+    if (!conf) {
+        return err;
+    }
+    enabled = true;
+    
+    for (int i = 0; i < (int)conf->directives.size(); i++) {
+        SrsConfDirective* rule = conf->at(i);
+        
+        SrsCidrTrie* trie = NULL;
+        if (rule->name == "allow") {
+            nn_allows++;
+            if (rule->arg0() == "play") {
+                trie = allow_play;
+            } else if (rule->arg0() == "publish") {
+                trie = allow_publish;
+            }
+        } else if (rule->name == "deny") {
+            nn_denies++;
+            if (rule->arg0() == "play") {
+                trie = deny_play;
+            } else if (rule->arg0() == "publish") {
+                trie = deny_publish;
+            }
+        }
+        
+        if (!trie) {
+            continue;
+        }
+        
+        string cidr = rule->arg1();
+        rules.push_back(cidr);
+        
+        // The all is the prefix of all addresses.
+        if (cidr == "all") {
+            cidr = "::/0";
+        }
+        
+        if ((err = trie->insert(cidr, (int)rules.size() - 1)) != srs_success) {
+            srs_warn("security: ignore %s %s %s, %s", rule->name.c_str(), rule->arg0().c_str(),
+                rule->arg1().c_str(), srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+    }
+    
+    return err;
+}
 
-    if (!rules) {
+srs_error_t SrsSecurityAcl::check(SrsRtmpConnType type, string ip)
+{
+    srs_error_t err = srs_success;
+    
+    if (!enabled) {
         return srs_error_new(ERROR_SYSTEM_SECURITY, "default deny for %s", ip.c_str());
     }
-
+    
     // deny if matches deny strategy.
-    if ((err = deny_check(rules, type, ip)) != srs_success) {
+    if ((err = deny_check(type, ip)) != srs_success) {
         return srs_error_wrap(err, "for %s", ip.c_str());
     }
     
     // allow if matches allow strategy.
-    if ((err = allow_check(rules, type, ip)) != srs_success) {
+    if ((err = allow_check(type, ip)) != srs_success) {
         return srs_error_wrap(err, "for %s", ip.c_str());
     }
-
+    
     return err;
 }
 
-srs_error_t SrsSecurity::allow_check(SrsConfDirective* rules, SrsRtmpConnType type, std::string ip)
+srs_error_t SrsSecurityAcl::allow_check(SrsRtmpConnType type, string ip)
+{
+    SrsCidrTrie* trie = NULL;
+    
+    switch (type) {
+        case SrsRtmpConnPlay:
+            trie = allow_play;
+            break;
+        case SrsRtmpConnFMLEPublish:
+        case SrsRtmpConnFlashPublish:
+        case SrsRtmpConnHaivisionPublish:
+            trie = allow_publish;
+            break;
+        case SrsRtmpConnUnknown:
+        default:
+            break;
+    }
+    
+    if (trie && trie->match(ip) >= 0) {
+        return srs_success; // OK
+    }
+    
+    if (nn_allows > 0 || (nn_denies + nn_allows) == 0) {
+        return srs_error_new(ERROR_SYSTEM_SECURITY_ALLOW, "not allowed by any of %d/%d rules", nn_allows, nn_denies);
+    }
+    return srs_success; // OK
+}
+
+srs_error_t SrsSecurityAcl::deny_check(SrsRtmpConnType type, string ip)
 {
-    int allow_rules = 0;
-    int deny_rules = 0;
+    SrsCidrTrie* trie = NULL;
+    
+    switch (type) {
+        case SrsRtmpConnPlay:
+            trie = deny_play;
+            break;
+        case SrsRtmpConnFMLEPublish:
+        case SrsRtmpConnFlashPublish:
+        case SrsRtmpConnHaivisionPublish:
+            trie = deny_publish;
+            break;
+        case SrsRtmpConnUnknown:
+        default:
+            break;
+    }
+    
+    int rule = trie? trie->match(ip) : -1;
+    if (rule >= 0) {
+        return srs_error_new(ERROR_SYSTEM_SECURITY_DENY, "deny by rule<%s>", rules.at(rule).c_str());
+    }
+    
+    return srs_success; // OK
+}
 
-    for (int i = 0; i < (int)rules->directives.size(); i++) {
-        SrsConfDirective* rule = rules->at(i);
+SrsSecurityAcls* SrsSecurityAcls::_instance = NULL;
 
-        if (rule->name != "allow") {
-            if (rule->name == "deny") {
-                deny_rules++;
-            }
-            continue;
-        }
-        allow_rules++;
-
-        switch (type) {
-            case SrsRtmpConnPlay:
-                if (rule->arg0() != "play") {
-                    break;
-                }
-                if (rule->arg1() == "all" || rule->arg1() == ip) {
-                    return srs_success; // OK
-                }
-                break;
-            case SrsRtmpConnFMLEPublish:
-            case SrsRtmpConnFlashPublish:
-            case SrsRtmpConnHaivisionPublish:
-                if (rule->arg0() != "publish") {
-                    break;
-                }
-                if (rule->arg1() == "all" || rule->arg1() == ip) {
-                    return srs_success; // OK
-                }
-                break;
-            case SrsRtmpConnUnknown:
-            default:
-                break;
-        }
+SrsSecurityAcls::SrsSecurityAcls()
+{
+    _srs_config->subscribe(this);
+}
+
+SrsSecurityAcls::~SrsSecurityAcls()
+{
+    _srs_config->unsubscribe(this);
+    
+    std::map<std::string, SrsSecurityAcl*>::iterator it;
+    for (it = acls.begin(); it != acls.end(); ++it) {
+        SrsSecurityAcl* acl = it->second;
+        srs_freep(acl);
     }
+    acls.clear();
+}
 
-    if (allow_rules > 0 || (deny_rules + allow_rules) == 0) {
-        return srs_error_new(ERROR_SYSTEM_SECURITY_ALLOW, "not allowed by any of %d/%d rules", allow_rules, deny_rules);
+SrsSecurityAcls* SrsSecurityAcls::instance()
+{
+    if (_instance == NULL) {
+        _instance = new SrsSecurityAcls();
     }
-    return srs_success; // OK
+    return _instance;
 }
 
-srs_error_t SrsSecurity::deny_check(SrsConfDirective* rules, SrsRtmpConnType type, std::string ip)
+srs_error_t SrsSecurityAcls::fetch(string vhost, SrsSecurityAcl** pacl)
 {
-    for (int i = 0; i < (int)rules->directives.size(); i++) {
-        SrsConfDirective* rule = rules->at(i);
-        
-        if (rule->name != "deny") {
-            continue;
-        }
-        
-        switch (type) {
-            case SrsRtmpConnPlay:
-                if (rule->arg0() != "play") {
-                    break;
-                }
-                if (rule->arg1() == "all" || rule->arg1() == ip) {
-                    return srs_error_new(ERROR_SYSTEM_SECURITY_DENY, "deny by rule<%s>", rule->arg1().c_str());
-                }
-                break;
-            case SrsRtmpConnFMLEPublish:
-            case SrsRtmpConnFlashPublish:
-            case SrsRtmpConnHaivisionPublish:
-                if (rule->arg0() != "publish") {
-                    break;
-                }
-                if (rule->arg1() == "all" || rule->arg1() == ip) {
-                    return srs_error_new(ERROR_SYSTEM_SECURITY_DENY, "deny by rule<%s>", rule->arg1().c_str());
-                }
-                break;
-            case SrsRtmpConnUnknown:
-            default:
-                break;
-        }
+    srs_error_t err = srs_success;
+    
+    std::map<std::string, SrsSecurityAcl*>::iterator it = acls.find(vhost);
+    if (it != acls.end()) {
+        *pacl = it->second;
+        return err;
     }
     
-    return srs_success; // OK
+    SrsSecurityAcl* acl = new SrsSecurityAcl();
+    if ((err = acl->initialize(_srs_config->get_security_rules(vhost))) != srs_success) {
+        srs_freep(acl);
+        return srs_error_wrap(err, "compile rules of %s", vhost.c_str());
+    }
+    
+    acls[vhost] = acl;
+    *pacl = acl;
+    
+    return err;
 }
 
+void SrsSecurityAcls::clear(string vhost)
+{
+    std::map<std::string, SrsSecurityAcl*>::iterator it = acls.find(vhost);
+    if (it != acls.end()) {
+        SrsSecurityAcl* acl = it->second;
+        srs_freep(acl);
+        acls.erase(it);
+    }
+}
+
+srs_error_t SrsSecurityAcls::on_reload_vhost_added(string vhost)
+{
+    clear(vhost);
+    return srs_success;
+}
+
+srs_error_t SrsSecurityAcls::on_reload_vhost_removed(string vhost)
+{
+    clear(vhost);
+    return srs_success;
+}
+
+srs_error_t SrsSecurityAcls::on_reload_vhost_security(string vhost)
+{
+    srs_error_t err = srs_success;
+    
+    // Compile the rules when reload, not when client connects.
+    clear(vhost);
+    
+    SrsSecurityAcl* acl = NULL;
+    if ((err = fetch(vhost, &acl)) != srs_success) {
+        return srs_error_wrap(err, "reload security of %s", vhost.c_str());
+    }
+    
+    return err;
+}
+
+SrsSecurity::SrsSecurity()
+{
+}
+
+SrsSecurity::~SrsSecurity()
+{
+}
+
+srs_error_t SrsSecurity::check(SrsRtmpConnType type, string ip, SrsRequest* req)
+{
+    srs_error_t err = srs_success;
+
+    // allow all if security disabled.
+    if (!_srs_config->get_security_enabled(req->vhost)) {
+        return err; // OK
+    }
+
+    // rules to apply, compiled once for vhost.
+    SrsSecurityAcl* acl = NULL;
+    if ((err = SrsSecurityAcls::instance()->fetch(req->vhost, &acl)) != srs_success) {
+        return srs_error_wrap(err, "fetch rules");
+    }
+    
+    return acl->check(type, ip);
+}
+
+srs_error_t SrsSecurity::do_check(SrsConfDirective* rules, SrsRtmpConnType type, string ip, SrsRequest* req)
+{
+    srs_error_t err = srs_success;
+    
+    SrsSecurityAcl acl;
+    if ((err = acl.initialize(rules)) != srs_success) {
+        return srs_error_wrap(err, "compile rules");
+    }
+    
+    return acl.check(type, ip);
+}
@@ -27,11 +27,98 @@
 #include <srs_core.hpp>
 
 #include <string>
+#include <map>
+#include <vector>
 
 #include <srs_rtmp_stack.hpp>
+#include <srs_app_reload.hpp>
 
 class SrsConfDirective;
 
+// The node of CIDR trie, the child for each bit of address.
+class SrsCidrNode
+{
+public:
+    // The index of child node for bit 0 and 1, or 0 if no child.
+    int children[2];
+    // The index of rule which ends at this node, or -1 if not.
+    int rule;
+public:
+    SrsCidrNode();
+    virtual ~SrsCidrNode();
+};
+
+// The binary prefix trie of IPv4 and IPv6 CIDR, where the IPv4 is mapped to IPv6 as
+// ::ffff:0:0/96, so lookup is at most 128 steps, no matter how many CIDRs.
+class SrsCidrTrie
+{
+private:
+    // The nodes in a vector, the root is the first one.
+    std::vector<SrsCidrNode> nodes;
+public:
+    SrsCidrTrie();
+    virtual ~SrsCidrTrie();
+public:
+    // Insert the CIDR such as 192.168.1.0/24 or 2001:db8::/32, or a single IP.
+    // @param rule The index of rule, returned when matched.
+    virtual srs_error_t insert(std::string cidr, int rule);
+    // Match the ip, return the index of rule of the shortest matched prefix, or -1 if not matched.
+    virtual int match(std::string ip);
+    // Get the number of nodes.
+    virtual int size();
+};
+
+// The security rules of vhost, compiled to CIDR tries.
+class SrsSecurityAcl
+{
+private:
+    bool enabled;
+    int nn_allows;
+    int nn_denies;
+    // The args of rules, to describe the matched rule.
+    std::vector<std::string> rules;
+    SrsCidrTrie* allow_play;
+    SrsCidrTrie* allow_publish;
+    SrsCidrTrie* deny_play;
+    SrsCidrTrie* deny_publish;
+public:
+    SrsSecurityAcl();
+    virtual ~SrsSecurityAcl();
+public:
+    // Compile the rules, NULL to deny all.
+    // @remark The invalid ip is ignored, which never match.
+    virtual srs_error_t initialize(SrsConfDirective* rules);
+    virtual srs_error_t check(SrsRtmpConnType type, std::string ip);
+private:
+    virtual srs_error_t allow_check(SrsRtmpConnType type, std::string ip);
+    virtual srs_error_t deny_check(SrsRtmpConnType type, std::string ip);
+};
+
+// The compiled security rules of all vhosts, compiled when used, and
+// recompiled when reload.
+class SrsSecurityAcls : public ISrsReloadHandler
+{
+private:
+    static SrsSecurityAcls* _instance;
+    std::map<std::string, SrsSecurityAcl*> acls;
+private:
+    SrsSecurityAcls();
+public:
+    virtual ~SrsSecurityAcls();
+public:
+    static SrsSecurityAcls* instance();
+public:
+    // Fetch the compiled rules of vhost, compile it if not.
+    virtual srs_error_t fetch(std::string vhost, SrsSecurityAcl** pacl);
+private:
+    virtual void clear(std::string vhost);
+// Interface ISrsReloadHandler
+public:
+    virtual srs_error_t on_reload_vhost_added(std::string vhost);
+    virtual srs_error_t on_reload_vhost_removed(std::string vhost);
+    virtual srs_error_t on_reload_vhost_security(std::string vhost);
+};
+
 // The security apply on vhost.
 // @see https://github.com/ossrs/srs/issues/211
 class SrsSecurity
@@ -46,9 +133,8 @@ public:
     // @param req the request object of client.
     virtual srs_error_t check(SrsRtmpConnType type, std::string ip, SrsRequest* req);
 private:
+    // Check by the rules, which is compiled for each check.
     virtual srs_error_t do_check(SrsConfDirective* rules, SrsRtmpConnType type, std::string ip, SrsRequest* req);
-    virtual srs_error_t allow_check(SrsConfDirective* rules, SrsRtmpConnType type, std::string ip);
-    virtual srs_error_t deny_check(SrsConfDirective* rules, SrsRtmpConnType type, std::string ip);
 };
 
 #endif
@@ -54,6 +54,7 @@ using namespace std;
 #include <srs_kernel_consts.hpp>
 #include <srs_app_thread.hpp>
 #include <srs_app_coworkers.hpp>
+#include <srs_app_workers.hpp>
 
 // system interval in srs_utime_t,
 // all resolution times should be times togother,
@@ -809,6 +810,11 @@ srs_error_t SrsServer::acquire_pid_file()
         return srs_success;
     }
     
+    // for workers mode, the pid file is held by master.
+    if (SrsWorkers::instance()->is_worker()) {
+        return srs_success;
+    }
+    
     std::string pid_file = _srs_config->get_pid_file();
     
     // -rw-r--r--
@@ -1145,6 +1151,11 @@ srs_error_t SrsServer::do_cycle()
                 return srs_error_new(ERROR_ASPROCESS_PPID, "asprocess ppid changed from %d to %d", ppid, ::getppid());
             }
             
+            // worker quit when master terminated.
+            if ((err = SrsWorkers::instance()->check_master()) != srs_success) {
+                return srs_error_wrap(err, "check master");
+            }
+            
             // gracefully quit for SIGINT or SIGTERM or SIGQUIT.
             if (signal_fast_quit || signal_gracefully_quit) {
                 srs_trace("cleanup for quit signal fast=%d, grace=%d", signal_fast_quit, signal_gracefully_quit);
@@ -1260,6 +1271,20 @@ srs_error_t SrsServer::listen_rtmp()
         }
     }
     
+    // For workers mode, listen at the relay port, for other workers to relay the streams we owned.
+    SrsWorkers* workers = SrsWorkers::instance();
+    if (workers->is_worker()) {
+        SrsListener* listener = new SrsBufferListener(this, SrsListenerRtmpStream);
+        listeners.push_back(listener);
+        
+        int port; string ip;
+        srs_parse_endpoint(workers->relay_endpoint(workers->worker_index()), ip, port);
+        
+        if ((err = listener->listen(ip, port)) != srs_success) {
+            return srs_error_wrap(err, "relay listen %s:%d", ip.c_str(), port);
+        }
+    }
+    
     return err;
 }
 
@@ -49,6 +49,9 @@ using namespace std;
 #include <srs_app_ng_exec.hpp>
 #include <srs_app_dash.hpp>
 #include <srs_protocol_format.hpp>
+#include <srs_app_workers.hpp>
+#include <srs_app_pipeline.hpp>
+#include <srs_app_bandwidth.hpp>
 
 #define CONST_MAX_JITTER_MS         250
 #define CONST_MAX_JITTER_MS_NEG         -250
@@ -75,6 +78,28 @@ int _srs_time_jitter_string2int(std::string time_jitter)
     }
 }
 
+SrsDropPolicy srs_drop_policy_parse(string v)
+{
+    if (v == "frame") {
+        return SrsDropPolicyFrame;
+    }
+    return SrsDropPolicyGop;
+}
+
+SrsDropStat::SrsDropStat()
+{
+    disposable = video = all = 0;
+}
+
+SrsDropStat::~SrsDropStat()
+{
+}
+
+int64_t SrsDropStat::total()
+{
+    return disposable + video + all;
+}
+
 SrsRtmpJitter::SrsRtmpJitter()
 {
     last_pkt_correct_time = -1;
@@ -242,6 +267,10 @@ SrsMessageQueue::SrsMessageQueue(bool ignore_shrink)
 {
     _ignore_shrink = ignore_shrink;
     max_queue_size = 0;
+    drop_policy = SrsDropPolicyGop;
+    drops = NULL;
+    nb_scanned = 0;
+    latest_keyframe = -1;
     av_start_time = av_end_time = -1;
 }
 
@@ -265,6 +294,12 @@ void SrsMessageQueue::set_queue_size(srs_utime_t queue_size)
 	max_queue_size = queue_size;
 }
 
+void SrsMessageQueue::set_drop_policy(SrsDropPolicy policy, SrsDropStat* stat)
+{
+    drop_policy = policy;
+    drops = stat;
+}
+
 srs_error_t SrsMessageQueue::enqueue(SrsSharedPtrMessage* msg, bool* is_overflow)
 {
     srs_error_t err = srs_success;
@@ -279,7 +314,20 @@ srs_error_t SrsMessageQueue::enqueue(SrsSharedPtrMessage* msg, bool* is_overflow
     
     msgs.push_back(msg);
     
-    while (av_end_time - av_start_time > max_queue_size) {
+    // For frame policy, drop the video frames first, and allow twice of queue size for audio.
+    srs_utime_t max_duration = max_queue_size;
+    if (drop_policy == SrsDropPolicyFrame) {
+        if (msg->is_video() && SrsFlvVideo::keyframe(msg->payload, msg->size) && !SrsFlvVideo::sh(msg->payload, msg->size)) {
+            latest_keyframe = (int)msgs.size() - 1;
+        }
+        
+        if (av_end_time - av_start_time > max_queue_size / 2) {
+            drop_frames();
+        }
+        max_duration = 2 * max_queue_size;
+    }
+    
+    while (av_end_time - av_start_time > max_duration) {
         // notice the caller queue already overflow and shrinked.
         if (is_overflow) {
             *is_overflow = true;
@@ -291,7 +339,7 @@ srs_error_t SrsMessageQueue::enqueue(SrsSharedPtrMessage* msg, bool* is_overflow
     return err;
 }
 
-srs_error_t SrsMessageQueue::dump_packets(int max_count, SrsSharedPtrMessage** pmsgs, int& count)
+srs_error_t SrsMessageQueue::dump_packets(int max_count, SrsSharedPtrMessage** pmsgs, int& count, int64_t max_bytes)
 {
     srs_error_t err = srs_success;
     
@@ -301,11 +349,18 @@ srs_error_t SrsMessageQueue::dump_packets(int max_count, SrsSharedPtrMessage** p
     }
     
     srs_assert(max_count > 0);
-    count = srs_min(max_count, nb_msgs);
+    max_count = srs_min(max_count, nb_msgs);
     
     SrsSharedPtrMessage** omsgs = msgs.data();
-    for (int i = 0; i < count; i++) {
-        pmsgs[i] = omsgs[i];
+    int64_t nb_bytes = 0;
+    for (count = 0; count < max_count && (max_bytes < 0 || nb_bytes < max_bytes); count++) {
+        pmsgs[count] = omsgs[count];
+        nb_bytes += omsgs[count]->size;
+    }
+    
+    // Nothing to dump for the bytes.
+    if (count <= 0) {
+        return err;
     }
     
     SrsSharedPtrMessage* last = omsgs[count - 1];
@@ -322,6 +377,9 @@ srs_error_t SrsMessageQueue::dump_packets(int max_count, SrsSharedPtrMessage** p
         msgs.erase(msgs.begin(), msgs.begin() + count);
     }
     
+    nb_scanned = srs_max(0, nb_scanned - count);
+    latest_keyframe = (latest_keyframe >= count)? latest_keyframe - count : -1;
+    
     return err;
 }
 
@@ -370,6 +428,12 @@ void SrsMessageQueue::shrink()
         srs_freep(msg);
     }
     msgs.clear();
+    nb_scanned = 0;
+    latest_keyframe = -1;
+    
+    if (drops) {
+        drops->all += msgs_size - (video_sh? 1:0) - (audio_sh? 1:0);
+    }
     
     // update av_start_time
     av_start_time = av_end_time;
@@ -388,6 +452,73 @@ void SrsMessageQueue::shrink()
     }
 }
 
+void SrsMessageQueue::drop_frames()
+{
+    int nb_msgs = (int)msgs.size();
+    SrsSharedPtrMessage** omsgs = msgs.data();
+    
+    // When exceed the queue size, drop the video before the latest keyframe, once for each keyframe.
+    int keyframe = 0;
+    if (av_end_time - av_start_time > max_queue_size && latest_keyframe > 0) {
+        keyframe = latest_keyframe;
+        latest_keyframe = -1;
+    }
+    
+    // Remove the dropped messages and keep the order of others, where the messages before
+    // nb_scanned are already checked, so it's O(1) for each message except for keyframe.
+    int start = (keyframe > 0)? 0 : nb_scanned;
+    int nb_kept = start;
+    for (int i = start; i < nb_msgs; i++) {
+        SrsSharedPtrMessage* msg = omsgs[i];
+        
+        bool drop = false;
+        if (msg->is_video() && !SrsFlvVideo::sh(msg->payload, msg->size)) {
+            if (i < keyframe) {
+                drop = true;
+                if (drops) {
+                    drops->video++;
+                }
+            } else if (msg->is_disposable()) {
+                drop = true;
+                if (drops) {
+                    drops->disposable++;
+                }
+            }
+        }
+        
+        // Keep the index of latest keyframe, after the messages are removed.
+        if (i == latest_keyframe) {
+            latest_keyframe = drop? -1 : nb_kept;
+        }
+        
+        if (drop) {
+            srs_freep(msg);
+        } else {
+            omsgs[nb_kept++] = msg;
+        }
+    }
+    nb_scanned = nb_kept;
+    
+    if (nb_kept >= nb_msgs) {
+        return;
+    }
+    msgs.erase(msgs.begin() + nb_kept, msgs.end());
+    
+    // Update the start time to the first message except sequence header, because the front is dropped.
+    av_start_time = av_end_time;
+    for (int i = 0; i < nb_kept; i++) {
+        SrsSharedPtrMessage* msg = omsgs[i];
+        if (msg->is_video() && !SrsFlvVideo::sh(msg->payload, msg->size)) {
+            av_start_time = srs_utime_t(msg->timestamp * SRS_UTIME_MILLISECONDS);
+            break;
+        }
+        if (msg->is_audio() && !SrsFlvAudio::sh(msg->payload, msg->size)) {
+            av_start_time = srs_utime_t(msg->timestamp * SRS_UTIME_MILLISECONDS);
+            break;
+        }
+    }
+}
+
 void SrsMessageQueue::clear()
 {
 #ifndef SRS_PERF_QUEUE_FAST_VECTOR
@@ -402,10 +533,159 @@ void SrsMessageQueue::clear()
 #endif
     
     msgs.clear();
+    nb_scanned = 0;
+    latest_keyframe = -1;
     
     av_start_time = av_end_time = -1;
 }
 
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+SrsMessageRing::SrsMessageRing()
+{
+    capacity = 8;
+    msgs = new SrsSharedPtrMessage*[capacity];
+    times = new srs_utime_t[capacity];
+    head = tail = 0;
+    ring_time = 0;
+    last_av_timestamp = -1;
+    max_queue_size = 0;
+}
+
+SrsMessageRing::~SrsMessageRing()
+{
+    clear();
+    srs_freepa(msgs);
+    srs_freepa(times);
+}
+
+void SrsMessageRing::set_queue_size(srs_utime_t queue_size)
+{
+    max_queue_size = queue_size;
+}
+
+int64_t SrsMessageRing::begin()
+{
+    return head;
+}
+
+int64_t SrsMessageRing::end()
+{
+    return tail;
+}
+
+SrsSharedPtrMessage* SrsMessageRing::at(int64_t seq)
+{
+    srs_assert(seq >= head && seq < tail);
+    return msgs[seq % capacity];
+}
+
+srs_utime_t SrsMessageRing::duration(int64_t seq)
+{
+    seq = srs_max(seq, head);
+    if (seq >= tail) {
+        return 0;
+    }
+    return ring_time - times[seq % capacity];
+}
+
+int64_t SrsMessageRing::keyframe()
+{
+    if (keyframes.empty()) {
+        return -1;
+    }
+    return keyframes.back();
+}
+
+void SrsMessageRing::enqueue(SrsSharedPtrMessage* msg)
+{
+    // increase ring, move all messages to the new position of sequence.
+    if (tail - head >= capacity) {
+        int size = srs_max(SRS_PERF_MW_MSGS * 8, capacity * 2);
+        SrsSharedPtrMessage** buf = new SrsSharedPtrMessage*[size];
+        srs_utime_t* tbuf = new srs_utime_t[size];
+        for (int64_t seq = head; seq < tail; seq++) {
+            buf[seq % size] = msgs[seq % capacity];
+            tbuf[seq % size] = times[seq % capacity];
+        }
+        srs_info("message ring incrase %d=>%d", capacity, size);
+        
+        srs_freepa(msgs);
+        srs_freepa(times);
+        msgs = buf;
+        times = tbuf;
+        capacity = size;
+    }
+    
+    // Increase the ring time by delta of av messages, ignore the jump back.
+    if (msg->is_av()) {
+        if (last_av_timestamp >= 0 && msg->timestamp > last_av_timestamp) {
+            ring_time += srs_utime_t((msg->timestamp - last_av_timestamp) * SRS_UTIME_MILLISECONDS);
+        }
+        last_av_timestamp = msg->timestamp;
+    }
+    
+    if (msg->is_video() && SrsFlvVideo::keyframe(msg->payload, msg->size) && !SrsFlvVideo::sh(msg->payload, msg->size)) {
+        keyframes.push_back(tail);
+    }
+    
+    msgs[tail % capacity] = msg->copy();
+    times[tail % capacity] = ring_time;
+    tail++;
+    
+    shrink();
+}
+
+void SrsMessageRing::shrink()
+{
+    int64_t latest = keyframe();
+    
+    while (tail - head > 1 && ring_time - times[head % capacity] > max_queue_size) {
+        // Keep the latest gop, for consumer to skip to.
+        if (latest >= 0 && head >= latest) {
+            break;
+        }
+        
+        pop();
+    }
+}
+
+void SrsMessageRing::trim(int64_t seq)
+{
+    // Keep the latest gop, for consumer to skip to.
+    int64_t latest = keyframe();
+    if (latest >= 0) {
+        seq = srs_min(seq, latest);
+    }
+    
+    while (head < seq && head < tail) {
+        pop();
+    }
+}
+
+void SrsMessageRing::pop()
+{
+    SrsSharedPtrMessage* msg = msgs[head % capacity];
+    srs_freep(msg);
+    head++;
+    
+    while (!keyframes.empty() && keyframes.front() < head) {
+        keyframes.pop_front();
+    }
+}
+
+void SrsMessageRing::clear()
+{
+    for (int64_t seq = head; seq < tail; seq++) {
+        SrsSharedPtrMessage* msg = msgs[seq % capacity];
+        srs_freep(msg);
+    }
+    
+    head = tail;
+    keyframes.clear();
+    last_av_timestamp = -1;
+}
+#endif
+
 ISrsWakable::ISrsWakable()
 {
 }
@@ -421,8 +701,19 @@ SrsConsumer::SrsConsumer(SrsSource* s, SrsConnection* c)
     paused = false;
     jitter = new SrsRtmpJitter();
     queue = new SrsMessageQueue();
+    pacer = NULL;
+    drop_policy = SrsDropPolicyGop;
+    drops = new SrsDropStat();
+    shift = 0;
     should_update_source_id = false;
     
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+    // Only consume the messages after created.
+    ring = s->ring;
+    cursor = ring->end();
+    queue_size = 0;
+#endif
+    
 #ifdef SRS_PERF_QUEUE_COND_WAIT
     mw_wait = srs_cond_new();
     mw_min_msgs = 0;
@@ -436,6 +727,13 @@ SrsConsumer::~SrsConsumer()
     source->on_consumer_destroy(this);
     srs_freep(jitter);
     srs_freep(queue);
+    srs_freep(pacer);
+    
+    if (drops->total() > 0) {
+        srs_trace("consumer dropped %d msgs, disposable=%d, video=%d, all=%d", (int)drops->total(),
+            (int)drops->disposable, (int)drops->video, (int)drops->all);
+    }
+    srs_freep(drops);
     
 #ifdef SRS_PERF_QUEUE_COND_WAIT
     srs_cond_destroy(mw_wait);
@@ -444,7 +742,15 @@ SrsConsumer::~SrsConsumer()
 
 void SrsConsumer::set_queue_size(srs_utime_t queue_size)
 {
-    queue->set_queue_size(queue_size);
+    queue->set_queue_size(queue_size + shift);
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+    this->queue_size = queue_size + shift;
+#endif
+}
+
+void SrsConsumer::set_time_shift(srs_utime_t shift)
+{
+    this->shift = shift;
 }
 
 void SrsConsumer::update_source_id()
@@ -452,6 +758,23 @@ void SrsConsumer::update_source_id()
     should_update_source_id = true;
 }
 
+void SrsConsumer::set_drop_policy(SrsDropPolicy policy)
+{
+    drop_policy = policy;
+    queue->set_drop_policy(policy, drops);
+}
+
+SrsDropStat* SrsConsumer::dropped()
+{
+    return drops;
+}
+
+void SrsConsumer::enable_pacing(string vhost)
+{
+    srs_freep(pacer);
+    pacer = SrsPacer::create(vhost);
+}
+
 int64_t SrsConsumer::get_time()
 {
     return jitter->get_time();
@@ -524,14 +847,186 @@ srs_error_t SrsConsumer::dump_packets(SrsMessageArray* msgs, int& count)
         return err;
     }
     
+    // The bytes allowed by pacer, the burst such as gop cache is sent in the rate.
+    int64_t quota = pacer? pacer->quota() : -1;
+    if (quota == 0) {
+        return err;
+    }
+    
     // pump msgs from queue.
-    if ((err = queue->dump_packets(max, msgs->msgs, count)) != srs_success) {
+    if ((err = queue->dump_packets(max, msgs->msgs, count, quota)) != srs_success) {
         return srs_error_wrap(err, "dump packets");
     }
     
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+    // pump msgs from ring, after all msgs in queue are consumed.
+    if (count < max && queue->size() == 0) {
+        if ((err = dump_ring(msgs->msgs, max, count, quota)) != srs_success) {
+            return srs_error_wrap(err, "dump ring");
+        }
+    }
+#endif
+    
+    if (pacer) {
+        pacer->consume(msgs->msgs, count);
+    }
+    
+    return err;
+}
+
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+void SrsConsumer::on_ring_messages(bool atc)
+{
+#ifdef SRS_PERF_QUEUE_COND_WAIT
+    // fire the mw when msgs is enough.
+    if (mw_waiting) {
+        srs_utime_t duration = this->duration();
+        bool match_min_msgs = size() > mw_min_msgs;
+        
+        // For ATC, maybe the SH timestamp bigger than A/V packet,
+        // when encoder republish or overflow.
+        // @see https://github.com/ossrs/srs/pull/749
+        if (atc && duration < 0) {
+            srs_cond_signal(mw_wait);
+            mw_waiting = false;
+            return;
+        }
+        
+        // when duration ok, signal to flush.
+        if (match_min_msgs && duration > mw_duration) {
+            srs_cond_signal(mw_wait);
+            mw_waiting = false;
+            return;
+        }
+    }
+#endif
+}
+
+int64_t SrsConsumer::ring_cursor()
+{
+    return cursor;
+}
+
+srs_error_t SrsConsumer::dump_ring(SrsSharedPtrMessage** pmsgs, int max, int& count, int64_t max_bytes)
+{
+    srs_error_t err = srs_success;
+    
+    // The bytes of messages dumped from queue.
+    int64_t nb_bytes = 0;
+    for (int i = 0; i < count; i++) {
+        nb_bytes += pmsgs[i]->size;
+    }
+    
+    // For frame policy, allow twice of queue size for the audio to catch up.
+    srs_utime_t lag = ring->duration(cursor);
+    srs_utime_t max_lag = (drop_policy == SrsDropPolicyFrame)? 2 * queue_size : queue_size;
+    
+    // The consumer is too slow, the messages are dropped by ring or overflow.
+    if (cursor < ring->begin() || lag > max_lag) {
+        if ((err = skip_ring()) != srs_success) {
+            return srs_error_wrap(err, "skip");
+        }
+        
+        // The sequence headers are dumped to queue, consume them first.
+        int nb_msgs = 0;
+        if ((err = queue->dump_packets(max - count, pmsgs + count, nb_msgs)) != srs_success) {
+            return srs_error_wrap(err, "dump packets");
+        }
+        count += nb_msgs;
+    }
+    
+    bool atc = source->atc;
+    SrsRtmpJitterAlgorithm ag = source->jitter_algorithm;
+    
+    // For frame policy, skip the video before the latest keyframe when exceed the queue size,
+    // and skip the disposable frames when exceed half of queue size, but keep the audio.
+    int64_t keyframe = cursor;
+    bool skip_disposable = false;
+    if (drop_policy == SrsDropPolicyFrame && cursor < ring->end()) {
+        lag = ring->duration(cursor);
+        if (lag > queue_size) {
+            keyframe = srs_max(cursor, ring->keyframe());
+        }
+        skip_disposable = lag > queue_size / 2;
+    }
+    
+    for (; count < max && cursor < ring->end() && (max_bytes < 0 || nb_bytes < max_bytes); cursor++) {
+        SrsSharedPtrMessage* m = ring->at(cursor);
+        if (m->is_video() && (cursor < keyframe || (skip_disposable && m->is_disposable()))
+            && !SrsFlvVideo::sh(m->payload, m->size)) {
+            if (cursor < keyframe) {
+                drops->video++;
+            } else {
+                drops->disposable++;
+            }
+            continue;
+        }
+        
+        SrsSharedPtrMessage* msg = m->copy();
+        nb_bytes += msg->size;
+        
+        if (!atc && (err = jitter->correct(msg, ag)) != srs_success) {
+            srs_freep(msg);
+            return srs_error_wrap(err, "consume message");
+        }
+        
+        pmsgs[count++] = msg;
+    }
+    
     return err;
 }
 
+srs_error_t SrsConsumer::skip_ring()
+{
+    srs_error_t err = srs_success;
+    
+    // Jump to the latest keyframe, or drop all messages if no keyframe.
+    int64_t seq = ring->keyframe();
+    if (seq < cursor) {
+        seq = ring->end();
+    }
+    
+    srs_trace("shrinking, skip=%d, max=%dms", (int)(seq - cursor), srsu2msi(queue_size));
+    drops->all += seq - cursor;
+    cursor = seq;
+    
+    // Keep the sequence headers for decoder, as the queue shrinks.
+    int64_t timestamp = 0;
+    if (cursor < ring->end()) {
+        timestamp = ring->at(cursor)->timestamp;
+    } else if (ring->begin() < ring->end()) {
+        timestamp = ring->at(ring->end() - 1)->timestamp;
+    }
+    
+    SrsSharedPtrMessage* shs[] = {source->meta->vsh(), source->meta->ash()};
+    for (int i = 0; i < 2; i++) {
+        if (!shs[i]) {
+            continue;
+        }
+        
+        SrsSharedPtrMessage* sh = shs[i]->copy();
+        SrsAutoFree(SrsSharedPtrMessage, sh);
+        sh->timestamp = timestamp;
+        
+        if ((err = enqueue(sh, source->atc, source->jitter_algorithm)) != srs_success) {
+            return srs_error_wrap(err, "enqueue sh");
+        }
+    }
+    
+    return err;
+}
+
+int SrsConsumer::size()
+{
+    return queue->size() + (int)(ring->end() - srs_max(cursor, ring->begin()));
+}
+
+srs_utime_t SrsConsumer::duration()
+{
+    return queue->duration() + ring->duration(cursor);
+}
+#endif
+
 #ifdef SRS_PERF_QUEUE_COND_WAIT
 void SrsConsumer::wait(int nb_msgs, srs_utime_t msgs_duration)
 {
@@ -540,11 +1035,23 @@ void SrsConsumer::wait(int nb_msgs, srs_utime_t msgs_duration)
         return;
     }
     
+    // Wait for the quota of pacer, the messages are ready to send.
+    srs_utime_t delay = pacer? pacer->delay() : 0;
+    if (delay > 0) {
+        srs_usleep(srs_min(delay, SRS_CONSTS_RTMP_PULSE));
+        return;
+    }
+    
     mw_min_msgs = nb_msgs;
     mw_duration = msgs_duration;
     
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+    srs_utime_t duration = this->duration();
+    bool match_min_msgs = size() > mw_min_msgs;
+#else
     srs_utime_t duration = queue->duration();
     bool match_min_msgs = queue->size() > mw_min_msgs;
+#endif
     
     // when duration ok, signal to flush.
     if (match_min_msgs && duration > mw_duration) {
@@ -584,6 +1091,9 @@ SrsGopCache::SrsGopCache()
     cached_video_count = 0;
     enable_gop_cache = true;
     audio_after_last_video_count = 0;
+    fast_join = false;
+    fast_join_latency = 0;
+    fast_join_accelerate = false;
 }
 
 SrsGopCache::~SrsGopCache()
@@ -611,6 +1121,13 @@ bool SrsGopCache::enabled()
     return enable_gop_cache;
 }
 
+void SrsGopCache::set_fast_join(bool v, srs_utime_t latency, bool accelerate)
+{
+    fast_join = v;
+    fast_join_latency = latency;
+    fast_join_accelerate = accelerate;
+}
+
 srs_error_t SrsGopCache::cache(SrsSharedPtrMessage* shared_msg)
 {
     srs_error_t err = srs_success;
@@ -651,11 +1168,13 @@ srs_error_t SrsGopCache::cache(SrsSharedPtrMessage* shared_msg)
     }
     
     // clear gop cache when got key frame
-    if (msg->is_video() && SrsFlvVideo::keyframe(msg->payload, msg->size)) {
+    bool keyframe = msg->is_video() && SrsFlvVideo::keyframe(msg->payload, msg->size);
+    if (keyframe) {
         clear();
         
         // curent msg is video frame, so we set to 1.
         cached_video_count = 1;
+        keyframes.push_back((int)gop_cache.size());
     }
     
     // cache the frame.
@@ -672,6 +1191,7 @@ void SrsGopCache::clear()
         srs_freep(msg);
     }
     gop_cache.clear();
+    keyframes.clear();
     
     cached_video_count = 0;
     audio_after_last_video_count = 0;
@@ -681,6 +1201,10 @@ srs_error_t SrsGopCache::dump(SrsConsumer* consumer, bool atc, SrsRtmpJitterAlgo
 {
     srs_error_t err = srs_success;
     
+    if (fast_join && !keyframes.empty()) {
+        return fast_dump(consumer, atc, jitter_algorithm);
+    }
+    
     std::vector<SrsSharedPtrMessage*>::iterator it;
     for (it = gop_cache.begin(); it != gop_cache.end(); ++it) {
         SrsSharedPtrMessage* msg = *it;
@@ -693,6 +1217,68 @@ srs_error_t SrsGopCache::dump(SrsConsumer* consumer, bool atc, SrsRtmpJitterAlgo
     return err;
 }
 
+srs_error_t SrsGopCache::fast_dump(SrsConsumer* consumer, bool atc, SrsRtmpJitterAlgorithm jitter_algorithm)
+{
+    srs_error_t err = srs_success;
+    
+    int start = keyframes.back();
+    int nb_msgs = (int)gop_cache.size();
+    
+    // The frames after the join point are dumped entirely.
+    int64_t join = gop_cache[nb_msgs - 1]->timestamp - srsu2ms(fast_join_latency);
+    
+    // The frames before join point, which are required to decode.
+    int nn_required = 0;
+    for (int i = start; i < nb_msgs && gop_cache[i]->timestamp < join; i++) {
+        SrsSharedPtrMessage* msg = gop_cache[i];
+        if (msg->is_video() && !msg->is_disposable()) {
+            nn_required++;
+        }
+    }
+    
+    // For atc, never change the timestamp.
+    bool accelerate = fast_join_accelerate && !atc;
+    
+    int nn_msgs = 0;
+    int nn_skipped = 0;
+    int64_t nn_skipped_bytes = 0;
+    for (int i = start; i < nb_msgs; i++) {
+        SrsSharedPtrMessage* msg = gop_cache[i];
+        
+        if (msg->timestamp >= join) {
+            if ((err = consumer->enqueue(msg, atc, jitter_algorithm)) != srs_success) {
+                return srs_error_wrap(err, "enqueue message");
+            }
+            nn_msgs++;
+            continue;
+        }
+        
+        // The audio and disposable frames before join point are never played.
+        if (msg->is_audio() || msg->is_disposable()) {
+            nn_skipped++;
+            nn_skipped_bytes += msg->size;
+            continue;
+        }
+        
+        // Squeeze the frames before join point, 1ms each, so the player decodes them instantly.
+        SrsSharedPtrMessage* copy = msg->copy();
+        SrsAutoFree(SrsSharedPtrMessage, copy);
+        if (accelerate) {
+            copy->timestamp = join - (nn_required--);
+        }
+        
+        if ((err = consumer->enqueue(copy, atc, jitter_algorithm)) != srs_success) {
+            return srs_error_wrap(err, "enqueue required message");
+        }
+        nn_msgs++;
+    }
+    
+    srs_trace("dispatch cached gop fast, count=%d, skip=%d, skip_bytes=%d, latency=%dms, accelerate=%d, duration=%d",
+        nn_msgs, nn_skipped, (int)nn_skipped_bytes, srsu2msi(fast_join_latency), accelerate, consumer->get_time());
+    
+    return err;
+}
+
 bool SrsGopCache::empty()
 {
     return gop_cache.empty();
@@ -715,6 +1301,189 @@ bool SrsGopCache::pure_audio()
     return cached_video_count == 0;
 }
 
+srs_utime_t srs_time_shift_parse(string v)
+{
+    // The offset is before live, so the sign is optional.
+    v = srs_string_trim_start(v, "-");
+    if (v.empty()) {
+        return 0;
+    }
+    
+    int64_t offset = ::atoll(v.c_str());
+    if (offset <= 0) {
+        return 0;
+    }
+    
+    if (srs_string_ends_with(v, "ms")) {
+        return offset * SRS_UTIME_MILLISECONDS;
+    }
+    return offset * SRS_UTIME_SECONDS;
+}
+
+SrsTimeShift::SrsTimeShift()
+{
+    duration = 0;
+    base = 0;
+}
+
+SrsTimeShift::~SrsTimeShift()
+{
+    clear();
+}
+
+void SrsTimeShift::dispose()
+{
+    clear();
+}
+
+void SrsTimeShift::set_duration(srs_utime_t v)
+{
+    duration = v;
+    
+    if (!v) {
+        clear();
+        return;
+    }
+    
+    shrink();
+}
+
+bool SrsTimeShift::enabled()
+{
+    return duration > 0;
+}
+
+srs_utime_t SrsTimeShift::get_duration()
+{
+    return duration;
+}
+
+srs_error_t SrsTimeShift::cache(SrsSharedPtrMessage* shared_msg)
+{
+    srs_error_t err = srs_success;
+    
+    if (!duration) {
+        return err;
+    }
+    
+    SrsSharedPtrMessage* msg = shared_msg;
+    
+    // The timestamp jumps back, for example, the encoder restarts, the buffer is not continuous.
+    if (!msgs.empty() && msg->timestamp + srsu2ms(duration) < msgs.back()->timestamp) {
+        srs_warn("time-shift: reset for timestamp jump %" PRId64 " to %" PRId64, msgs.back()->timestamp, msg->timestamp);
+        clear();
+    }
+    
+    if (msg->is_video() && SrsFlvVideo::keyframe(msg->payload, msg->size)) {
+        keyframes.push_back(std::make_pair(msg->timestamp, base + (int64_t)msgs.size()));
+    }
+    msgs.push_back(msg->copy());
+    
+    shrink();
+    
+    return err;
+}
+
+void SrsTimeShift::clear()
+{
+    std::deque<SrsSharedPtrMessage*>::iterator it;
+    for (it = msgs.begin(); it != msgs.end(); ++it) {
+        SrsSharedPtrMessage* msg = *it;
+        srs_freep(msg);
+    }
+    msgs.clear();
+    keyframes.clear();
+    base = 0;
+}
+
+srs_error_t SrsTimeShift::dump(SrsConsumer* consumer, srs_utime_t offset, bool atc, SrsRtmpJitterAlgorithm jitter_algorithm, int& nb_msgs)
+{
+    srs_error_t err = srs_success;
+    
+    nb_msgs = 0;
+    if (msgs.empty()) {
+        return err;
+    }
+    
+    int64_t target = msgs.back()->timestamp - srsu2ms(offset);
+    
+    // Start at the keyframe before the target, or the first one when the buffer is shorter than offset.
+    // For pure audio, start at the first message after target.
+    int64_t start = base;
+    if (!keyframes.empty()) {
+        start = keyframes.front().second;
+        
+        std::deque<std::pair<int64_t, int64_t> >::iterator it;
+        for (it = keyframes.begin(); it != keyframes.end() && it->first <= target; ++it) {
+            start = it->second;
+        }
+    } else {
+        while (start < base + (int64_t)msgs.size() - 1 && msgs[start - base]->timestamp < target) {
+            start++;
+        }
+    }
+    
+    for (int64_t i = start - base; i < (int64_t)msgs.size(); i++) {
+        SrsSharedPtrMessage* msg = msgs[i];
+        if ((err = consumer->enqueue(msg, atc, jitter_algorithm)) != srs_success) {
+            return srs_error_wrap(err, "enqueue message");
+        }
+        nb_msgs++;
+    }
+    
+    srs_trace("dispatch time-shift success, offset=%dms, count=%d, start=%" PRId64 ", buffered=%dms, duration=%d",
+        srsu2msi(offset), nb_msgs, msgs[start - base]->timestamp, srsu2msi(buffered()), consumer->get_time());
+    
+    return err;
+}
+
+srs_utime_t SrsTimeShift::buffered()
+{
+    if (msgs.empty()) {
+        return 0;
+    }
+    return (msgs.back()->timestamp - msgs.front()->timestamp) * SRS_UTIME_MILLISECONDS;
+}
+
+int SrsTimeShift::size()
+{
+    return (int)msgs.size();
+}
+
+void SrsTimeShift::shrink()
+{
+    if (msgs.empty()) {
+        return;
+    }
+    
+    int64_t deadline = msgs.back()->timestamp - srsu2ms(duration);
+    
+    // The video is disabled when the latest keyframe is too old, drop the index to shrink as pure audio.
+    if (!keyframes.empty() && keyframes.back().first < deadline - srsu2ms(duration)) {
+        keyframes.clear();
+    }
+    
+    // Drop the whole GOP when the next one is still in the duration, so the buffer always starts at keyframe.
+    // For pure audio, drop the messages out of duration.
+    int64_t end = base;
+    if (!keyframes.empty()) {
+        while (keyframes.size() > 1 && keyframes[1].first <= deadline) {
+            keyframes.pop_front();
+        }
+        end = keyframes.front().second;
+    } else {
+        while (end < base + (int64_t)msgs.size() && msgs[end - base]->timestamp < deadline) {
+            end++;
+        }
+    }
+    
+    for (; base < end; base++) {
+        SrsSharedPtrMessage* msg = msgs.front();
+        msgs.pop_front();
+        srs_freep(msg);
+    }
+}
+
 ISrsSourceHandler::ISrsSourceHandler()
 {
 }
@@ -829,6 +1598,7 @@ SrsOriginHub::SrsOriginHub()
 #endif
     ng_exec = new SrsNgExec();
     format = new SrsRtmpFormat();
+    pipeline = new SrsMuxPipeline();
     
     _srs_config->subscribe(this);
 }
@@ -848,6 +1618,7 @@ SrsOriginHub::~SrsOriginHub()
     srs_freep(ng_exec);
     
     srs_freep(format);
+    srs_freep(pipeline);
     srs_freep(hls);
     srs_freep(dash);
     srs_freep(dvr);
@@ -868,6 +1639,10 @@ srs_error_t SrsOriginHub::initialize(SrsSource* s, SrsRequest* r)
         return srs_error_wrap(err, "format initialize");
     }
     
+    if ((err = pipeline->initialize()) != srs_success) {
+        return srs_error_wrap(err, "pipeline initialize");
+    }
+    
     if ((err = hls->initialize(this, req)) != srs_success) {
         return srs_error_wrap(err, "hls initialize");
     }
@@ -908,6 +1683,11 @@ bool SrsOriginHub::active()
     return is_active;
 }
 
+SrsMuxPipeline* SrsOriginHub::mux_pipeline()
+{
+    return pipeline;
+}
+
 srs_error_t SrsOriginHub::on_meta_data(SrsSharedPtrMessage* shared_metadata, SrsOnMetaDataPacket* packet)
 {
     srs_error_t err = srs_success;
@@ -931,6 +1711,11 @@ srs_error_t SrsOriginHub::on_meta_data(SrsSharedPtrMessage* shared_metadata, Srs
         return srs_error_wrap(err, "DVR consume metadata");
     }
     
+    if ((err = pipeline->on_meta_data(shared_metadata)) != srs_success) {
+        srs_warn("pipeline: ignore metadata error %s", srs_error_desc(err).c_str());
+        srs_error_reset(err);
+    }
+    
     return err;
 }
 
@@ -940,6 +1725,9 @@ srs_error_t SrsOriginHub::on_audio(SrsSharedPtrMessage* shared_audio)
     
     SrsSharedPtrMessage* msg = shared_audio;
     
+    // The starttime of each stage, to measure the cost of pipeline.
+    srs_utime_t starttime = srs_update_system_time();
+    
     if ((err = format->on_audio(msg)) != srs_success) {
         return srs_error_wrap(err, "format consume audio");
     }
@@ -965,6 +1753,7 @@ srs_error_t SrsOriginHub::on_audio(SrsSharedPtrMessage* shared_audio)
                   flv_sample_sizes[c->sound_size], flv_sound_types[c->sound_type],
                   srs_flv_srates[c->sound_rate]);
     }
+    starttime = pipeline->on_stage(SrsPipelineStageFormat, starttime);
     
     if ((err = hls->on_audio(msg, format)) != srs_success) {
         // apply the error strategy for hls.
@@ -984,18 +1773,21 @@ srs_error_t SrsOriginHub::on_audio(SrsSharedPtrMessage* shared_audio)
             return srs_error_wrap(err, "hls: audio");
         }
     }
+    starttime = pipeline->on_stage(SrsPipelineStageHls, starttime);
     
     if ((err = dash->on_audio(msg, format)) != srs_success) {
         srs_warn("dash: ignore audio error %s", srs_error_desc(err).c_str());
         srs_error_reset(err);
         dash->on_unpublish();
     }
+    starttime = pipeline->on_stage(SrsPipelineStageDash, starttime);
     
     if ((err = dvr->on_audio(msg, format)) != srs_success) {
         srs_warn("dvr: ignore audio error %s", srs_error_desc(err).c_str());
         srs_error_reset(err);
         dvr->on_unpublish();
     }
+    starttime = pipeline->on_stage(SrsPipelineStageDvr, starttime);
     
 #ifdef SRS_AUTO_HDS
     if ((err = hds->on_audio(msg)) != srs_success) {
@@ -1003,8 +1795,16 @@ srs_error_t SrsOriginHub::on_audio(SrsSharedPtrMessage* shared_audio)
         srs_error_reset(err);
         hds->on_unpublish();
     }
+    starttime = pipeline->on_stage(SrsPipelineStageHds, starttime);
 #endif
     
+    // The HTTP-FLV/TS/AAC/MP3 is muxed once for all viewers.
+    if ((err = pipeline->on_audio(msg)) != srs_success) {
+        srs_warn("pipeline: ignore audio error %s", srs_error_desc(err).c_str());
+        srs_error_reset(err);
+    }
+    starttime = srs_update_system_time();
+    
     // copy to all forwarders.
     if (true) {
         std::vector<SrsForwarder*>::iterator it;
@@ -1014,6 +1814,7 @@ srs_error_t SrsOriginHub::on_audio(SrsSharedPtrMessage* shared_audio)
                 return srs_error_wrap(err, "forward: audio");
             }
         }
+        pipeline->on_stage(SrsPipelineStageForward, starttime);
     }
     
     return err;
@@ -1025,6 +1826,9 @@ srs_error_t SrsOriginHub::on_video(SrsSharedPtrMessage* shared_video, bool is_se
     
     SrsSharedPtrMessage* msg = shared_video;
     
+    // The starttime of each stage, to measure the cost of pipeline.
+    srs_utime_t starttime = srs_update_system_time();
+    
     // user can disable the sps parse to workaround when parse sps failed.
     // @see https://github.com/ossrs/srs/issues/474
     if (is_sequence_header) {
@@ -1035,6 +1839,11 @@ srs_error_t SrsOriginHub::on_video(SrsSharedPtrMessage* shared_video, bool is_se
         return srs_error_wrap(err, "format consume video");
     }
     
+    // Mark the frame which is not referenced, shared by all copies, for slow consumer to drop it.
+    if (!is_sequence_header && format->video && SrsFlvVideo::h264(msg->payload, msg->size)) {
+        msg->set_disposable(format->video->disposable());
+    }
+    
     // cache the sequence header if h264
     // donot cache the sequence header to gop_cache, return here.
     if (format->is_avc_sequence_header()) {
@@ -1058,6 +1867,7 @@ srs_error_t SrsOriginHub::on_video(SrsSharedPtrMessage* shared_video, bool is_se
     if (format->vcodec && !format->vcodec->is_avc_codec_ok()) {
         return err;
     }
+    starttime = pipeline->on_stage(SrsPipelineStageFormat, starttime);
     
     if ((err = hls->on_video(msg, format)) != srs_success) {
         // apply the error strategy for hls.
@@ -1077,18 +1887,21 @@ srs_error_t SrsOriginHub::on_video(SrsSharedPtrMessage* shared_video, bool is_se
             return srs_error_wrap(err, "hls: video");
         }
     }
+    starttime = pipeline->on_stage(SrsPipelineStageHls, starttime);
     
     if ((err = dash->on_video(msg, format)) != srs_success) {
         srs_warn("dash: ignore video error %s", srs_error_desc(err).c_str());
         srs_error_reset(err);
         dash->on_unpublish();
     }
+    starttime = pipeline->on_stage(SrsPipelineStageDash, starttime);
     
     if ((err = dvr->on_video(msg, format)) != srs_success) {
         srs_warn("dvr: ignore video error %s", srs_error_desc(err).c_str());
         srs_error_reset(err);
         dvr->on_unpublish();
     }
+    starttime = pipeline->on_stage(SrsPipelineStageDvr, starttime);
     
 #ifdef SRS_AUTO_HDS
     if ((err = hds->on_video(msg)) != srs_success) {
@@ -1096,8 +1909,16 @@ srs_error_t SrsOriginHub::on_video(SrsSharedPtrMessage* shared_video, bool is_se
         srs_error_reset(err);
         hds->on_unpublish();
     }
+    starttime = pipeline->on_stage(SrsPipelineStageHds, starttime);
 #endif
     
+    // The HTTP-FLV/TS/AAC/MP3 is muxed once for all viewers.
+    if ((err = pipeline->on_video(msg)) != srs_success) {
+        srs_warn("pipeline: ignore video error %s", srs_error_desc(err).c_str());
+        srs_error_reset(err);
+    }
+    starttime = srs_update_system_time();
+    
     // copy to all forwarders.
     if (!forwarders.empty()) {
         std::vector<SrsForwarder*>::iterator it;
@@ -1108,6 +1929,7 @@ srs_error_t SrsOriginHub::on_video(SrsSharedPtrMessage* shared_video, bool is_se
             }
         }
     }
+    pipeline->on_stage(SrsPipelineStageForward, starttime);
     
     return err;
 }
@@ -1116,6 +1938,13 @@ srs_error_t SrsOriginHub::on_publish()
 {
     srs_error_t err = srs_success;
     
+    // For workers mode, the stream relayed from its owner never delivers to
+    // forward, transcode, HLS, DASH, DVR and exec, which are done by the owner.
+    if (SrsWorkers::instance()->should_relay(req)) {
+        is_active = true;
+        return err;
+    }
+    
     // create forwarders
     if ((err = create_forwarders()) != srs_success) {
         return srs_error_wrap(err, "create forwarders");
@@ -1172,6 +2001,12 @@ void SrsOriginHub::on_unpublish()
 #endif
     
     ng_exec->on_unpublish();
+    
+    srs_error_t err = srs_success;
+    if ((err = pipeline->on_unpublish()) != srs_success) {
+        srs_warn("pipeline: ignore unpublish error %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
 }
 
 srs_error_t SrsOriginHub::on_forwarder_start(SrsForwarder* forwarder)
@@ -1343,6 +2178,11 @@ srs_error_t SrsOriginHub::on_reload_vhost_hls(string vhost)
         }
     }
     
+    // The FMP4 hls is generated by DASH muxer, so reload it.
+    if ((err = on_reload_vhost_dash(vhost)) != srs_success) {
+        return srs_error_wrap(err, "dash reload");
+    }
+    
     return err;
 }
 
@@ -1826,12 +2666,17 @@ SrsSource::SrsSource()
     _can_publish = true;
     _pre_source_id = _source_id = -1;
     die_at = 0;
+    nn_shared = 0;
     
     play_edge = new SrsPlayEdge();
     publish_edge = new SrsPublishEdge();
     gop_cache = new SrsGopCache();
+    time_shift = new SrsTimeShift();
     hub = new SrsOriginHub();
     meta = new SrsMetaCache();
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+    ring = new SrsMessageRing();
+#endif
     
     is_monotonically_increase = false;
     last_packet_time = 0;
@@ -1851,10 +2696,14 @@ SrsSource::~SrsSource()
     srs_freep(hub);
     srs_freep(meta);
     srs_freep(mix_queue);
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+    srs_freep(ring);
+#endif
     
     srs_freep(play_edge);
     srs_freep(publish_edge);
     srs_freep(gop_cache);
+    srs_freep(time_shift);
     
     srs_freep(req);
 }
@@ -1864,6 +2713,7 @@ void SrsSource::dispose()
     hub->dispose();
     meta->dispose();
     gop_cache->dispose();
+    time_shift->dispose();
 }
 
 srs_error_t SrsSource::cycle()
@@ -1873,6 +2723,10 @@ srs_error_t SrsSource::cycle()
         return srs_error_wrap(err, "hub cycle");
     }
     
+    if ((err = play_edge->cycle()) != srs_success) {
+        return srs_error_wrap(err, "edge cycle");
+    }
+    
     return srs_success;
 }
 
@@ -1889,7 +2743,7 @@ bool SrsSource::expired()
     }
     
     // has any consumers?
-    if (!consumers.empty()) {
+    if (!consumers.empty() || nn_shared > 0) {
         return false;
     }
     
@@ -1928,10 +2782,30 @@ srs_error_t SrsSource::initialize(SrsRequest* r, ISrsSourceHandler* h)
     
     jitter_algorithm = (SrsRtmpJitterAlgorithm)_srs_config->get_time_jitter(req->vhost);
     mix_correct = _srs_config->get_mix_correct(req->vhost);
+    gop_cache->set_fast_join(_srs_config->get_fast_join(req->vhost), _srs_config->get_fast_join_latency(req->vhost),
+        _srs_config->get_fast_join_accelerate(req->vhost));
+    time_shift->set_duration(_srs_config->get_time_shift(req->vhost));
+    
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+    update_ring_size(srs_drop_policy_parse(_srs_config->get_drop_policy(req->vhost)), queue_size);
+#endif
     
     return err;
 }
 
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+void SrsSource::update_ring_size(SrsDropPolicy policy, srs_utime_t queue_size)
+{
+    // The ring only keeps the messages not read by consumers, and this size limits the lag of
+    // the slowest consumer. The shifted consumer reads the backlog from its queue, while the ring
+    // grows by the offset, so the limit is the offset plus the queue size, or it skips to live.
+    srs_utime_t v = queue_size + time_shift->get_duration();
+    
+    // For frame policy, the consumer lags at most twice of queue size.
+    ring->set_queue_size(policy == SrsDropPolicyFrame? 2 * v : v);
+}
+#endif
+
 srs_error_t SrsSource::on_reload_vhost_play(string vhost)
 {
     srs_error_t err = srs_success;
@@ -1974,6 +2848,19 @@ srs_error_t SrsSource::on_reload_vhost_play(string vhost)
             srs_trace("vhost %s gop_cache changed to %d, source url=%s", vhost.c_str(), v, url.c_str());
             gop_cache->set(v);
         }
+        
+        gop_cache->set_fast_join(_srs_config->get_fast_join(vhost), _srs_config->get_fast_join_latency(vhost),
+            _srs_config->get_fast_join_accelerate(vhost));
+    }
+    
+    // time-shift changed.
+    if (true) {
+        srs_utime_t v = _srs_config->get_time_shift(vhost);
+        
+        if ((v > 0) != time_shift->enabled()) {
+            srs_trace("vhost %s time_shift changed to %dms, source url=%s", vhost.c_str(), srsu2msi(v), req->get_stream_url().c_str());
+        }
+        time_shift->set_duration(v);
     }
     
     // queue length
@@ -1983,10 +2870,15 @@ srs_error_t SrsSource::on_reload_vhost_play(string vhost)
         if (true) {
             std::vector<SrsConsumer*>::iterator it;
             
+            SrsDropPolicy policy = srs_drop_policy_parse(_srs_config->get_drop_policy(req->vhost));
             for (it = consumers.begin(); it != consumers.end(); ++it) {
                 SrsConsumer* consumer = *it;
                 consumer->set_queue_size(v);
+                consumer->set_drop_policy(policy);
             }
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+            update_ring_size(policy, v);
+#endif
             
             srs_trace("consumers reload queue size success.");
         }
@@ -2056,6 +2948,11 @@ bool SrsSource::inactive()
     return _can_publish;
 }
 
+SrsMuxPipeline* SrsSource::mux_pipeline()
+{
+    return hub->mux_pipeline();
+}
+
 void SrsSource::update_auth(SrsRequest* r)
 {
     req->update_auth(r);
@@ -2102,14 +2999,8 @@ srs_error_t SrsSource::on_meta_data(SrsCommonMessage* msg, SrsOnMetaDataPacket*
     }
     
     // copy to all consumer
-    if (!drop_for_reduce) {
-        std::vector<SrsConsumer*>::iterator it;
-        for (it = consumers.begin(); it != consumers.end(); ++it) {
-            SrsConsumer* consumer = *it;
-            if ((err = consumer->enqueue(meta->data(), atc, jitter_algorithm)) != srs_success) {
-                return srs_error_wrap(err, "consume metadata");
-            }
-        }
+    if (!drop_for_reduce && (err = copy_to_consumers(meta->data())) != srs_success) {
+        return srs_error_wrap(err, "consume metadata");
     }
     
     // Copy to hub to all utilities.
@@ -2178,13 +3069,8 @@ srs_error_t SrsSource::on_audio_imp(SrsSharedPtrMessage* msg)
     }
     
     // copy to all consumer
-    if (!drop_for_reduce) {
-        for (int i = 0; i < (int)consumers.size(); i++) {
-            SrsConsumer* consumer = consumers.at(i);
-            if ((err = consumer->enqueue(msg, atc, jitter_algorithm)) != srs_success) {
-                return srs_error_wrap(err, "consume message");
-            }
-        }
+    if (!drop_for_reduce && (err = copy_to_consumers(msg)) != srs_success) {
+        return srs_error_wrap(err, "consume message");
     }
     
     // Copy to hub to all utilities.
@@ -2211,6 +3097,11 @@ srs_error_t SrsSource::on_audio_imp(SrsSharedPtrMessage* msg)
         return srs_error_wrap(err, "gop cache consume audio");
     }
     
+    // keep the recent packets for time-shift.
+    if ((err = time_shift->cache(msg)) != srs_success) {
+        return srs_error_wrap(err, "time-shift consume audio");
+    }
+    
     // if atc, update the sequence header to abs time.
     if (atc) {
         if (meta->ash()) {
@@ -2308,13 +3199,8 @@ srs_error_t SrsSource::on_video_imp(SrsSharedPtrMessage* msg)
     }
     
     // copy to all consumer
-    if (!drop_for_reduce) {
-        for (int i = 0; i < (int)consumers.size(); i++) {
-            SrsConsumer* consumer = consumers.at(i);
-            if ((err = consumer->enqueue(msg, atc, jitter_algorithm)) != srs_success) {
-                return srs_error_wrap(err, "consume video");
-            }
-        }
+    if (!drop_for_reduce && (err = copy_to_consumers(msg)) != srs_success) {
+        return srs_error_wrap(err, "consume video");
     }
     
     // when sequence header, donot push to gop cache and adjust the timestamp.
@@ -2327,6 +3213,11 @@ srs_error_t SrsSource::on_video_imp(SrsSharedPtrMessage* msg)
         return srs_error_wrap(err, "gop cache consume vdieo");
     }
     
+    // keep the recent packets for time-shift.
+    if ((err = time_shift->cache(msg)) != srs_success) {
+        return srs_error_wrap(err, "time-shift consume video");
+    }
+    
     // if atc, update the sequence header to abs time.
     if (atc) {
         if (meta->vsh()) {
@@ -2340,6 +3231,38 @@ srs_error_t SrsSource::on_video_imp(SrsSharedPtrMessage* msg)
     return err;
 }
 
+srs_error_t SrsSource::copy_to_consumers(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    if (consumers.empty()) {
+        return err;
+    }
+    
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+    // Enqueue once, all consumers read it from the ring.
+    ring->enqueue(msg);
+    
+    // Remove the messages read by all consumers.
+    int64_t seq = ring->end();
+    for (int i = 0; i < (int)consumers.size(); i++) {
+        SrsConsumer* consumer = consumers.at(i);
+        consumer->on_ring_messages(atc);
+        seq = srs_min(seq, consumer->ring_cursor());
+    }
+    ring->trim(seq);
+#else
+    for (int i = 0; i < (int)consumers.size(); i++) {
+        SrsConsumer* consumer = consumers.at(i);
+        if ((err = consumer->enqueue(msg, atc, jitter_algorithm)) != srs_success) {
+            return srs_error_wrap(err, "consume message");
+        }
+    }
+#endif
+    
+    return err;
+}
+
 srs_error_t SrsSource::on_aggregate(SrsCommonMessage* msg)
 {
     srs_error_t err = srs_success;
@@ -2468,6 +3391,7 @@ srs_error_t SrsSource::on_publish()
     }
     SrsStatistic* stat = SrsStatistic::instance();
     stat->on_stream_publish(req, _source_id);
+    stat->on_stream_pipeline(req, hub->mux_pipeline());
     
     return err;
 }
@@ -2486,6 +3410,7 @@ void SrsSource::on_unpublish()
     // donot clear the sequence header, for it maybe not changed,
     // when drop dup sequence header, drop the metadata also.
     gop_cache->clear();
+    time_shift->clear();
 
     // Reset the metadata cache, to make VLC happy when disable/enable stream.
     // @see https://github.com/ossrs/srs/issues/1630#issuecomment-597979448
@@ -2509,14 +3434,19 @@ void SrsSource::on_unpublish()
     }
 }
 
-srs_error_t SrsSource::create_consumer(SrsConnection* conn, SrsConsumer*& consumer, bool ds, bool dm, bool dg)
+srs_error_t SrsSource::create_consumer(SrsConnection* conn, SrsConsumer*& consumer, bool ds, bool dm, bool dg, srs_utime_t shift)
 {
     srs_error_t err = srs_success;
     
     consumer = new SrsConsumer(this, conn);
     consumers.push_back(consumer);
+    
+    // The time-shift is only available when enabled, and the queue holds the offset,
+    // which is at most the duration of time-shift, the same as the ring keeps.
+    shift = srs_min(shift, time_shift->get_duration());
 
     srs_utime_t queue_size = _srs_config->get_queue_length(req->vhost);
+    consumer->set_time_shift(shift);
     consumer->set_queue_size(queue_size);
 
     // if atc, update the sequence header to gop cache time.
@@ -2539,21 +3469,30 @@ srs_error_t SrsSource::create_consumer(SrsConnection* conn, SrsConsumer*& consum
             return srs_error_wrap(err, "meta dumps");
         }
 
+        // copy time-shift buffer to client, start at the offset from live.
+        int nb_shifted = 0;
+        if (dg && shift > 0 && (err = time_shift->dump(consumer, shift, atc, jitter_algorithm, nb_shifted)) != srs_success) {
+            return srs_error_wrap(err, "time-shift dumps");
+        }
+
         // copy gop cache to client.
-        if (dg && (err = gop_cache->dump(consumer, atc, jitter_algorithm)) != srs_success) {
+        if (dg && !nb_shifted && (err = gop_cache->dump(consumer, atc, jitter_algorithm)) != srs_success) {
             return srs_error_wrap(err, "gop cache dumps");
         }
     }
+    
+    // The drop policy is for the lag of consumer, which excludes the dumped messages.
+    consumer->set_drop_policy(srs_drop_policy_parse(_srs_config->get_drop_policy(req->vhost)));
 
     // print status.
     if (dg) {
-        srs_trace("create consumer, active=%d, queue_size=%.2f, jitter=%d", hub->active(), queue_size, jitter_algorithm);
+        srs_trace("create consumer, active=%d, queue_size=%dms, shift=%dms, jitter=%d", hub->active(), srsu2msi(queue_size), srsu2msi(shift), jitter_algorithm);
     } else {
         srs_trace("create consumer, active=%d, ignore gop cache, jitter=%d", hub->active(), jitter_algorithm);
     }
     
     // for edge, when play edge stream, check the state
-    if (_srs_config->get_vhost_is_edge(req->vhost)) {
+    if (SrsWorkers::instance()->is_edge(req)) {
         // notice edge to start for the first client.
         if ((err = play_edge->on_client_play()) != srs_success) {
             return srs_error_wrap(err, "play edge");
@@ -2572,6 +3511,40 @@ void SrsSource::on_consumer_destroy(SrsConsumer* consumer)
     }
     
     if (consumers.empty()) {
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+        ring->clear();
+#endif
+    }
+    
+    if (consumers.empty() && nn_shared == 0) {
+        play_edge->on_all_client_stop();
+        die_at = srs_get_system_time();
+    }
+}
+
+srs_error_t SrsSource::on_shared_play()
+{
+    srs_error_t err = srs_success;
+    
+    nn_shared++;
+    
+    // for edge, when play edge stream, check the state
+    if (SrsWorkers::instance()->is_edge(req)) {
+        // notice edge to start for the first client.
+        if ((err = play_edge->on_client_play()) != srs_success) {
+            return srs_error_wrap(err, "play edge");
+        }
+    }
+    
+    return err;
+}
+
+void SrsSource::on_shared_stop()
+{
+    nn_shared--;
+    srs_assert(nn_shared >= 0);
+    
+    if (consumers.empty() && nn_shared == 0) {
         play_edge->on_all_client_stop();
         die_at = srs_get_system_time();
     }
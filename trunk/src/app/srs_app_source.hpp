@@ -28,6 +28,7 @@
 
 #include <map>
 #include <vector>
+#include <deque>
 #include <string>
 
 #include <srs_app_st.hpp>
@@ -51,6 +52,7 @@ class SrsRtmpServer;
 class SrsEdgeProxyContext;
 class SrsMessageArray;
 class SrsNgExec;
+class SrsMuxPipeline;
 class SrsConnection;
 class SrsMessageHeader;
 class SrsHls;
@@ -58,6 +60,7 @@ class SrsDvr;
 class SrsDash;
 class SrsEncoder;
 class SrsBuffer;
+class SrsPacer;
 #ifdef SRS_AUTO_HDS
 class SrsHds;
 #endif
@@ -74,6 +77,34 @@ enum SrsRtmpJitterAlgorithm
 };
 int _srs_time_jitter_string2int(std::string time_jitter);
 
+// The policy to drop messages for slow consumer, when the queue exceeds the queue length.
+// 1. gop, drop all messages and start from the latest keyframe.
+// 2. frame, drop the disposable frames, then the video before latest keyframe but keep the audio,
+//      finally drop all messages when exceeds twice of queue length.
+enum SrsDropPolicy
+{
+    SrsDropPolicyGop = 0x01,
+    SrsDropPolicyFrame,
+};
+SrsDropPolicy srs_drop_policy_parse(std::string v);
+
+// The counters of messages dropped for slow consumer.
+class SrsDropStat
+{
+public:
+    // The disposable video frames dropped.
+    int64_t disposable;
+    // The video frames dropped before keyframe, while the audio is kept.
+    int64_t video;
+    // The messages dropped by shrinking the whole queue.
+    int64_t all;
+public:
+    SrsDropStat();
+    virtual ~SrsDropStat();
+public:
+    virtual int64_t total();
+};
+
 // Time jitter detect and correct, to ensure the rtmp stream is monotonically.
 class SrsRtmpJitter
 {
@@ -129,6 +160,13 @@ private:
     bool _ignore_shrink;
     // The max queue size, shrink if exceed it.
     srs_utime_t max_queue_size;
+    SrsDropPolicy drop_policy;
+    // The counters of dropped messages, NULL to ignore.
+    SrsDropStat* drops;
+    // For frame policy, the number of messages at the front already scanned for disposable frames,
+    // and the index of the latest keyframe to drop the video before it, -1 if dropped or none.
+    int nb_scanned;
+    int latest_keyframe;
 #ifdef SRS_PERF_QUEUE_FAST_VECTOR
     SrsFastVector msgs;
 #else
@@ -145,6 +183,8 @@ public:
     // Set the queue size
     // @param queue_size the queue size in srs_utime_t.
     virtual void set_queue_size(srs_utime_t queue_size);
+    // Set the drop policy, and the counters to update, NULL to ignore.
+    virtual void set_drop_policy(SrsDropPolicy policy, SrsDropStat* stat);
 public:
     // Enqueue the message, the timestamp always monotonically.
     // @param msg, the msg to enqueue, user never free it whatever the return code.
@@ -154,7 +194,8 @@ public:
     // @pmsgs SrsSharedPtrMessage*[], used to store the msgs, user must alloc it.
     // @count the count in array, output param.
     // @max_count the max count to dequeue, must be positive.
-    virtual srs_error_t dump_packets(int max_count, SrsSharedPtrMessage** pmsgs, int& count);
+    // @max_bytes the max bytes to dequeue, -1 for unlimited, the last message maybe exceed it.
+    virtual srs_error_t dump_packets(int max_count, SrsSharedPtrMessage** pmsgs, int& count, int64_t max_bytes = -1);
     // Dumps packets to consumer, use specified args.
     // @remark the atc/tba/tbv/ag are same to SrsConsumer.enqueue().
     virtual srs_error_t dump_packets(SrsConsumer* consumer, bool atc, SrsRtmpJitterAlgorithm ag);
@@ -162,11 +203,71 @@ private:
     // Remove a gop from the front.
     // if no iframe found, clear it.
     virtual void shrink();
+    // Drop the video frames by the frame policy, keep the audio.
+    // @remark Only scan the new messages, except when dropping the video before a new keyframe.
+    virtual void drop_frames();
 public:
     // clear all messages in queue.
     virtual void clear();
 };
 
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+// The shared ring of messages for all consumers of source, each consumer reads
+// the messages by its cursor, so the source enqueue a message once rather than
+// copy it to the queue of each consumer.
+// We only keep the messages not read by all consumers and the latest gop, while
+// the size in seconds limits the lag of the slowest consumer.
+class SrsMessageRing
+{
+private:
+    // The ring of messages, in sequence [head, tail).
+    SrsSharedPtrMessage** msgs;
+    // The ring time of each message.
+    srs_utime_t* times;
+    int capacity;
+    int64_t head;
+    int64_t tail;
+    // The ring time, only increased by the delta of av messages,
+    // so it's monotonically when the timestamp of stream jumps.
+    srs_utime_t ring_time;
+    int64_t last_av_timestamp;
+    // The sequence of video keyframes in ring, in ascending order.
+    std::deque<int64_t> keyframes;
+    // The max queue size, shrink if exceed it.
+    srs_utime_t max_queue_size;
+public:
+    SrsMessageRing();
+    virtual ~SrsMessageRing();
+public:
+    // Set the queue size, in srs_utime_t.
+    virtual void set_queue_size(srs_utime_t queue_size);
+    // The sequence of the first message.
+    virtual int64_t begin();
+    // The sequence of the next message to enqueue.
+    virtual int64_t end();
+    // Get the message at sequence, which must in [begin, end).
+    virtual SrsSharedPtrMessage* at(int64_t seq);
+    // Get the duration from sequence to the last message.
+    virtual srs_utime_t duration(int64_t seq);
+    // Get the sequence of the latest keyframe, -1 if no keyframe.
+    virtual int64_t keyframe();
+public:
+    // Enqueue the message, which is copied by ring.
+    // @param msg, directly ptr, copy it if need to save it.
+    virtual void enqueue(SrsSharedPtrMessage* msg);
+    // Remove the messages before sequence, which are read by all consumers,
+    // but keep the latest gop, for new or slow consumer to skip to.
+    virtual void trim(int64_t seq);
+    // Clear all messages in ring, the sequence is never reset.
+    virtual void clear();
+private:
+    // Remove the old messages from the front, but keep the latest keyframe.
+    virtual void shrink();
+    // Remove the first message.
+    virtual void pop();
+};
+#endif
+
 // The wakable used for some object
 // which is waiting on cond.
 class ISrsWakable
@@ -188,8 +289,23 @@ private:
     SrsRtmpJitter* jitter;
     SrsSource* source;
     SrsMessageQueue* queue;
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+    // The live messages are read from the shared ring of source,
+    // while the queue only for the messages dumps to this consumer,
+    // for example, the sequence headers and gop cache.
+    SrsMessageRing* ring;
+    // The sequence of next message to read in ring.
+    int64_t cursor;
+    srs_utime_t queue_size;
+#endif
+    // The offset of time-shift, the queue holds it beyond the queue length.
+    srs_utime_t shift;
     // The owner connection for debug, maybe NULL.
     SrsConnection* conn;
+    // The pacer of egress, NULL if disabled.
+    SrsPacer* pacer;
+    SrsDropPolicy drop_policy;
+    SrsDropStat* drops;
     bool paused;
     // when source id changed, notice all consumers
     bool should_update_source_id;
@@ -205,10 +321,17 @@ public:
     SrsConsumer(SrsSource* s, SrsConnection* c);
     virtual ~SrsConsumer();
 public:
-    // Set the size of queue.
+    // Set the size of queue, which also holds the offset of time-shift.
     virtual void set_queue_size(srs_utime_t queue_size);
+    // Set the offset of time-shift, apply it when set the size of queue.
+    virtual void set_time_shift(srs_utime_t shift);
     // when source id changed, notice client to print.
     virtual void update_source_id();
+    // Set the policy to drop messages when the consumer is slow.
+    virtual void set_drop_policy(SrsDropPolicy policy);
+    virtual SrsDropStat* dropped();
+    // Pace the dumped packets by the config of vhost.
+    virtual void enable_pacing(std::string vhost);
 public:
     // Get current client time, the last packet time.
     virtual int64_t get_time();
@@ -222,6 +345,23 @@ public:
     // @param count the count in array, intput and output param.
     // @remark user can specifies the count to get specified msgs; 0 to get all if possible.
     virtual srs_error_t dump_packets(SrsMessageArray* msgs, int& count);
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+    // When source enqueue messages to the shared ring, wakeup consumer if enough.
+    // @param whether atc, the duration maybe negative for atc.
+    virtual void on_ring_messages(bool atc);
+    // Get the sequence of next message to read in ring.
+    virtual int64_t ring_cursor();
+private:
+    // Dumps the messages from ring, and correct the time jitter.
+    // @param max_bytes the max bytes to dump, -1 for unlimited.
+    virtual srs_error_t dump_ring(SrsSharedPtrMessage** pmsgs, int max, int& count, int64_t max_bytes);
+    // Skip to the latest keyframe when consumer is too slow.
+    virtual srs_error_t skip_ring();
+    // Get the count and duration of messages to consume.
+    virtual int size();
+    virtual srs_utime_t duration();
+public:
+#endif
 #ifdef SRS_PERF_QUEUE_COND_WAIT
     // wait for messages incomming, atleast nb_msgs and in duration.
     // @param nb_msgs the messages count to wait.
@@ -263,6 +403,14 @@ private:
     int audio_after_last_video_count;
     // cached gop.
     std::vector<SrsSharedPtrMessage*> gop_cache;
+    // The index of keyframes in cached gop, the join point of consumer.
+    std::vector<int> keyframes;
+    // Whether fast join, start from the latest keyframe and skip the frames not required to decode.
+    bool fast_join;
+    // For fast join, the latency of the last frames which are dumped entirely.
+    srs_utime_t fast_join_latency;
+    // For fast join, whether accelerate the timestamp of frames before the latency.
+    bool fast_join_accelerate;
 public:
     SrsGopCache();
     virtual ~SrsGopCache();
@@ -272,6 +420,8 @@ public:
     // To enable or disable the gop cache.
     virtual void set(bool v);
     virtual bool enabled();
+    // Set the fast join of consumer.
+    virtual void set_fast_join(bool v, srs_utime_t latency, bool accelerate);
     // only for h264 codec
     // 1. cache the gop when got h264 video packet.
     // 2. clear gop when got keyframe.
@@ -281,6 +431,11 @@ public:
     virtual void clear();
     // dump the cached gop to consumer.
     virtual srs_error_t dump(SrsConsumer* consumer, bool atc, SrsRtmpJitterAlgorithm jitter_algorithm);
+private:
+    // Dump from the latest keyframe, the frames before the latency are dumped only when required
+    // to decode, that is the referenced video frames, and accelerated if required.
+    virtual srs_error_t fast_dump(SrsConsumer* consumer, bool atc, SrsRtmpJitterAlgorithm jitter_algorithm);
+public:
     // used for atc to get the time of gop cache,
     // The atc will adjust the sequence header timestamp to gop cache.
     virtual bool empty();
@@ -292,6 +447,48 @@ public:
     virtual bool pure_audio();
 };
 
+// Parse the start offset of player from live, for example, -60s, -1500ms or 60.
+// @return the offset before live, 0 for live or invalid.
+srs_utime_t srs_time_shift_parse(std::string v);
+
+// The time-shift buffer of source, keeps the recent media in memory indexed by keyframe,
+// so the player starts at an offset from live, without DVR.
+class SrsTimeShift
+{
+private:
+    // The duration of media to keep, 0 to disable.
+    srs_utime_t duration;
+    // The cached messages, the sequence of the first one is base.
+    std::deque<SrsSharedPtrMessage*> msgs;
+    int64_t base;
+    // The index of keyframes, the timestamp in ms and the sequence of message.
+    std::deque<std::pair<int64_t, int64_t> > keyframes;
+public:
+    SrsTimeShift();
+    virtual ~SrsTimeShift();
+public:
+    // cleanup when system quit.
+    virtual void dispose();
+    // To set the duration, 0 to disable and clear the buffer.
+    virtual void set_duration(srs_utime_t v);
+    virtual bool enabled();
+    // The max offset for consumer, which is the duration to keep.
+    virtual srs_utime_t get_duration();
+    // Cache the audio or video, except the sequence header.
+    // @param shared_msg, directly ptr, copy it if need to save it.
+    virtual srs_error_t cache(SrsSharedPtrMessage* shared_msg);
+    virtual void clear();
+    // Dump the messages from the keyframe before the offset from the last message.
+    // @param nb_msgs The number of messages dumped, 0 if buffer is empty.
+    virtual srs_error_t dump(SrsConsumer* consumer, srs_utime_t offset, bool atc, SrsRtmpJitterAlgorithm jitter_algorithm, int& nb_msgs);
+    // The duration of media in buffer.
+    virtual srs_utime_t buffered();
+    virtual int size();
+private:
+    // Drop the GOPs out of the duration, and the messages before the first keyframe.
+    virtual void shrink();
+};
+
 // The handler to handle the event of srs source.
 // For example, the http flv streaming module handle the event and
 // mount http when rtmp start publishing.
@@ -349,6 +546,8 @@ private:
 #endif
     // nginx-rtmp exec feature.
     SrsNgExec* ng_exec;
+    // The muxing pipeline, to share the output formats and measure the stages.
+    SrsMuxPipeline* pipeline;
     // To forward stream to other servers
     std::vector<SrsForwarder*> forwarders;
 public:
@@ -366,6 +565,7 @@ public:
     virtual srs_error_t cycle();
     // Whether the stream hub is active, or stream is publishing.
     virtual bool active();
+    virtual SrsMuxPipeline* mux_pipeline();
 public:
     // When got a parsed metadata.
     virtual srs_error_t on_meta_data(SrsSharedPtrMessage* shared_metadata, SrsOnMetaDataPacket* packet);
@@ -489,6 +689,7 @@ extern SrsSourceManager* _srs_sources;
 class SrsSource : public ISrsReloadHandler
 {
     friend class SrsOriginHub;
+    friend class SrsConsumer;
 private:
     // For publish, it's the publish client id.
     // For edge, it's the edge ingest id.
@@ -523,16 +724,24 @@ private:
     SrsPublishEdge* publish_edge;
     // The gop cache for client fast startup.
     SrsGopCache* gop_cache;
+    // The time-shift buffer for client to start at an offset from live.
+    SrsTimeShift* time_shift;
     // The hub for origin server.
     SrsOriginHub* hub;
     // The metadata cache.
     SrsMetaCache* meta;
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+    // The shared ring of messages for consumers.
+    SrsMessageRing* ring;
+#endif
 private:
     // Whether source is avaiable for publishing.
     bool _can_publish;
     // The last die time, when all consumers quit and no publisher,
     // We will remove the source when source die.
     srs_utime_t die_at;
+    // The number of viewers of the shared outputs of pipeline, which has no consumer.
+    int nn_shared;
 public:
     SrsSource();
     virtual ~SrsSource();
@@ -544,6 +753,11 @@ public:
 public:
     // Initialize the hls with handlers.
     virtual srs_error_t initialize(SrsRequest* r, ISrsSourceHandler* h);
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+private:
+    // Set the size of ring to the max lag of consumers, including the time-shift offset.
+    virtual void update_ring_size(SrsDropPolicy policy, srs_utime_t queue_size);
+#endif
 // Interface ISrsReloadHandler
 public:
     virtual srs_error_t on_reload_vhost_play(std::string vhost);
@@ -556,6 +770,8 @@ public:
     // Whether source is inactive, which means there is no publishing stream source.
     // @remark For edge, it's inactive util stream has been pulled from origin.
     virtual bool inactive();
+    // Get the muxing pipeline of source, to share the output formats.
+    virtual SrsMuxPipeline* mux_pipeline();
     // Update the authentication information in request.
     virtual void update_auth(SrsRequest* r);
 public:
@@ -569,6 +785,8 @@ public:
     virtual srs_error_t on_video(SrsCommonMessage* video);
 private:
     virtual srs_error_t on_video_imp(SrsSharedPtrMessage* video);
+    // Copy the message to all consumers.
+    virtual srs_error_t copy_to_consumers(SrsSharedPtrMessage* msg);
 public:
     virtual srs_error_t on_aggregate(SrsCommonMessage* msg);
     // Publish stream event notify.
@@ -582,8 +800,12 @@ public:
     // @param ds, whether dumps the sequence header.
     // @param dm, whether dumps the metadata.
     // @param dg, whether dumps the gop cache.
-    virtual srs_error_t create_consumer(SrsConnection* conn, SrsConsumer*& consumer, bool ds = true, bool dm = true, bool dg = true);
+    // @param shift, the offset from live to start at in time-shift buffer, 0 for gop cache.
+    virtual srs_error_t create_consumer(SrsConnection* conn, SrsConsumer*& consumer, bool ds = true, bool dm = true, bool dg = true, srs_utime_t shift = 0);
     virtual void on_consumer_destroy(SrsConsumer* consumer);
+    // The viewer of shared output of pipeline starts and stops to play.
+    virtual srs_error_t on_shared_play();
+    virtual void on_shared_stop();
     virtual void set_cache(bool enabled);
     virtual SrsRtmpJitterAlgorithm jitter();
 public:
@@ -34,6 +34,7 @@ using namespace std;
 #include <srs_app_config.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_protocol_amf0.hpp>
+#include <srs_app_pipeline.hpp>
 
 int64_t srs_gvid = 0;
 
@@ -115,6 +116,7 @@ SrsStatisticStream::SrsStatisticStream()
     aac_object = SrsAacObjectTypeReserved;
     width = 0;
     height = 0;
+    pipeline = NULL;
     
     clk = new SrsWallClock();
     kbps = new SrsKbps(clk);
@@ -122,6 +124,8 @@ SrsStatisticStream::SrsStatisticStream()
     
     nb_clients = 0;
     nb_frames = 0;
+    nb_plays = 0;
+    last_play = 0;
 }
 
 SrsStatisticStream::~SrsStatisticStream()
@@ -181,6 +185,15 @@ srs_error_t SrsStatisticStream::dumps(SrsJsonObject* obj)
         audio->set("profile", SrsJsonAny::str(srs_aac_object2str(aac_object).c_str()));
     }
     
+    if (!pipeline) {
+        obj->set("pipeline", SrsJsonAny::null());
+    } else {
+        SrsJsonObject* opipeline = SrsJsonAny::object();
+        obj->set("pipeline", opipeline);
+        
+        pipeline->dumps(opipeline);
+    }
+    
     return err;
 }
 
@@ -197,6 +210,7 @@ void SrsStatisticStream::close()
     has_video = false;
     has_audio = false;
     active = false;
+    pipeline = NULL;
     
     vhost->nb_streams--;
 }
@@ -231,6 +245,10 @@ srs_error_t SrsStatisticClient::dumps(SrsJsonObject* obj)
     obj->set("publish", SrsJsonAny::boolean(srs_client_type_is_publish(type)));
     obj->set("alive", SrsJsonAny::number(srsu2ms(srs_get_system_time() - create) / 1000.0));
     
+    if (conn) {
+        conn->dumps(obj);
+    }
+    
     return err;
 }
 
@@ -380,6 +398,14 @@ void SrsStatistic::on_stream_publish(SrsRequest* req, int cid)
     stream->publish(cid);
 }
 
+void SrsStatistic::on_stream_pipeline(SrsRequest* req, SrsMuxPipeline* pipeline)
+{
+    SrsStatisticVhost* vhost = create_vhost(req);
+    SrsStatisticStream* stream = create_stream(vhost, req);
+    
+    stream->pipeline = pipeline;
+}
+
 void SrsStatistic::on_stream_close(SrsRequest* req)
 {
     SrsStatisticVhost* vhost = create_vhost(req);
@@ -428,6 +454,11 @@ srs_error_t SrsStatistic::on_client(int id, SrsRequest* req, SrsConnection* conn
     stream->nb_clients++;
     vhost->nb_clients++;
     
+    if (!srs_client_type_is_publish(type)) {
+        stream->nb_plays++;
+        stream->last_play = srs_get_system_time();
+    }
+    
     return err;
 }
 
@@ -449,6 +480,36 @@ void SrsStatistic::on_disconnect(int id)
     vhost->nb_clients--;
 }
 
+bool SrsStatistic::is_hot(SrsRequest* req, int top, srs_utime_t duration)
+{
+    std::map<std::string, SrsStatisticStream*>::iterator it = rstreams.find(req->get_stream_url());
+    if (it == rstreams.end()) {
+        return false;
+    }
+    
+    srs_utime_t now = srs_get_system_time();
+    
+    SrsStatisticStream* stream = it->second;
+    if (stream->nb_plays <= 0 || now - stream->last_play > duration) {
+        return false;
+    }
+    
+    // The rank of stream, by the plays of recent played streams in vhost.
+    int rank = 0;
+    for (it = rstreams.begin(); it != rstreams.end() && rank < top; ++it) {
+        SrsStatisticStream* s = it->second;
+        if (s == stream || s->vhost != stream->vhost || now - s->last_play > duration) {
+            continue;
+        }
+        
+        if (s->nb_plays > stream->nb_plays) {
+            rank++;
+        }
+    }
+    
+    return rank < top;
+}
+
 void SrsStatistic::kbps_add_delta(SrsConnection* conn)
 {
     int id = conn->srs_id();
@@ -39,6 +39,7 @@ class SrsRequest;
 class SrsConnection;
 class SrsJsonObject;
 class SrsJsonArray;
+class SrsMuxPipeline;
 
 struct SrsStatisticVhost
 {
@@ -70,6 +71,9 @@ public:
     int connection_cid;
     int nb_clients;
     uint64_t nb_frames;
+    // The number of players, and when the last player starts.
+    int64_t nb_plays;
+    srs_utime_t last_play;
 public:
     // The stream total kbps.
     SrsKbps* kbps;
@@ -94,6 +98,9 @@ public:
     // 1.5.1.1 Audio object type definition, page 23,
     //           in ISO_IEC_14496-3-AAC-2001.pdf.
     SrsAacObjectType aac_object;
+public:
+    // The muxing pipeline of source, NULL if not published.
+    SrsMuxPipeline* pipeline;
 public:
     SrsStatisticStream();
     virtual ~SrsStatisticStream();
@@ -170,6 +177,8 @@ public:
     // @param req the request object of publish connection.
     // @param cid the cid of publish connection.
     virtual void on_stream_publish(SrsRequest* req, int cid);
+    // When stream is published, to dumps the cost of muxing pipeline.
+    virtual void on_stream_pipeline(SrsRequest* req, SrsMuxPipeline* pipeline);
     // When close stream.
     virtual void on_stream_close(SrsRequest* req);
 public:
@@ -184,6 +193,9 @@ public:
     //      only got the request object, so the client specified by id maybe not
     //      exists in stat.
     virtual void on_disconnect(int id);
+    // Whether the stream is hot, in the top streams by plays of vhost,
+    // and played in the duration.
+    virtual bool is_hot(SrsRequest* req, int top, srs_utime_t duration);
     // Sample the kbps, add delta bytes of conn.
     // Use kbps_sample() to get all result of kbps stat.
     // TODO: FIXME: the add delta must use ISrsKbpsDelta interface instead.
@@ -49,6 +49,8 @@ using namespace std;
 #include <srs_kernel_buffer.hpp>
 #include <srs_protocol_amf0.hpp>
 #include <srs_kernel_utility.hpp>
+#include <srs_kernel_pool.hpp>
+#include <srs_app_hls.hpp>
 
 // the longest time to wait for a process to quit.
 #define SRS_PROCESS_QUIT_TIMEOUT_MS 1000
@@ -1257,5 +1259,34 @@ void srs_api_dump_summaries(SrsJsonObject* obj)
     sys->set("conn_sys_tw", SrsJsonAny::integer(nrs->nb_conn_sys_tw));
     sys->set("conn_sys_udp", SrsJsonAny::integer(nrs->nb_conn_sys_udp));
     sys->set("conn_srs", SrsJsonAny::integer(nrs->nb_conn_srs));
+    
+    // pool of messages
+    SrsSlabPool* mp = srs_message_pool();
+    SrsJsonObject* pool = SrsJsonAny::object();
+    data->set("pool", pool);
+    
+    pool->set("allocs", SrsJsonAny::integer(mp->allocs()));
+    pool->set("hits", SrsJsonAny::integer(mp->hits()));
+    pool->set("frees", SrsJsonAny::integer(mp->frees()));
+    pool->set("drops", SrsJsonAny::integer(mp->drops()));
+    pool->set("large_allocs", SrsJsonAny::integer(mp->large_allocs()));
+    pool->set("cached_bytes", SrsJsonAny::integer(mp->cached_bytes()));
+    
+    SrsJsonArray* classes = SrsJsonAny::array();
+    pool->set("classes", classes);
+    for (int i = 0; i < mp->classes(); i++) {
+        SrsJsonObject* cls = SrsJsonAny::object();
+        classes->append(cls);
+        
+        cls->set("size", SrsJsonAny::integer(mp->class_size(i)));
+        cls->set("cached", SrsJsonAny::integer(mp->cached(i)));
+    }
+    
+    // hls files in memory
+    SrsJsonObject* hls = SrsJsonAny::object();
+    data->set("hls_memory", hls);
+    
+    hls->set("files", SrsJsonAny::integer(_srs_hls_store->size()));
+    hls->set("bytes", SrsJsonAny::integer(_srs_hls_store->bytes()));
 }
 
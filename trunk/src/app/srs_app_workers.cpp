@@ -0,0 +1,272 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_workers.hpp>
+
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <algorithm>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_consts.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_utility.hpp>
+
+// The interval for master to check the signals and workers.
+#define SRS_WORKER_CHECK_INTERVAL (100 * SRS_UTIME_MILLISECONDS)
+
+// The interval to respawn the dead worker, to avoid fork storm when worker crash at startup.
+#define SRS_WORKER_RESPAWN_INTERVAL (1 * SRS_UTIME_SECONDS)
+
+// The signals received by master, which are forwarded to workers.
+static int srs_worker_signals[] = {
+    SRS_SIGNAL_RELOAD, SRS_SIGNAL_REOPEN_LOG, SRS_SIGNAL_FAST_QUIT, SRS_SIGNAL_GRACEFULLY_QUIT, SIGINT
+};
+#define SRS_WORKER_NB_SIGNALS (int)(sizeof(srs_worker_signals) / sizeof(int))
+
+// The pending signals of master, set by signal handler.
+static volatile sig_atomic_t srs_worker_pending[SRS_WORKER_NB_SIGNALS];
+
+static void srs_worker_sig_catcher(int signo)
+{
+    for (int i = 0; i < SRS_WORKER_NB_SIGNALS; i++) {
+        if (srs_worker_signals[i] == signo) {
+            srs_worker_pending[i] = 1;
+        }
+    }
+}
+
+SrsWorkers* SrsWorkers::_instance = NULL;
+
+SrsWorkers::SrsWorkers()
+{
+    index = -1;
+    nb_workers = 0;
+    master = -1;
+}
+
+SrsWorkers::~SrsWorkers()
+{
+}
+
+SrsWorkers* SrsWorkers::instance()
+{
+    if (!_instance) {
+        _instance = new SrsWorkers();
+    }
+    return _instance;
+}
+
+bool SrsWorkers::enabled()
+{
+    return nb_workers > 0 || _srs_config->get_workers_enabled();
+}
+
+bool SrsWorkers::is_worker()
+{
+    return index >= 0;
+}
+
+int SrsWorkers::worker_index()
+{
+    return index;
+}
+
+srs_error_t SrsWorkers::fork_workers()
+{
+    srs_error_t err = srs_success;
+
+    nb_workers = _srs_config->get_workers_count();
+    if (nb_workers <= 0) {
+        nb_workers = srs_max(1, srs_get_cpuinfo()->nb_processors_online);
+    }
+    master = ::getpid();
+
+    // Catch the signals before fork, then forward to workers.
+    for (int i = 0; i < SRS_WORKER_NB_SIGNALS; i++) {
+        struct sigaction sa;
+        sa.sa_handler = srs_worker_sig_catcher;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = 0;
+        sigaction(srs_worker_signals[i], &sa, NULL);
+    }
+
+    // The failed worker is respawned later, see the loop below.
+    for (int i = 0; i < nb_workers; i++) {
+        int pid = spawn(i);
+        if (pid == 0) {
+            return err;
+        }
+        if (pid < 0) {
+            srs_warn("master fork worker %d failed, errno=%d, retry later", i, errno);
+        }
+        pids.push_back(pid);
+        respawns.push_back(pid < 0? srs_update_system_time() + SRS_WORKER_RESPAWN_INTERVAL : 0);
+    }
+    if (std::count(pids.begin(), pids.end(), -1) == nb_workers) {
+        return srs_error_new(ERROR_WORKER_FORK, "fork %d workers", nb_workers);
+    }
+    srs_trace("master pid=%d, fork %d workers, relay=%d", master, nb_workers, _srs_config->get_workers_relay_port());
+
+    bool quit = false;
+    while (true) {
+        // Forward all pending signals to workers.
+        for (int i = 0; i < SRS_WORKER_NB_SIGNALS; i++) {
+            if (!srs_worker_pending[i]) {
+                continue;
+            }
+            srs_worker_pending[i] = 0;
+
+            int signo = srs_worker_signals[i];
+            if (signo == SRS_SIGNAL_FAST_QUIT || signo == SRS_SIGNAL_GRACEFULLY_QUIT || signo == SIGINT) {
+                quit = true;
+            }
+            if (signo == SRS_SIGNAL_REOPEN_LOG) {
+                _srs_log->reopen();
+            }
+
+            srs_trace("master forward signal %d to %d workers, quit=%d", signo, (int)pids.size(), quit);
+            for (int j = 0; j < (int)pids.size(); j++) {
+                if (pids[j] > 0) {
+                    ::kill(pids[j], signo);
+                }
+            }
+        }
+
+        // Respawn the terminated workers when due, and retry if failed.
+        bool respawning = false;
+        srs_utime_t now = srs_update_system_time();
+        for (int i = 0; !quit && i < (int)respawns.size(); i++) {
+            if (!respawns[i]) {
+                continue;
+            }
+            if (now < respawns[i]) {
+                respawning = true;
+                continue;
+            }
+            
+            int pid = spawn(i);
+            if (pid == 0) {
+                return err;
+            }
+            if (pid < 0) {
+                srs_warn("master respawn worker %d failed, errno=%d, retry later", i, errno);
+                respawns[i] = now + SRS_WORKER_RESPAWN_INTERVAL;
+                respawning = true;
+                continue;
+            }
+            pids[i] = pid;
+            respawns[i] = 0;
+        }
+
+        int status = 0;
+        int pid = ::waitpid(-1, &status, WNOHANG);
+        if (pid < 0 && errno == ECHILD && !respawning) {
+            srs_trace("master quit, all workers terminated");
+            return err;
+        }
+        if (pid <= 0) {
+            ::usleep(SRS_WORKER_CHECK_INTERVAL);
+            continue;
+        }
+
+        vector<int>::iterator it = std::find(pids.begin(), pids.end(), pid);
+        if (it == pids.end()) {
+            continue;
+        }
+
+        int i = (int)(it - pids.begin());
+        pids[i] = -1;
+        srs_warn("worker %d pid=%d terminated, status=%d, quit=%d", i, pid, status, quit);
+
+        // Respawn the worker later if not quit, never block the signals forwarding.
+        if (!quit) {
+            respawns[i] = srs_update_system_time() + SRS_WORKER_RESPAWN_INTERVAL;
+        }
+    }
+
+    return err;
+}
+
+srs_error_t SrsWorkers::check_master()
+{
+    if (is_worker() && ::getppid() != master) {
+        return srs_error_new(ERROR_WORKER_MASTER, "master changed from %d to %d", master, ::getppid());
+    }
+    return srs_success;
+}
+
+int SrsWorkers::spawn(int i)
+{
+    int pid = ::fork();
+
+    if (pid == 0) {
+        index = i;
+        pids.clear();
+        respawns.clear();
+
+        // Restore the signals, the server will handle them by signal manager.
+        for (int j = 0; j < SRS_WORKER_NB_SIGNALS; j++) {
+            ::signal(srs_worker_signals[j], SIG_DFL);
+        }
+
+        srs_trace("worker %d started, pid=%d, master=%d", index, ::getpid(), master);
+    }
+
+    return pid;
+}
+
+int SrsWorkers::owner(SrsRequest* req)
+{
+    if (nb_workers <= 0) {
+        return index;
+    }
+
+    string url = req->get_stream_url();
+    uint32_t hash = srs_crc32_ieee(url.data(), (int)url.length());
+    return (int)(hash % (uint32_t)nb_workers);
+}
+
+bool SrsWorkers::should_relay(SrsRequest* req)
+{
+    return is_worker() && owner(req) != index;
+}
+
+bool SrsWorkers::is_edge(SrsRequest* req)
+{
+    return should_relay(req) || _srs_config->get_vhost_is_edge(req->vhost);
+}
+
+string SrsWorkers::relay_endpoint(int i)
+{
+    int port = _srs_config->get_workers_relay_port() + i;
+    return string(SRS_CONSTS_LOCALHOST) + ":" + srs_int2str(port);
+}
+
@@ -0,0 +1,90 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_WORKERS_HPP
+#define SRS_APP_WORKERS_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+#include <vector>
+
+class SrsRequest;
+
+// The multiple process workers, to use more CPUs.
+// The master forks workers which listen at the same ports by SO_REUSEPORT,
+// so the kernel balances the connections between workers. Each stream is owned
+// by one worker selected by the hash of stream url, and other workers relay the
+// stream from or to the owner by its loopback relay port, like edge to origin.
+class SrsWorkers
+{
+private:
+    static SrsWorkers* _instance;
+private:
+    // The index of current worker, -1 for master or single process.
+    int index;
+    // The number of workers.
+    int nb_workers;
+    // The pid of master, worker quits when master changed.
+    int master;
+    // The pid of workers, for master only, -1 if terminated.
+    std::vector<int> pids;
+    // The time in srs_utime_t to respawn the terminated worker, 0 if alive.
+    std::vector<srs_utime_t> respawns;
+private:
+    SrsWorkers();
+    virtual ~SrsWorkers();
+public:
+    static SrsWorkers* instance();
+public:
+    // Whether the workers mode is enabled, for both master and workers.
+    virtual bool enabled();
+    // Whether current process is a worker.
+    virtual bool is_worker();
+    // Get the index of current worker, -1 for master or single process.
+    virtual int worker_index();
+public:
+    // For master, fork the workers then supervise them, that is, forward the signals
+    // to workers and respawn the dead worker.
+    // @remark Return in worker process to serve clients, while return in master
+    //       process when all workers terminated.
+    virtual srs_error_t fork_workers();
+    // For worker, check whether master is alive.
+    virtual srs_error_t check_master();
+private:
+    // Fork worker at index.
+    // @return The pid for master, 0 for worker, -1 when failed.
+    virtual int spawn(int i);
+public:
+    // Get the index of worker which owns the stream.
+    virtual int owner(SrsRequest* req);
+    // Whether current worker should relay the stream from or to its owner.
+    virtual bool should_relay(SrsRequest* req);
+    // Whether the stream works as edge, which is relayed or the vhost is edge.
+    virtual bool is_edge(SrsRequest* req);
+    // Get the relay endpoint <ip:port> of the worker at index.
+    virtual std::string relay_endpoint(int i);
+};
+
+#endif
+
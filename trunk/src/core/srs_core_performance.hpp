@@ -58,6 +58,16 @@
 #define SRS_PERF_MR_ENABLED false
 #define SRS_PERF_MR_SLEEP (350 * SRS_UTIME_MILLISECONDS)
 
+/**
+ * whether the message references the slice of receive buffer without copy,
+ * when the message is in one chunk, for the publisher, the chunk size is
+ * generally larger than the video frame, for example, 60000 bytes.
+ * the receive buffer is a refcounted block, which is switched to a new block
+ * when it's referenced by messages and no space left.
+ * @see SrsSharedBlock
+ */
+#define SRS_PERF_ZERO_COPY_READ
+
 /**
  * the MW(merged-write) send cache time in srs_utime_t.
  * the default value, user can override it in config.
@@ -125,6 +135,22 @@
 #ifdef SRS_PERF_QUEUE_COND_WAIT
     #define SRS_PERF_MW_MIN_MSGS 8
 #endif
+/**
+ * whether use a shared ring of messages for all consumers of source,
+ * the source enqueue a message once, each consumer reads it by its cursor,
+ * rather than copy the message to the queue of each consumer.
+ * @remark the time jitter is corrected when consumer dumps the messages.
+ */
+#define SRS_PERF_QUEUE_SHARED_RING
+
+/**
+ * whether share the HTTP-FLV/TS/AAC/MP3 stream between viewers,
+ * the stream is muxed once by the pipeline of source to refcounted chunks,
+ * and each viewer only sends the chunks by writev,
+ * rather than a consumer and encoder for each viewer.
+ * @see SrsMuxPipeline
+ */
+#define SRS_PERF_SHARED_HTTP_STREAM
 /**
  * the default value of vhost for
  * SRS whether use the min latency mode.
@@ -158,6 +184,15 @@
  */
 //#undef SRS_PERF_COMPLEX_SEND
 #define SRS_PERF_COMPLEX_SEND
+/**
+ * whether share the encoded chunks of message between players,
+ * the chunk headers and iovecs are built once by the first player,
+ * then copied by the others which send in the same chunk size, while the c0
+ * and c3 of extended timestamp are written by each player for its timestamp.
+ * @remark only apply it when SRS_PERF_COMPLEX_SEND is defined.
+ * @see SrsSharedPtrMessage::chunks()
+ */
+#define SRS_PERF_SHARED_CHUNKS
 /**
  * whether enable the TCP_NODELAY
  * user maybe need send small tcp packet for some network.
@@ -177,6 +212,45 @@
     #undef SRS_PERF_SO_SNDBUF_SIZE
 #endif
 
+/**
+ * whether use the slab pool for messages, to reuse the shared ptr messages,
+ * the shared payloads and the payload buffers, which are freed to the pool,
+ * to avoid malloc and fragment the heap for lots of streams.
+ * @see SrsSlabPool
+ */
+#define SRS_PERF_MESSAGE_POOL
+// The size of the first class of pool, the size of classes doubles.
+#define SRS_PERF_POOL_MIN_SIZE 64
+// The number of classes, 64B to 512KB, the larger buffers are not pooled.
+#define SRS_PERF_POOL_CLASSES 14
+// The max cached bytes of each class.
+#define SRS_PERF_POOL_MAX_CACHED (4 * 1024 * 1024)
+
+/**
+ * whether use the batch epoll of ST, which keeps the fd registered between waits,
+ * so a coroutine which waits on the same fd again, for example, the receive thread
+ * of publisher or player, costs no epoll_ctl, that is one epoll_wait per wait.
+ * @remark fallback to the epoll or kqueue when not supported.
+ * @see ST_EVENTSYS_BATCH
+ */
+#define SRS_PERF_ST_EPOLL_BATCH
+
+/**
+ * whether cache the DH keys and HMAC contexts for RTMP complex handshake, where
+ * the DH key is reused by some handshakes before regenerated, and the HMAC of the
+ * genuine FMS/FP keys is initialized once, so a reconnect storm costs less crypto.
+ * @remark Never cache for librtmp, which may handshake in threads.
+ * @see SrsDHPool
+ */
+#define SRS_PERF_HANDSHAKE_CACHE
+#if defined(SRS_EXPORT_LIBRTMP)
+    #undef SRS_PERF_HANDSHAKE_CACHE
+#endif
+// The number of DH keys in pool, used by handshakes in turn.
+#define SRS_PERF_HANDSHAKE_DH_KEYS 16
+// The max handshakes of a DH key, regenerated when exceed.
+#define SRS_PERF_HANDSHAKE_DH_REUSE 64
+
 /**
  * whether ensure glibc memory check.
  */
@@ -71,6 +71,36 @@ srs_error_t SrsAacTransmuxer::write_audio(int64_t timestamp, char* data, int siz
     
     timestamp &= 0x7fffffff;
     
+    char aac_fixed_header[7];
+    int pos = 0;
+    if ((err = encode_audio(data, size, aac_fixed_header, &pos)) != srs_success) {
+        return srs_error_wrap(err, "encode audio");
+    }
+    
+    // Ignore the sequence header.
+    if (pos <= 0) {
+        return err;
+    }
+    
+    // write 7bytes fixed header.
+    if ((err = writer->write(aac_fixed_header, 7, NULL)) != srs_success) {
+        return srs_error_wrap(err, "write aac header");
+    }
+    
+    // write aac frame body.
+    if ((err = writer->write(data + pos, size - pos, NULL)) != srs_success) {
+        return srs_error_wrap(err, "write aac frame");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsAacTransmuxer::encode_audio(char* data, int size, char* header, int* ppos)
+{
+    srs_error_t err = srs_success;
+    
+    *ppos = 0;
+    
     SrsBuffer* stream = new SrsBuffer(data, size);
     SrsAutoFree(SrsBuffer, stream);
     
@@ -148,9 +178,8 @@ srs_error_t SrsAacTransmuxer::write_audio(int64_t timestamp, char* data, int siz
     //      require(7bytes)=56bits
     // else
     //      require(9bytes)=72bits
-    char aac_fixed_header[7];
     if(true) {
-        char* pp = aac_fixed_header;
+        char* pp = header;
         int16_t aac_frame_length = aac_raw_length + 7;
         
         // Syncword 12 bslbf
@@ -187,15 +216,7 @@ srs_error_t SrsAacTransmuxer::write_audio(int64_t timestamp, char* data, int siz
         *pp++ = 0xfc;
     }
     
-    // write 7bytes fixed header.
-    if ((err = writer->write(aac_fixed_header, 7, NULL)) != srs_success) {
-        return srs_error_wrap(err, "write aac header");
-    }
-    
-    // write aac frame body.
-    if ((err = writer->write(data + stream->pos(), aac_raw_length, NULL)) != srs_success) {
-        return srs_error_wrap(err, "write aac frame");
-    }
+    *ppos = stream->pos();
     
     return err;
 }
@@ -57,6 +57,10 @@ public:
    // Write audio/video packet.
    // @remark The assert data should not be NULL.
     virtual srs_error_t write_audio(int64_t timestamp, char* data, int size);
+    // Parse the audio packet and encode the 7bytes ADTS header, without writing,
+    // for user to send the header and raw frame in data.
+    // @param ppos Output the position of raw frame in data, 0 for sequence header.
+    virtual srs_error_t encode_audio(char* data, int size, char* header, int* ppos);
 };
 
 #endif
@@ -25,6 +25,22 @@
 
 using namespace std;
 
+#include <srs_kernel_utility.hpp>
+
+// the number of virtual nodes of a server on ring.
+#define SRS_LB_VIRTUAL_NODES 64
+// the backoff of failed server, doubled for each continuous failure, to the max.
+#define SRS_LB_BACKOFF (1 * SRS_UTIME_SECONDS)
+#define SRS_LB_MAX_BACKOFF (30 * SRS_UTIME_SECONDS)
+
+ISrsLoadBalancer::ISrsLoadBalancer()
+{
+}
+
+ISrsLoadBalancer::~ISrsLoadBalancer()
+{
+}
+
 SrsLbRoundRobin::SrsLbRoundRobin()
 {
     index = -1;
@@ -55,3 +71,165 @@ string SrsLbRoundRobin::select(const vector<string>& servers)
     return elem;
 }
 
+
+string SrsLbRoundRobin::select(const vector<string>& servers, string /*key*/)
+{
+    return select(servers);
+}
+
+SrsLbServerHealth::SrsLbServerHealth()
+{
+    failures = 0;
+    last_failure = 0;
+    srtt = 0;
+    nn_success = 0;
+    nn_failure = 0;
+}
+
+SrsLbServerHealth::~SrsLbServerHealth()
+{
+}
+
+SrsLbHealth::SrsLbHealth()
+{
+}
+
+SrsLbHealth::~SrsLbHealth()
+{
+    map<string, SrsLbServerHealth*>::iterator it;
+    for (it = servers.begin(); it != servers.end(); ++it) {
+        SrsLbServerHealth* h = it->second;
+        srs_freep(h);
+    }
+    servers.clear();
+}
+
+void SrsLbHealth::on_success(string server, srs_utime_t latency)
+{
+    SrsLbServerHealth* h = servers[server];
+    if (!h) {
+        h = servers[server] = new SrsLbServerHealth();
+    }
+    
+    h->failures = 0;
+    h->nn_success++;
+    
+    // smooth the latency like TCP srtt, by 1/8 of the new sample.
+    if (h->srtt == 0) {
+        h->srtt = latency;
+    } else {
+        h->srtt = (h->srtt * 7 + latency) / 8;
+    }
+}
+
+void SrsLbHealth::on_failure(string server)
+{
+    SrsLbServerHealth* h = servers[server];
+    if (!h) {
+        h = servers[server] = new SrsLbServerHealth();
+    }
+    
+    h->failures++;
+    h->nn_failure++;
+    h->last_failure = srs_get_system_time();
+}
+
+bool SrsLbHealth::available(string server)
+{
+    map<string, SrsLbServerHealth*>::iterator it = servers.find(server);
+    if (it == servers.end()) {
+        return true;
+    }
+    
+    SrsLbServerHealth* h = it->second;
+    if (h->failures <= 0) {
+        return true;
+    }
+    
+    srs_utime_t backoff = SRS_LB_BACKOFF << srs_min(h->failures - 1, 5);
+    backoff = srs_min(backoff, SRS_LB_MAX_BACKOFF);
+    
+    return srs_get_system_time() - h->last_failure >= backoff;
+}
+
+SrsLbServerHealth* SrsLbHealth::at(string server)
+{
+    map<string, SrsLbServerHealth*>::iterator it = servers.find(server);
+    if (it == servers.end()) {
+        return NULL;
+    }
+    return it->second;
+}
+
+SrsLbConsistentHash::SrsLbConsistentHash(SrsLbHealth* h)
+{
+    health = h;
+    index = -1;
+}
+
+SrsLbConsistentHash::~SrsLbConsistentHash()
+{
+}
+
+uint32_t SrsLbConsistentHash::current()
+{
+    return index;
+}
+
+string SrsLbConsistentHash::selected()
+{
+    return elem;
+}
+
+string SrsLbConsistentHash::select(const vector<string>& servers, string key)
+{
+    srs_assert(!servers.empty());
+    
+    if (servers != this->servers) {
+        build(servers);
+    }
+    
+    // the first node at or after the hash of key, wrap to the begin of ring.
+    uint32_t hash = srs_crc32_ieee(key.data(), (int)key.length());
+    map<uint32_t, int>::iterator start = ring.lower_bound(hash);
+    if (start == ring.end()) {
+        start = ring.begin();
+    }
+    
+    // walk the ring for the first available server, or the owner of key if all unavailable.
+    index = start->second;
+    map<uint32_t, int>::iterator it = start;
+    for (int i = 0; health && i < (int)ring.size(); i++) {
+        if (health->available(servers.at(it->second))) {
+            index = it->second;
+            break;
+        }
+        
+        if (++it == ring.end()) {
+            it = ring.begin();
+        }
+    }
+    
+    elem = servers.at(index);
+    
+    return elem;
+}
+
+void SrsLbConsistentHash::build(const vector<string>& servers)
+{
+    this->servers = servers;
+    ring.clear();
+    
+    for (int i = 0; i < (int)servers.size(); i++) {
+        const string& server = servers.at(i);
+        for (int j = 0; j < SRS_LB_VIRTUAL_NODES; j++) {
+            string node = server + "#" + srs_int2str(j);
+            uint32_t hash = srs_crc32_ieee(node.data(), (int)node.length());
+            
+            // the first server owns the node when hash collision.
+            if (ring.find(hash) == ring.end()) {
+                ring[hash] = i;
+            }
+        }
+    }
+}
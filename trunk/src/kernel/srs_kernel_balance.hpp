@@ -28,12 +28,30 @@
 
 #include <vector>
 #include <string>
+#include <map>
+
+/**
+ * the load balance algorithm to select a server,
+ * used for edge pull and other multiple server feature.
+ */
+class ISrsLoadBalancer
+{
+public:
+    ISrsLoadBalancer();
+    virtual ~ISrsLoadBalancer();
+public:
+    virtual std::string selected() = 0;
+    /**
+     * select a server for the key, for example, the url of stream.
+     */
+    virtual std::string select(const std::vector<std::string>& servers, std::string key) = 0;
+};
 
 /**
  * the round-robin load balance algorithm,
  * used for edge pull and other multiple server feature.
  */
-class SrsLbRoundRobin
+class SrsLbRoundRobin : public ISrsLoadBalancer
 {
 private:
     // current selected index.
@@ -49,6 +67,79 @@ public:
     virtual uint32_t current();
     virtual std::string selected();
     virtual std::string select(const std::vector<std::string>& servers);
+    virtual std::string select(const std::vector<std::string>& servers, std::string key);
+};
+
+/**
+ * the health of server, updated by the result of connecting to it.
+ */
+class SrsLbServerHealth
+{
+public:
+    // the continuous failures, reset when success.
+    int failures;
+    // when the last failure occurs.
+    srs_utime_t last_failure;
+    // the smoothed latency to connect to server.
+    srs_utime_t srtt;
+    // the total success and failure count.
+    int64_t nn_success;
+    int64_t nn_failure;
+public:
+    SrsLbServerHealth();
+    virtual ~SrsLbServerHealth();
+};
+
+/**
+ * the health of servers, shared by all load balancers.
+ */
+class SrsLbHealth
+{
+private:
+    std::map<std::string, SrsLbServerHealth*> servers;
+public:
+    SrsLbHealth();
+    virtual ~SrsLbHealth();
+public:
+    virtual void on_success(std::string server, srs_utime_t latency);
+    virtual void on_failure(std::string server);
+    /**
+     * whether server is available, the failed server is unavailable for a backoff duration,
+     * which is doubled for each continuous failure.
+     */
+    virtual bool available(std::string server);
+    // get the health of server, NULL if never connected.
+    virtual SrsLbServerHealth* at(std::string server);
+};
+
+/**
+ * the consistent-hash load balance algorithm, to select the same server for a key,
+ * for example, the edge always pull a stream from the same origin.
+ * the server is skipped when unavailable, and the next server on ring is selected.
+ */
+class SrsLbConsistentHash : public ISrsLoadBalancer
+{
+private:
+    // the health of servers, not owned.
+    SrsLbHealth* health;
+    // the servers of ring, rebuild when servers changed.
+    std::vector<std::string> servers;
+    // the ring of virtual nodes, map the hash to the index of server.
+    std::map<uint32_t, int> ring;
+    // current selected index.
+    int index;
+    // current selected server.
+    std::string elem;
+public:
+    // @param h the health of servers, NULL to ignore the health.
+    SrsLbConsistentHash(SrsLbHealth* h);
+    virtual ~SrsLbConsistentHash();
+public:
+    virtual uint32_t current();
+    virtual std::string selected();
+    virtual std::string select(const std::vector<std::string>& servers, std::string key);
+private:
+    virtual void build(const std::vector<std::string>& servers);
 };
 
 #endif
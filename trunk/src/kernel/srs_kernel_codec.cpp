@@ -412,6 +412,7 @@ SrsVideoCodecConfig::SrsVideoCodecConfig()
     
     NAL_unit_length = 0;
     avc_profile = SrsAvcProfileReserved;
+    avc_profile_compatibility = 0;
     avc_level = SrsAvcLevelReserved;
     
     payload_format = SrsAvcPayloadFormatGuess;
@@ -514,6 +515,33 @@ srs_error_t SrsVideoFrame::add_sample(char* bytes, int size)
     return err;
 }
 
+bool SrsVideoFrame::disposable()
+{
+    bool has_slice = false;
+    
+    for (int i = 0; i < nb_samples; i++) {
+        SrsSample* sample = &samples[i];
+        if (sample->size <= 0) {
+            continue;
+        }
+        
+        SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(sample->bytes[0] & 0x1f);
+        if (nal_unit_type != SrsAvcNaluTypeNonIDR && nal_unit_type != SrsAvcNaluTypeDataPartitionA
+            && nal_unit_type != SrsAvcNaluTypeIDR) {
+            continue;
+        }
+        
+        // The nal_ref_idc is not 0, the slice is referenced.
+        // @see: 7.4.1 NAL unit semantics, ISO_IEC_14496-10-AVC-2003.pdf, page 44.
+        if ((sample->bytes[0] >> 5) & 0x03) {
+            return false;
+        }
+        has_slice = true;
+    }
+    
+    return has_slice;
+}
+
 SrsVideoCodecConfig* SrsVideoFrame::vcodec()
 {
     return (SrsVideoCodecConfig*)codec;
@@ -735,7 +763,7 @@ srs_error_t SrsFormat::avc_demux_sps_pps(SrsBuffer* stream)
     //int8_t AVCProfileIndication = stream->read_1bytes();
     vcodec->avc_profile = (SrsAvcProfile)stream->read_1bytes();
     //int8_t profile_compatibility = stream->read_1bytes();
-    stream->read_1bytes();
+    vcodec->avc_profile_compatibility = (uint8_t)stream->read_1bytes();
     //int8_t AVCLevelIndication = stream->read_1bytes();
     vcodec->avc_level = (SrsAvcLevel)stream->read_1bytes();
     
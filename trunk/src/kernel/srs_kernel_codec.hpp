@@ -604,6 +604,8 @@ public:
      */
     // profile_idc, ISO_IEC_14496-10-AVC-2003.pdf, page 45.
     SrsAvcProfile avc_profile;
+    // The constraint_set flags, ISO_IEC_14496-15-AVC-format-2012.pdf, page 16
+    uint8_t avc_profile_compatibility;
     // level_idc, ISO_IEC_14496-10-AVC-2003.pdf, page 45.
     SrsAvcLevel avc_level;
     // lengthSizeMinusOne, ISO_IEC_14496-15-AVC-format-2012.pdf, page 16
@@ -684,6 +686,9 @@ public:
 public:
     // Add the sample without ANNEXB or IBMF header, or RAW AAC or MP3 data.
     virtual srs_error_t add_sample(char* bytes, int size);
+    // Whether the frame is disposable, that all slices are not referenced by other frames,
+    // for example, the B frame of most encoders, so it can be dropped without corrupting the decoding.
+    virtual bool disposable();
 public:
     virtual SrsVideoCodecConfig* vcodec();
 };
@@ -118,6 +118,9 @@
 #define ERROR_SOCKET_SETREUSEADDR           1079
 #define ERROR_SOCKET_SETCLOSEEXEC           1080
 #define ERROR_SOCKET_ACCEPT                 1081
+#define ERROR_WORKER_FORK                   1082
+#define ERROR_WORKER_MASTER                 1083
+#define ERROR_SYSTEM_IO_THREAD              1084
 
 ///////////////////////////////////////////////////////
 // RTMP protocol error.
@@ -287,6 +290,7 @@
 #define ERROR_INOTIFY_CREATE                3092
 #define ERROR_INOTIFY_OPENFD                3093
 #define ERROR_INOTIFY_WATCH                 3094
+#define ERROR_HTTP_HOOKS_OVERFLOW           3095
 
 ///////////////////////////////////////////////////////
 // HTTP/StreamCaster protocol error.
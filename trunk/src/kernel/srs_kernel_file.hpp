@@ -42,7 +42,7 @@ class SrsFileReader;
  */
 class SrsFileWriter : public ISrsWriteSeeker
 {
-private:
+protected:
     std::string path;
     int fd;
 public:
@@ -40,6 +40,7 @@ using namespace std;
 #include <srs_kernel_utility.hpp>
 #include <srs_core_mem_watch.hpp>
 #include <srs_core_autofree.hpp>
+#include <srs_kernel_pool.hpp>
 
 SrsMessageHeader::SrsMessageHeader()
 {
@@ -157,6 +158,8 @@ SrsCommonMessage::SrsCommonMessage()
 {
     payload = NULL;
     size = 0;
+    capacity = 0;
+    block = NULL;
 }
 
 SrsCommonMessage::~SrsCommonMessage()
@@ -164,14 +167,33 @@ SrsCommonMessage::~SrsCommonMessage()
 #ifdef SRS_AUTO_MEM_WATCH
     srs_memory_unwatch(payload);
 #endif
-    srs_freepa(payload);
+    free_payload();
 }
 
+#ifdef SRS_PERF_MESSAGE_POOL
+void* SrsCommonMessage::operator new(size_t size)
+{
+    int capacity = 0;
+    return srs_message_pool()->alloc((int)size, &capacity);
+}
+
+void SrsCommonMessage::operator delete(void* p, size_t size)
+{
+    SrsSlabPool* pool = srs_message_pool();
+    pool->free((char*)p, pool->capacity((int)size));
+}
+#endif
+
 void SrsCommonMessage::create_payload(int size)
 {
-    srs_freepa(payload);
+    free_payload();
     
+#ifdef SRS_PERF_MESSAGE_POOL
+    payload = srs_message_pool()->alloc(size, &capacity);
+#else
     payload = new char[size];
+    capacity = 0;
+#endif
     srs_verbose("create payload for RTMP message. size=%d", size);
     
 #ifdef SRS_AUTO_MEM_WATCH
@@ -179,10 +201,31 @@ void SrsCommonMessage::create_payload(int size)
 #endif
 }
 
+void SrsCommonMessage::create_payload(SrsSharedBlock* block, char* data)
+{
+    free_payload();
+    
+    this->block = block->acquire();
+    payload = data;
+}
+
+void SrsCommonMessage::free_payload()
+{
+    if (block) {
+        block->release();
+        block = NULL;
+    } else {
+        srs_message_pool()->free(payload, capacity);
+    }
+    
+    payload = NULL;
+    capacity = 0;
+}
+
 srs_error_t SrsCommonMessage::create(SrsMessageHeader* pheader, char* body, int size)
 {
     // drop previous payload.
-    srs_freepa(payload);
+    free_payload();
     
     this->header = *pheader;
     this->payload = body;
@@ -203,7 +246,14 @@ SrsSharedPtrMessage::SrsSharedPtrPayload::SrsSharedPtrPayload()
 {
     payload = NULL;
     size = 0;
+    capacity = 0;
+    block = NULL;
     shared_count = 0;
+    disposable = false;
+    
+    chunks = NULL;
+    nb_chunks = 0;
+    chunk_size = 0;
 }
 
 SrsSharedPtrMessage::SrsSharedPtrPayload::~SrsSharedPtrPayload()
@@ -211,9 +261,28 @@ SrsSharedPtrMessage::SrsSharedPtrPayload::~SrsSharedPtrPayload()
 #ifdef SRS_AUTO_MEM_WATCH
     srs_memory_unwatch(payload);
 #endif
-    srs_freepa(payload);
+    if (block) {
+        block->release();
+    } else {
+        srs_message_pool()->free(payload, capacity);
+    }
+    srs_freepa(chunks);
 }
 
+#ifdef SRS_PERF_MESSAGE_POOL
+void* SrsSharedPtrMessage::SrsSharedPtrPayload::operator new(size_t size)
+{
+    int capacity = 0;
+    return srs_message_pool()->alloc((int)size, &capacity);
+}
+
+void SrsSharedPtrMessage::SrsSharedPtrPayload::operator delete(void* p, size_t size)
+{
+    SrsSlabPool* pool = srs_message_pool();
+    pool->free((char*)p, pool->capacity((int)size));
+}
+#endif
+
 SrsSharedPtrMessage::SrsSharedPtrMessage() : timestamp(0), stream_id(0), size(0), payload(NULL)
 {
     ptr = NULL;
@@ -230,6 +299,20 @@ SrsSharedPtrMessage::~SrsSharedPtrMessage()
     }
 }
 
+#ifdef SRS_PERF_MESSAGE_POOL
+void* SrsSharedPtrMessage::operator new(size_t size)
+{
+    int capacity = 0;
+    return srs_message_pool()->alloc((int)size, &capacity);
+}
+
+void SrsSharedPtrMessage::operator delete(void* p, size_t size)
+{
+    SrsSlabPool* pool = srs_message_pool();
+    pool->free((char*)p, pool->capacity((int)size));
+}
+#endif
+
 srs_error_t SrsSharedPtrMessage::create(SrsCommonMessage* msg)
 {
     srs_error_t err = srs_success;
@@ -241,8 +324,12 @@ srs_error_t SrsSharedPtrMessage::create(SrsCommonMessage* msg)
     // to prevent double free of payload:
     // initialize already attach the payload of msg,
     // detach the payload to transfer the owner to shared ptr.
+    ptr->capacity = msg->capacity;
+    ptr->block = msg->block;
     msg->payload = NULL;
     msg->size = 0;
+    msg->capacity = 0;
+    msg->block = NULL;
     
     return err;
 }
@@ -321,6 +408,16 @@ bool SrsSharedPtrMessage::is_video()
     return ptr->header.message_type == RTMP_MSG_VideoMessage;
 }
 
+bool SrsSharedPtrMessage::is_disposable()
+{
+    return ptr->disposable;
+}
+
+void SrsSharedPtrMessage::set_disposable(bool v)
+{
+    ptr->disposable = v;
+}
+
 int SrsSharedPtrMessage::chunk_header(char* cache, int nb_cache, bool c0)
 {
     if (c0) {
@@ -332,6 +429,50 @@ int SrsSharedPtrMessage::chunk_header(char* cache, int nb_cache, bool c0)
     }
 }
 
+void SrsSharedPtrMessage::chunks(int chunk_size, iovec** piovs, int* pnb_iovs)
+{
+    *piovs = NULL;
+    *pnb_iovs = 0;
+    
+    if (!ptr || !payload || size <= 0 || chunk_size <= 0) {
+        return;
+    }
+    
+    // Build the shared chunks by the first sender, without the c0 and extended timestamp,
+    // which depends on the timestamp of sender, for example, corrected by jitter.
+    if (!ptr->chunks) {
+        ptr->chunk_size = chunk_size;
+        
+        int nb_c3 = srs_chunk_header_c3(ptr->header.perfer_cid, 0, ptr->c3, SRS_CONSTS_RTMP_MAX_FMT3_HEADER_SIZE);
+        srs_assert(nb_c3 > 0);
+        
+        int nb_packets = (size + chunk_size - 1) / chunk_size;
+        ptr->nb_chunks = 2 * nb_packets;
+        ptr->chunks = new iovec[ptr->nb_chunks];
+        
+        char* p = payload;
+        for (int i = 0; i < nb_packets; i++) {
+            iovec* iovs = ptr->chunks + 2 * i;
+            
+            iovs[0].iov_base = (i == 0)? NULL : ptr->c3;
+            iovs[0].iov_len = (i == 0)? 0 : nb_c3;
+            
+            int payload_size = srs_min(chunk_size, (int)(payload + size - p));
+            iovs[1].iov_base = p;
+            iovs[1].iov_len = payload_size;
+            p += payload_size;
+        }
+    }
+    
+    // The chunks is built for other chunk size, user should build the chunks itself.
+    if (ptr->chunk_size != chunk_size) {
+        return;
+    }
+    
+    *piovs = ptr->chunks;
+    *pnb_iovs = ptr->nb_chunks;
+}
+
 SrsSharedPtrMessage* SrsSharedPtrMessage::copy()
 {
     srs_assert(ptr);
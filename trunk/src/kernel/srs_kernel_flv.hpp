@@ -28,6 +28,8 @@
 
 #include <string>
 
+#include <srs_kernel_consts.hpp>
+
 // For srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <sys/uio.h>
@@ -36,6 +38,7 @@
 class SrsBuffer;
 class ISrsWriter;
 class ISrsReader;
+class SrsSharedBlock;
 class SrsFileReader;
 class SrsPacket;
 
@@ -202,6 +205,7 @@ public:
 // while the shared ptr message used to copy and send.
 class SrsCommonMessage
 {
+    friend class SrsSharedPtrMessage;
 // 4.1. Message Header
 public:
     SrsMessageHeader header;
@@ -216,12 +220,27 @@ public:
     // @remark, not all message payload can be decoded to packet. for example,
     //       video/audio packet use raw bytes, no video/audio packet.
     char* payload;
+private:
+    // The capacity of payload alloced by pool, 0 if not pooled.
+    int capacity;
+    // The block which the payload is a slice of, NULL if payload is owned by message.
+    SrsSharedBlock* block;
 public:
     SrsCommonMessage();
     virtual ~SrsCommonMessage();
+#ifdef SRS_PERF_MESSAGE_POOL
+public:
+    static void* operator new(size_t size);
+    static void operator delete(void* p, size_t size);
+#endif
 public:
     // Alloc the payload to specified size of bytes.
     virtual void create_payload(int size);
+    // Reference the payload in block without copy, for example, the receive buffer.
+    // @remark The size is not changed, user should update it after read the bytes.
+    virtual void create_payload(SrsSharedBlock* block, char* data);
+private:
+    virtual void free_payload();
 public:
     // Create common message,
     // from the header and body.
@@ -296,16 +315,44 @@ private:
         char* payload;
         // The size of payload.
         int size;
+        // The capacity of payload alloced by pool, 0 if not pooled.
+        int capacity;
+        // The block which the payload is a slice of, NULL if payload is owned.
+        SrsSharedBlock* block;
         // The reference count
         int shared_count;
+        // Whether the video frame is disposable, which is not referenced by other frames.
+        bool disposable;
+    public:
+        // The encoded chunks, pairs of header and payload iovecs, which are built once by
+        // the first sender then shared by all senders in the same chunk size, that is, the
+        // players of a stream generally. The c0 depends on the timestamp and stream id of
+        // each player, so it's empty in the shared chunks.
+        // @remark Never change after built, for the iovecs maybe in sending by other coroutines.
+        iovec* chunks;
+        int nb_chunks;
+        // The key of the encoded chunks.
+        int chunk_size;
+        // The c3 header of chunks, without the extended timestamp.
+        char c3[SRS_CONSTS_RTMP_MAX_FMT3_HEADER_SIZE];
     public:
         SrsSharedPtrPayload();
         virtual ~SrsSharedPtrPayload();
+#ifdef SRS_PERF_MESSAGE_POOL
+    public:
+        static void* operator new(size_t size);
+        static void operator delete(void* p, size_t size);
+#endif
     };
     SrsSharedPtrPayload* ptr;
 public:
     SrsSharedPtrMessage();
     virtual ~SrsSharedPtrMessage();
+#ifdef SRS_PERF_MESSAGE_POOL
+public:
+    static void* operator new(size_t size);
+    static void operator delete(void* p, size_t size);
+#endif
 public:
     // Create shared ptr message,
     // copy header, manage the payload of msg,
@@ -331,10 +378,22 @@ public:
     virtual bool is_av();
     virtual bool is_audio();
     virtual bool is_video();
+    // Whether the video frame is disposable, so it can be dropped for slow consumer,
+    // which is marked by the source when parsed the NALUs, and shared by all copies.
+    virtual bool is_disposable();
+    virtual void set_disposable(bool v);
 public:
     // generate the chunk header to cache.
     // @return the size of header.
     virtual int chunk_header(char* cache, int nb_cache, bool c0);
+    // Get the encoded chunks, pairs of header and payload iovecs, which are shared by all copies.
+    // @param chunk_size The output chunk size of peer.
+    // @param piovs Output the iovecs, NULL if the shared chunks is built for other chunk size,
+    //       user should build the chunks by chunk_header() then.
+    // @param pnb_iovs Output the number of iovecs.
+    // @remark User should never free or change the iovecs, but copy them then write the c0 by
+    //       chunk_header(), and the c3 by chunk_header() if extended timestamp.
+    virtual void chunks(int chunk_size, iovec** piovs, int* pnb_iovs);
 public:
     // copy current shared ptr message, use ref-count.
     // @remark, assert object is created.
@@ -394,11 +453,14 @@ private:
 public:
     // Write the tags in a time.
     virtual srs_error_t write_tags(SrsSharedPtrMessage** msgs, int count);
-private:
+public:
+    // Encode the 11bytes tag header and 4bytes previous tag size to cache,
+    // for user to send the tag body without copy.
     virtual void cache_metadata(char type, char* data, int size, char* cache);
     virtual void cache_audio(int64_t timestamp, char* data, int size, char* cache);
     virtual void cache_video(int64_t timestamp, char* data, int size, char* cache);
     virtual void cache_pts(int size, char* cache);
+private:
     virtual srs_error_t write_tag(char* header, int header_size, char* tag, int tag_size);
 };
 
@@ -779,6 +779,11 @@ void SrsMp4MovieFragmentBox::set_traf(SrsMp4TrackFragmentBox* v)
     boxes.push_back(v);
 }
 
+void SrsMp4MovieFragmentBox::add_traf(SrsMp4TrackFragmentBox* v)
+{
+    boxes.push_back(v);
+}
+
 SrsMp4MovieFragmentHeaderBox::SrsMp4MovieFragmentHeaderBox()
 {
     type = SrsMp4BoxTypeMFHD;
@@ -1667,6 +1672,11 @@ void SrsMp4MovieExtendsBox::set_trex(SrsMp4TrackExtendsBox* v)
     boxes.push_back(v);
 }
 
+void SrsMp4MovieExtendsBox::add_trex(SrsMp4TrackExtendsBox* v)
+{
+    boxes.push_back(v);
+}
+
 SrsMp4TrackExtendsBox::SrsMp4TrackExtendsBox()
 {
     type = SrsMp4BoxTypeTREX;
@@ -5760,161 +5770,9 @@ srs_error_t SrsMp4Encoder::flush()
     
     // Write moov.
     if (true) {
-        SrsMp4MovieBox* moov = new SrsMp4MovieBox();
+        SrsMp4MovieBox* moov = create_moov();
         SrsAutoFree(SrsMp4MovieBox, moov);
         
-        SrsMp4MovieHeaderBox* mvhd = new SrsMp4MovieHeaderBox();
-        moov->set_mvhd(mvhd);
-        
-        mvhd->timescale = 1000; // Use tbn ms.
-        mvhd->duration_in_tbn = srs_max(vduration, aduration);
-        mvhd->next_track_ID = 1; // Starts from 1, increase when use it.
-        
-        if (nb_videos || !pavcc.empty()) {
-            SrsMp4TrackBox* trak = new SrsMp4TrackBox();
-            moov->add_trak(trak);
-            
-            SrsMp4TrackHeaderBox* tkhd = new SrsMp4TrackHeaderBox();
-            trak->set_tkhd(tkhd);
-            
-            tkhd->track_ID = mvhd->next_track_ID++;
-            tkhd->duration = vduration;
-            tkhd->width = (width << 16);
-            tkhd->height = (height << 16);
-            
-            SrsMp4MediaBox* mdia = new SrsMp4MediaBox();
-            trak->set_mdia(mdia);
-            
-            SrsMp4MediaHeaderBox* mdhd = new SrsMp4MediaHeaderBox();
-            mdia->set_mdhd(mdhd);
-            
-            mdhd->timescale = 1000;
-            mdhd->duration = vduration;
-            mdhd->set_language0('u');
-            mdhd->set_language1('n');
-            mdhd->set_language2('d');
-            
-            SrsMp4HandlerReferenceBox* hdlr = new SrsMp4HandlerReferenceBox();
-            mdia->set_hdlr(hdlr);
-            
-            hdlr->handler_type = SrsMp4HandlerTypeVIDE;
-            hdlr->name = "VideoHandler";
-            
-            SrsMp4MediaInformationBox* minf = new SrsMp4MediaInformationBox();
-            mdia->set_minf(minf);
-            
-            SrsMp4VideoMeidaHeaderBox* vmhd = new SrsMp4VideoMeidaHeaderBox();
-            minf->set_vmhd(vmhd);
-            
-            SrsMp4DataInformationBox* dinf = new SrsMp4DataInformationBox();
-            minf->set_dinf(dinf);
-            
-            SrsMp4DataReferenceBox* dref = new SrsMp4DataReferenceBox();
-            dinf->set_dref(dref);
-            
-            SrsMp4DataEntryBox* url = new SrsMp4DataEntryUrlBox();
-            dref->append(url);
-            
-            SrsMp4SampleTableBox* stbl = new SrsMp4SampleTableBox();
-            minf->set_stbl(stbl);
-            
-            SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
-            stbl->set_stsd(stsd);
-            
-            SrsMp4VisualSampleEntry* avc1 = new SrsMp4VisualSampleEntry();
-            stsd->append(avc1);
-            
-            avc1->width = width;
-            avc1->height = height;
-            avc1->data_reference_index = 1;
-            
-            SrsMp4AvccBox* avcC = new SrsMp4AvccBox();
-            avc1->set_avcC(avcC);
-            
-            avcC->avc_config = pavcc;
-        }
-        
-        if (nb_audios || !pasc.empty()) {
-            SrsMp4TrackBox* trak = new SrsMp4TrackBox();
-            moov->add_trak(trak);
-            
-            SrsMp4TrackHeaderBox* tkhd = new SrsMp4TrackHeaderBox();
-            tkhd->volume = 0x0100;
-            trak->set_tkhd(tkhd);
-            
-            tkhd->track_ID = mvhd->next_track_ID++;
-            tkhd->duration = aduration;
-            
-            SrsMp4MediaBox* mdia = new SrsMp4MediaBox();
-            trak->set_mdia(mdia);
-            
-            SrsMp4MediaHeaderBox* mdhd = new SrsMp4MediaHeaderBox();
-            mdia->set_mdhd(mdhd);
-            
-            mdhd->timescale = 1000;
-            mdhd->duration = aduration;
-            mdhd->set_language0('u');
-            mdhd->set_language1('n');
-            mdhd->set_language2('d');
-            
-            SrsMp4HandlerReferenceBox* hdlr = new SrsMp4HandlerReferenceBox();
-            mdia->set_hdlr(hdlr);
-            
-            hdlr->handler_type = SrsMp4HandlerTypeSOUN;
-            hdlr->name = "SoundHandler";
-            
-            SrsMp4MediaInformationBox* minf = new SrsMp4MediaInformationBox();
-            mdia->set_minf(minf);
-            
-            SrsMp4SoundMeidaHeaderBox* smhd = new SrsMp4SoundMeidaHeaderBox();
-            minf->set_smhd(smhd);
-            
-            SrsMp4DataInformationBox* dinf = new SrsMp4DataInformationBox();
-            minf->set_dinf(dinf);
-            
-            SrsMp4DataReferenceBox* dref = new SrsMp4DataReferenceBox();
-            dinf->set_dref(dref);
-            
-            SrsMp4DataEntryBox* url = new SrsMp4DataEntryUrlBox();
-            dref->append(url);
-            
-            SrsMp4SampleTableBox* stbl = new SrsMp4SampleTableBox();
-            minf->set_stbl(stbl);
-            
-            SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
-            stbl->set_stsd(stsd);
-            
-            SrsMp4AudioSampleEntry* mp4a = new SrsMp4AudioSampleEntry();
-            mp4a->data_reference_index = 1;
-            mp4a->samplerate = uint32_t(srs_flv_srates[sample_rate]) << 16;
-            if (sound_bits == SrsAudioSampleBits16bit) {
-                mp4a->samplesize = 16;
-            } else {
-                mp4a->samplesize = 8;
-            }
-            if (channels == SrsAudioChannelsStereo) {
-                mp4a->channelcount = 2;
-            } else {
-                mp4a->channelcount = 1;
-            }
-            stsd->append(mp4a);
-            
-            SrsMp4EsdsBox* esds = new SrsMp4EsdsBox();
-            mp4a->set_esds(esds);
-            
-            SrsMp4ES_Descriptor* es = esds->es;
-            es->ES_ID = 0x02;
-            
-            SrsMp4DecoderConfigDescriptor& desc = es->decConfigDescr;
-            desc.objectTypeIndication = SrsMp4ObjectTypeAac;
-            desc.streamType = SrsMp4StreamTypeAudioStream;
-            srs_freep(desc.decSpecificInfo);
-            
-            SrsMp4DecoderSpecificInfo* asc = new SrsMp4DecoderSpecificInfo();
-            desc.decSpecificInfo = asc;
-            asc->asc = pasc;;
-        }
-        
         if ((err = samples->write(moov)) != srs_success) {
             return srs_error_wrap(err, "write samples");
         }
@@ -5971,6 +5829,165 @@ srs_error_t SrsMp4Encoder::flush()
     return err;
 }
 
+SrsMp4MovieBox* SrsMp4Encoder::create_moov()
+{
+    SrsMp4MovieBox* moov = new SrsMp4MovieBox();
+    
+    SrsMp4MovieHeaderBox* mvhd = new SrsMp4MovieHeaderBox();
+    moov->set_mvhd(mvhd);
+    
+    mvhd->timescale = 1000; // Use tbn ms.
+    mvhd->duration_in_tbn = srs_max(vduration, aduration);
+    mvhd->next_track_ID = 1; // Starts from 1, increase when use it.
+    
+    if (nb_videos || !pavcc.empty()) {
+        SrsMp4TrackBox* trak = new SrsMp4TrackBox();
+        moov->add_trak(trak);
+        
+        SrsMp4TrackHeaderBox* tkhd = new SrsMp4TrackHeaderBox();
+        trak->set_tkhd(tkhd);
+        
+        tkhd->track_ID = mvhd->next_track_ID++;
+        tkhd->duration = vduration;
+        tkhd->width = (width << 16);
+        tkhd->height = (height << 16);
+        
+        SrsMp4MediaBox* mdia = new SrsMp4MediaBox();
+        trak->set_mdia(mdia);
+        
+        SrsMp4MediaHeaderBox* mdhd = new SrsMp4MediaHeaderBox();
+        mdia->set_mdhd(mdhd);
+        
+        mdhd->timescale = 1000;
+        mdhd->duration = vduration;
+        mdhd->set_language0('u');
+        mdhd->set_language1('n');
+        mdhd->set_language2('d');
+        
+        SrsMp4HandlerReferenceBox* hdlr = new SrsMp4HandlerReferenceBox();
+        mdia->set_hdlr(hdlr);
+        
+        hdlr->handler_type = SrsMp4HandlerTypeVIDE;
+        hdlr->name = "VideoHandler";
+        
+        SrsMp4MediaInformationBox* minf = new SrsMp4MediaInformationBox();
+        mdia->set_minf(minf);
+        
+        SrsMp4VideoMeidaHeaderBox* vmhd = new SrsMp4VideoMeidaHeaderBox();
+        minf->set_vmhd(vmhd);
+        
+        SrsMp4DataInformationBox* dinf = new SrsMp4DataInformationBox();
+        minf->set_dinf(dinf);
+        
+        SrsMp4DataReferenceBox* dref = new SrsMp4DataReferenceBox();
+        dinf->set_dref(dref);
+        
+        SrsMp4DataEntryBox* url = new SrsMp4DataEntryUrlBox();
+        dref->append(url);
+        
+        SrsMp4SampleTableBox* stbl = new SrsMp4SampleTableBox();
+        minf->set_stbl(stbl);
+        
+        SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
+        stbl->set_stsd(stsd);
+        
+        SrsMp4VisualSampleEntry* avc1 = new SrsMp4VisualSampleEntry();
+        stsd->append(avc1);
+        
+        avc1->width = width;
+        avc1->height = height;
+        avc1->data_reference_index = 1;
+        
+        SrsMp4AvccBox* avcC = new SrsMp4AvccBox();
+        avc1->set_avcC(avcC);
+        
+        avcC->avc_config = pavcc;
+    }
+    
+    if (nb_audios || !pasc.empty()) {
+        SrsMp4TrackBox* trak = new SrsMp4TrackBox();
+        moov->add_trak(trak);
+        
+        SrsMp4TrackHeaderBox* tkhd = new SrsMp4TrackHeaderBox();
+        tkhd->volume = 0x0100;
+        trak->set_tkhd(tkhd);
+        
+        tkhd->track_ID = mvhd->next_track_ID++;
+        tkhd->duration = aduration;
+        
+        SrsMp4MediaBox* mdia = new SrsMp4MediaBox();
+        trak->set_mdia(mdia);
+        
+        SrsMp4MediaHeaderBox* mdhd = new SrsMp4MediaHeaderBox();
+        mdia->set_mdhd(mdhd);
+        
+        mdhd->timescale = 1000;
+        mdhd->duration = aduration;
+        mdhd->set_language0('u');
+        mdhd->set_language1('n');
+        mdhd->set_language2('d');
+        
+        SrsMp4HandlerReferenceBox* hdlr = new SrsMp4HandlerReferenceBox();
+        mdia->set_hdlr(hdlr);
+        
+        hdlr->handler_type = SrsMp4HandlerTypeSOUN;
+        hdlr->name = "SoundHandler";
+        
+        SrsMp4MediaInformationBox* minf = new SrsMp4MediaInformationBox();
+        mdia->set_minf(minf);
+        
+        SrsMp4SoundMeidaHeaderBox* smhd = new SrsMp4SoundMeidaHeaderBox();
+        minf->set_smhd(smhd);
+        
+        SrsMp4DataInformationBox* dinf = new SrsMp4DataInformationBox();
+        minf->set_dinf(dinf);
+        
+        SrsMp4DataReferenceBox* dref = new SrsMp4DataReferenceBox();
+        dinf->set_dref(dref);
+        
+        SrsMp4DataEntryBox* url = new SrsMp4DataEntryUrlBox();
+        dref->append(url);
+        
+        SrsMp4SampleTableBox* stbl = new SrsMp4SampleTableBox();
+        minf->set_stbl(stbl);
+        
+        SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
+        stbl->set_stsd(stsd);
+        
+        SrsMp4AudioSampleEntry* mp4a = new SrsMp4AudioSampleEntry();
+        mp4a->data_reference_index = 1;
+        mp4a->samplerate = uint32_t(srs_flv_srates[sample_rate]) << 16;
+        if (sound_bits == SrsAudioSampleBits16bit) {
+            mp4a->samplesize = 16;
+        } else {
+            mp4a->samplesize = 8;
+        }
+        if (channels == SrsAudioChannelsStereo) {
+            mp4a->channelcount = 2;
+        } else {
+            mp4a->channelcount = 1;
+        }
+        stsd->append(mp4a);
+        
+        SrsMp4EsdsBox* esds = new SrsMp4EsdsBox();
+        mp4a->set_esds(esds);
+        
+        SrsMp4ES_Descriptor* es = esds->es;
+        es->ES_ID = 0x02;
+        
+        SrsMp4DecoderConfigDescriptor& desc = es->decConfigDescr;
+        desc.objectTypeIndication = SrsMp4ObjectTypeAac;
+        desc.streamType = SrsMp4StreamTypeAudioStream;
+        srs_freep(desc.decSpecificInfo);
+        
+        SrsMp4DecoderSpecificInfo* asc = new SrsMp4DecoderSpecificInfo();
+        desc.decSpecificInfo = asc;
+        asc->asc = pasc;;
+    }
+    
+    return moov;
+}
+
 srs_error_t SrsMp4Encoder::copy_sequence_header(SrsFormat* format, bool vsh, uint8_t* sample, uint32_t nb_sample)
 {
     srs_error_t err = srs_success;
@@ -6029,6 +6046,574 @@ srs_error_t SrsMp4Encoder::do_write_sample(SrsMp4Sample* ps, uint8_t* sample, ui
     return err;
 }
 
+SrsMp4FragmentTrack::SrsMp4FragmentTrack(uint32_t tid, bool index)
+{
+    track_id = tid;
+    nb_bytes = 0;
+    indexing = index;
+    nb_samples = 0;
+    last_dts = 0;
+    last_delta = 0;
+}
+
+SrsMp4FragmentTrack::~SrsMp4FragmentTrack()
+{
+    clear();
+}
+
+void SrsMp4FragmentTrack::append(SrsMp4Sample* ps)
+{
+    // The delta of previous sample is known when got this sample.
+    if (nb_samples) {
+        last_delta = (uint32_t)(ps->dts > last_dts ? ps->dts - last_dts : 0);
+        
+        if (indexing && !stts.empty() && stts.back().sample_delta == last_delta) {
+            stts.back().sample_count++;
+        } else if (indexing) {
+            SrsMp4SttsEntry entry;
+            entry.sample_count = 1;
+            entry.sample_delta = last_delta;
+            stts.push_back(entry);
+        }
+    }
+    
+    if (indexing) {
+        int64_t offset = (int64_t)(ps->pts - ps->dts);
+        if (!ctts.empty() && ctts.back().sample_offset == offset) {
+            ctts.back().sample_count++;
+        } else {
+            SrsMp4CttsEntry entry;
+            entry.sample_count = 1;
+            entry.sample_offset = offset;
+            ctts.push_back(entry);
+        }
+        
+        if (ps->frame_type == SrsVideoAvcFrameTypeKeyFrame) {
+            stss.push_back(nb_samples + 1);
+        }
+        stsz.push_back(ps->nb_data);
+    }
+    
+    last_dts = ps->dts;
+    nb_samples++;
+    
+    samples.push_back(ps);
+    nb_bytes += ps->nb_data;
+}
+
+SrsMp4TrackFragmentBox* SrsMp4FragmentTrack::create_traf(uint64_t basetime)
+{
+    SrsMp4TrackFragmentBox* traf = new SrsMp4TrackFragmentBox();
+    
+    SrsMp4TrackFragmentHeaderBox* tfhd = new SrsMp4TrackFragmentHeaderBox();
+    traf->set_tfhd(tfhd);
+    
+    tfhd->track_id = track_id;
+    tfhd->flags = SrsMp4TfhdFlagsDefaultBaseIsMoof;
+    
+    SrsMp4TrackFragmentDecodeTimeBox* tfdt = new SrsMp4TrackFragmentDecodeTimeBox();
+    traf->set_tfdt(tfdt);
+    
+    tfdt->version = 1;
+    tfdt->base_media_decode_time = basetime;
+    
+    SrsMp4TrackFragmentRunBox* trun = new SrsMp4TrackFragmentRunBox();
+    traf->set_trun(trun);
+    
+    trun->flags = SrsMp4TrunFlagsDataOffset | SrsMp4TrunFlagsSampleDuration
+        | SrsMp4TrunFlagsSampleSize | SrsMp4TrunFlagsSampleFlag | SrsMp4TrunFlagsSampleCtsOffset;
+    
+    for (int i = 0; i < (int)samples.size(); i++) {
+        SrsMp4Sample* sample = samples.at(i);
+        SrsMp4TrunEntry* entry = new SrsMp4TrunEntry(trun);
+        
+        // The duration of last sample is unknown, use the delta of previous one.
+        if (i < (int)samples.size() - 1) {
+            SrsMp4Sample* next = samples.at(i + 1);
+            entry->sample_duration = (uint32_t)(next->dts > sample->dts ? next->dts - sample->dts : 0);
+        } else {
+            entry->sample_duration = last_delta;
+        }
+        
+        // The non-key frame depends on others and is not a sync sample.
+        if (sample->type == SrsFrameTypeVideo && sample->frame_type != SrsVideoAvcFrameTypeKeyFrame) {
+            entry->sample_flags = 0x01010000;
+        } else {
+            entry->sample_flags = 0x02000000;
+        }
+        
+        entry->sample_size = sample->nb_data;
+        entry->sample_composition_time_offset = (int64_t)(sample->pts - sample->dts);
+        if (entry->sample_composition_time_offset < 0) {
+            trun->version = 1;
+        }
+        
+        trun->entries.push_back(entry);
+    }
+    
+    return traf;
+}
+
+void SrsMp4FragmentTrack::on_chunk(uint64_t offset)
+{
+    if (!indexing || samples.empty()) {
+        return;
+    }
+    
+    uint32_t samples_per_chunk = (uint32_t)samples.size();
+    if (stsc.empty() || stsc.back().samples_per_chunk != samples_per_chunk) {
+        SrsMp4StscEntry entry;
+        entry.first_chunk = (uint32_t)stco.size() + 1;
+        entry.samples_per_chunk = samples_per_chunk;
+        entry.sample_description_index = 1;
+        stsc.push_back(entry);
+    }
+    
+    // TODO: FIXME: Support co64 for file larger than 4GB.
+    stco.push_back((uint32_t)offset);
+}
+
+void SrsMp4FragmentTrack::clear()
+{
+    vector<SrsMp4Sample*>::iterator it;
+    for (it = samples.begin(); it != samples.end(); ++it) {
+        SrsMp4Sample* sample = *it;
+        srs_freep(sample);
+    }
+    samples.clear();
+    nb_bytes = 0;
+}
+
+void SrsMp4FragmentTrack::write(SrsMp4SampleTableBox* stbl)
+{
+    SrsMp4DecodingTime2SampleBox* pstts = new SrsMp4DecodingTime2SampleBox();
+    stbl->set_stts(pstts);
+    
+    pstts->entries = stts;
+    if (nb_samples) {
+        if (!pstts->entries.empty() && pstts->entries.back().sample_delta == last_delta) {
+            pstts->entries.back().sample_count++;
+        } else {
+            SrsMp4SttsEntry entry;
+            entry.sample_count = 1;
+            entry.sample_delta = last_delta;
+            pstts->entries.push_back(entry);
+        }
+    }
+    
+    // The ctts is only required when the dts and pts differ.
+    if (ctts.size() > 1 || (ctts.size() == 1 && ctts.at(0).sample_offset)) {
+        SrsMp4CompositionTime2SampleBox* pctts = new SrsMp4CompositionTime2SampleBox();
+        stbl->set_ctts(pctts);
+        
+        pctts->entries = ctts;
+        for (int i = 0; i < (int)ctts.size(); i++) {
+            if (ctts.at(i).sample_offset < 0) {
+                pctts->version = 0x01;
+            }
+        }
+    }
+    
+    // If the sync sample box is not present, every sample is a sync sample.
+    if (!stss.empty()) {
+        SrsMp4SyncSampleBox* pstss = new SrsMp4SyncSampleBox();
+        stbl->set_stss(pstss);
+        
+        pstss->entry_count = (uint32_t)stss.size();
+        pstss->sample_numbers = new uint32_t[pstss->entry_count];
+        memcpy(pstss->sample_numbers, &stss[0], pstss->entry_count * sizeof(uint32_t));
+    }
+    
+    SrsMp4Sample2ChunkBox* pstsc = new SrsMp4Sample2ChunkBox();
+    stbl->set_stsc(pstsc);
+    
+    if (!stsc.empty()) {
+        pstsc->entry_count = (uint32_t)stsc.size();
+        pstsc->entries = new SrsMp4StscEntry[pstsc->entry_count];
+        for (int i = 0; i < (int)stsc.size(); i++) {
+            pstsc->entries[i] = stsc.at(i);
+        }
+    }
+    
+    SrsMp4SampleSizeBox* pstsz = new SrsMp4SampleSizeBox();
+    stbl->set_stsz(pstsz);
+    
+    if (!stsz.empty()) {
+        pstsz->sample_count = (uint32_t)stsz.size();
+        pstsz->entry_sizes = new uint32_t[pstsz->sample_count];
+        memcpy(pstsz->entry_sizes, &stsz[0], pstsz->sample_count * sizeof(uint32_t));
+    }
+    
+    SrsMp4ChunkOffsetBox* pstco = new SrsMp4ChunkOffsetBox();
+    stbl->set_stco(pstco);
+    
+    if (!stco.empty()) {
+        pstco->entry_count = (uint32_t)stco.size();
+        pstco->entries = new uint32_t[pstco->entry_count];
+        memcpy(pstco->entries, &stco[0], pstco->entry_count * sizeof(uint32_t));
+    }
+}
+
+SrsMp4FragmentEncoder::SrsMp4FragmentEncoder()
+{
+    fragment = 0;
+    finalize = false;
+    moov_offset = -1;
+    sequence_number = 1;
+    start_dts = fragment_dts = 0;
+    video = audio = NULL;
+}
+
+SrsMp4FragmentEncoder::~SrsMp4FragmentEncoder()
+{
+    srs_freep(video);
+    srs_freep(audio);
+}
+
+srs_error_t SrsMp4FragmentEncoder::initialize(ISrsWriteSeeker* ws, srs_utime_t duration, bool fin)
+{
+    srs_error_t err = srs_success;
+    
+    wsio = ws;
+    fragment = duration;
+    finalize = fin;
+    
+    // Write ftyp box, the init moov is writen when got the first sample.
+    if (true) {
+        SrsMp4FileTypeBox* ftyp = new SrsMp4FileTypeBox();
+        SrsAutoFree(SrsMp4FileTypeBox, ftyp);
+        
+        ftyp->major_brand = SrsMp4BoxBrandISO5;
+        ftyp->minor_version = 512;
+        ftyp->set_compatible_brands(SrsMp4BoxBrandISO6, SrsMp4BoxBrandMP41);
+        
+        if ((err = srs_mp4_write_box(wsio, ftyp)) != srs_success) {
+            return srs_error_wrap(err, "write ftyp");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4FragmentEncoder::write_sample(
+    SrsFormat* format, SrsMp4HandlerType ht, uint16_t ft, uint16_t ct, uint32_t dts, uint32_t pts,
+    uint8_t* sample, uint32_t nb_sample
+) {
+    srs_error_t err = srs_success;
+    
+    // For SPS/PPS or ASC, copy it to moov, ignore the track which is not in init moov.
+    bool vsh = (ht == SrsMp4HandlerTypeVIDE) && (ct == (uint16_t)SrsVideoAvcFrameTraitSequenceHeader);
+    bool ash = (ht == SrsMp4HandlerTypeSOUN) && (ct == (uint16_t)SrsAudioAacFrameTraitSequenceHeader);
+    if (vsh || ash) {
+        if (moov_offset >= 0 && !(vsh ? video : audio)) {
+            return err;
+        }
+        return copy_sequence_header(format, vsh, sample, nb_sample);
+    }
+    
+    // Write the init moov when got the first sample, and the tracks are fixed.
+    if (moov_offset < 0) {
+        if (pavcc.empty() && pasc.empty()) {
+            return err;
+        }
+        
+        start_dts = dts;
+        if ((err = write_init()) != srs_success) {
+            return srs_error_wrap(err, "write init");
+        }
+    }
+    
+    SrsMp4FragmentTrack* track = (ht == SrsMp4HandlerTypeVIDE)? video : audio;
+    if (!track) {
+        return err;
+    }
+    
+    // Start new fragment at keyframe, or at any audio frame for pure audio stream, and
+    // force to start new fragment when exceed twice duration to limit the memory.
+    bool join = !video || (ht == SrsMp4HandlerTypeVIDE && ft == (uint16_t)SrsVideoAvcFrameTypeKeyFrame);
+    bool empty = video? video->samples.empty() : true;
+    empty = empty && (audio? audio->samples.empty() : true);
+    
+    srs_utime_t elapsed = (dts > fragment_dts)? (dts - fragment_dts) * SRS_UTIME_MILLISECONDS : 0;
+    if (!empty && elapsed >= fragment && (join || elapsed >= 2 * fragment)) {
+        if ((err = write_fragment()) != srs_success) {
+            return srs_error_wrap(err, "write fragment");
+        }
+        empty = true;
+    }
+    
+    if (empty) {
+        fragment_dts = dts;
+    }
+    
+    SrsMp4Sample* ps = new SrsMp4Sample();
+    
+    if (ht == SrsMp4HandlerTypeVIDE) {
+        ps->type = SrsFrameTypeVideo;
+        ps->frame_type = (SrsVideoAvcFrameType)ft;
+        ps->index = nb_videos++;
+        vduration = (dts > start_dts)? dts - start_dts : 0;
+    } else {
+        ps->type = SrsFrameTypeAudio;
+        ps->index = nb_audios++;
+        aduration = (dts > start_dts)? dts - start_dts : 0;
+    }
+    ps->tbn = 1000;
+    ps->dts = dts;
+    ps->pts = pts;
+    
+    // We should copy the sample data, which is shared ptr from video/audio message.
+    ps->data = new uint8_t[nb_sample];
+    memcpy(ps->data, sample, nb_sample);
+    ps->nb_data = nb_sample;
+    
+    track->append(ps);
+    
+    return err;
+}
+
+srs_error_t SrsMp4FragmentEncoder::flush()
+{
+    srs_error_t err = srs_success;
+    
+    if (!nb_audios && !nb_videos) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "Missing audio and video track");
+    }
+    
+    if ((err = write_fragment()) != srs_success) {
+        return srs_error_wrap(err, "write fragment");
+    }
+    
+    if (finalize && (err = do_finalize()) != srs_success) {
+        return srs_error_wrap(err, "finalize");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4FragmentEncoder::write_init()
+{
+    srs_error_t err = srs_success;
+    
+    SrsMp4MovieBox* moov = create_moov();
+    SrsAutoFree(SrsMp4MovieBox, moov);
+    
+    SrsMp4MovieExtendsBox* mvex = new SrsMp4MovieExtendsBox();
+    moov->set_mvex(mvex);
+    
+    for (int i = 0; i < 2; i++) {
+        SrsMp4TrackBox* trak = (i == 0)? moov->video() : moov->audio();
+        if (!trak) {
+            continue;
+        }
+        
+        // The sample tables are required but empty, the samples are in fragments.
+        SrsMp4SampleTableBox* stbl = trak->stbl();
+        stbl->set_stts(new SrsMp4DecodingTime2SampleBox());
+        stbl->set_stsc(new SrsMp4Sample2ChunkBox());
+        stbl->set_stsz(new SrsMp4SampleSizeBox());
+        stbl->set_stco(new SrsMp4ChunkOffsetBox());
+        
+        SrsMp4TrackExtendsBox* trex = new SrsMp4TrackExtendsBox();
+        mvex->add_trex(trex);
+        
+        trex->track_ID = trak->tkhd()->track_ID;
+        trex->default_sample_description_index = 1;
+        
+        if (i == 0) {
+            video = new SrsMp4FragmentTrack(trex->track_ID, finalize);
+        } else {
+            audio = new SrsMp4FragmentTrack(trex->track_ID, finalize);
+        }
+    }
+    
+    if ((err = wsio->lseek(0, SEEK_CUR, &moov_offset)) != srs_success) {
+        return srs_error_wrap(err, "seek to moov");
+    }
+    
+    if ((err = srs_mp4_write_box(wsio, moov)) != srs_success) {
+        return srs_error_wrap(err, "write moov");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4FragmentEncoder::write_fragment()
+{
+    srs_error_t err = srs_success;
+    
+    // The samples of video then audio in mdat.
+    SrsMp4FragmentTrack* tracks[] = {video, audio};
+    
+    mdat_bytes = 0;
+    for (int i = 0; i < 2; i++) {
+        if (tracks[i]) {
+            mdat_bytes += tracks[i]->nb_bytes;
+        }
+    }
+    if (!mdat_bytes) {
+        return err;
+    }
+    
+    SrsMp4MediaDataBox* mdat = new SrsMp4MediaDataBox();
+    SrsAutoFree(SrsMp4MediaDataBox, mdat);
+    
+    // TODO: FIXME: Support 64bits size.
+    mdat->nb_data = (int)mdat_bytes;
+    
+    off_t moof_offset = 0;
+    if ((err = wsio->lseek(0, SEEK_CUR, &moof_offset)) != srs_success) {
+        return srs_error_wrap(err, "seek to moof");
+    }
+    
+    // Write moof.
+    if (true) {
+        SrsMp4MovieFragmentBox* moof = new SrsMp4MovieFragmentBox();
+        SrsAutoFree(SrsMp4MovieFragmentBox, moof);
+        
+        SrsMp4MovieFragmentHeaderBox* mfhd = new SrsMp4MovieFragmentHeaderBox();
+        moof->set_mfhd(mfhd);
+        
+        mfhd->sequence_number = sequence_number++;
+        
+        SrsMp4TrackFragmentRunBox* truns[] = {NULL, NULL};
+        for (int i = 0; i < 2; i++) {
+            SrsMp4FragmentTrack* track = tracks[i];
+            if (!track || track->samples.empty()) {
+                continue;
+            }
+            
+            uint64_t dts = track->samples.at(0)->dts;
+            SrsMp4TrackFragmentBox* traf = track->create_traf(dts > start_dts? dts - start_dts : 0);
+            moof->add_traf(traf);
+            truns[i] = traf->trun();
+        }
+        
+        // @remark The data_offset of trun is from the start of moof.
+        int32_t data_offset = (int32_t)(moof->nb_bytes() + mdat->sz_header());
+        for (int i = 0; i < 2; i++) {
+            if (!truns[i]) {
+                continue;
+            }
+            
+            truns[i]->data_offset = data_offset;
+            tracks[i]->on_chunk(moof_offset + data_offset);
+            data_offset += (int32_t)tracks[i]->nb_bytes;
+        }
+        
+        if ((err = srs_mp4_write_box(wsio, moof)) != srs_success) {
+            return srs_error_wrap(err, "write moof");
+        }
+    }
+    
+    // Write mdat.
+    if (true) {
+        int nb_data = mdat->sz_header();
+        uint8_t* data = new uint8_t[nb_data];
+        SrsAutoFreeA(uint8_t, data);
+        
+        SrsBuffer* buffer = new SrsBuffer((char*)data, nb_data);
+        SrsAutoFree(SrsBuffer, buffer);
+        
+        if ((err = mdat->encode(buffer)) != srs_success) {
+            return srs_error_wrap(err, "encode mdat");
+        }
+        
+        if ((err = wsio->write(data, nb_data, NULL)) != srs_success) {
+            return srs_error_wrap(err, "write mdat");
+        }
+        
+        for (int i = 0; i < 2; i++) {
+            SrsMp4FragmentTrack* track = tracks[i];
+            if (!track) {
+                continue;
+            }
+            
+            vector<SrsMp4Sample*>::iterator it;
+            for (it = track->samples.begin(); it != track->samples.end(); ++it) {
+                SrsMp4Sample* sample = *it;
+                
+                // TODO: FIXME: Ensure all bytes are writen.
+                if ((err = wsio->write(sample->data, sample->nb_data, NULL)) != srs_success) {
+                    return srs_error_wrap(err, "write sample");
+                }
+            }
+            
+            track->clear();
+        }
+    }
+    
+    if (finalize) {
+        moofs.push_back(moof_offset);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4FragmentEncoder::do_finalize()
+{
+    srs_error_t err = srs_success;
+    
+    // Append the regular moov, built from the index of samples.
+    if (true) {
+        SrsMp4MovieBox* moov = create_moov();
+        SrsAutoFree(SrsMp4MovieBox, moov);
+        
+        if (video && moov->video()) {
+            video->write(moov->video()->stbl());
+        }
+        if (audio && moov->audio()) {
+            audio->write(moov->audio()->stbl());
+        }
+        
+        if ((err = wsio->lseek(0, SEEK_END, NULL)) != srs_success) {
+            return srs_error_wrap(err, "seek to end");
+        }
+        
+        if ((err = srs_mp4_write_box(wsio, moov)) != srs_success) {
+            return srs_error_wrap(err, "write moov");
+        }
+    }
+    
+    // Overwrite the init moov and all moof to free box, the mdat is kept and referenced
+    // by the regular moov.
+    if ((err = overwrite_type(moov_offset, SrsMp4BoxTypeFREE)) != srs_success) {
+        return srs_error_wrap(err, "free init moov");
+    }
+    
+    for (int i = 0; i < (int)moofs.size(); i++) {
+        if ((err = overwrite_type(moofs.at(i), SrsMp4BoxTypeFREE)) != srs_success) {
+            return srs_error_wrap(err, "free moof");
+        }
+    }
+    
+    if ((err = wsio->lseek(0, SEEK_END, NULL)) != srs_success) {
+        return srs_error_wrap(err, "seek to end");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4FragmentEncoder::overwrite_type(off_t offset, SrsMp4BoxType type)
+{
+    srs_error_t err = srs_success;
+    
+    // The type is after the 4B size of box.
+    if ((err = wsio->lseek(offset + 4, SEEK_SET, NULL)) != srs_success) {
+        return srs_error_wrap(err, "seek to %d", (int)offset);
+    }
+    
+    char data[4];
+    SrsBuffer buffer(data, sizeof(data));
+    buffer.write_4bytes(type);
+    
+    if ((err = wsio->write(data, sizeof(data), NULL)) != srs_success) {
+        return srs_error_wrap(err, "write type");
+    }
+    
+    return err;
+}
+
 SrsMp4M2tsInitEncoder::SrsMp4M2tsInitEncoder()
 {
     writer = NULL;
@@ -330,6 +330,8 @@ public:
     // Get the traf.
     virtual SrsMp4TrackFragmentBox* traf();
     virtual void set_traf(SrsMp4TrackFragmentBox* v);
+    // Add a traf, for the fragment of multiple tracks.
+    virtual void add_traf(SrsMp4TrackFragmentBox* v);
 };
 
 // 8.8.5 Movie Fragment Header Box (mfhd)
@@ -723,6 +725,8 @@ public:
     // Get the track extends box.
     virtual SrsMp4TrackExtendsBox* trex();
     virtual void set_trex(SrsMp4TrackExtendsBox* v);
+    // Add a trex, for the movie of multiple tracks.
+    virtual void add_trex(SrsMp4TrackExtendsBox* v);
 };
 
 // 8.8.3 Track Extends Box(trex)
@@ -2021,7 +2025,7 @@ private:
 // The MP4 muxer.
 class SrsMp4Encoder
 {
-private:
+protected:
     ISrsWriteSeeker* wsio;
     // The mdat offset at file, we must update the header when flush.
     off_t mdat_offset;
@@ -2039,7 +2043,7 @@ public:
     SrsAudioSampleBits sound_bits;
     // The audio sound type.
     SrsAudioChannels channels;
-private:
+protected:
     // For AAC, the asc in esds box.
     std::vector<char> pasc;
     // The number of audio samples.
@@ -2050,7 +2054,7 @@ public:
     // The video codec of first track, generally there is zero or one track.
     // Forbidden if no video stream.
     SrsVideoCodecId vcodec;
-private:
+protected:
     // For H.264/AVC, the avcc contains the sps/pps.
     std::vector<char> pavcc;
     // The number of video samples.
@@ -2079,11 +2083,92 @@ public:
         uint32_t dts, uint32_t pts, uint8_t* sample, uint32_t nb_sample);
     // Flush the encoder, to write the moov.
     virtual srs_error_t flush();
-private:
+protected:
+    // Create the moov with the tracks and sample descriptions, without the sample tables.
+    virtual SrsMp4MovieBox* create_moov();
     virtual srs_error_t copy_sequence_header(SrsFormat* format, bool vsh, uint8_t* sample, uint32_t nb_sample);
     virtual srs_error_t do_write_sample(SrsMp4Sample* ps, uint8_t* sample, uint32_t nb_sample);
 };
 
+// The track of fragmented MP4 encoder, to cache the samples of current fragment,
+// and build the compact index of all samples to finalize the regular moov.
+class SrsMp4FragmentTrack
+{
+public:
+    uint32_t track_id;
+    // The samples of current fragment, freed when the fragment is writen.
+    std::vector<SrsMp4Sample*> samples;
+    // The bytes of samples in current fragment.
+    uint64_t nb_bytes;
+private:
+    // Whether build the index of samples, only required for finalize.
+    bool indexing;
+    uint32_t nb_samples;
+    // The dts of last sample, and the delta to its previous sample.
+    uint64_t last_dts;
+    uint32_t last_delta;
+    // The index of samples, about 10 bytes per sample, where each fragment is a chunk.
+    std::vector<SrsMp4SttsEntry> stts;
+    std::vector<SrsMp4CttsEntry> ctts;
+    std::vector<uint32_t> stss;
+    std::vector<SrsMp4StscEntry> stsc;
+    std::vector<uint32_t> stsz;
+    std::vector<uint32_t> stco;
+public:
+    SrsMp4FragmentTrack(uint32_t tid, bool index);
+    virtual ~SrsMp4FragmentTrack();
+public:
+    // Append the sample to current fragment.
+    virtual void append(SrsMp4Sample* ps);
+    // Create the traf of current fragment, whose decode time starts from basetime.
+    virtual SrsMp4TrackFragmentBox* create_traf(uint64_t basetime);
+    // Update the index when the samples of current fragment is writen at offset of file.
+    virtual void on_chunk(uint64_t offset);
+    // Free the samples of current fragment.
+    virtual void clear();
+    // Write the index to the sample table of regular moov.
+    virtual void write(SrsMp4SampleTableBox* stbl);
+};
+
+// A fragmented MP4 encoder for DVR, which writes the init moov with mvex, then
+// appends the samples as moof and mdat each fragment, so the memory is bounded
+// and the file is playable even if server crash. When finalize, a regular moov is
+// appended and the init moov and moof boxes are overwritten to free boxes.
+class SrsMp4FragmentEncoder : public SrsMp4Encoder
+{
+private:
+    // The duration of fragment.
+    srs_utime_t fragment;
+    // Whether finalize to a regular moov file when flush.
+    bool finalize;
+    // The offset of init moov, and the moof of each fragment, to overwrite when finalize.
+    off_t moov_offset;
+    std::vector<off_t> moofs;
+    uint32_t sequence_number;
+    // The dts of first sample in file, and in current fragment.
+    uint64_t start_dts;
+    uint64_t fragment_dts;
+    SrsMp4FragmentTrack* video;
+    SrsMp4FragmentTrack* audio;
+public:
+    SrsMp4FragmentEncoder();
+    virtual ~SrsMp4FragmentEncoder();
+public:
+    // Initialize the encoder with a writer and seeker ws.
+    // @param duration The duration of fragment.
+    // @param fin Whether finalize to a regular moov when flush.
+    virtual srs_error_t initialize(ISrsWriteSeeker* ws, srs_utime_t duration, bool fin);
+    virtual srs_error_t write_sample(SrsFormat* format, SrsMp4HandlerType ht, uint16_t ft, uint16_t ct,
+        uint32_t dts, uint32_t pts, uint8_t* sample, uint32_t nb_sample);
+    // Flush the last fragment, and finalize the file if required.
+    virtual srs_error_t flush();
+private:
+    virtual srs_error_t write_init();
+    virtual srs_error_t write_fragment();
+    virtual srs_error_t do_finalize();
+    virtual srs_error_t overwrite_type(off_t offset, SrsMp4BoxType type);
+};
+
 // A fMP4 encoder, to write the init.mp4 with sequence header.
 class SrsMp4M2tsInitEncoder
 {
@@ -0,0 +1,228 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_kernel_pool.hpp>
+
+#include <srs_core_performance.hpp>
+
+using namespace std;
+
+SrsSlabPool::SrsSlabPool(int min_size, int nb_classes, int max_cached)
+{
+    this->min_size = min_size;
+    this->nb_classes = nb_classes;
+    this->max_cached = max_cached;
+    caches = new vector<char*>[nb_classes];
+    
+    nn_allocs = nn_hits = 0;
+    nn_frees = nn_drops = 0;
+    nn_large_allocs = 0;
+}
+
+SrsSlabPool::~SrsSlabPool()
+{
+    clear();
+    srs_freepa(caches);
+}
+
+int SrsSlabPool::capacity(int size)
+{
+    int v = min_size;
+    for (int i = 0; i < nb_classes; i++, v *= 2) {
+        if (size <= v) {
+            return v;
+        }
+    }
+    return 0;
+}
+
+char* SrsSlabPool::alloc(int size, int* pcapacity)
+{
+    int v = capacity(size);
+    
+    // Too large, never pooled.
+    if (v <= 0) {
+        nn_large_allocs++;
+        *pcapacity = 0;
+        return new char[size];
+    }
+    
+    nn_allocs++;
+    *pcapacity = v;
+    
+    vector<char*>& cache = caches[class_index(v)];
+    if (cache.empty()) {
+        return new char[v];
+    }
+    
+    nn_hits++;
+    char* p = cache.back();
+    cache.pop_back();
+    return p;
+}
+
+void SrsSlabPool::free(char* p, int capacity)
+{
+    if (!p) {
+        return;
+    }
+    
+    if (capacity <= 0) {
+        delete[] p;
+        return;
+    }
+    
+    nn_frees++;
+    
+    // Drop the buffer when cache is full.
+    vector<char*>& cache = caches[class_index(capacity)];
+    if ((int64_t)(cache.size() + 1) * capacity > max_cached) {
+        nn_drops++;
+        delete[] p;
+        return;
+    }
+    
+    cache.push_back(p);
+}
+
+void SrsSlabPool::clear()
+{
+    for (int i = 0; i < nb_classes; i++) {
+        vector<char*>& cache = caches[i];
+        for (int j = 0; j < (int)cache.size(); j++) {
+            char* p = cache.at(j);
+            srs_freepa(p);
+        }
+        cache.clear();
+    }
+}
+
+int SrsSlabPool::class_index(int capacity)
+{
+    int index = 0;
+    for (int v = min_size; v < capacity; v *= 2) {
+        index++;
+    }
+    srs_assert(index < nb_classes);
+    return index;
+}
+
+int64_t SrsSlabPool::allocs()
+{
+    return nn_allocs;
+}
+
+int64_t SrsSlabPool::hits()
+{
+    return nn_hits;
+}
+
+int64_t SrsSlabPool::frees()
+{
+    return nn_frees;
+}
+
+int64_t SrsSlabPool::drops()
+{
+    return nn_drops;
+}
+
+int64_t SrsSlabPool::large_allocs()
+{
+    return nn_large_allocs;
+}
+
+int SrsSlabPool::classes()
+{
+    return nb_classes;
+}
+
+int SrsSlabPool::class_size(int index)
+{
+    srs_assert(index >= 0 && index < nb_classes);
+    return min_size << index;
+}
+
+int SrsSlabPool::cached(int index)
+{
+    srs_assert(index >= 0 && index < nb_classes);
+    return (int)caches[index].size();
+}
+
+int64_t SrsSlabPool::cached_bytes()
+{
+    int64_t v = 0;
+    for (int i = 0; i < nb_classes; i++) {
+        v += (int64_t)class_size(i) * caches[i].size();
+    }
+    return v;
+}
+
+SrsSlabPool* srs_message_pool()
+{
+    // Never free it, for the messages maybe freed when process exit.
+    static SrsSlabPool* pool = new SrsSlabPool(SRS_PERF_POOL_MIN_SIZE, SRS_PERF_POOL_CLASSES, SRS_PERF_POOL_MAX_CACHED);
+    return pool;
+}
+
+
+SrsSharedBlock::SrsSharedBlock(int size)
+{
+    nb_data = size;
+    data = srs_message_pool()->alloc(size, &capacity);
+    refs = 1;
+}
+
+SrsSharedBlock::~SrsSharedBlock()
+{
+    srs_message_pool()->free(data, capacity);
+}
+
+char* SrsSharedBlock::bytes()
+{
+    return data;
+}
+
+int SrsSharedBlock::size()
+{
+    return nb_data;
+}
+
+bool SrsSharedBlock::shared()
+{
+    return refs > 1;
+}
+
+SrsSharedBlock* SrsSharedBlock::acquire()
+{
+    refs++;
+    return this;
+}
+
+void SrsSharedBlock::release()
+{
+    srs_assert(refs > 0);
+    if (--refs == 0) {
+        delete this;
+    }
+}
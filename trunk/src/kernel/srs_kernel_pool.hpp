@@ -0,0 +1,120 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_KERNEL_POOL_HPP
+#define SRS_KERNEL_POOL_HPP
+
+#include <srs_core.hpp>
+
+#include <vector>
+
+// The slab pool, alloc the buffers in size classes, and cache the freed buffers to reuse,
+// to avoid hammering malloc and fragmenting the heap for the frequently created messages.
+// The size of class is doubled from the min size, for example, 64, 128, 256, ..., and the
+// buffer larger than the max class is not pooled.
+// @remark The buffer is alloced by new char[], so it's ok to free it by delete[].
+class SrsSlabPool
+{
+private:
+    // The size of the first class.
+    int min_size;
+    // The number of classes.
+    int nb_classes;
+    // The max cached bytes of each class.
+    int max_cached;
+    // The cached buffers of each class.
+    std::vector<char*>* caches;
+private:
+    // The stat, the total alloc and hit the cached buffer.
+    int64_t nn_allocs;
+    int64_t nn_hits;
+    // The stat, the total free and drop the buffer for cache is full.
+    int64_t nn_frees;
+    int64_t nn_drops;
+    // The stat, the buffers which are not pooled, for too large.
+    int64_t nn_large_allocs;
+public:
+    SrsSlabPool(int min_size, int nb_classes, int max_cached);
+    virtual ~SrsSlabPool();
+public:
+    // Get the capacity of buffer for size, 0 if not pooled.
+    virtual int capacity(int size);
+    // Alloc a buffer which is at least size bytes.
+    // @param pcapacity Output the capacity of buffer, which should be used to free it, 0 if not pooled.
+    virtual char* alloc(int size, int* pcapacity);
+    // Free the buffer to pool, which is alloced in capacity.
+    // @remark Directly delete[] the buffer if capacity is 0.
+    virtual void free(char* p, int capacity);
+    // Free all cached buffers.
+    virtual void clear();
+private:
+    // Get the index of class by capacity.
+    virtual int class_index(int capacity);
+// Stat of pool.
+public:
+    virtual int64_t allocs();
+    virtual int64_t hits();
+    virtual int64_t frees();
+    virtual int64_t drops();
+    virtual int64_t large_allocs();
+    // The size classes.
+    virtual int classes();
+    virtual int class_size(int index);
+    // The number of cached buffers in class.
+    virtual int cached(int index);
+    // The total bytes of cached buffers.
+    virtual int64_t cached_bytes();
+};
+
+// The pool for messages, the shared ptr message, the shared payload and the payload buffers.
+extern SrsSlabPool* srs_message_pool();
+
+// The refcounted block of bytes, for example, the receive buffer of protocol, whose slices are
+// referenced by messages without copy. The block is freed when the last reference is released.
+// @remark The bytes are alloced from the message pool.
+class SrsSharedBlock
+{
+private:
+    char* data;
+    int nb_data;
+    int capacity;
+    // The number of references, the creator holds the first one.
+    int refs;
+public:
+    SrsSharedBlock(int size);
+private:
+    // Use release() to free it.
+    virtual ~SrsSharedBlock();
+public:
+    virtual char* bytes();
+    virtual int size();
+    // Whether the block is referenced by others besides the creator.
+    virtual bool shared();
+    // Add a reference to block, return itself.
+    virtual SrsSharedBlock* acquire();
+    // Release a reference, and free the block for the last one.
+    virtual void release();
+};
+
+#endif
+
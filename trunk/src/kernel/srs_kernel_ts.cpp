@@ -200,6 +200,8 @@ SrsTsContext::SrsTsContext()
     sync_byte = 0x47; // ts default sync byte.
     vcodec = SrsVideoCodecIdReserved;
     acodec = SrsAudioCodecIdReserved1;
+    pes_buf = NULL;
+    nb_pes_buf = 0;
 }
 
 SrsTsContext::~SrsTsContext()
@@ -210,6 +212,8 @@ SrsTsContext::~SrsTsContext()
         srs_freep(channel);
     }
     pids.clear();
+    
+    srs_freepa(pes_buf);
 }
 
 bool SrsTsContext::is_pure_audio()
@@ -459,45 +463,48 @@ srs_error_t SrsTsContext::encode_pes(ISrsStreamWriter* writer, SrsTsMessage* msg
     char* end = start + msg->payload->length();
     char* p = start;
     
-    while (p < end) {
-        SrsTsPacket* pkt = NULL;
-        if (p == start) {
-            // write pcr according to message.
-            bool write_pcr = msg->write_pcr;
-            
-            // for pure audio, always write pcr.
-            // TODO: FIXME: maybe only need to write at begin and end of ts.
-            if (pure_audio && msg->is_audio()) {
-                write_pcr = true;
-            }
-            
-            // it's ok to set pcr equals to dts,
-            // @see https://github.com/ossrs/srs/issues/311
-            // Fig. 3.18. Program Clock Reference of Digital-Video-and-Audio-Broadcasting-Technology, page 65
-            // In MPEG-2, these are the "Program Clock Refer- ence" (PCR) values which are
-            // nothing else than an up-to-date copy of the STC counter fed into the transport
-            // stream at a certain time. The data stream thus carries an accurate internal
-            // "clock time". All coding and de- coding processes are controlled by this clock
-            // time. To do this, the receiver, i.e. the MPEG decoder, must read out the
-            // "clock time", namely the PCR values, and compare them with its own internal
-            // system clock, that is to say its own 42 bit counter.
-            int64_t pcr = write_pcr? msg->dts : -1;
-            
-            // TODO: FIXME: finger it why use discontinuity of msg.
-            pkt = SrsTsPacket::create_pes_first(this,
-                pid, msg->sid, channel->continuity_counter++, msg->is_discontinuity,
-                pcr, msg->dts, msg->pts, msg->payload->length()
-            );
-        } else {
-            pkt = SrsTsPacket::create_pes_continue(this, pid, msg->sid, channel->continuity_counter++);
-        }
+    // The first packet carry the PES header, the others at least carry 182 bytes payload,
+    // so we alloc the contiguous buffer for all packets, to write them once.
+    int nb_packets = 2 + msg->payload->length() / (SRS_TS_PACKET_SIZE - 6);
+    if (nb_packets > nb_pes_buf) {
+        srs_freepa(pes_buf);
+        nb_pes_buf = srs_max(nb_packets, nb_pes_buf * 2);
+        pes_buf = new char[nb_pes_buf * SRS_TS_PACKET_SIZE];
+    }
+    
+    // The first packet, with PES header.
+    char* buf = pes_buf;
+    if (true) {
+        // write pcr according to message.
+        bool write_pcr = msg->write_pcr;
+        
+        // for pure audio, always write pcr.
+        // TODO: FIXME: maybe only need to write at begin and end of ts.
+        if (pure_audio && msg->is_audio()) {
+            write_pcr = true;
+        }
+        
+        // it's ok to set pcr equals to dts,
+        // @see https://github.com/ossrs/srs/issues/311
+        // Fig. 3.18. Program Clock Reference of Digital-Video-and-Audio-Broadcasting-Technology, page 65
+        // In MPEG-2, these are the "Program Clock Refer- ence" (PCR) values which are
+        // nothing else than an up-to-date copy of the STC counter fed into the transport
+        // stream at a certain time. The data stream thus carries an accurate internal
+        // "clock time". All coding and de- coding processes are controlled by this clock
+        // time. To do this, the receiver, i.e. the MPEG decoder, must read out the
+        // "clock time", namely the PCR values, and compare them with its own internal
+        // system clock, that is to say its own 42 bit counter.
+        int64_t pcr = write_pcr? msg->dts : -1;
+        
+        // TODO: FIXME: finger it why use discontinuity of msg.
+        SrsTsPacket* pkt = SrsTsPacket::create_pes_first(this,
+            pid, msg->sid, channel->continuity_counter++, msg->is_discontinuity,
+            pcr, msg->dts, msg->pts, msg->payload->length()
+        );
         SrsAutoFree(SrsTsPacket, pkt);
         
         pkt->sync_byte = sync_byte;
         
-        char* buf = new char[SRS_TS_PACKET_SIZE];
-        SrsAutoFreeA(char, buf);
-        
         // set the left bytes with 0xFF.
         int nb_buf = pkt->size();
         srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
@@ -526,9 +533,45 @@ srs_error_t SrsTsContext::encode_pes(ISrsStreamWriter* writer, SrsTsMessage* msg
         if ((err = pkt->encode(&stream)) != srs_success) {
             return srs_error_wrap(err, "ts: encode packet");
         }
-        if ((err = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != srs_success) {
-            return srs_error_wrap(err, "ts: write packet");
+        buf += SRS_TS_PACKET_SIZE;
+    }
+    
+    // The continue packets, the header is 4 bytes, without payload_unit_start_indicator.
+    // @remark The af is at least 2 bytes for stuffings, same to SrsTsPacket::padding().
+    char pid0 = (char)((pid >> 8) & 0x1F);
+    char pid1 = (char)(pid & 0xFF);
+    while (p < end) {
+        buf[0] = sync_byte;
+        buf[1] = pid0;
+        buf[2] = pid1;
+        
+        uint8_t cc = channel->continuity_counter++ & 0x0F;
+        int left = (int)(end - p);
+        
+        if (left >= SRS_TS_PACKET_SIZE - 4) {
+            // Payload only.
+            buf[3] = (char)((SrsTsAdaptationFieldTypePayloadOnly << 4) | cc);
+            left = SRS_TS_PACKET_SIZE - 4;
+            memcpy(buf + 4, p, left);
+        } else {
+            // Payload with af, padding with stuffings.
+            int nb_af = srs_max(2, SRS_TS_PACKET_SIZE - 4 - left);
+            left = srs_min(left, SRS_TS_PACKET_SIZE - 4 - nb_af);
+            
+            buf[3] = (char)((SrsTsAdaptationFieldTypeBoth << 4) | cc);
+            buf[4] = (char)(nb_af - 1);
+            buf[5] = 0x00;
+            memset(buf + 6, 0xFF, nb_af - 2);
+            memcpy(buf + 4 + nb_af, p, left);
         }
+        
+        p += left;
+        buf += SRS_TS_PACKET_SIZE;
+    }
+    
+    // Write all packets of PES once.
+    if ((err = writer->write(pes_buf, buf - pes_buf, NULL)) != srs_success) {
+        return srs_error_wrap(err, "ts: write packets");
     }
     
     return err;
@@ -2635,24 +2678,27 @@ srs_error_t SrsEncFileWriter::write(void* data, size_t count, ssize_t* pnwrite)
 {
     srs_error_t err = srs_success;
     
-    srs_assert(count == SRS_TS_PACKET_SIZE);
-
-    if (nb_buf < HLS_AES_ENCRYPT_BLOCK_LENGTH) {
-        memcpy(buf + nb_buf, (char*)data, SRS_TS_PACKET_SIZE);
-        nb_buf += SRS_TS_PACKET_SIZE;
-    }
+    // The data maybe multiple ts packets of a PES.
+    srs_assert(count > 0 && (count % SRS_TS_PACKET_SIZE) == 0);
     
-    if (nb_buf == HLS_AES_ENCRYPT_BLOCK_LENGTH) {
-        nb_buf = 0;
-        
-        char* cipher = new char[HLS_AES_ENCRYPT_BLOCK_LENGTH];
-        SrsAutoFreeA(char, cipher);
-        
-        AES_KEY* k = (AES_KEY*)key;
-        AES_cbc_encrypt((unsigned char *)buf, (unsigned char *)cipher, HLS_AES_ENCRYPT_BLOCK_LENGTH, k, iv, AES_ENCRYPT);
+    for (char* p = (char*)data; p < (char*)data + count; p += SRS_TS_PACKET_SIZE) {
+        if (nb_buf < HLS_AES_ENCRYPT_BLOCK_LENGTH) {
+            memcpy(buf + nb_buf, p, SRS_TS_PACKET_SIZE);
+            nb_buf += SRS_TS_PACKET_SIZE;
+        }
         
-        if ((err = SrsFileWriter::write(cipher, HLS_AES_ENCRYPT_BLOCK_LENGTH, pnwrite)) != srs_success) {
-            return srs_error_wrap(err, "write cipher");
+        if (nb_buf == HLS_AES_ENCRYPT_BLOCK_LENGTH) {
+            nb_buf = 0;
+            
+            char* cipher = new char[HLS_AES_ENCRYPT_BLOCK_LENGTH];
+            SrsAutoFreeA(char, cipher);
+            
+            AES_KEY* k = (AES_KEY*)key;
+            AES_cbc_encrypt((unsigned char *)buf, (unsigned char *)cipher, HLS_AES_ENCRYPT_BLOCK_LENGTH, k, iv, AES_ENCRYPT);
+            
+            if ((err = SrsFileWriter::write(cipher, HLS_AES_ENCRYPT_BLOCK_LENGTH, pnwrite)) != srs_success) {
+                return srs_error_wrap(err, "write cipher");
+            }
         }
     }
     
@@ -3097,6 +3143,11 @@ srs_error_t SrsTsTransmuxer::write_video(int64_t timestamp, char* data, int size
     return flush_video();
 }
 
+void SrsTsTransmuxer::reset_context()
+{
+    context->reset();
+}
+
 srs_error_t SrsTsTransmuxer::flush_audio()
 {
     srs_error_t err = srs_success;
@@ -323,6 +323,9 @@ private:
     // when any codec changed, write the PAT/PMT.
     SrsVideoCodecId vcodec;
     SrsAudioCodecId acodec;
+    // The contiguous buffer of ts packets for a PES, in packets.
+    char* pes_buf;
+    int nb_pes_buf;
 public:
     SrsTsContext();
     virtual ~SrsTsContext();
@@ -1343,6 +1346,9 @@ public:
     // @remark assert data is not NULL.
     virtual srs_error_t write_audio(int64_t timestamp, char* data, int size);
     virtual srs_error_t write_video(int64_t timestamp, char* data, int size);
+    // Reset the context, to write the PAT/PMT before the next frame,
+    // for example, to allow player to start at the keyframe.
+    virtual void reset_context();
 private:
     virtual srs_error_t flush_audio();
     virtual srs_error_t flush_video();
@@ -49,6 +49,7 @@ using namespace std;
 #include <srs_app_utility.hpp>
 #include <srs_core_autofree.hpp>
 #include <srs_kernel_file.hpp>
+#include <srs_app_workers.hpp>
 
 // pre-declare
 srs_error_t run(SrsServer* svr);
@@ -454,6 +455,26 @@ srs_error_t run_master(SrsServer* svr)
 {
     srs_error_t err = srs_success;
     
+    // For workers mode, the master holds the pid file, forks and supervises the workers,
+    // so only the worker returns to run the server.
+    SrsWorkers* workers = SrsWorkers::instance();
+    if (workers->enabled()) {
+        if ((err = svr->acquire_pid_file()) != srs_success) {
+            return srs_error_wrap(err, "acquire pid file");
+        }
+        
+        if ((err = workers->fork_workers()) != srs_success) {
+            return srs_error_wrap(err, "fork workers");
+        }
+        
+        // The master never initialize the st and server, so quit like SrsServer::cycle,
+        // never destroy the server.
+        if (!workers->is_worker()) {
+            srs_trace("master terminated");
+            exit(0);
+        }
+    }
+    
     if ((err = svr->initialize_st()) != srs_success) {
         return srs_error_wrap(err, "initialize st");
     }
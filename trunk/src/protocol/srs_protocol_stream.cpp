@@ -29,6 +29,7 @@
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_core_performance.hpp>
+#include <srs_kernel_pool.hpp>
 
 // the default recv buffer size, 128KB.
 #define SRS_DEFAULT_RECV_BUFFER_SIZE 131072
@@ -60,13 +61,14 @@ SrsFastStream::SrsFastStream(int size)
 #endif
     
     nb_buffer = size? size:SRS_DEFAULT_RECV_BUFFER_SIZE;
-    buffer = (char*)malloc(nb_buffer);
+    block = new SrsSharedBlock(nb_buffer);
+    buffer = block->bytes();
     p = end = buffer;
 }
 
 SrsFastStream::~SrsFastStream()
 {
-    free(buffer);
+    block->release();
     buffer = NULL;
 }
 
@@ -99,7 +101,13 @@ void SrsFastStream::set_buffer(int buffer_size)
     int start = (int)(p - buffer);
     int nb_bytes = (int)(end - p);
     
-    buffer = (char*)realloc(buffer, nb_resize_buf);
+    // copy the whole buffer, for the consumed bytes maybe referenced.
+    SrsSharedBlock* nblock = new SrsSharedBlock(nb_resize_buf);
+    memcpy(nblock->bytes(), buffer, end - buffer);
+    block->release();
+    
+    block = nblock;
+    buffer = block->bytes();
     nb_buffer = nb_resize_buf;
     p = buffer + start;
     end = p + nb_bytes;
@@ -130,6 +138,13 @@ void SrsFastStream::skip(int size)
     p += size;
 }
 
+char* SrsFastStream::read_shared_slice(int size, SrsSharedBlock** pblock)
+{
+    char* ptr = read_slice(size);
+    *pblock = block->acquire();
+    return ptr;
+}
+
 srs_error_t SrsFastStream::grow(ISrsReader* reader, int required_size)
 {
     srs_error_t err = srs_success;
@@ -152,8 +167,18 @@ srs_error_t SrsFastStream::grow(ISrsReader* reader, int required_size)
     
     // resize the space when no left space.
     if (nb_exists_bytes + nb_free_space < required_size) {
-        // reset or move to get more space.
-        if (!nb_exists_bytes) {
+        // switch to a new block when the consumed bytes are referenced by messages,
+        // and move the left bytes to it.
+        if (block->shared()) {
+            SrsSharedBlock* nblock = new SrsSharedBlock(nb_buffer);
+            memcpy(nblock->bytes(), p, nb_exists_bytes);
+            block->release();
+            
+            block = nblock;
+            buffer = block->bytes();
+            p = buffer;
+            end = p + nb_exists_bytes;
+        } else if (!nb_exists_bytes) {
             // reset when buffer is empty.
             p = end = buffer;
         } else if (nb_exists_bytes < nb_buffer && p > buffer) {
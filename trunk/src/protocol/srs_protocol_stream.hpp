@@ -30,6 +30,8 @@
 #include <srs_core_performance.hpp>
 #include <srs_kernel_stream.hpp>
 
+class SrsSharedBlock;
+
 #ifdef SRS_PERF_MERGED_READ
 /**
  * to improve read performance, merge some packets then read,
@@ -83,6 +85,9 @@ private:
     char* buffer;
     // the size of buffer.
     int nb_buffer;
+    // the refcounted block of buffer, whose consumed bytes maybe referenced by messages,
+    // so the buffer is switched to a new block rather than reset or move when shared.
+    SrsSharedBlock* block;
 public:
     // If buffer is 0, use default size.
     SrsFastStream(int size=0);
@@ -127,6 +132,12 @@ public:
      *       while skip never consume bytes.
      */
     virtual void skip(int size);
+    /**
+     * read a slice in size bytes which is referenced by user, move to next bytes.
+     * @param pblock output the block of slice, which is acquired and user must release it.
+     * @remark the slice is never overwritten until the block released.
+     */
+    virtual char* read_shared_slice(int size, SrsSharedBlock** pblock);
 public:
     /**
      * grow buffer to atleast required size, loop to read from skt to fill.
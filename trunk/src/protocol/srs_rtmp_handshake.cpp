@@ -153,6 +153,21 @@ namespace _srs_internal
         return err;
     }
 
+#ifdef SRS_PERF_HANDSHAKE_CACHE
+    // The HMAC contexts and DH keys for handshakes, created when used, and never freed.
+    static SrsHmacSha256Cache* srs_hmac_cache()
+    {
+        static SrsHmacSha256Cache* cache = new SrsHmacSha256Cache();
+        return cache;
+    }
+    
+    static SrsDHPool* srs_dh_pool()
+    {
+        static SrsDHPool* pool = new SrsDHPool(SRS_PERF_HANDSHAKE_DH_KEYS, SRS_PERF_HANDSHAKE_DH_REUSE);
+        return pool;
+    }
+#endif
+
     /**
      * sha256 digest algorithm.
      * @param key the sha256 key, NULL to use EVP_Digest, for instance,
@@ -175,6 +190,17 @@ namespace _srs_internal
                 return srs_error_new(ERROR_OpenSslSha256EvpDigest, "evp digest");
             }
         } else {
+#ifdef SRS_PERF_HANDSHAKE_CACHE
+            // use the cached context of key to digest.
+            HMAC_CTX* ctx = NULL;
+            if ((err = srs_hmac_cache()->fetch(temp_key, key_size, &ctx)) != srs_success) {
+                return srs_error_wrap(err, "hmac fetch");
+            }
+            
+            if ((err = do_openssl_HMACsha256(ctx, data, data_size, temp_digest, &digest_size)) != srs_success) {
+                return srs_error_wrap(err, "hmac sha256");
+            }
+#else
             // use key-data to digest.
             HMAC_CTX *ctx = HMAC_CTX_new();
             if (ctx == NULL) {
@@ -193,6 +219,7 @@ namespace _srs_internal
             if (err != srs_success) {
                 return srs_error_wrap(err, "hmac sha256");
             }
+#endif
         }
         
         if (digest_size != 32) {
@@ -344,7 +371,12 @@ namespace _srs_internal
         }
         
         // 4. Set the key length
+        // @remark OpenSSL 3.0 requires the length less than the bits of prime, so use its default.
+#if OPENSSL_VERSION_NUMBER < 0x30000000L
         DH_set_length(pdh, bits_count);
+#else
+        (void)bits_count;
+#endif
         
         // 5. Generate private and public key
         // @see ./test/dhtest.c:152
@@ -355,6 +387,127 @@ namespace _srs_internal
         return err;
     }
     
+    SrsDHPool::SrsDHPool(int size, int reuse)
+    {
+        for (int i = 0; i < size; i++) {
+            keys.push_back(NULL);
+            uses.push_back(0);
+        }
+        index = 0;
+        max_reuse = reuse;
+        nn_generated = 0;
+    }
+    
+    SrsDHPool::~SrsDHPool()
+    {
+        for (int i = 0; i < (int)keys.size(); i++) {
+            SrsDH* dh = keys.at(i);
+            srs_freep(dh);
+        }
+        keys.clear();
+    }
+    
+    srs_error_t SrsDHPool::fetch(SrsDH** pdh)
+    {
+        srs_error_t err = srs_success;
+        
+        srs_assert(!keys.empty());
+        
+        // Use the keys in turn.
+        int i = index;
+        index = (index + 1) % (int)keys.size();
+        
+        // Regenerate the key when first use or reused too many times.
+        SrsDH* dh = keys.at(i);
+        if (!dh || uses.at(i) >= max_reuse) {
+            srs_freep(dh);
+            keys[i] = NULL;
+            
+            dh = new SrsDH();
+            if ((err = dh->initialize(true)) != srs_success) {
+                srs_freep(dh);
+                return srs_error_wrap(err, "dh init");
+            }
+            
+            keys[i] = dh;
+            uses[i] = 0;
+            nn_generated++;
+        }
+        
+        uses[i]++;
+        *pdh = dh;
+        
+        return err;
+    }
+    
+    int64_t SrsDHPool::generated()
+    {
+        return nn_generated;
+    }
+    
+    SrsHmacSha256Cache::SrsHmacSha256Cache()
+    {
+        shared = NULL;
+    }
+    
+    SrsHmacSha256Cache::~SrsHmacSha256Cache()
+    {
+        for (int i = 0; i < (int)ctxs.size(); i++) {
+            HMAC_CTX* ctx = ctxs.at(i);
+            HMAC_CTX_free(ctx);
+        }
+        ctxs.clear();
+        
+        if (shared) {
+            HMAC_CTX_free(shared);
+        }
+    }
+    
+    srs_error_t SrsHmacSha256Cache::fetch(const void* key, int key_size, HMAC_CTX** pctx)
+    {
+        srs_error_t err = srs_success;
+        
+        // Only the genuine keys are cached, because they are static and never change.
+        bool genuine = (key == SrsGenuineFMSKey || key == SrsGenuineFPKey);
+        
+        // Reset the context of genuine key, which reuses the key set before.
+        if (genuine) {
+            for (int i = 0; i < (int)ctxs.size(); i++) {
+                if (keys.at(i) != key || sizes.at(i) != key_size) {
+                    continue;
+                }
+                
+                HMAC_CTX* ctx = ctxs.at(i);
+                if (HMAC_Init_ex(ctx, NULL, 0, NULL, NULL) < 0) {
+                    return srs_error_new(ERROR_OpenSslSha256Init, "hmac reset");
+                }
+                
+                *pctx = ctx;
+                return err;
+            }
+        }
+        
+        HMAC_CTX* ctx = genuine? NULL : shared;
+        if (!ctx && (ctx = HMAC_CTX_new()) == NULL) {
+            return srs_error_new(ERROR_OpenSslCreateHMAC, "hmac new");
+        }
+        
+        if (genuine) {
+            keys.push_back(key);
+            sizes.push_back(key_size);
+            ctxs.push_back(ctx);
+        } else {
+            shared = ctx;
+        }
+        
+        if (HMAC_Init_ex(ctx, key, key_size, EVP_sha256(), NULL) < 0) {
+            return srs_error_new(ERROR_OpenSslSha256Init, "hmac init");
+        }
+        
+        *pctx = ctx;
+        return err;
+    }
+    
     key_block::key_block()
     {
         offset = (int32_t)rand();
@@ -579,17 +732,26 @@ namespace _srs_internal
     {
         srs_error_t err = srs_success;
         
-        SrsDH dh;
+#ifdef SRS_PERF_HANDSHAKE_CACHE
+        // use the key in pool, which is ensured 128bytes public key.
+        SrsDH* dh = NULL;
+        if ((err = srs_dh_pool()->fetch(&dh)) != srs_success) {
+            return srs_error_wrap(err, "dh fetch");
+        }
+#else
+        SrsDH key_dh;
+        SrsDH* dh = &key_dh;
         
         // ensure generate 128bytes public key.
-        if ((err = dh.initialize(true)) != srs_success) {
+        if ((err = dh->initialize(true)) != srs_success) {
             return srs_error_wrap(err, "dh init");
         }
+#endif
         
         // directly generate the public key.
         // @see: https://github.com/ossrs/srs/issues/148
         int pkey_size = 128;
-        if ((err = dh.copy_shared_key(c1->get_key(), 128, key.key, pkey_size)) != srs_success) {
+        if ((err = dh->copy_shared_key(c1->get_key(), 128, key.key, pkey_size)) != srs_success) {
             return srs_error_wrap(err, "copy shared key");
         }
         
@@ -26,6 +26,8 @@
 
 #include <srs_core.hpp>
 
+#include <vector>
+
 class ISrsProtocolReadWriter;
 class SrsComplexHandshake;
 class SrsHandshakeBytes;
@@ -40,6 +42,7 @@ namespace _srs_internal
     #define SRS_OpensslHashSize 512
     extern uint8_t SrsGenuineFMSKey[];
     extern uint8_t SrsGenuineFPKey[];
+    srs_error_t do_openssl_HMACsha256(HMAC_CTX* ctx, const void* data, int data_size, void* digest, unsigned int* digest_size);
     srs_error_t openssl_HMACsha256(const void* key, int key_size, const void* data, int data_size, void* digest);
     srs_error_t openssl_generate_key(char* public_key, int32_t size);
     
@@ -76,6 +79,48 @@ namespace _srs_internal
     private:
         virtual srs_error_t do_initialize();
     };
+    
+    // The pool of DH keys for server, because the DH key generation costs most of the
+    // complex handshake. Each key is used by handshakes in turn, and regenerated after
+    // reused some times.
+    class SrsDHPool
+    {
+    private:
+        std::vector<SrsDH*> keys;
+        // The number of handshakes of each key.
+        std::vector<int> uses;
+        int index;
+        int max_reuse;
+        // The number of generated keys.
+        int64_t nn_generated;
+    public:
+        SrsDHPool(int size, int reuse);
+        virtual ~SrsDHPool();
+    public:
+        // Fetch a key with 128bytes public key, which is owned by pool.
+        // @remark The key should be used immediately, before next fetch.
+        virtual srs_error_t fetch(SrsDH** pdh);
+        virtual int64_t generated();
+    };
+    
+    // The HMAC-sha256 contexts, where the contexts of genuine FMS/FP keys are initialized
+    // once and reset for each digest, and the others share a context.
+    class SrsHmacSha256Cache
+    {
+    private:
+        // The genuine key and size of each context.
+        std::vector<const void*> keys;
+        std::vector<int> sizes;
+        std::vector<HMAC_CTX*> ctxs;
+        // The context for other keys.
+        HMAC_CTX* shared;
+    public:
+        SrsHmacSha256Cache();
+        virtual ~SrsHmacSha256Cache();
+    public:
+        // Fetch the context initialized with key, which is owned by cache.
+        virtual srs_error_t fetch(const void* key, int key_size, HMAC_CTX** pctx);
+    };
     // The schema type.
     enum srs_schema_type
     {
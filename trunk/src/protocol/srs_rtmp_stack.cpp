@@ -29,6 +29,7 @@
 #include <srs_core_autofree.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_protocol_stream.hpp>
+#include <srs_kernel_pool.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_rtmp_handshake.hpp>
 
@@ -230,6 +231,10 @@ SrsProtocol::SrsProtocol(ISrsProtocolReadWriter* io)
     skt = io;
     
     in_chunk_size = SRS_CONSTS_RTMP_PROTOCOL_CHUNK_SIZE;
+#ifdef SRS_PERF_ZERO_COPY_READ
+    zero_copy_read = false;
+#endif
+    partial_chunk = false;
     out_chunk_size = SRS_CONSTS_RTMP_PROTOCOL_CHUNK_SIZE;
     
     nb_out_iovs = 8 * SRS_CONSTS_IOVS_MAX;
@@ -339,6 +344,37 @@ void SrsProtocol::set_recv_buffer(int buffer_size)
 }
 #endif
 
+#ifdef SRS_PERF_ZERO_COPY_READ
+void SrsProtocol::set_zero_copy_read(bool v)
+{
+    zero_copy_read = v;
+}
+#endif
+
+bool SrsProtocol::is_message_boundary()
+{
+    if (partial_chunk) {
+        return false;
+    }
+    
+    for (int cid = 0; cid < SRS_PERF_CHUNK_STREAM_CACHE; cid++) {
+        SrsChunkStream* cs = cs_cache[cid];
+        if (cs->msg && cs->msg->size > 0) {
+            return false;
+        }
+    }
+    
+    std::map<int, SrsChunkStream*>::iterator it;
+    for (it = chunk_streams.begin(); it != chunk_streams.end(); ++it) {
+        SrsChunkStream* cs = it->second;
+        if (cs->msg && cs->msg->size > 0) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
 void SrsProtocol::set_recv_timeout(srs_utime_t tm)
 {
     return skt->set_recv_timeout(tm);
@@ -463,6 +499,62 @@ srs_error_t SrsProtocol::do_send_messages(SrsSharedPtrMessage** msgs, int nb_msg
             continue;
         }
         
+#ifdef SRS_PERF_SHARED_CHUNKS
+        // use the chunks shared by other players, which are already encoded,
+        // while the c0 and c3 of extended timestamp are written to the header cache,
+        // so use it only when the cache is enough for them and the next chunk.
+        if (true) {
+            int c0c3_left = SRS_CONSTS_C0C3_HEADERS_MAX - c0c3_cache_index;
+            iovec* chunks = NULL;
+            int nb_chunks = 0;
+            if (c0c3_left >= 2 * SRS_CONSTS_RTMP_MAX_FMT0_HEADER_SIZE + SRS_CONSTS_RTMP_MAX_FMT3_HEADER_SIZE) {
+                msg->chunks(out_chunk_size, &chunks, &nb_chunks);
+            }
+            
+            if (chunks) {
+                // realloc the iovs if exceed.
+                if (iov_index + nb_chunks >= nb_out_iovs - 2) {
+                    int ov = nb_out_iovs;
+                    while (iov_index + nb_chunks >= nb_out_iovs - 2) {
+                        nb_out_iovs = 2 * nb_out_iovs;
+                    }
+                    int realloc_size = sizeof(iovec) * nb_out_iovs;
+                    out_iovs = (iovec*)realloc(out_iovs, realloc_size);
+                    srs_warn("resize iovs %d => %d, max_msgs=%d", ov, nb_out_iovs, SRS_PERF_MW_MSGS);
+                }
+                
+                iovs = out_iovs + iov_index;
+                memcpy(iovs, chunks, sizeof(iovec) * nb_chunks);
+                
+                // the c0 of this connection.
+                int nbh = msg->chunk_header(c0c3_cache, c0c3_left, true);
+                srs_assert(nbh > 0);
+                iovs[0].iov_base = c0c3_cache;
+                iovs[0].iov_len = nbh;
+                c0c3_cache_index += nbh;
+                c0c3_cache = out_c0c3_caches + c0c3_cache_index;
+                
+                // the c3 with extended timestamp of this connection, same for all chunks.
+                if (nb_chunks > 2) {
+                    nbh = msg->chunk_header(c0c3_cache, c0c3_left - (int)iovs[0].iov_len, false);
+                    srs_assert(nbh > 0);
+                    if (nbh != (int)iovs[2].iov_len) {
+                        for (int j = 2; j < nb_chunks; j += 2) {
+                            iovs[j].iov_base = c0c3_cache;
+                            iovs[j].iov_len = nbh;
+                        }
+                        c0c3_cache_index += nbh;
+                        c0c3_cache = out_c0c3_caches + c0c3_cache_index;
+                    }
+                }
+                
+                iov_index += nb_chunks;
+                iovs = out_iovs + iov_index;
+                continue;
+            }
+        }
+#endif
+        
         // p set to current write position,
         // it's ok when payload is NULL and size is 0.
         char* p = msg->payload;
@@ -904,6 +996,7 @@ srs_error_t SrsProtocol::recv_interlaced_message(SrsCommonMessage** pmsg)
     if ((err = read_message_payload(chunk, &msg)) != srs_success) {
         return srs_error_wrap(err, "read message payload");
     }
+    partial_chunk = false;
     
     // not got an entire RTMP message, try next chunk.
     if (!msg) {
@@ -967,6 +1060,7 @@ srs_error_t SrsProtocol::read_basic_header(char& fmt, int& cid)
     }
     
     fmt = in_buffer->read_1byte();
+    partial_chunk = true;
     cid = fmt & 0x3f;
     fmt = (fmt >> 6) & 0x03;
     
@@ -1280,15 +1374,31 @@ srs_error_t SrsProtocol::read_message_payload(SrsChunkStream* chunk, SrsCommonMe
     int payload_size = chunk->header.payload_length - chunk->msg->size;
     payload_size = srs_min(payload_size, in_chunk_size);
     
+    // read payload to buffer
+    if ((err = in_buffer->grow(skt, payload_size)) != srs_success) {
+        return srs_error_wrap(err, "read %d bytes payload", payload_size);
+    }
+    
+#ifdef SRS_PERF_ZERO_COPY_READ
+    // the entire message in one chunk, reference the receive buffer without copy.
+    if (zero_copy_read && !chunk->msg->payload && payload_size == chunk->header.payload_length) {
+        SrsSharedBlock* block = NULL;
+        char* data = in_buffer->read_shared_slice(payload_size, &block);
+        chunk->msg->create_payload(block, data);
+        block->release();
+        
+        chunk->msg->size = payload_size;
+        *pmsg = chunk->msg;
+        chunk->msg = NULL;
+        return err;
+    }
+#endif
+    
     // create msg payload if not initialized
     if (!chunk->msg->payload) {
         chunk->msg->create_payload(chunk->header.payload_length);
     }
     
-    // read payload to buffer
-    if ((err = in_buffer->grow(skt, payload_size)) != srs_success) {
-        return srs_error_wrap(err, "read %d bytes payload", payload_size);
-    }
     memcpy(chunk->msg->payload + chunk->msg->size, in_buffer->read_slice(payload_size), payload_size);
     chunk->msg->size += payload_size;
     
@@ -2186,6 +2296,23 @@ srs_error_t SrsRtmpClient::fmle_publish(string stream, int& stream_id)
     return err;
 }
 
+srs_error_t SrsRtmpClient::close_stream(int stream_id)
+{
+    srs_error_t err = srs_success;
+    
+    SrsCloseStreamPacket* pkt = new SrsCloseStreamPacket();
+    if ((err = protocol->send_and_free_packet(pkt, stream_id)) != srs_success) {
+        return srs_error_wrap(err, "send close stream failed. stream_id=%d", stream_id);
+    }
+    
+    return err;
+}
+
+bool SrsRtmpClient::is_message_boundary()
+{
+    return protocol->is_message_boundary();
+}
+
 SrsRtmpServer::SrsRtmpServer(ISrsProtocolReadWriter* skt)
 {
     io = skt;
@@ -2221,6 +2348,13 @@ void SrsRtmpServer::set_recv_buffer(int buffer_size)
 }
 #endif
 
+#ifdef SRS_PERF_ZERO_COPY_READ
+void SrsRtmpServer::set_zero_copy_read(bool v)
+{
+    protocol->set_zero_copy_read(v);
+}
+#endif
+
 void SrsRtmpServer::set_recv_timeout(srs_utime_t tm)
 {
     protocol->set_recv_timeout(tm);
@@ -3564,6 +3698,40 @@ srs_error_t SrsCloseStreamPacket::decode(SrsBuffer* stream)
     return err;
 }
 
+int SrsCloseStreamPacket::get_prefer_cid()
+{
+    return RTMP_CID_OverStream;
+}
+
+int SrsCloseStreamPacket::get_message_type()
+{
+    return RTMP_MSG_AMF0CommandMessage;
+}
+
+int SrsCloseStreamPacket::get_size()
+{
+    return SrsAmf0Size::str(command_name) + SrsAmf0Size::number() + SrsAmf0Size::null();
+}
+
+srs_error_t SrsCloseStreamPacket::encode_packet(SrsBuffer* stream)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = srs_amf0_write_string(stream, command_name)) != srs_success) {
+        return srs_error_wrap(err, "command_name");
+    }
+    
+    if ((err = srs_amf0_write_number(stream, transaction_id)) != srs_success) {
+        return srs_error_wrap(err, "transaction_id");
+    }
+    
+    if ((err = srs_amf0_write_null(stream)) != srs_success) {
+        return srs_error_wrap(err, "command_object");
+    }
+    
+    return err;
+}
+
 SrsFMLEStartPacket::SrsFMLEStartPacket()
 {
     command_name = RTMP_AMF0_COMMAND_RELEASE_STREAM;
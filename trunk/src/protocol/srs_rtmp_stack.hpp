@@ -184,6 +184,12 @@ private:
     SrsFastStream* in_buffer;
     // The input chunk size, default to 128, set by peer packet.
     int32_t in_chunk_size;
+#ifdef SRS_PERF_ZERO_COPY_READ
+    // Whether the message in one chunk references the receive buffer without copy.
+    bool zero_copy_read;
+#endif
+    // Whether in the middle of a chunk, that the basic header is read but not the payload.
+    bool partial_chunk;
     // The input ack window, to response acknowledge to peer,
     // For example, to respose the encoder, for server got lots of packets.
     AckWindowSize in_ack_size;
@@ -248,6 +254,15 @@ public:
     // @see https://github.com/ossrs/srs/issues/241
     virtual void set_recv_buffer(int buffer_size);
 #endif
+#ifdef SRS_PERF_ZERO_COPY_READ
+    // To avoid copy the payload of message, which is in one chunk, the message
+    // references the slice of receive buffer, for example, the publisher.
+    // @remark User should never detach the payload of message to free it.
+    virtual void set_zero_copy_read(bool v);
+#endif
+    // Whether the received bytes end at a message boundary, that no chunk or message
+    // is partially received, so the connection could be reused for another stream.
+    virtual bool is_message_boundary();
 public:
     // To set/get the recv timeout in srs_utime_t.
     // if timeout, recv/send message return ERROR_SOCKET_TIMEOUT.
@@ -586,6 +601,10 @@ public:
     // start publish stream. use FMLE publish workflow:
     //       connect-app => FMLE publish
     virtual srs_error_t fmle_publish(std::string stream, int& stream_id);
+    // Close the stream to stop play or publish, the connection is kept for another stream.
+    virtual srs_error_t close_stream(int stream_id);
+    // Whether the connection is at message boundary, see SrsProtocol::is_message_boundary.
+    virtual bool is_message_boundary();
 public:
     // Expect a specified message, drop others util got specified one.
     // @pmsg, user must free it. NULL if not success.
@@ -645,6 +664,12 @@ public:
     // @remark when buffer changed, the previous ptr maybe invalid.
     // @see https://github.com/ossrs/srs/issues/241
     virtual void set_recv_buffer(int buffer_size);
+#endif
+#ifdef SRS_PERF_ZERO_COPY_READ
+    // To avoid copy the payload of message, which is in one chunk, the message
+    // references the slice of receive buffer, for example, the publisher.
+    // @remark User should never detach the payload of message to free it.
+    virtual void set_zero_copy_read(bool v);
 #endif
     // To set/get the recv timeout in srs_utime_t.
     // if timeout, recv/send message return ERROR_SOCKET_TIMEOUT.
@@ -978,6 +1003,13 @@ public:
 // Decode functions for concrete packet to override.
 public:
     virtual srs_error_t decode(SrsBuffer* stream);
+// Encode functions for concrete packet to override.
+public:
+    virtual int get_prefer_cid();
+    virtual int get_message_type();
+protected:
+    virtual int get_size();
+    virtual srs_error_t encode_packet(SrsBuffer* stream);
 };
 
 // FMLE start publish: ReleaseStream/PublishStream/FCPublish/FCUnpublish
@@ -204,6 +204,11 @@ void SrsHttpClient::kbps_sample(const char* label, int64_t age)
     srs_trace("<- %s time=%" PRId64 ", okbps=%d,%d,%d, ikbps=%d,%d,%d", label, age, sr, sr30s, sr5m, rr, rr30s, rr5m);
 }
 
+int64_t SrsHttpClient::get_recv_bytes()
+{
+    return transport? transport->get_recv_bytes() : 0;
+}
+
 void SrsHttpClient::disconnect()
 {
     kbps->set_io(NULL, NULL);
@@ -95,6 +95,8 @@ private:
     virtual void set_recv_timeout(srs_utime_t tm);
 public:
     virtual void kbps_sample(const char* label, int64_t age);
+    // Get the bytes received by transport, 0 if disconnected.
+    virtual int64_t get_recv_bytes();
 private:
     virtual void disconnect();
     virtual srs_error_t connect();
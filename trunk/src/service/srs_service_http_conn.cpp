@@ -82,6 +82,9 @@ srs_error_t SrsHttpParser::parse_message(ISrsReader* reader, ISrsHttpMessage** p
     // Reset request data.
     state = SrsHttpParseStateInit;
     hp_header = http_parser();
+    // Reset the parser for each message of keep-alive connection, because the body is never
+    // parsed by it, so it's still in the state of body of previous message.
+    http_parser_init(&parser, (enum http_parser_type)parser.type);
     // The body that we have read from cache.
     p_body_start = p_header_tail = NULL;
     // We must reset the field name and value, because we may get a partial value in on_header_value.
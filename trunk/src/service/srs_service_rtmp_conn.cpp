@@ -98,6 +98,60 @@ void SrsBasicRtmpClient::close()
     srs_freep(transport);
 }
 
+srs_error_t SrsBasicRtmpClient::close_stream()
+{
+    srs_error_t err = srs_success;
+    
+    if (!client) {
+        return srs_error_new(ERROR_RTMP_STREAM_NOT_FOUND, "not connected");
+    }
+    
+    if ((err = client->close_stream(stream_id)) != srs_success) {
+        return srs_error_wrap(err, "close stream_id=%d", stream_id);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsBasicRtmpClient::recreate_stream(string r)
+{
+    srs_error_t err = srs_success;
+    
+    if (!client) {
+        return srs_error_new(ERROR_RTMP_STREAM_NOT_FOUND, "not connected");
+    }
+    
+    // Only the stream and param changes, the tcUrl is kept for the connected app.
+    std::string tcUrl, schema, host, vhost, app, stream, param;
+    int port = 0;
+    srs_parse_rtmp_url(r, tcUrl, stream);
+    srs_discovery_tc_url(tcUrl, schema, host, vhost, app, stream, port, param);
+    
+    url = r;
+    req->stream = stream;
+    req->param = param;
+    
+    // The messages of previous stream in flight are dropped when expect the response.
+    if ((err = client->create_stream(stream_id)) != srs_success) {
+        return srs_error_wrap(err, "create stream_id=%d", stream_id);
+    }
+    
+    return err;
+}
+
+bool SrsBasicRtmpClient::is_message_boundary()
+{
+    return client && client->is_message_boundary();
+}
+
+void SrsBasicRtmpClient::set_connect_arg(string key, SrsAmf0Any* value)
+{
+    if (req->args == NULL) {
+        req->args = SrsAmf0Any::object();
+    }
+    req->args->set(key, value);
+}
+
 srs_error_t SrsBasicRtmpClient::connect_app()
 {
     return do_connect_app(srs_get_public_internet_address(), false);
@@ -34,6 +34,7 @@ class SrsRtmpClient;
 class SrsCommonMessage;
 class SrsSharedPtrMessage;
 class SrsPacket;
+class SrsAmf0Any;
 class SrsKbps;
 class SrsWallClock;
 
@@ -70,6 +71,17 @@ public:
     // @remark We always close the transport.
     virtual srs_error_t connect();
     virtual void close();
+    // Close the stream and keep the connection, which could be reused to play or publish
+    // another stream of the same vhost and app, by recreate_stream.
+    virtual srs_error_t close_stream();
+    // Create a stream for url on the connected app, without connect and handshake again.
+    // @param r The RTMP url, must be the same vhost and app of connection.
+    virtual srs_error_t recreate_stream(std::string r);
+    // Whether the connection could be reused, that it's at message boundary.
+    virtual bool is_message_boundary();
+    // Set the arg of connect app, for example, the hint to server, the value is owned by client.
+    // @remark Must be set before connect.
+    virtual void set_connect_arg(std::string key, SrsAmf0Any* value);
 protected:
     virtual srs_error_t connect_app();
     virtual srs_error_t do_connect_app(std::string local_ip, bool debug);
@@ -33,6 +33,7 @@ using namespace std;
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_log.hpp>
 #include <srs_service_utility.hpp>
+#include <srs_core_performance.hpp>
 #include <srs_kernel_utility.hpp>
 
 // nginx also set to 512
@@ -66,7 +67,12 @@ srs_error_t srs_st_init()
     
     // Select the best event system available on the OS. In Linux this is
     // epoll(). On BSD it will be kqueue.
-    if (st_set_eventsys(ST_EVENTSYS_ALT) == -1) {
+#ifdef SRS_PERF_ST_EPOLL_BATCH
+    int eventsys = ST_EVENTSYS_BATCH;
+#else
+    int eventsys = ST_EVENTSYS_ALT;
+#endif
+    if (st_set_eventsys(eventsys) == -1) {
         return srs_error_new(ERROR_ST_SET_EPOLL, "st enable st failed, current is %s", st_get_eventsys_name());
     }
     
@@ -349,6 +355,11 @@ int srs_cond_signal(srs_cond_t cond)
     return st_cond_signal((st_cond_t)cond);
 }
 
+int srs_cond_broadcast(srs_cond_t cond)
+{
+    return st_cond_broadcast((st_cond_t)cond);
+}
+
 srs_mutex_t srs_mutex_new()
 {
     return (srs_mutex_t)st_mutex_new();
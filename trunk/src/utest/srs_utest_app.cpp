@@ -28,8 +28,25 @@ using namespace std;
 #include <srs_app_fragment.hpp>
 #include <srs_app_security.hpp>
 #include <srs_app_config.hpp>
+#include <srs_app_source.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_app_hls.hpp>
+#include <srs_app_dash.hpp>
+#include <srs_kernel_ts.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_app_pipeline.hpp>
+#include <srs_protocol_json.hpp>
 
 #include <srs_app_st.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_app_mw_scheduler.hpp>
+#include <srs_app_bandwidth.hpp>
+#include <srs_rtmp_msg_array.hpp>
+#include <srs_app_async_file.hpp>
+#include <srs_app_http_hooks.hpp>
+#include <srs_service_http_client.hpp>
+#include <srs_utest_config.hpp>
 
 VOID TEST(AppCoroutineTest, Dummy)
 {
@@ -557,3 +574,1572 @@ VOID TEST(AppSecurity, CheckSecurity)
     //       4. deny if matches deny strategy.
 }
 
+VOID TEST(AppSecurity, CidrTrie)
+{
+    srs_error_t err;
+    
+    SrsCidrTrie trie;
+    EXPECT_EQ(-1, trie.match("12.13.14.15"));
+    
+    HELPER_EXPECT_SUCCESS(trie.insert("12.13.14.15", 0));
+    HELPER_EXPECT_SUCCESS(trie.insert("192.168.0.0/16", 1));
+    HELPER_EXPECT_SUCCESS(trie.insert("2001:db8::/32", 2));
+    HELPER_EXPECT_SUCCESS(trie.insert("::1", 3));
+    
+    EXPECT_EQ(0, trie.match("12.13.14.15"));
+    EXPECT_EQ(-1, trie.match("12.13.14.16"));
+    EXPECT_EQ(1, trie.match("192.168.1.10"));
+    EXPECT_EQ(1, trie.match("192.168.255.255"));
+    EXPECT_EQ(-1, trie.match("192.169.0.1"));
+    EXPECT_EQ(2, trie.match("2001:db8:1::10"));
+    EXPECT_EQ(-1, trie.match("2001:db9::10"));
+    EXPECT_EQ(3, trie.match("::1"));
+    EXPECT_EQ(-1, trie.match("::2"));
+    
+    // The IPv4 is mapped to IPv6.
+    EXPECT_EQ(1, trie.match("::ffff:192.168.1.10"));
+    
+    // The invalid ip never match.
+    EXPECT_EQ(-1, trie.match(""));
+    EXPECT_EQ(-1, trie.match("localhost"));
+    HELPER_EXPECT_FAILED(trie.insert("localhost", 4));
+    HELPER_EXPECT_FAILED(trie.insert("12.13.14.0/33", 4));
+    HELPER_EXPECT_FAILED(trie.insert("2001:db8::/129", 4));
+    HELPER_EXPECT_FAILED(trie.insert("12.13.14.0/", 4));
+    
+    // The shortest prefix wins, and all matches any address.
+    HELPER_EXPECT_SUCCESS(trie.insert("12.0.0.0/8", 5));
+    EXPECT_EQ(5, trie.match("12.13.14.15"));
+    HELPER_EXPECT_SUCCESS(trie.insert("::/0", 6));
+    EXPECT_EQ(6, trie.match("12.13.14.15"));
+    EXPECT_EQ(6, trie.match("localhost"));
+}
+
+VOID TEST(AppSecurity, CheckCidrRules)
+{
+    srs_error_t err;
+    
+    // Deny the range, allow the others.
+    if (true) {
+        SrsSecurity sec; SrsRequest rr; SrsConfDirective rules;
+        rules.get_or_create("deny", "play", "10.0.0.0/8");
+        HELPER_EXPECT_FAILED(sec.do_check(&rules, SrsRtmpConnPlay, "10.1.2.3", &rr));
+        HELPER_EXPECT_SUCCESS(sec.do_check(&rules, SrsRtmpConnPlay, "11.1.2.3", &rr));
+        HELPER_EXPECT_SUCCESS(sec.do_check(&rules, SrsRtmpConnFMLEPublish, "10.1.2.3", &rr));
+    }
+    
+    // Allow the range only.
+    if (true) {
+        SrsSecurity sec; SrsRequest rr; SrsConfDirective rules;
+        rules.get_or_create("allow", "publish", "fd00::/8");
+        HELPER_EXPECT_SUCCESS(sec.do_check(&rules, SrsRtmpConnFMLEPublish, "fd12::1", &rr));
+        HELPER_EXPECT_FAILED(sec.do_check(&rules, SrsRtmpConnFMLEPublish, "fe80::1", &rr));
+        HELPER_EXPECT_FAILED(sec.do_check(&rules, SrsRtmpConnPlay, "fd12::1", &rr));
+    }
+    
+    // Lots of rules, compiled once.
+    if (true) {
+        SrsConfDirective rules;
+        for (int i = 0; i < 20000; i++) {
+            SrsConfDirective* d = new SrsConfDirective();
+            d->name = "allow";
+            d->args.push_back("play");
+            d->args.push_back("10." + srs_int2str(i / 256) + "." + srs_int2str(i % 256) + ".1");
+            rules.directives.push_back(d);
+        }
+        rules.get_or_create("deny", "play", "10.78.0.0/16");
+        
+        SrsSecurityAcl acl;
+        HELPER_EXPECT_SUCCESS(acl.initialize(&rules));
+        HELPER_EXPECT_SUCCESS(acl.check(SrsRtmpConnPlay, "10.0.0.1"));
+        HELPER_EXPECT_SUCCESS(acl.check(SrsRtmpConnPlay, "10.77.255.1"));
+        HELPER_EXPECT_FAILED(acl.check(SrsRtmpConnPlay, "10.78.31.1"));
+        HELPER_EXPECT_FAILED(acl.check(SrsRtmpConnPlay, "10.0.0.2"));
+        HELPER_EXPECT_FAILED(acl.check(SrsRtmpConnPlay, "10.79.0.1"));
+    }
+}
+
+
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+SrsSharedPtrMessage* _mock_create_video(int64_t timestamp, bool keyframe)
+{
+    SrsMessageHeader h;
+    h.message_type = RTMP_MSG_VideoMessage;
+    h.timestamp = timestamp;
+    
+    char* payload = new char[2];
+    payload[0] = keyframe? 0x17 : 0x27;
+    payload[1] = 0x01;
+    
+    SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+    srs_error_t err = msg->create(&h, payload, 2);
+    srs_assert(err == srs_success);
+    return msg;
+}
+
+VOID TEST(AppSourceTest, MessageRing)
+{
+    // Enqueue and read by sequence.
+    if (true) {
+        SrsMessageRing ring;
+        ring.set_queue_size(10 * SRS_UTIME_SECONDS);
+        EXPECT_EQ(0, ring.begin());
+        EXPECT_EQ(0, ring.end());
+        EXPECT_EQ(-1, ring.keyframe());
+        
+        for (int i = 0; i < 100; i++) {
+            SrsSharedPtrMessage* msg = _mock_create_video(i * 40, (i % 25) == 0);
+            SrsAutoFree(SrsSharedPtrMessage, msg);
+            ring.enqueue(msg);
+        }
+        
+        EXPECT_EQ(0, ring.begin());
+        EXPECT_EQ(100, ring.end());
+        EXPECT_EQ(75, ring.keyframe());
+        EXPECT_EQ(40, ring.at(1)->timestamp);
+        EXPECT_EQ(99 * 40 * SRS_UTIME_MILLISECONDS, ring.duration(0));
+        EXPECT_EQ(0, ring.duration(99));
+        EXPECT_EQ(0, ring.duration(100));
+    }
+    
+    // Shrink the old messages, but keep the latest gop.
+    if (true) {
+        SrsMessageRing ring;
+        ring.set_queue_size(1 * SRS_UTIME_SECONDS);
+        
+        for (int i = 0; i < 100; i++) {
+            SrsSharedPtrMessage* msg = _mock_create_video(i * 40, (i % 50) == 0);
+            SrsAutoFree(SrsSharedPtrMessage, msg);
+            ring.enqueue(msg);
+        }
+        
+        EXPECT_EQ(50, ring.begin());
+        EXPECT_EQ(100, ring.end());
+        EXPECT_EQ(50, ring.keyframe());
+        
+        ring.clear();
+        EXPECT_EQ(100, ring.begin());
+        EXPECT_EQ(100, ring.end());
+        EXPECT_EQ(-1, ring.keyframe());
+    }
+    
+    // The timestamp jump back never shrink the ring.
+    if (true) {
+        SrsMessageRing ring;
+        ring.set_queue_size(1 * SRS_UTIME_SECONDS);
+        
+        for (int i = 0; i < 20; i++) {
+            SrsSharedPtrMessage* msg = _mock_create_video(100000 + i * 40, i == 0);
+            SrsAutoFree(SrsSharedPtrMessage, msg);
+            ring.enqueue(msg);
+        }
+        for (int i = 0; i < 5; i++) {
+            SrsSharedPtrMessage* msg = _mock_create_video(i * 40, i == 0);
+            SrsAutoFree(SrsSharedPtrMessage, msg);
+            ring.enqueue(msg);
+        }
+        
+        EXPECT_EQ(0, ring.begin());
+        EXPECT_EQ(25, ring.end());
+        EXPECT_EQ(20, ring.keyframe());
+        EXPECT_EQ(23 * 40 * SRS_UTIME_MILLISECONDS, ring.duration(0));
+    }
+    
+    // Trim the messages read by all consumers, but keep the latest gop.
+    if (true) {
+        SrsMessageRing ring;
+        ring.set_queue_size(10 * SRS_UTIME_SECONDS);
+        
+        for (int i = 0; i < 100; i++) {
+            SrsSharedPtrMessage* msg = _mock_create_video(i * 40, (i % 25) == 0);
+            SrsAutoFree(SrsSharedPtrMessage, msg);
+            ring.enqueue(msg);
+        }
+        
+        ring.trim(30);
+        EXPECT_EQ(30, ring.begin());
+        ring.trim(100);
+        EXPECT_EQ(75, ring.begin());
+        EXPECT_EQ(75, ring.keyframe());
+        EXPECT_EQ(100, ring.end());
+    }
+}
+#endif
+
+VOID TEST(AppHlsTest, MemoryStore)
+{
+    srs_error_t err;
+
+    // The memory writer append data, and detach to store.
+    if (true) {
+        SrsHlsMemoryWriter w;
+        HELPER_EXPECT_SUCCESS(w.open("/tmp/srs-utest/livestream-0.ts.tmp"));
+        EXPECT_TRUE(w.is_open());
+        HELPER_EXPECT_FAILED(w.open("/tmp/srs-utest/livestream-0.ts.tmp"));
+
+        char buf[188];
+        memset(buf, 0x47, sizeof(buf));
+        for (int i = 0; i < 1000; i++) {
+            HELPER_EXPECT_SUCCESS(w.write(buf, sizeof(buf), NULL));
+        }
+        EXPECT_EQ(188 * 1000, w.tellg());
+        HELPER_EXPECT_FAILED(w.lseek(0, SEEK_SET, NULL));
+        w.close();
+        EXPECT_FALSE(w.is_open());
+
+        char* data = NULL;
+        int size = 0;
+        w.detach(&data, &size);
+        EXPECT_EQ(188 * 1000, size);
+        EXPECT_EQ(0, w.tellg());
+
+        SrsHlsMemoryStore store;
+        HELPER_EXPECT_SUCCESS(store.update("/tmp/srs-utest/livestream-0.ts", data, size));
+        EXPECT_EQ(1, store.size());
+        EXPECT_EQ(188 * 1000, store.bytes());
+        EXPECT_TRUE(store.fetch("/tmp/srs-utest/livestream-1.ts") == NULL);
+
+        // The fetched file shares the content, which is safe after removed.
+        SrsHlsMemoryFile* file = store.fetch("/tmp/srs-utest/livestream-0.ts");
+        SrsAutoFree(SrsHlsMemoryFile, file);
+        ASSERT_TRUE(file != NULL);
+        EXPECT_EQ(1, file->content->count());
+        EXPECT_FALSE(file->etag.empty());
+        EXPECT_TRUE(srs_string_ends_with(file->last_modified, " GMT"));
+
+        store.remove("/tmp/srs-utest/livestream-0.ts");
+        EXPECT_EQ(0, store.size());
+        EXPECT_EQ(0, store.bytes());
+        EXPECT_EQ(0, file->content->count());
+        EXPECT_EQ(0x47, file->content->payload[188 * 1000 - 1]);
+    }
+
+    // The update of file changes the ETag.
+    if (true) {
+        SrsHlsMemoryStore store;
+
+        char* data = new char[10];
+        memset(data, 0, 10);
+        HELPER_EXPECT_SUCCESS(store.update("/tmp/srs-utest/livestream.m3u8", data, 10));
+        SrsHlsMemoryFile* f0 = store.fetch("/tmp/srs-utest/livestream.m3u8");
+        SrsAutoFree(SrsHlsMemoryFile, f0);
+
+        data = new char[11];
+        memset(data, 0, 11);
+        HELPER_EXPECT_SUCCESS(store.update("/tmp/srs-utest/livestream.m3u8", data, 11));
+        SrsHlsMemoryFile* f1 = store.fetch("/tmp/srs-utest/livestream.m3u8");
+        SrsAutoFree(SrsHlsMemoryFile, f1);
+
+        EXPECT_EQ(1, store.size());
+        EXPECT_EQ(11, store.bytes());
+        EXPECT_NE(f0->etag, f1->etag);
+    }
+
+    // The memory segment is removed from store when freed.
+    if (true) {
+        SrsHlsMemoryWriter w;
+        SrsTsContext ctx;
+        SrsHlsSegment* seg = new SrsHlsSegment(&ctx, SrsAudioCodecIdAAC, SrsVideoCodecIdAVC, &w);
+        seg->memory = true;
+        seg->set_path("/tmp/srs-utest/livestream-[duration].ts");
+        seg->append(0);
+        seg->append(10000);
+        HELPER_EXPECT_SUCCESS(seg->rename());
+        EXPECT_STREQ("/tmp/srs-utest/livestream-10000.ts", seg->fullpath().c_str());
+        HELPER_EXPECT_SUCCESS(seg->unlink_tmpfile());
+
+        char* data = new char[188];
+        HELPER_EXPECT_SUCCESS(_srs_hls_store->update(seg->fullpath(), data, 188));
+        int nn_files = _srs_hls_store->size();
+
+        srs_freep(seg);
+        EXPECT_EQ(nn_files - 1, _srs_hls_store->size());
+    }
+}
+
+VOID TEST(AppHlsTest, LowLatencyParts)
+{
+    srs_error_t err;
+
+    // The part name is generated from the segment name.
+    if (true) {
+        SrsHlsMemoryWriter w;
+        SrsTsContext ctx;
+        SrsHlsSegment seg(&ctx, SrsAudioCodecIdAAC, SrsVideoCodecIdAVC, &w);
+        seg.memory = true;
+        seg.uri = "livestream-3.ts";
+        seg.set_path("/tmp/srs-utest.d/live/livestream-[duration].ts");
+        EXPECT_STREQ("livestream-3.0.ts", seg.part_uri(0).c_str());
+        EXPECT_STREQ("/tmp/srs-utest.d/live/livestream-part.2.ts", seg.part_path(2).c_str());
+
+        seg.uri = "live/livestream";
+        EXPECT_STREQ("live/livestream.1", seg.part_uri(1).c_str());
+    }
+
+    // The parts and hint are removed with segment.
+    if (true) {
+        SrsHlsMemoryWriter w;
+        SrsTsContext ctx;
+        SrsHlsSegment seg(&ctx, SrsAudioCodecIdAAC, SrsVideoCodecIdAVC, &w);
+        seg.memory = true;
+        seg.uri = "livestream-3.ts";
+        seg.set_path("/tmp/srs-utest/live/livestream-3.ts");
+
+        int nn_files = _srs_hls_store->size();
+        for (int i = 0; i < 2; i++) {
+            SrsHlsPart* part = new SrsHlsPart();
+            part->uri = seg.part_uri(i);
+            part->path = seg.part_path(i);
+            seg.parts.push_back(part);
+            HELPER_EXPECT_SUCCESS(_srs_hls_store->update(part->path, new char[188], 188));
+        }
+        EXPECT_EQ(nn_files + 2, _srs_hls_store->size());
+
+        seg.hint = seg.part_path(2);
+        _srs_hls_store->hint(seg.hint);
+        EXPECT_TRUE(_srs_hls_store->is_hinted("/tmp/srs-utest/live/livestream-3.2.ts"));
+
+        seg.clear_parts();
+        EXPECT_EQ(nn_files, _srs_hls_store->size());
+        EXPECT_FALSE(_srs_hls_store->is_hinted("/tmp/srs-utest/live/livestream-3.2.ts"));
+        EXPECT_TRUE(seg.parts.empty());
+    }
+
+    // The hinted file is available when updated, and the m3u8 carries the next part.
+    if (true) {
+        SrsHlsMemoryStore store;
+
+        store.hint("/tmp/srs-utest/live/livestream-3.0.ts");
+        EXPECT_TRUE(store.is_hinted("/tmp/srs-utest/live/livestream-3.0.ts"));
+        HELPER_EXPECT_SUCCESS(store.update("/tmp/srs-utest/live/livestream-3.0.ts", new char[188], 188));
+        EXPECT_FALSE(store.is_hinted("/tmp/srs-utest/live/livestream-3.0.ts"));
+
+        // Never hint the file which exists.
+        store.hint("/tmp/srs-utest/live/livestream-3.0.ts");
+        EXPECT_FALSE(store.is_hinted("/tmp/srs-utest/live/livestream-3.0.ts"));
+
+        HELPER_EXPECT_SUCCESS(store.update("/tmp/srs-utest/live/livestream.m3u8", new char[10], 10, 3, 1));
+        SrsHlsMemoryFile* file = store.fetch("/tmp/srs-utest/live/livestream.m3u8");
+        SrsAutoFree(SrsHlsMemoryFile, file);
+        EXPECT_EQ(3, file->msn);
+        EXPECT_EQ(1, file->part);
+
+        HELPER_EXPECT_SUCCESS(store.update("/tmp/srs-utest/live/livestream.m3u8", new char[10], 10));
+        SrsHlsMemoryFile* file2 = store.fetch("/tmp/srs-utest/live/livestream.m3u8");
+        SrsAutoFree(SrsHlsMemoryFile, file2);
+        EXPECT_EQ(-1, file2->msn);
+        EXPECT_EQ(-1, file2->part);
+    }
+}
+
+VOID TEST(AppHlsTest, Fmp4Track)
+{
+    SrsFmp4HlsTrack track("video");
+    EXPECT_TRUE(track.empty());
+
+    for (int i = 0; i < 10; i++) {
+        track.append("video-" + srs_int2str(100 + i) + ".m4s", 2 * SRS_UTIME_SECONDS, 250000, 6 * SRS_UTIME_SECONDS);
+    }
+    EXPECT_FALSE(track.empty());
+    EXPECT_EQ(1000000, track.bandwidth());
+
+    // Keep fragments in window, and the sequence is the first fragment.
+    string m3u8 = track.generate(2 * SRS_UTIME_SECONDS);
+    EXPECT_STREQ("#EXTM3U\n#EXT-X-VERSION:7\n#EXT-X-TARGETDURATION:2\n#EXT-X-MEDIA-SEQUENCE:7\n"
+        "#EXT-X-MAP:URI=\"video-init.mp4\"\n"
+        "#EXTINF:2.000, no desc\nvideo-107.m4s\n"
+        "#EXTINF:2.000, no desc\nvideo-108.m4s\n"
+        "#EXTINF:2.000, no desc\nvideo-109.m4s\n", m3u8.c_str());
+
+    // The target duration is the max duration.
+    track.append("video-110.m4s", 3500 * SRS_UTIME_MILLISECONDS, 875000, 6 * SRS_UTIME_SECONDS);
+    m3u8 = track.generate(2 * SRS_UTIME_SECONDS);
+    EXPECT_TRUE(m3u8.find("#EXT-X-TARGETDURATION:4\n") != string::npos);
+    EXPECT_TRUE(m3u8.find("#EXT-X-MEDIA-SEQUENCE:8\n") != string::npos);
+
+    // The bandwidth is the peak bitrate of fragments.
+    EXPECT_EQ(2000000, track.bandwidth());
+
+    track.clear();
+    EXPECT_TRUE(track.empty());
+    EXPECT_EQ(0, track.bandwidth());
+}
+
+SrsSharedPtrMessage* _mock_create_av(int type, int64_t timestamp, const uint8_t* data, int size)
+{
+    SrsMessageHeader h;
+    h.message_type = type;
+    h.timestamp = timestamp;
+    
+    char* payload = new char[size];
+    memcpy(payload, data, size);
+    
+    SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+    srs_error_t err = msg->create(&h, payload, size);
+    srs_assert(err == srs_success);
+    return msg;
+}
+
+void _mock_free_chunks(vector<SrsPipelineChunk*>& msgs)
+{
+    for (int i = 0; i < (int)msgs.size(); i++) {
+        SrsPipelineChunk* chunk = msgs[i];
+        srs_freep(chunk);
+    }
+    msgs.clear();
+}
+
+VOID TEST(AppPipelineTest, SharedTs)
+{
+    srs_error_t err;
+    
+    // The sequence headers of H.264 and AAC, and the frames.
+    uint8_t vsh[] = {
+        0x17, 0x00, 0x00, 0x00, 0x00, 0x01, 0x42, 0xc0, 0x1e, 0xff, 0xe1, 0x00, 0x0a,
+        0x67, 0x42, 0xc0, 0x1e, 0x8c, 0x8d, 0x40, 0x50, 0x1e, 0x90,
+        0x01, 0x00, 0x04, 0x68, 0xce, 0x3c, 0x80
+    };
+    uint8_t ash[] = {0xaf, 0x00, 0x12, 0x10};
+    uint8_t key[] = {0x17, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x65, 0x88, 0x84, 0x00};
+    uint8_t inter[] = {0x27, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x41, 0x9a, 0x02, 0x00};
+    uint8_t aac[] = {0xaf, 0x01, 0x21, 0x10, 0x04, 0x60};
+    
+    SrsMuxPipeline pipeline;
+    HELPER_EXPECT_SUCCESS(pipeline.initialize());
+    SrsPipelineOutput* ts = pipeline.ts_output();
+    
+    // No TS muxed without viewer, but the sequence headers are parsed.
+    if (true) {
+        SrsSharedPtrMessage* msg = _mock_create_av(RTMP_MSG_VideoMessage, 0, vsh, sizeof(vsh));
+        SrsAutoFree(SrsSharedPtrMessage, msg);
+        HELPER_EXPECT_SUCCESS(pipeline.on_video(msg));
+    }
+    if (true) {
+        SrsSharedPtrMessage* msg = _mock_create_av(RTMP_MSG_AudioMessage, 0, ash, sizeof(ash));
+        SrsAutoFree(SrsSharedPtrMessage, msg);
+        HELPER_EXPECT_SUCCESS(pipeline.on_audio(msg));
+    }
+    if (true) {
+        SrsSharedPtrMessage* msg = _mock_create_av(RTMP_MSG_VideoMessage, 0, key, sizeof(key));
+        SrsAutoFree(SrsSharedPtrMessage, msg);
+        HELPER_EXPECT_SUCCESS(pipeline.on_video(msg));
+    }
+    
+    SrsPipelineViewer viewer;
+    vector<SrsPipelineChunk*> msgs;
+    HELPER_EXPECT_SUCCESS(ts->fetch(&viewer, msgs, 128));
+    EXPECT_EQ(0, (int)msgs.size());
+    EXPECT_EQ(0, pipeline.stage(SrsPipelineStageTs)->nn_frames);
+    
+    // Attached, the viewer starts at the keyframe, with PAT/PMT.
+    ts->attach(&viewer);
+    for (int i = 0; i < 3; i++) {
+        if (true) {
+            SrsSharedPtrMessage* msg = _mock_create_av(RTMP_MSG_AudioMessage, 1000 + i * 40, aac, sizeof(aac));
+            SrsAutoFree(SrsSharedPtrMessage, msg);
+            HELPER_EXPECT_SUCCESS(pipeline.on_audio(msg));
+        }
+        if (true) {
+            uint8_t* data = (i == 1)? key : inter;
+            SrsSharedPtrMessage* msg = _mock_create_av(RTMP_MSG_VideoMessage, 1000 + i * 40, data, sizeof(key));
+            SrsAutoFree(SrsSharedPtrMessage, msg);
+            HELPER_EXPECT_SUCCESS(pipeline.on_video(msg));
+        }
+    }
+    EXPECT_EQ(6, pipeline.stage(SrsPipelineStageTs)->nn_frames);
+    
+    HELPER_EXPECT_SUCCESS(ts->fetch(&viewer, msgs, 128));
+    ASSERT_EQ(3, (int)msgs.size());
+    EXPECT_EQ(6, viewer.cursor);
+    EXPECT_TRUE(viewer.joined);
+    for (int i = 0; i < (int)msgs.size(); i++) {
+        SrsPipelineChunk* chunk = msgs[i];
+        EXPECT_EQ(0, chunk->size() % 188);
+        EXPECT_EQ(0x47, (uint8_t)chunk->body->payload[0]);
+    }
+    // The join point starts with PAT, whose pid is 0.
+    EXPECT_TRUE(msgs[0]->join);
+    EXPECT_EQ(0, (int)(msgs[0]->body->payload[1] & 0x1f));
+    EXPECT_EQ(0, (int)msgs[0]->body->payload[2]);
+    // The audio frame is not a join point, there is video.
+    EXPECT_FALSE(msgs[1]->join);
+    EXPECT_NE(0, (int)msgs[1]->body->payload[2]);
+    _mock_free_chunks(msgs);
+    
+    // Nothing more to fetch.
+    HELPER_EXPECT_SUCCESS(ts->fetch(&viewer, msgs, 128));
+    EXPECT_EQ(0, (int)msgs.size());
+    
+    // Keep the last and current GOP and the retention, the slow viewer skips to the last keyframe.
+    SrsPipelineViewer slow;
+    ts->attach(&slow);
+    for (int i = 0; i < 10; i++) {
+        SrsSharedPtrMessage* msg = _mock_create_av(RTMP_MSG_VideoMessage, 5000 + i * 40, (i % 4) == 0? key : inter, sizeof(key));
+        SrsAutoFree(SrsSharedPtrMessage, msg);
+        HELPER_EXPECT_SUCCESS(pipeline.on_video(msg));
+    }
+    slow.cursor = 0;
+    slow.joined = true;
+    HELPER_EXPECT_SUCCESS(ts->fetch(&slow, msgs, 128));
+    EXPECT_EQ(2, (int)msgs.size());
+    EXPECT_EQ(16, slow.cursor);
+    _mock_free_chunks(msgs);
+    
+    // The viewer in retention does not skip.
+    HELPER_EXPECT_SUCCESS(ts->fetch(&viewer, msgs, 128));
+    EXPECT_EQ(10, (int)msgs.size());
+    EXPECT_EQ(16, viewer.cursor);
+    _mock_free_chunks(msgs);
+    
+    // Fetch at most max chunks.
+    SrsPipelineViewer joiner;
+    ts->attach(&joiner);
+    HELPER_EXPECT_SUCCESS(ts->fetch(&joiner, msgs, 1));
+    EXPECT_EQ(1, (int)msgs.size());
+    EXPECT_EQ(15, joiner.cursor);
+    _mock_free_chunks(msgs);
+    
+    // Without gop cache, wait for the next keyframe.
+    SrsPipelineViewer waiter;
+    waiter.gop = false;
+    ts->attach(&waiter);
+    HELPER_EXPECT_SUCCESS(ts->fetch(&waiter, msgs, 128));
+    EXPECT_EQ(0, (int)msgs.size());
+    EXPECT_FALSE(waiter.joined);
+    
+    // Drop the chunks when no viewer.
+    ts->detach(&viewer);
+    ts->detach(&slow);
+    ts->detach(&joiner);
+    EXPECT_TRUE(ts->active());
+    ts->detach(&waiter);
+    EXPECT_FALSE(ts->active());
+    HELPER_EXPECT_SUCCESS(ts->fetch(&viewer, msgs, 128));
+    EXPECT_EQ(0, (int)msgs.size());
+    
+    // The stages are reported.
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+    pipeline.dumps(obj);
+    EXPECT_TRUE(obj->get_property("stages") != NULL);
+    EXPECT_TRUE(obj->get_property("outputs") != NULL);
+}
+
+VOID TEST(AppPipelineTest, SharedFlvAac)
+{
+    srs_error_t err;
+    
+    uint8_t meta[] = {0x02, 0x00, 0x0a, 'o', 'n', 'M', 'e', 't', 'a', 'D', 'a', 't', 'a'};
+    uint8_t vsh[] = {
+        0x17, 0x00, 0x00, 0x00, 0x00, 0x01, 0x42, 0xc0, 0x1e, 0xff, 0xe1, 0x00, 0x0a,
+        0x67, 0x42, 0xc0, 0x1e, 0x8c, 0x8d, 0x40, 0x50, 0x1e, 0x90,
+        0x01, 0x00, 0x04, 0x68, 0xce, 0x3c, 0x80
+    };
+    uint8_t ash[] = {0xaf, 0x00, 0x12, 0x10};
+    uint8_t key[] = {0x17, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x65, 0x88, 0x84, 0x00};
+    uint8_t aac[] = {0xaf, 0x01, 0x21, 0x10, 0x04, 0x60};
+    
+    SrsMuxPipeline pipeline;
+    HELPER_EXPECT_SUCCESS(pipeline.initialize());
+    SrsPipelineOutput* flv = pipeline.flv_output();
+    SrsPipelineOutput* aacs = pipeline.aac_output();
+    
+    // The metadata and sequence headers are cached without viewer.
+    if (true) {
+        SrsSharedPtrMessage* msg = _mock_create_av(RTMP_MSG_AMF0DataMessage, 0, meta, sizeof(meta));
+        SrsAutoFree(SrsSharedPtrMessage, msg);
+        HELPER_EXPECT_SUCCESS(pipeline.on_meta_data(msg));
+    }
+    if (true) {
+        SrsSharedPtrMessage* msg = _mock_create_av(RTMP_MSG_VideoMessage, 0, vsh, sizeof(vsh));
+        SrsAutoFree(SrsSharedPtrMessage, msg);
+        HELPER_EXPECT_SUCCESS(pipeline.on_video(msg));
+    }
+    if (true) {
+        SrsSharedPtrMessage* msg = _mock_create_av(RTMP_MSG_AudioMessage, 0, ash, sizeof(ash));
+        SrsAutoFree(SrsSharedPtrMessage, msg);
+        HELPER_EXPECT_SUCCESS(pipeline.on_audio(msg));
+    }
+    
+    SrsPipelineViewer viewer;
+    flv->attach(&viewer);
+    
+    SrsPipelineViewer listener;
+    listener.gop = false;
+    aacs->attach(&listener);
+    
+    SrsSharedPtrMessage* kmsg = _mock_create_av(RTMP_MSG_VideoMessage, 1000, key, sizeof(key));
+    SrsAutoFree(SrsSharedPtrMessage, kmsg);
+    HELPER_EXPECT_SUCCESS(pipeline.on_video(kmsg));
+    
+    SrsSharedPtrMessage* amsg = _mock_create_av(RTMP_MSG_AudioMessage, 1000, aac, sizeof(aac));
+    SrsAutoFree(SrsSharedPtrMessage, amsg);
+    HELPER_EXPECT_SUCCESS(pipeline.on_audio(amsg));
+    
+    // The FLV header, metadata and sequence headers, then the keyframe and audio.
+    vector<SrsPipelineChunk*> msgs;
+    HELPER_EXPECT_SUCCESS(flv->fetch(&viewer, msgs, 128));
+    ASSERT_EQ(6, (int)msgs.size());
+    
+    EXPECT_EQ(13, msgs[0]->size());
+    EXPECT_EQ('F', msgs[0]->head[0]);
+    EXPECT_EQ('L', msgs[0]->head[1]);
+    EXPECT_EQ('V', msgs[0]->head[2]);
+    EXPECT_EQ(0x05, msgs[0]->head[4]);
+    
+    // The script tag, whose timestamp is zero.
+    EXPECT_EQ(18, msgs[1]->head[0]);
+    EXPECT_EQ(11 + (int)sizeof(meta) + 4, msgs[1]->size());
+    
+    // The sequence header at the timestamp of keyframe, 1000 is 0x0003e8.
+    EXPECT_EQ(9, msgs[2]->head[0]);
+    EXPECT_EQ(0x00, (uint8_t)msgs[2]->head[4]);
+    EXPECT_EQ(0x03, (uint8_t)msgs[2]->head[5]);
+    EXPECT_EQ(0xe8, (uint8_t)msgs[2]->head[6]);
+    EXPECT_EQ(8, msgs[3]->head[0]);
+    
+    // The keyframe shares the payload of message, with tag header and previous tag size.
+    SrsPipelineChunk* chunk = msgs[4];
+    EXPECT_TRUE(chunk->join);
+    EXPECT_EQ(kmsg->payload, chunk->body->payload);
+    EXPECT_EQ(11 + (int)sizeof(key) + 4, chunk->size());
+    EXPECT_EQ(11 + (int)sizeof(key), (uint8_t)chunk->tail[3]);
+    
+    iovec iovs[SRS_PIPELINE_CHUNK_IOVS];
+    EXPECT_EQ(3, chunk->to_iovs(iovs));
+    EXPECT_EQ(kmsg->payload, iovs[1].iov_base);
+    EXPECT_EQ(sizeof(key), iovs[1].iov_len);
+    
+    EXPECT_FALSE(msgs[5]->join);
+    EXPECT_EQ(amsg->payload, msgs[5]->body->payload);
+    _mock_free_chunks(msgs);
+    
+    // The paced viewer fetches in the quota, the chunk exceeds it is still fetched.
+    if (true) {
+        SrsPipelineViewer paced;
+        flv->attach(&paced);
+        
+        HELPER_EXPECT_SUCCESS(flv->fetch(&paced, msgs, 128, 1));
+        EXPECT_EQ(4, (int)msgs.size());
+        _mock_free_chunks(msgs);
+        
+        HELPER_EXPECT_SUCCESS(flv->fetch(&paced, msgs, 128, 0));
+        EXPECT_EQ(0, (int)msgs.size());
+        
+        HELPER_EXPECT_SUCCESS(flv->fetch(&paced, msgs, 128, 1));
+        ASSERT_EQ(1, (int)msgs.size());
+        EXPECT_EQ(kmsg->payload, msgs[0]->body->payload);
+        _mock_free_chunks(msgs);
+        
+        HELPER_EXPECT_SUCCESS(flv->fetch(&paced, msgs, 128));
+        ASSERT_EQ(1, (int)msgs.size());
+        EXPECT_EQ(amsg->payload, msgs[0]->body->payload);
+        _mock_free_chunks(msgs);
+        
+        flv->detach(&paced);
+    }
+    
+    // The ADTS header and the raw AAC frame in payload of message.
+    HELPER_EXPECT_SUCCESS(aacs->fetch(&listener, msgs, 128));
+    ASSERT_EQ(1, (int)msgs.size());
+    
+    chunk = msgs[0];
+    EXPECT_EQ(7 + 4, chunk->size());
+    EXPECT_EQ(0xff, (uint8_t)chunk->head[0]);
+    EXPECT_EQ(0xf0, (uint8_t)chunk->head[1] & 0xf0);
+    EXPECT_EQ(2, chunk->to_iovs(iovs));
+    EXPECT_EQ(amsg->payload + 2, iovs[1].iov_base);
+    _mock_free_chunks(msgs);
+    
+    flv->detach(&viewer);
+    aacs->detach(&listener);
+}
+
+VOID TEST(AppStatisticTest, HotStreams)
+{
+    srs_error_t err;
+    
+    SrsStatistic* stat = SrsStatistic::instance();
+    
+    SrsRequest reqs[3];
+    for (int i = 0; i < 3; i++) {
+        reqs[i].vhost = "hot.utest.com";
+        reqs[i].app = "live";
+        reqs[i].stream = "s" + srs_int2str(i);
+    }
+    
+    // The stream s0 is played 3 times, s1 2 times, and s2 once.
+    int id = 0x7f0000;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3 - i; j++) {
+            HELPER_EXPECT_SUCCESS(stat->on_client(id, &reqs[i], NULL, SrsRtmpConnPlay));
+            stat->on_disconnect(id++);
+        }
+    }
+    
+    EXPECT_TRUE(stat->is_hot(&reqs[0], 1, 10 * SRS_UTIME_SECONDS));
+    EXPECT_FALSE(stat->is_hot(&reqs[1], 1, 10 * SRS_UTIME_SECONDS));
+    EXPECT_TRUE(stat->is_hot(&reqs[1], 2, 10 * SRS_UTIME_SECONDS));
+    EXPECT_FALSE(stat->is_hot(&reqs[2], 2, 10 * SRS_UTIME_SECONDS));
+    EXPECT_TRUE(stat->is_hot(&reqs[2], 3, 10 * SRS_UTIME_SECONDS));
+    EXPECT_FALSE(stat->is_hot(&reqs[0], 0, 10 * SRS_UTIME_SECONDS));
+    
+    // The publisher is not a play.
+    SrsRequest req;
+    req.vhost = "hot.utest.com";
+    req.app = "live";
+    req.stream = "s3";
+    HELPER_EXPECT_SUCCESS(stat->on_client(id, &req, NULL, SrsRtmpConnFMLEPublish));
+    stat->on_disconnect(id++);
+    EXPECT_FALSE(stat->is_hot(&req, 3, 10 * SRS_UTIME_SECONDS));
+}
+
+VOID TEST(AppMwSchedulerTest, AdaptiveBatch)
+{
+    EXPECT_EQ(SrsMwLatencyLow, srs_mw_latency_parse("low"));
+    EXPECT_EQ(SrsMwLatencyBulk, srs_mw_latency_parse("bulk"));
+    EXPECT_EQ(SrsMwLatencyNormal, srs_mw_latency_parse("any"));
+    
+    // Without measurement, use the middle of range.
+    if (true) {
+        SrsMwScheduler mw;
+        mw.schedule(false, 350 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(225 * SRS_UTIME_MILLISECONDS, mw.duration());
+        EXPECT_EQ(SRS_PERF_MW_MIN_MSGS, mw.min_msgs());
+        
+        mw.schedule(true, 350 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(50 * SRS_UTIME_MILLISECONDS, mw.duration());
+        EXPECT_EQ(0, mw.min_msgs());
+        
+        mw.set_latency(SrsMwLatencyBulk);
+        mw.schedule(false, 350 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(675 * SRS_UTIME_MILLISECONDS, mw.duration());
+    }
+    
+    // The socket drains fast, use small batch; drains slow, use large batch.
+    if (true) {
+        SrsMwScheduler mw;
+        
+        // 1Mbps stream, 40 msgs per second, the socket blocks for 2ms to write it.
+        mw.on_send(40, 125000, SRS_UTIME_SECONDS, 2 * SRS_UTIME_MILLISECONDS);
+        mw.schedule(false, 350 * SRS_UTIME_MILLISECONDS);
+        EXPECT_LE(100 * SRS_UTIME_MILLISECONDS, mw.duration());
+        EXPECT_GT(101 * SRS_UTIME_MILLISECONDS, mw.duration());
+        
+        // The socket blocks for 1s to write 1s stream.
+        SrsMwScheduler slow;
+        slow.on_send(40, 125000, SRS_UTIME_SECONDS, SRS_UTIME_SECONDS);
+        slow.schedule(false, 350 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(350 * SRS_UTIME_MILLISECONDS, slow.duration());
+        
+        SrsJsonObject* obj = SrsJsonAny::object();
+        SrsAutoFree(SrsJsonObject, obj);
+        slow.dumps(obj);
+        EXPECT_EQ(1000, obj->get_property("bitrate")->to_integer());
+        EXPECT_EQ(40, obj->get_property("batch_msgs")->to_integer());
+    }
+    
+    // The socket never blocks, the write takes some microseconds, which is not the drain rate.
+    if (true) {
+        SrsMwScheduler mw;
+        for (int i = 0; i < 10; i++) {
+            mw.on_send(40, 125000, SRS_UTIME_SECONDS, 30);
+            mw.on_send(40, 125000, SRS_UTIME_SECONDS, SRS_UTIME_MILLISECONDS);
+        }
+        mw.schedule(false, 350 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(0, mw.drain);
+        EXPECT_EQ(225 * SRS_UTIME_MILLISECONDS, mw.duration());
+    }
+    
+    // The batch is limited by the max messages of writev.
+    if (true) {
+        SrsMwScheduler mw;
+        mw.set_latency(SrsMwLatencyBulk);
+        mw.on_send(1000, 125000, SRS_UTIME_SECONDS, SRS_UTIME_SECONDS);
+        mw.schedule(false, 100 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(SRS_PERF_MW_MSGS * SRS_UTIME_SECONDS / 1000, mw.duration());
+    }
+}
+
+VOID TEST(AppPacingTest, TokenBucket)
+{
+    // Unlimited.
+    if (true) {
+        SrsTokenBucket b;
+        EXPECT_FALSE(b.enabled());
+        b.consume(1000);
+        EXPECT_EQ(0, b.delay());
+    }
+    
+    // The 8kbps is 1000Bps, the burst of 1s is allowed.
+    if (true) {
+        SrsTokenBucket b;
+        b.set_rate(8, SRS_UTIME_SECONDS);
+        EXPECT_TRUE(b.enabled());
+        EXPECT_EQ(1000, b.available());
+        EXPECT_EQ(0, b.delay());
+        
+        // The debt of 2000 bytes, wait about 2s.
+        b.consume(3000);
+        EXPECT_GE(0, b.available());
+        EXPECT_LT(1900 * SRS_UTIME_MILLISECONDS, b.delay());
+        EXPECT_GE(2001 * SRS_UTIME_MILLISECONDS, b.delay());
+    }
+}
+
+VOID TEST(AppPacingTest, DumpQueueInBytes)
+{
+    srs_error_t err;
+    
+    SrsMessageQueue q;
+    q.set_queue_size(10 * SRS_UTIME_SECONDS);
+    
+    for (int i = 0; i < 10; i++) {
+        SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+        HELPER_ASSERT_SUCCESS(msg->create(NULL, new char[100], 100));
+        msg->timestamp = i * 10;
+        HELPER_ASSERT_SUCCESS(q.enqueue(msg));
+    }
+    
+    SrsSharedPtrMessage* msgs[10];
+    
+    // The last message maybe exceed the bytes.
+    int count = 0;
+    HELPER_ASSERT_SUCCESS(q.dump_packets(10, msgs, count, 250));
+    EXPECT_EQ(3, count);
+    EXPECT_EQ(7, q.size());
+    for (int i = 0; i < count; i++) {
+        srs_freep(msgs[i]);
+    }
+    
+    // Unlimited bytes.
+    HELPER_ASSERT_SUCCESS(q.dump_packets(10, msgs, count));
+    EXPECT_EQ(7, count);
+    EXPECT_EQ(0, q.size());
+    for (int i = 0; i < count; i++) {
+        srs_freep(msgs[i]);
+    }
+}
+
+VOID TEST(AppDropPolicyTest, QueueDropFrames)
+{
+    srs_error_t err;
+    
+    EXPECT_EQ(SrsDropPolicyGop, srs_drop_policy_parse("gop"));
+    EXPECT_EQ(SrsDropPolicyFrame, srs_drop_policy_parse("frame"));
+    
+    SrsDropStat stat;
+    SrsMessageQueue q(true);
+    q.set_queue_size(1 * SRS_UTIME_SECONDS);
+    q.set_drop_policy(SrsDropPolicyFrame, &stat);
+    
+    uint8_t key[] = {0x17, 0x01};
+    uint8_t inter[] = {0x27, 0x01};
+    uint8_t audio[] = {0xaf, 0x01};
+    
+    // The video with GOP 1s, where the odd frames are disposable, and audio interleaved.
+    int ts = 0;
+    for (; ts < 2000; ts += 40) {
+        bool keyframe = (ts % 1000) == 0;
+        SrsSharedPtrMessage* v = _mock_create_av(RTMP_MSG_VideoMessage, ts, keyframe? key : inter, 2);
+        v->set_disposable(!keyframe && (ts / 40) % 2 == 1);
+        HELPER_ASSERT_SUCCESS(q.enqueue(v));
+        HELPER_ASSERT_SUCCESS(q.enqueue(_mock_create_av(RTMP_MSG_AudioMessage, ts, audio, 2)));
+    }
+    
+    // The disposable frames are dropped when exceed 0.5s, and video before keyframe when exceed 1s.
+    EXPECT_EQ(0, stat.all);
+    EXPECT_LT(0, stat.disposable);
+    EXPECT_LT(0, stat.video);
+    
+    // All audio is kept, and the video starts from keyframe.
+    SrsSharedPtrMessage* msgs[256];
+    int count = 0;
+    HELPER_ASSERT_SUCCESS(q.dump_packets(256, msgs, count));
+    
+    int nn_audio = 0;
+    SrsSharedPtrMessage* first_video = NULL;
+    for (int i = 0; i < count; i++) {
+        if (msgs[i]->is_audio()) {
+            nn_audio++;
+        } else if (!first_video) {
+            first_video = msgs[i];
+        }
+    }
+    EXPECT_EQ(50, nn_audio);
+    ASSERT_TRUE(first_video != NULL);
+    EXPECT_EQ(1000, first_video->timestamp);
+    EXPECT_EQ(100 - stat.disposable - stat.video, count);
+    
+    for (int i = 0; i < count; i++) {
+        srs_freep(msgs[i]);
+    }
+    
+    // Drop all messages when exceed twice of queue size.
+    SrsMessageQueue q2(true);
+    q2.set_queue_size(1 * SRS_UTIME_SECONDS);
+    q2.set_drop_policy(SrsDropPolicyFrame, &stat);
+    for (ts = 0; ts <= 2100; ts += 40) {
+        HELPER_ASSERT_SUCCESS(q2.enqueue(_mock_create_av(RTMP_MSG_AudioMessage, ts, audio, 2)));
+    }
+    EXPECT_LT(0, stat.all);
+    
+    // The start time moves to the keyframe after the video before it is dropped.
+    SrsDropStat stat3;
+    SrsMessageQueue q3(true);
+    q3.set_queue_size(1 * SRS_UTIME_SECONDS);
+    q3.set_drop_policy(SrsDropPolicyFrame, &stat3);
+    for (ts = 0; ts <= 1040; ts += 40) {
+        bool keyframe = (ts % 1000) == 0;
+        HELPER_ASSERT_SUCCESS(q3.enqueue(_mock_create_av(RTMP_MSG_VideoMessage, ts, keyframe? key : inter, 2)));
+    }
+    EXPECT_EQ(25, stat3.video);
+    EXPECT_EQ(2, q3.size());
+    EXPECT_EQ(40 * SRS_UTIME_MILLISECONDS, q3.duration());
+    
+    // The video is not dropped again, until next keyframe.
+    for (ts = 1080; ts < 2000; ts += 40) {
+        HELPER_ASSERT_SUCCESS(q3.enqueue(_mock_create_av(RTMP_MSG_VideoMessage, ts, inter, 2)));
+    }
+    EXPECT_EQ(25, stat3.video);
+    EXPECT_EQ(25, q3.size());
+    
+    // The disposable frames queued before exceed are also dropped.
+    SrsDropStat stat4;
+    SrsMessageQueue q4(true);
+    q4.set_queue_size(1 * SRS_UTIME_SECONDS);
+    q4.set_drop_policy(SrsDropPolicyFrame, &stat4);
+    for (ts = 0; ts <= 520; ts += 40) {
+        SrsSharedPtrMessage* v = _mock_create_av(RTMP_MSG_VideoMessage, ts, ts? inter : key, 2);
+        v->set_disposable(ts == 40 || ts == 520);
+        HELPER_ASSERT_SUCCESS(q4.enqueue(v));
+    }
+    EXPECT_EQ(2, stat4.disposable);
+    EXPECT_EQ(12, q4.size());
+}
+
+// The source subscribes to the global config, which is NULL in utest.
+class MockSrsConfigScope
+{
+private:
+    SrsConfig conf;
+    SrsConfig* previous;
+public:
+    MockSrsConfigScope() {
+        previous = _srs_config;
+        _srs_config = &conf;
+    }
+    virtual ~MockSrsConfigScope() {
+        _srs_config = previous;
+    }
+};
+
+VOID TEST(AppGopCacheTest, FastJoin)
+{
+    srs_error_t err;
+    
+    uint8_t key[] = {0x17, 0x01};
+    uint8_t inter[] = {0x27, 0x01};
+    uint8_t audio[] = {0xaf, 0x01};
+    
+    // The GOP of 1s, where the odd frames are disposable.
+    SrsGopCache cache;
+    for (int ts = 0; ts < 1000; ts += 40) {
+        bool keyframe = (ts == 0);
+        SrsSharedPtrMessage* v = _mock_create_av(RTMP_MSG_VideoMessage, ts, keyframe? key : inter, 2);
+        SrsAutoFree(SrsSharedPtrMessage, v);
+        v->set_disposable(!keyframe && (ts / 40) % 2 == 1);
+        HELPER_ASSERT_SUCCESS(cache.cache(v));
+        
+        SrsSharedPtrMessage* a = _mock_create_av(RTMP_MSG_AudioMessage, ts, audio, 2);
+        SrsAutoFree(SrsSharedPtrMessage, a);
+        HELPER_ASSERT_SUCCESS(cache.cache(a));
+    }
+    
+    MockSrsConfigScope scope;
+    SrsSource source;
+    SrsMessageArray msgs(256);
+    
+    // Dump the whole gop.
+    if (true) {
+        SrsConsumer consumer(&source, NULL);
+        consumer.set_queue_size(10 * SRS_UTIME_SECONDS);
+        HELPER_ASSERT_SUCCESS(cache.dump(&consumer, false, SrsRtmpJitterAlgorithmOFF));
+        
+        int count = 0;
+        HELPER_ASSERT_SUCCESS(consumer.dump_packets(&msgs, count));
+        EXPECT_EQ(50, count);
+        for (int i = 0; i < count; i++) {
+            srs_freep(msgs.msgs[i]);
+        }
+    }
+    
+    // Start from the keyframe instantly, only the referenced frames and the last frames are dumped.
+    if (true) {
+        cache.set_fast_join(true, 0, true);
+        
+        SrsConsumer consumer(&source, NULL);
+        consumer.set_queue_size(10 * SRS_UTIME_SECONDS);
+        HELPER_ASSERT_SUCCESS(cache.dump(&consumer, false, SrsRtmpJitterAlgorithmOFF));
+        
+        int count = 0;
+        HELPER_ASSERT_SUCCESS(consumer.dump_packets(&msgs, count));
+        
+        // The 12 referenced video before 960ms, then the last video and audio.
+        EXPECT_EQ(14, count);
+        EXPECT_TRUE(msgs.msgs[0]->is_video());
+        EXPECT_EQ(960 - 12, msgs.msgs[0]->timestamp);
+        EXPECT_EQ(959, msgs.msgs[11]->timestamp);
+        EXPECT_EQ(960, msgs.msgs[12]->timestamp);
+        EXPECT_EQ(960, msgs.msgs[13]->timestamp);
+        for (int i = 0; i < count; i++) {
+            srs_freep(msgs.msgs[i]);
+        }
+    }
+    
+    // Keep the last 200ms, without acceleration.
+    if (true) {
+        cache.set_fast_join(true, 200 * SRS_UTIME_MILLISECONDS, false);
+        
+        SrsConsumer consumer(&source, NULL);
+        consumer.set_queue_size(10 * SRS_UTIME_SECONDS);
+        HELPER_ASSERT_SUCCESS(cache.dump(&consumer, false, SrsRtmpJitterAlgorithmOFF));
+        
+        int count = 0;
+        HELPER_ASSERT_SUCCESS(consumer.dump_packets(&msgs, count));
+        
+        // The 10 referenced video before 760ms, then 6 video and 6 audio.
+        EXPECT_EQ(22, count);
+        EXPECT_EQ(0, msgs.msgs[0]->timestamp);
+        EXPECT_EQ(760, msgs.msgs[10]->timestamp);
+        for (int i = 0; i < count; i++) {
+            srs_freep(msgs.msgs[i]);
+        }
+    }
+}
+
+
+VOID TEST(AppTimeShiftTest, ParseOffset)
+{
+    EXPECT_EQ(60 * SRS_UTIME_SECONDS, srs_time_shift_parse("-60s"));
+    EXPECT_EQ(60 * SRS_UTIME_SECONDS, srs_time_shift_parse("-60"));
+    EXPECT_EQ(60 * SRS_UTIME_SECONDS, srs_time_shift_parse("60"));
+    EXPECT_EQ(1500 * SRS_UTIME_MILLISECONDS, srs_time_shift_parse("-1500ms"));
+    EXPECT_EQ(0, srs_time_shift_parse(""));
+    EXPECT_EQ(0, srs_time_shift_parse("-"));
+    EXPECT_EQ(0, srs_time_shift_parse("now"));
+}
+
+VOID TEST(AppTimeShiftTest, SeekBack)
+{
+    srs_error_t err;
+    
+    uint8_t key[] = {0x17, 0x01};
+    uint8_t inter[] = {0x27, 0x01};
+    uint8_t audio[] = {0xaf, 0x01};
+    
+    // Disabled by default.
+    SrsTimeShift shift;
+    EXPECT_FALSE(shift.enabled());
+    
+    // Keep 2s, feed 5 GOPs of 1s, from 0 to 4960ms.
+    shift.set_duration(2 * SRS_UTIME_SECONDS);
+    for (int ts = 0; ts < 5000; ts += 40) {
+        SrsSharedPtrMessage* v = _mock_create_av(RTMP_MSG_VideoMessage, ts, (ts % 1000) == 0? key : inter, 2);
+        SrsAutoFree(SrsSharedPtrMessage, v);
+        HELPER_ASSERT_SUCCESS(shift.cache(v));
+        
+        SrsSharedPtrMessage* a = _mock_create_av(RTMP_MSG_AudioMessage, ts, audio, 2);
+        SrsAutoFree(SrsSharedPtrMessage, a);
+        HELPER_ASSERT_SUCCESS(shift.cache(a));
+    }
+    
+    // The buffer starts at the keyframe of 2000ms, for the 3000ms is after the deadline 2960ms.
+    EXPECT_EQ(2960 * SRS_UTIME_MILLISECONDS, shift.buffered());
+    EXPECT_EQ(150, shift.size());
+    
+    MockSrsConfigScope scope;
+    SrsSource source;
+    SrsMessageArray msgs(256);
+    
+    // Start at the keyframe before the offset.
+    if (true) {
+        SrsConsumer consumer(&source, NULL);
+        consumer.set_queue_size(10 * SRS_UTIME_SECONDS);
+        
+        int nb_msgs = 0;
+        HELPER_ASSERT_SUCCESS(shift.dump(&consumer, 1500 * SRS_UTIME_MILLISECONDS, false, SrsRtmpJitterAlgorithmOFF, nb_msgs));
+        EXPECT_EQ(100, nb_msgs);
+        
+        int count = 0;
+        HELPER_ASSERT_SUCCESS(consumer.dump_packets(&msgs, count));
+        EXPECT_EQ(100, count);
+        EXPECT_TRUE(msgs.msgs[0]->is_video());
+        EXPECT_EQ(3000, msgs.msgs[0]->timestamp);
+        for (int i = 0; i < count; i++) {
+            srs_freep(msgs.msgs[i]);
+        }
+    }
+    
+    // Start at the first keyframe, when the offset exceeds the buffer.
+    if (true) {
+        SrsConsumer consumer(&source, NULL);
+        consumer.set_queue_size(10 * SRS_UTIME_SECONDS);
+        
+        int nb_msgs = 0;
+        HELPER_ASSERT_SUCCESS(shift.dump(&consumer, 60 * SRS_UTIME_SECONDS, false, SrsRtmpJitterAlgorithmOFF, nb_msgs));
+        EXPECT_EQ(150, nb_msgs);
+        
+        int count = 0;
+        HELPER_ASSERT_SUCCESS(consumer.dump_packets(&msgs, count));
+        EXPECT_EQ(150, count);
+        EXPECT_EQ(2000, msgs.msgs[0]->timestamp);
+        for (int i = 0; i < count; i++) {
+            srs_freep(msgs.msgs[i]);
+        }
+    }
+    
+    // Reset when timestamp jumps back.
+    if (true) {
+        SrsSharedPtrMessage* v = _mock_create_av(RTMP_MSG_VideoMessage, 0, key, 2);
+        SrsAutoFree(SrsSharedPtrMessage, v);
+        HELPER_ASSERT_SUCCESS(shift.cache(v));
+        EXPECT_EQ(1, shift.size());
+    }
+    
+    // Disable to clear the buffer.
+    shift.set_duration(0);
+    EXPECT_EQ(0, shift.size());
+}
+
+class MockSrsSourceHandler : public ISrsSourceHandler
+{
+public:
+    MockSrsSourceHandler() {
+    }
+    virtual ~MockSrsSourceHandler() {
+    }
+public:
+    virtual srs_error_t on_publish(SrsSource* /*s*/, SrsRequest* /*r*/) {
+        return srs_success;
+    }
+    virtual void on_unpublish(SrsSource* /*s*/, SrsRequest* /*r*/) {
+    }
+};
+
+VOID TEST(AppTimeShiftTest, BacklogLongerThanQueue)
+{
+    srs_error_t err;
+    
+    uint8_t key[] = {0x17, 0x01};
+    uint8_t inter[] = {0x27, 0x01};
+    uint8_t audio[] = {0xaf, 0x01};
+    
+    MockSrsConfig conf;
+    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost __defaultVhost__ { play { queue_length 2; time_shift 10; time_jitter off; } }"));
+    SrsConfig* previous = _srs_config;
+    _srs_config = &conf;
+    
+    if (true) {
+        SrsRequest req;
+        req.vhost = "__defaultVhost__";
+        req.app = "live";
+        req.stream = "livestream";
+        
+        MockSrsSourceHandler handler;
+        SrsSource source;
+        HELPER_ASSERT_SUCCESS(source.initialize(&req, &handler));
+        source.hub->is_active = true;
+        
+        // The 10s history in time-shift buffer, GOP of 1s, video and audio of 40ms.
+        int ts = 0;
+        for (; ts < 10000; ts += 40) {
+            SrsSharedPtrMessage* v = _mock_create_av(RTMP_MSG_VideoMessage, ts, (ts % 1000) == 0? key : inter, 2);
+            SrsAutoFree(SrsSharedPtrMessage, v);
+            HELPER_ASSERT_SUCCESS(source.time_shift->cache(v));
+            
+            SrsSharedPtrMessage* a = _mock_create_av(RTMP_MSG_AudioMessage, ts, audio, 2);
+            SrsAutoFree(SrsSharedPtrMessage, a);
+            HELPER_ASSERT_SUCCESS(source.time_shift->cache(a));
+        }
+        
+        // Start at 6s before live, which is longer than the queue length 2s.
+        SrsConsumer* consumer = NULL;
+        HELPER_ASSERT_SUCCESS(source.create_consumer(NULL, consumer, true, true, true, 6 * SRS_UTIME_SECONDS));
+        SrsAutoFree(SrsConsumer, consumer);
+        
+        // The player consumes the backlog in realtime, while the live messages arrive.
+        SrsMessageArray msgs(8);
+        int64_t last_timestamp = -1;
+        int nb_consumed = 0;
+        for (; ts < 20000; ts += 40) {
+            SrsSharedPtrMessage* v = _mock_create_av(RTMP_MSG_VideoMessage, ts, (ts % 1000) == 0? key : inter, 2);
+            SrsAutoFree(SrsSharedPtrMessage, v);
+            HELPER_ASSERT_SUCCESS(source.copy_to_consumers(v));
+            
+            SrsSharedPtrMessage* a = _mock_create_av(RTMP_MSG_AudioMessage, ts, audio, 2);
+            SrsAutoFree(SrsSharedPtrMessage, a);
+            HELPER_ASSERT_SUCCESS(source.copy_to_consumers(a));
+            
+            // Reload in the middle, the queue still holds the offset of time-shift.
+            if (ts == 15000) {
+                HELPER_ASSERT_SUCCESS(source.on_reload_vhost_play(req.vhost));
+                EXPECT_EQ(8 * SRS_UTIME_SECONDS, consumer->queue->max_queue_size);
+            }
+            
+            int count = 2;
+            HELPER_ASSERT_SUCCESS(consumer->dump_packets(&msgs, count));
+            for (int i = 0; i < count; i++) {
+                // The timestamp never jumps, that is, the consumer never skips to live.
+                if (last_timestamp >= 0) {
+                    EXPECT_LE(msgs.msgs[i]->timestamp - last_timestamp, 40);
+                }
+                last_timestamp = msgs.msgs[i]->timestamp;
+                srs_freep(msgs.msgs[i]);
+            }
+            nb_consumed += count;
+        }
+        
+        // Drain the consumer, all the backlog and live messages are consumed.
+        for (int count = 1; count > 0;) {
+            count = 0;
+            HELPER_ASSERT_SUCCESS(consumer->dump_packets(&msgs, count));
+            for (int i = 0; i < count; i++) {
+                EXPECT_LE(msgs.msgs[i]->timestamp - last_timestamp, 40);
+                last_timestamp = msgs.msgs[i]->timestamp;
+                srs_freep(msgs.msgs[i]);
+            }
+            nb_consumed += count;
+        }
+        
+        EXPECT_EQ(0, consumer->dropped()->total());
+        EXPECT_EQ(19960, last_timestamp);
+        // The backlog starts at the keyframe of 3000ms, before the offset 3960ms.
+        EXPECT_EQ((20000 - 3000) / 40 * 2, nb_consumed);
+    }
+    
+    _srs_config = previous;
+}
+
+#ifdef SRS_PERF_QUEUE_SHARED_RING
+VOID TEST(AppSourceTest, RingDrainsToGop)
+{
+    srs_error_t err;
+    
+    uint8_t key[] = {0x17, 0x01};
+    uint8_t inter[] = {0x27, 0x01};
+    uint8_t audio[] = {0xaf, 0x01};
+    
+    MockSrsConfig conf;
+    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost __defaultVhost__ { play { queue_length 4; time_jitter off; } }"));
+    SrsConfig* previous = _srs_config;
+    _srs_config = &conf;
+    
+    if (true) {
+        SrsRequest req;
+        req.vhost = "__defaultVhost__";
+        req.app = "live";
+        req.stream = "livestream";
+        
+        MockSrsSourceHandler handler;
+        SrsSource source;
+        HELPER_ASSERT_SUCCESS(source.initialize(&req, &handler));
+        
+        SrsConsumer* fast = NULL;
+        HELPER_ASSERT_SUCCESS(source.create_consumer(NULL, fast, true, true, true));
+        SrsAutoFree(SrsConsumer, fast);
+        
+        SrsConsumer* slow = NULL;
+        HELPER_ASSERT_SUCCESS(source.create_consumer(NULL, slow, true, true, true));
+        SrsAutoFree(SrsConsumer, slow);
+        
+        // GOP of 1s, video and audio of 40ms, the slow consumer reads nothing in the first 3s.
+        SrsMessageArray msgs(128);
+        for (int ts = 0; ts < 10000; ts += 40) {
+            SrsSharedPtrMessage* v = _mock_create_av(RTMP_MSG_VideoMessage, ts, (ts % 1000) == 0? key : inter, 2);
+            SrsAutoFree(SrsSharedPtrMessage, v);
+            HELPER_ASSERT_SUCCESS(source.copy_to_consumers(v));
+            
+            SrsSharedPtrMessage* a = _mock_create_av(RTMP_MSG_AudioMessage, ts, audio, 2);
+            SrsAutoFree(SrsSharedPtrMessage, a);
+            HELPER_ASSERT_SUCCESS(source.copy_to_consumers(a));
+            
+            // The ring keeps the messages not read by the slow consumer.
+            if (ts == 2960) {
+                EXPECT_EQ(0, source.ring->begin());
+                EXPECT_EQ(150, source.ring->end());
+            }
+            
+            SrsConsumer* consumers[] = {fast, slow};
+            for (int i = 0; i < 2; i++) {
+                if (consumers[i] == slow && ts < 3000) {
+                    continue;
+                }
+                
+                int count = 0;
+                HELPER_ASSERT_SUCCESS(consumers[i]->dump_packets(&msgs, count));
+                for (int j = 0; j < count; j++) {
+                    srs_freep(msgs.msgs[j]);
+                }
+            }
+        }
+        
+        // All consumers are at the tail, the ring drains to the latest gop.
+        EXPECT_EQ(0, fast->dropped()->total());
+        EXPECT_EQ(0, slow->dropped()->total());
+        EXPECT_EQ(source.ring->end(), slow->ring_cursor());
+        EXPECT_EQ(source.ring->keyframe(), source.ring->begin());
+        EXPECT_EQ(50, source.ring->end() - source.ring->begin());
+    }
+    
+    _srs_config = previous;
+}
+#endif
+
+VOID TEST(AppAsyncFileTest, WriteSeek)
+{
+    srs_error_t err;
+    
+    string path = _srs_tmp_file_prefix + "async-file.flv";
+    ::unlink(path.c_str());
+    
+    // Write in the I/O thread, the seek and tell never touch the disk.
+    if (true) {
+        SrsAsyncFileWriter fw(1024);
+        HELPER_ASSERT_SUCCESS(fw.open(path));
+        EXPECT_TRUE(fw.is_open());
+        
+        HELPER_ASSERT_SUCCESS(fw.write((void*)"Hello", 5, NULL));
+        EXPECT_EQ(5, fw.tellg());
+        
+        // Exceed the chunk, submit to I/O thread and wait for the max pending bytes.
+        char buf[100 * 1024];
+        memset(buf, 'x', sizeof(buf));
+        HELPER_ASSERT_SUCCESS(fw.write(buf, sizeof(buf), NULL));
+        EXPECT_EQ(5 + (int)sizeof(buf), fw.tellg());
+        
+        // Overwrite the head, which is written in order.
+        fw.seek2(0);
+        HELPER_ASSERT_SUCCESS(fw.write((void*)"World", 5, NULL));
+        EXPECT_EQ(5, fw.tellg());
+        
+        off_t seeked = 0;
+        HELPER_ASSERT_SUCCESS(fw.lseek(-2, SEEK_END, &seeked));
+        EXPECT_EQ(3 + (int)sizeof(buf), seeked);
+        HELPER_ASSERT_SUCCESS(fw.write((void*)"!!", 2, NULL));
+        
+        fw.close();
+        EXPECT_FALSE(fw.is_open());
+    }
+    
+    // Append to the file.
+    if (true) {
+        SrsAsyncFileWriter fw(1024);
+        HELPER_ASSERT_SUCCESS(fw.open_append(path));
+        EXPECT_EQ(5 + 100 * 1024, fw.tellg());
+        HELPER_ASSERT_SUCCESS(fw.write((void*)"END", 3, NULL));
+    }
+    
+    SrsFileReader fr;
+    HELPER_ASSERT_SUCCESS(fr.open(path));
+    EXPECT_EQ(8 + 100 * 1024, fr.filesize());
+    
+    char buf[8 + 100 * 1024];
+    HELPER_ASSERT_SUCCESS(fr.read(buf, sizeof(buf), NULL));
+    EXPECT_EQ(0, memcmp(buf, "World", 5));
+    EXPECT_EQ('x', buf[5]);
+    EXPECT_EQ(0, memcmp(buf + 3 + 100 * 1024, "!!END", 5));
+    
+    fr.close();
+    ::unlink(path.c_str());
+}
+
+VOID TEST(AppHttpHooksTest, ClientPool)
+{
+    srs_error_t err;
+    
+    SrsHttpHookPool pool;
+    EXPECT_EQ(0, pool.size("127.0.0.1", 8085));
+    
+    // New client when pool is empty.
+    SrsHttpClient* hc = NULL;
+    bool reused = true;
+    HELPER_ASSERT_SUCCESS(pool.fetch("127.0.0.1", 8085, &hc, reused));
+    EXPECT_TRUE(hc != NULL);
+    EXPECT_FALSE(reused);
+    
+    // Reuse the released client, for the same server only.
+    pool.release("127.0.0.1", 8085, hc);
+    EXPECT_EQ(1, pool.size("127.0.0.1", 8085));
+    EXPECT_EQ(0, pool.size("127.0.0.1", 8086));
+    
+    SrsHttpClient* hc2 = NULL;
+    HELPER_ASSERT_SUCCESS(pool.fetch("127.0.0.1", 8085, &hc2, reused));
+    EXPECT_TRUE(hc == hc2);
+    EXPECT_TRUE(reused);
+    EXPECT_EQ(0, pool.size("127.0.0.1", 8085));
+    
+    // The idle clients are bounded, the others are freed.
+    pool.release("127.0.0.1", 8085, hc2);
+    for (int i = 0; i < 20; i++) {
+        HELPER_ASSERT_SUCCESS(pool.fetch("127.0.0.1", 8086, &hc, reused));
+        pool.release("127.0.0.1", 8085, hc);
+    }
+    EXPECT_EQ(8, pool.size("127.0.0.1", 8085));
+}
+
+// The mock hook server, which acts for each request in order, for example,
+// ok to respond, close to respond then close, or partial to close in the response.
+class MockHttpHookServer : public ISrsCoroutineHandler
+{
+public:
+    SrsSTCoroutine* trd;
+    srs_netfd_t lfd;
+    std::vector<std::string> actions;
+    int nn_requests;
+public:
+    MockHttpHookServer() {
+        trd = new SrsSTCoroutine("hooks", this);
+        lfd = NULL;
+        nn_requests = 0;
+    }
+    virtual ~MockHttpHookServer() {
+        trd->stop();
+        srs_freep(trd);
+        srs_close_stfd(lfd);
+    }
+public:
+    virtual srs_error_t start(int port) {
+        srs_error_t err = srs_success;
+        if ((err = srs_tcp_listen("127.0.0.1", port, &lfd)) != srs_success) {
+            return err;
+        }
+        return trd->start();
+    }
+    virtual srs_error_t cycle() {
+        srs_error_t err = srs_success;
+        while ((err = trd->pull()) == srs_success) {
+            srs_netfd_t cfd = srs_accept(lfd, NULL, NULL, SRS_UTIME_NO_TIMEOUT);
+            if (!cfd) {
+                continue;
+            }
+            serve(cfd);
+            srs_close_stfd(cfd);
+        }
+        return err;
+    }
+    virtual void serve(srs_netfd_t cfd) {
+        SrsStSocket skt;
+        srs_error_t err = skt.initialize(cfd);
+        
+        char buf[4096];
+        while (err == srs_success && (err = skt.read(buf, sizeof(buf), NULL)) == srs_success) {
+            std::string action = (nn_requests < (int)actions.size())? actions.at(nn_requests) : "ok";
+            nn_requests++;
+            
+            std::string res = "HTTP/1.1 200 OK\r\nContent-Length: 1\r\n\r\n0";
+            if (action == "partial") {
+                res = "HTTP/1.1 200 OK\r\n";
+            }
+            if ((err = skt.write((void*)res.data(), res.length(), NULL)) != srs_success || action != "ok") {
+                break;
+            }
+        }
+        srs_freep(err);
+    }
+};
+
+VOID TEST(AppHttpHooksTest, RetryIdleClient)
+{
+    srs_error_t err;
+    
+    MockHttpHookServer server;
+    server.actions.push_back("close");
+    server.actions.push_back("ok");
+    server.actions.push_back("partial");
+    HELPER_ASSERT_SUCCESS(server.start(18085));
+    
+    string url = "http://127.0.0.1:18085/api/v1/streams";
+    int code = 0;
+    string res;
+    
+    // The client is released to pool after responded.
+    HELPER_ASSERT_SUCCESS(SrsHttpHooks::do_post(url, "{}", code, res));
+    EXPECT_EQ(200, code);
+    EXPECT_EQ(1, server.nn_requests);
+    
+    // The idle client is closed by server, retry once with a new client.
+    res = "";
+    HELPER_ASSERT_SUCCESS(SrsHttpHooks::do_post(url, "{}", code, res));
+    EXPECT_EQ(200, code);
+    EXPECT_EQ(2, server.nn_requests);
+    
+    // Never retry when server closed after responded some bytes, for it maybe processed.
+    res = "";
+    HELPER_EXPECT_FAILED(SrsHttpHooks::do_post(url, "{}", code, res));
+    EXPECT_EQ(3, server.nn_requests);
+}
+
+VOID TEST(AppHttpHooksTest, AuthCache)
+{
+    srs_error_t err = srs_success;
+    
+    SrsHttpHookCache cache;
+    EXPECT_FALSE(cache.fetch("on_publish|livestream", &err));
+    
+    // The allowed result.
+    cache.start("on_publish|livestream");
+    cache.update("on_publish|livestream", srs_success, 3600 * SRS_UTIME_SECONDS);
+    
+    err = srs_error_new(-1, "mock");
+    EXPECT_TRUE(cache.fetch("on_publish|livestream", &err));
+    EXPECT_TRUE(err == srs_success);
+    EXPECT_FALSE(cache.fetch("on_publish|other", &err));
+    
+    // The rejected result, and copy the error for each fetch.
+    if (true) {
+        srs_error_t r0 = srs_error_new(ERROR_RESPONSE_CODE, "reject");
+        cache.start("on_play|livestream");
+        cache.update("on_play|livestream", r0, 3600 * SRS_UTIME_SECONDS);
+        srs_freep(r0);
+        
+        for (int i = 0; i < 2; i++) {
+            srs_error_t r1 = srs_success;
+            EXPECT_TRUE(cache.fetch("on_play|livestream", &r1));
+            EXPECT_EQ(ERROR_RESPONSE_CODE, srs_error_code(r1));
+            srs_freep(r1);
+        }
+    }
+    
+    // The result without TTL is never cached, for example, the error of network.
+    if (true) {
+        srs_error_t r0 = srs_error_new(ERROR_SOCKET_CONNECT, "connect");
+        cache.start("on_connect|live");
+        cache.update("on_connect|live", r0, 0);
+        srs_freep(r0);
+        
+        EXPECT_FALSE(cache.fetch("on_connect|live", &err));
+    }
+    
+    // The expired result is missed.
+    cache.start("on_publish|livestream");
+    cache.update("on_publish|livestream", srs_success, 0);
+    EXPECT_FALSE(cache.fetch("on_publish|livestream", &err));
+}
+
+VOID TEST(AppHttpHooksTest, NotifyBatch)
+{
+    srs_error_t err;
+    
+    SrsHttpHookBatch batch;
+    EXPECT_STREQ("[]", batch.dumps("http://127.0.0.1:8085/api/v1/sessions").c_str());
+    
+    HELPER_ASSERT_SUCCESS(batch.notify("http://127.0.0.1:8085/api/v1/sessions", "{\"action\":\"on_close\"}"));
+    HELPER_ASSERT_SUCCESS(batch.notify("http://127.0.0.1:8085/api/v1/dvrs", "{\"action\":\"on_dvr\"}"));
+    HELPER_ASSERT_SUCCESS(batch.notify("http://127.0.0.1:8085/api/v1/sessions", "{\"action\":\"on_stop\"}"));
+    
+    // The events of each url in a json array, removed once dumped.
+    EXPECT_STREQ("[{\"action\":\"on_close\"},{\"action\":\"on_stop\"}]", batch.dumps("http://127.0.0.1:8085/api/v1/sessions").c_str());
+    EXPECT_STREQ("[]", batch.dumps("http://127.0.0.1:8085/api/v1/sessions").c_str());
+    EXPECT_STREQ("[{\"action\":\"on_dvr\"}]", batch.dumps("http://127.0.0.1:8085/api/v1/dvrs").c_str());
+}
@@ -3642,3 +3642,29 @@ VOID TEST(ConfigMainTest, CheckVhostConfig5)
     }
 }
 
+
+VOID TEST(ConfigMainTest, CheckWorkers)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_FALSE(conf.get_workers_enabled());
+        EXPECT_EQ(0, conf.get_workers_count());
+        EXPECT_EQ(19350, conf.get_workers_relay_port());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "workers{enabled on;count 4;relay_port 29350;}"));
+        EXPECT_TRUE(conf.get_workers_enabled());
+        EXPECT_EQ(4, conf.get_workers_count());
+        EXPECT_EQ(29350, conf.get_workers_relay_port());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "workers{counts 4;}"));
+    }
+}
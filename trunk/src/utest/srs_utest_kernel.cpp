@@ -27,6 +27,7 @@ using namespace std;
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_codec.hpp>
 #include <srs_kernel_flv.hpp>
+#include <srs_kernel_pool.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_kernel_buffer.hpp>
@@ -583,6 +584,54 @@ VOID TEST(KernelFastBufferTest, Grow)
     }
 }
 
+VOID TEST(KernelFastBufferTest, SharedSlice)
+{
+    srs_error_t err;
+
+    if (true) {
+        SrsFastStream b(6);
+        MockBufferReader r("Hello, world!");
+
+        HELPER_ASSERT_SUCCESS(b.grow(&r, 5));
+        SrsSharedBlock* block = NULL;
+        char* slice = b.read_shared_slice(5, &block);
+        ASSERT_TRUE(block != NULL);
+        EXPECT_TRUE(block->shared());
+        EXPECT_EQ(0, memcmp(slice, "Hello", 5));
+
+        // The slice is referenced, so switch to a new block rather than move the left bytes.
+        HELPER_ASSERT_SUCCESS(b.grow(&r, 5));
+        EXPECT_EQ(',', b.read_1byte());
+        EXPECT_EQ(' ', b.read_1byte());
+        b.skip(3);
+        EXPECT_EQ(0, memcmp(slice, "Hello", 5));
+        EXPECT_FALSE(block->shared());
+        block->release();
+
+        // The block is not shared, move the left bytes.
+        HELPER_ASSERT_SUCCESS(b.grow(&r, 3));
+        EXPECT_EQ('l', b.read_1byte());
+        EXPECT_EQ('d', b.read_1byte());
+        EXPECT_EQ('!', b.read_1byte());
+    }
+
+    if (true) {
+        SrsFastStream b(6);
+        MockBufferReader r("Hello, world!");
+
+        HELPER_ASSERT_SUCCESS(b.grow(&r, 5));
+        SrsSharedBlock* block = NULL;
+        char* slice = b.read_shared_slice(5, &block);
+
+        // The whole buffer is copied when resize, the slice is still referenced.
+        b.set_buffer(12);
+        HELPER_ASSERT_SUCCESS(b.grow(&r, 5));
+        EXPECT_EQ(',', b.read_1byte());
+        EXPECT_EQ(0, memcmp(slice, "Hello", 5));
+        block->release();
+    }
+}
+
 /**
 * test the codec,
 * whether H.264 keyframe
@@ -3020,6 +3069,83 @@ VOID TEST(KernelLBRRTest, CoverAll)
     }
 }
 
+VOID TEST(KernelLBRRTest, ConsistentHash)
+{
+    vector<string> servers;
+    servers.push_back("s0");
+    servers.push_back("s1");
+    servers.push_back("s2");
+    
+    // The same key always selects the same server.
+    if (true) {
+        SrsLbConsistentHash lb(NULL);
+        EXPECT_EQ(-1, (int)lb.current());
+        EXPECT_TRUE("" == lb.selected());
+        
+        string s = lb.select(servers, "live/livestream");
+        EXPECT_TRUE(s == lb.selected());
+        EXPECT_TRUE(s == servers.at(lb.current()));
+        for (int i = 0; i < 10; i++) {
+            EXPECT_TRUE(s == lb.select(servers, "live/livestream"));
+        }
+    }
+    
+    // The keys are distributed to all servers, and only the keys of removed server moves.
+    if (true) {
+        SrsLbConsistentHash lb(NULL);
+        
+        std::map<string, int> counts;
+        std::map<string, string> selects;
+        for (int i = 0; i < 300; i++) {
+            string key = "live/stream" + srs_int2str(i);
+            selects[key] = lb.select(servers, key);
+            counts[selects[key]]++;
+        }
+        EXPECT_EQ(3, (int)counts.size());
+        EXPECT_GT(counts["s0"], 30);
+        EXPECT_GT(counts["s1"], 30);
+        EXPECT_GT(counts["s2"], 30);
+        
+        vector<string> servers2;
+        servers2.push_back("s0");
+        servers2.push_back("s1");
+        for (int i = 0; i < 300; i++) {
+            string key = "live/stream" + srs_int2str(i);
+            if (selects[key] != "s2") {
+                EXPECT_TRUE(selects[key] == lb.select(servers2, key));
+            }
+        }
+    }
+    
+    // The failed server is skipped, and selected again when success.
+    if (true) {
+        SrsLbHealth health;
+        SrsLbConsistentHash lb(&health);
+        
+        string s = lb.select(servers, "live/livestream");
+        EXPECT_TRUE(health.available(s));
+        
+        health.on_failure(s);
+        EXPECT_FALSE(health.available(s));
+        EXPECT_EQ(1, health.at(s)->failures);
+        
+        string s2 = lb.select(servers, "live/livestream");
+        EXPECT_TRUE(s != s2);
+        EXPECT_TRUE(s2 == lb.select(servers, "live/livestream"));
+        
+        health.on_success(s, 10 * SRS_UTIME_MILLISECONDS);
+        EXPECT_TRUE(health.available(s));
+        EXPECT_EQ(10 * SRS_UTIME_MILLISECONDS, health.at(s)->srtt);
+        EXPECT_TRUE(s == lb.select(servers, "live/livestream"));
+        
+        // Select the owner of key when all servers fail.
+        for (int i = 0; i < (int)servers.size(); i++) {
+            health.on_failure(servers.at(i));
+        }
+        EXPECT_TRUE(s == lb.select(servers, "live/livestream"));
+    }
+}
+
 VOID TEST(KernelCodecTest, CoverAll)
 {
     if (true) {
@@ -3253,6 +3379,27 @@ VOID TEST(KernelCodecTest, AVFrame)
         EXPECT_TRUE(f.has_aud == true);
     }
     
+    // The slice with nal_ref_idc 0 is disposable.
+    if (true) {
+        SrsVideoFrame f;
+        EXPECT_FALSE(f.disposable());
+        
+        HELPER_EXPECT_SUCCESS(f.add_sample((char*)"\x09", 1));
+        EXPECT_FALSE(f.disposable());
+        
+        HELPER_EXPECT_SUCCESS(f.add_sample((char*)"\x01", 1));
+        EXPECT_TRUE(f.disposable());
+        
+        HELPER_EXPECT_SUCCESS(f.add_sample((char*)"\x41", 1));
+        EXPECT_FALSE(f.disposable());
+    }
+    
+    if (true) {
+        SrsVideoFrame f;
+        HELPER_EXPECT_SUCCESS(f.add_sample((char*)"\x65", 1));
+        EXPECT_FALSE(f.disposable());
+    }
+    
     if (true) {
         SrsVideoFrame f;
         for (int i = 0; i < SrsMaxNbSamples; i++) {
@@ -3598,6 +3745,9 @@ VOID TEST(KernelCodecTest, VideoFormat)
         
         EXPECT_EQ(768, f.vcodec->width);
         EXPECT_EQ(320, f.vcodec->height);
+        EXPECT_EQ(SrsAvcProfileHigh, f.vcodec->avc_profile);
+        EXPECT_EQ(0x00, f.vcodec->avc_profile_compatibility);
+        EXPECT_EQ(SrsAvcLevel_32, f.vcodec->avc_level);
         
         HELPER_EXPECT_SUCCESS(f.on_video(0, (char*)rawIBMF, sizeof(rawIBMF)));
         EXPECT_EQ(1, f.video->nb_samples);
@@ -4086,6 +4236,165 @@ VOID TEST(KernelFLVTest, CoverSharedPtrMessage)
 	}
 }
 
+VOID TEST(KernelFLVTest, CoverSharedChunks)
+{
+	srs_error_t err;
+
+	if (true) {
+		SrsMessageHeader h;
+		h.message_type = RTMP_MSG_VideoMessage;
+		h.timestamp = 100;
+
+		SrsSharedPtrMessage m;
+		HELPER_EXPECT_SUCCESS(m.create(&h, new char[300], 300));
+
+		iovec* iovs = NULL; int nb_iovs = 0;
+		m.chunks(128, &iovs, &nb_iovs);
+		ASSERT_TRUE(iovs != NULL);
+		EXPECT_EQ(6, nb_iovs);
+		EXPECT_TRUE(iovs[0].iov_base == NULL);
+		EXPECT_EQ(0, (int)iovs[0].iov_len);
+		EXPECT_EQ(1, (int)iovs[2].iov_len);
+		EXPECT_EQ(128, (int)iovs[1].iov_len);
+		EXPECT_EQ(128, (int)iovs[3].iov_len);
+		EXPECT_EQ(44, (int)iovs[5].iov_len);
+		EXPECT_EQ(iovs[2].iov_base, iovs[4].iov_base);
+
+		// The copy with the same key share the chunks.
+		SrsSharedPtrMessage* cp = m.copy();
+		SrsAutoFree(SrsSharedPtrMessage, cp);
+
+		iovec* iovs2 = NULL; int nb_iovs2 = 0;
+		cp->chunks(128, &iovs2, &nb_iovs2);
+		EXPECT_TRUE(iovs == iovs2);
+		EXPECT_EQ(6, nb_iovs2);
+
+		// Not shared for different chunk size.
+		cp->chunks(4096, &iovs2, &nb_iovs2);
+		EXPECT_TRUE(iovs2 == NULL);
+		EXPECT_EQ(0, nb_iovs2);
+
+		// Shared for different timestamp and stream id, the c0 is written by sender.
+		cp->timestamp = 200;
+		cp->stream_id = 2;
+		cp->chunks(128, &iovs2, &nb_iovs2);
+		EXPECT_TRUE(iovs == iovs2);
+	}
+
+	if (true) {
+		SrsMessageHeader h;
+		SrsSharedPtrMessage m;
+		HELPER_EXPECT_SUCCESS(m.create(&h, NULL, 0));
+
+		iovec* iovs = NULL; int nb_iovs = 0;
+		m.chunks(128, &iovs, &nb_iovs);
+		EXPECT_TRUE(iovs == NULL);
+		EXPECT_EQ(0, nb_iovs);
+	}
+}
+
+VOID TEST(KernelPoolTest, SlabPool)
+{
+    if (true) {
+        SrsSlabPool pool(64, 4, 1024);
+        EXPECT_EQ(64, pool.capacity(1));
+        EXPECT_EQ(64, pool.capacity(64));
+        EXPECT_EQ(128, pool.capacity(65));
+        EXPECT_EQ(512, pool.capacity(512));
+        EXPECT_EQ(0, pool.capacity(513));
+        EXPECT_EQ(4, pool.classes());
+        EXPECT_EQ(512, pool.class_size(3));
+    }
+    
+    // Reuse the freed buffer.
+    if (true) {
+        SrsSlabPool pool(64, 4, 1024);
+        
+        int capacity = 0;
+        char* p = pool.alloc(100, &capacity);
+        EXPECT_EQ(128, capacity);
+        EXPECT_EQ(1, pool.allocs());
+        EXPECT_EQ(0, pool.hits());
+        
+        pool.free(p, capacity);
+        EXPECT_EQ(1, pool.frees());
+        EXPECT_EQ(1, pool.cached(1));
+        EXPECT_EQ(128, pool.cached_bytes());
+        
+        char* p2 = pool.alloc(120, &capacity);
+        EXPECT_TRUE(p == p2);
+        EXPECT_EQ(1, pool.hits());
+        EXPECT_EQ(0, pool.cached(1));
+        pool.free(p2, capacity);
+    }
+    
+    // Never pool the large buffer.
+    if (true) {
+        SrsSlabPool pool(64, 4, 1024);
+        
+        int capacity = 0;
+        char* p = pool.alloc(1000, &capacity);
+        EXPECT_EQ(0, capacity);
+        EXPECT_EQ(1, pool.large_allocs());
+        EXPECT_EQ(0, pool.allocs());
+        
+        pool.free(p, capacity);
+        EXPECT_EQ(0, pool.frees());
+        EXPECT_EQ(0, pool.cached_bytes());
+    }
+    
+    // Drop the buffer when cache is full.
+    if (true) {
+        SrsSlabPool pool(64, 4, 1024);
+        
+        int capacity = 0;
+        char* p0 = pool.alloc(512, &capacity);
+        char* p1 = pool.alloc(512, &capacity);
+        char* p2 = pool.alloc(512, &capacity);
+        
+        pool.free(p0, capacity);
+        pool.free(p1, capacity);
+        pool.free(p2, capacity);
+        EXPECT_EQ(3, pool.frees());
+        EXPECT_EQ(1, pool.drops());
+        EXPECT_EQ(2, pool.cached(3));
+        
+        pool.clear();
+        EXPECT_EQ(0, pool.cached(3));
+    }
+}
+
+VOID TEST(KernelPoolTest, MessagePayload)
+{
+    srs_error_t err;
+    
+    // The pooled payload is transfered to shared ptr message.
+    if (true) {
+        SrsCommonMessage* msg = new SrsCommonMessage();
+        SrsAutoFree(SrsCommonMessage, msg);
+        
+        msg->header.message_type = RTMP_MSG_VideoMessage;
+        msg->create_payload(100);
+        msg->size = 100;
+        char* payload = msg->payload;
+        
+        SrsSharedPtrMessage m;
+        HELPER_EXPECT_SUCCESS(m.create(msg));
+        EXPECT_TRUE(payload == m.payload);
+        EXPECT_TRUE(msg->payload == NULL);
+    }
+    
+    // The payload is reused.
+    if (true) {
+        SrsCommonMessage msg;
+        msg.create_payload(100);
+        char* payload = msg.payload;
+        
+        msg.create_payload(110);
+        EXPECT_TRUE(payload == msg.payload);
+    }
+}
+
 VOID TEST(KernelLogTest, CoverAll)
 {
 	srs_error_t err;
@@ -4678,6 +4987,88 @@ VOID TEST(KernelTSTest, CoverContextEncode)
     }
 }
 
+// The reference encoder of PES, which encode each ts packet by SrsTsPacket.
+srs_error_t _mock_encode_pes(SrsTsContext* ctx, ISrsStreamWriter* writer, SrsTsMessage* msg, int16_t pid, uint8_t& cc)
+{
+    srs_error_t err = srs_success;
+    
+    char* start = msg->payload->bytes();
+    char* end = start + msg->payload->length();
+    char* p = start;
+    
+    while (p < end) {
+        SrsTsPacket* pkt = NULL;
+        if (p == start) {
+            pkt = SrsTsPacket::create_pes_first(ctx, pid, msg->sid, cc++, msg->is_discontinuity,
+                msg->write_pcr? msg->dts : -1, msg->dts, msg->pts, msg->payload->length());
+        } else {
+            pkt = SrsTsPacket::create_pes_continue(ctx, pid, msg->sid, cc++);
+        }
+        SrsAutoFree(SrsTsPacket, pkt);
+        
+        char buf[SRS_TS_PACKET_SIZE];
+        int nb_buf = pkt->size();
+        int left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - nb_buf);
+        int nb_stuffings = SRS_TS_PACKET_SIZE - nb_buf - left;
+        if (nb_stuffings > 0) {
+            memset(buf, 0xFF, SRS_TS_PACKET_SIZE);
+            pkt->padding(nb_stuffings);
+            nb_buf = pkt->size();
+            left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - nb_buf);
+        }
+        memcpy(buf + nb_buf, p, left);
+        p += left;
+        
+        SrsBuffer stream(buf, nb_buf);
+        if ((err = pkt->encode(&stream)) != srs_success) {
+            return err;
+        }
+        if ((err = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != srs_success) {
+            return err;
+        }
+    }
+    
+    return err;
+}
+
+VOID TEST(KernelTSTest, EncodePESPackets)
+{
+    srs_error_t err;
+    
+    int sizes[] = {1, 100, 150, 160, 170, 183, 184, 185, 350, 365, 366, 367, 368, 1000, 5000, 65536};
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(int)); i++) {
+        for (int pcr = 0; pcr < 2; pcr++) {
+            SrsTsContext ctx;
+            MockSrsFileWriter f;
+            HELPER_EXPECT_SUCCESS(ctx.encode_pat_pmt(&f, 0x100, SrsTsStreamVideoH264, 0x101, SrsTsStreamAudioAAC));
+            int64_t pos = f.tellg();
+            
+            SrsTsMessage m;
+            m.sid = SrsTsPESStreamIdVideoCommon;
+            m.write_pcr = pcr;
+            m.dts = m.pts = 90 * 1000;
+            for (int j = 0; j < sizes[i]; j++) {
+                char v = (char)j;
+                m.payload->append(&v, 1);
+            }
+            
+            // Write twice, to check the continuity counter.
+            HELPER_EXPECT_SUCCESS(ctx.encode_pes(&f, &m, 0x100, SrsTsStreamVideoH264, false));
+            HELPER_EXPECT_SUCCESS(ctx.encode_pes(&f, &m, 0x100, SrsTsStreamVideoH264, false));
+            
+            SrsTsContext rctx;
+            MockSrsFileWriter rf;
+            uint8_t cc = 0;
+            HELPER_EXPECT_SUCCESS(_mock_encode_pes(&rctx, &rf, &m, 0x100, cc));
+            HELPER_EXPECT_SUCCESS(_mock_encode_pes(&rctx, &rf, &m, 0x100, cc));
+            
+            ASSERT_EQ(rf.filesize(), f.filesize() - pos);
+            EXPECT_TRUE(0 == (rf.filesize() % SRS_TS_PACKET_SIZE));
+            EXPECT_TRUE(0 == memcmp(rf.data(), f.data() + pos, rf.filesize()));
+        }
+    }
+}
+
 VOID TEST(KernelTSTest, CoverContextDecode)
 {
 	srs_error_t err;
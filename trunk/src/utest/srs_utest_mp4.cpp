@@ -1837,3 +1837,137 @@ VOID TEST(KernelMp4Test, SrsMp4M2tsInitEncoder)
     }
 }
 
+
+// Write 3s video at 25fps with keyframe every 1s, and audio at 50fps, in fragments of 1s.
+srs_error_t mock_write_fragments(SrsMp4FragmentEncoder* enc)
+{
+    srs_error_t err = srs_success;
+
+    SrsFormat fmt;
+    if ((err = fmt.initialize()) != srs_success) {
+        return err;
+    }
+
+    uint8_t vsh[] = {
+        0x17,
+        0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20,
+        0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00,
+        0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+    };
+    if ((err = fmt.on_video(0, (char*)vsh, sizeof(vsh))) != srs_success) {
+        return err;
+    }
+    if ((err = enc->write_sample(&fmt, SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeKeyFrame, SrsVideoAvcFrameTraitSequenceHeader,
+        0, 0, (uint8_t*)fmt.raw, (uint32_t)fmt.nb_raw)) != srs_success) {
+        return err;
+    }
+
+    uint8_t ash[] = {0xaf, 0x00, 0x12, 0x10};
+    if ((err = fmt.on_audio(0, (char*)ash, sizeof(ash))) != srs_success) {
+        return err;
+    }
+    if ((err = enc->write_sample(&fmt, SrsMp4HandlerTypeSOUN, 0, SrsAudioAacFrameTraitSequenceHeader,
+        0, 0, (uint8_t*)fmt.raw, (uint32_t)fmt.nb_raw)) != srs_success) {
+        return err;
+    }
+
+    uint8_t sample[16];
+    for (int i = 0; i < 150; i++) {
+        uint32_t dts = i * 20;
+        memset(sample, i, sizeof(sample));
+
+        if ((i % 2) == 0) {
+            uint16_t ft = (i % 50) == 0 ? SrsVideoAvcFrameTypeKeyFrame : SrsVideoAvcFrameTypeInterFrame;
+            if ((err = enc->write_sample(&fmt, SrsMp4HandlerTypeVIDE, ft, SrsVideoAvcFrameTraitNALU,
+                dts, dts + 40, sample, sizeof(sample))) != srs_success) {
+                return err;
+            }
+        }
+
+        if ((err = enc->write_sample(&fmt, SrsMp4HandlerTypeSOUN, 0, SrsAudioAacFrameTraitRawData,
+            dts, dts, sample, 8)) != srs_success) {
+            return err;
+        }
+    }
+
+    return enc->flush();
+}
+
+VOID TEST(KernelMp4Test, SrsMp4FragmentEncoder)
+{
+    srs_error_t err;
+
+    // Without finalize, the init moov then a moof and mdat for each fragment.
+    if (true) {
+        MockSrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open("test.mp4"));
+
+        SrsMp4FragmentEncoder enc;
+        HELPER_ASSERT_SUCCESS(enc.initialize(&fw, 1 * SRS_UTIME_SECONDS, false));
+        HELPER_ASSERT_SUCCESS(mock_write_fragments(&enc));
+
+        vector<uint32_t> types;
+        SrsBuffer b(fw.data(), (int)fw.filesize());
+        while (b.left() >= 8) {
+            uint32_t size = (uint32_t)b.read_4bytes();
+            types.push_back((uint32_t)b.read_4bytes());
+            ASSERT_TRUE(size >= 8 && b.require(size - 8));
+            b.skip(size - 8);
+        }
+        EXPECT_EQ(0, b.left());
+
+        ASSERT_EQ(8, (int)types.size());
+        EXPECT_EQ(SrsMp4BoxTypeFTYP, types.at(0));
+        EXPECT_EQ(SrsMp4BoxTypeMOOV, types.at(1));
+        for (int i = 2; i < (int)types.size(); i += 2) {
+            EXPECT_EQ(SrsMp4BoxTypeMOOF, types.at(i));
+            EXPECT_EQ(SrsMp4BoxTypeMDAT, types.at(i + 1));
+        }
+    }
+
+    // Finalize to a regular moov, which is playable by the mp4 decoder.
+    if (true) {
+        MockSrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open("test.mp4"));
+
+        SrsMp4FragmentEncoder enc;
+        HELPER_ASSERT_SUCCESS(enc.initialize(&fw, 1 * SRS_UTIME_SECONDS, true));
+        HELPER_ASSERT_SUCCESS(mock_write_fragments(&enc));
+
+        MockSrsFileReader fr(fw.data(), (int)fw.filesize());
+        SrsMp4Decoder dec;
+        HELPER_ASSERT_SUCCESS(dec.initialize(&fr));
+
+        // @remark The decoder adjusts audio by the interleave of chunks, so only check the delta of audio.
+        int nn_videos = 0, nn_audios = 0, nn_keyframes = 0;
+        uint32_t audio_start = 0;
+        while (true) {
+            SrsMp4HandlerType ht; uint16_t ft, ct; uint32_t dts, pts, nb_sample; uint8_t* sample = NULL;
+            err = dec.read_sample(&ht, &ft, &ct, &dts, &pts, &sample, &nb_sample);
+            if (err != srs_success) {
+                srs_freep(err);
+                break;
+            }
+            SrsAutoFreeA(uint8_t, sample);
+
+            if (ht == SrsMp4HandlerTypeVIDE && ct == SrsVideoAvcFrameTraitNALU) {
+                EXPECT_EQ(16, (int)nb_sample);
+                EXPECT_EQ(nn_videos * 40, (int)dts);
+                EXPECT_EQ(dts + 40, pts);
+                EXPECT_EQ(nn_videos * 2, (int)sample[0]);
+                nn_keyframes += (ft == SrsVideoAvcFrameTypeKeyFrame) ? 1 : 0;
+                nn_videos++;
+            } else if (ht == SrsMp4HandlerTypeSOUN && ct == SrsAudioAacFrameTraitRawData) {
+                EXPECT_EQ(8, (int)nb_sample);
+                audio_start = nn_audios ? audio_start : dts;
+                EXPECT_EQ(audio_start + nn_audios * 20, dts);
+                EXPECT_EQ(nn_audios, (int)sample[0]);
+                nn_audios++;
+            }
+        }
+
+        EXPECT_EQ(75, nn_videos);
+        EXPECT_EQ(150, nn_audios);
+        EXPECT_EQ(3, nn_keyframes);
+    }
+}
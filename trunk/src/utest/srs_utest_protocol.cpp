@@ -378,6 +378,149 @@ VOID TEST(ProtocolHandshakeTest, DHKey)
     EXPECT_FALSE(srs_bytes_equals(pub_key1, pub_key2, 128));
 }
 
+VOID TEST(ProtocolHandshakeTest, DHPool)
+{
+    srs_error_t err;
+    
+    _srs_internal::SrsDHPool pool(2, 3);
+    
+    // The keys are used in turn.
+    _srs_internal::SrsDH* dh0 = NULL;
+    _srs_internal::SrsDH* dh1 = NULL;
+    HELPER_ASSERT_SUCCESS(pool.fetch(&dh0));
+    HELPER_ASSERT_SUCCESS(pool.fetch(&dh1));
+    EXPECT_TRUE(dh0 != dh1);
+    EXPECT_EQ(2, pool.generated());
+    
+    char pub_key[128];
+    int pkey_size = 128;
+    HELPER_EXPECT_SUCCESS(dh0->copy_public_key(pub_key, pkey_size));
+    EXPECT_EQ(128, pkey_size);
+    
+    // Reuse the keys.
+    for (int i = 0; i < 4; i++) {
+        _srs_internal::SrsDH* dh = NULL;
+        HELPER_ASSERT_SUCCESS(pool.fetch(&dh));
+        EXPECT_TRUE(dh == (i % 2? dh1 : dh0));
+    }
+    EXPECT_EQ(2, pool.generated());
+    
+    // Regenerate the key when reused too many times.
+    _srs_internal::SrsDH* dh = NULL;
+    HELPER_ASSERT_SUCCESS(pool.fetch(&dh));
+    EXPECT_EQ(3, pool.generated());
+    
+    char pub_key2[128];
+    HELPER_EXPECT_SUCCESS(dh->copy_public_key(pub_key2, pkey_size));
+    EXPECT_EQ(128, pkey_size);
+    EXPECT_FALSE(srs_bytes_equals(pub_key, pub_key2, 128));
+}
+
+VOID TEST(ProtocolHandshakeTest, HmacSha256Cache)
+{
+    srs_error_t err;
+    
+    char data[1504];
+    srs_random_generate(data, sizeof(data));
+    
+    char temp_key[32];
+    srs_random_generate(temp_key, sizeof(temp_key));
+    
+    _srs_internal::SrsHmacSha256Cache cache;
+    
+    // The digest of reused context equals to the new one.
+    for (int i = 0; i < 2; i++) {
+        const void* keys[] = {_srs_internal::SrsGenuineFPKey, _srs_internal::SrsGenuineFMSKey, _srs_internal::SrsGenuineFPKey, temp_key};
+        int sizes[] = {30, 36, 62, 32};
+        
+        for (int j = 0; j < 4; j++) {
+            HMAC_CTX* ctx = NULL;
+            HELPER_ASSERT_SUCCESS(cache.fetch(keys[j], sizes[j], &ctx));
+            
+            char digest[32];
+            unsigned int digest_size = 0;
+            HELPER_ASSERT_SUCCESS(_srs_internal::do_openssl_HMACsha256(ctx, data, sizeof(data), digest, &digest_size));
+            EXPECT_EQ(32, (int)digest_size);
+            
+            unsigned char expect[32];
+            HMAC(EVP_sha256(), keys[j], sizes[j], (unsigned char*)data, sizeof(data), expect, &digest_size);
+            EXPECT_TRUE(srs_bytes_equals(digest, (char*)expect, 32));
+        }
+    }
+}
+
+// The crypto cost of server complex handshake, that is a DH key and shared key,
+// and 3 HMAC-sha256 of the 1504bytes c1/s1/s2 data.
+// @remark It's a benchmark, disabled in utest, run by:
+//      ./objs/srs_utest --gtest_also_run_disabled_tests --gtest_filter=*BenchHandshakeCrypto
+VOID TEST(ProtocolHandshakeTest, DISABLED_BenchHandshakeCrypto)
+{
+    srs_error_t err;
+    
+    const int nn_handshakes = 64;
+    
+    _srs_internal::SrsDH peer;
+    HELPER_ASSERT_SUCCESS(peer.initialize(true));
+    
+    char peer_key[128];
+    int peer_key_size = 128;
+    HELPER_ASSERT_SUCCESS(peer.copy_public_key(peer_key, peer_key_size));
+    
+    char data[1504];
+    srs_random_generate(data, sizeof(data));
+    
+    char shared_key[128];
+    char digest[SRS_OpensslHashSize];
+    
+    // Generate the DH key and HMAC context for each handshake.
+    srs_utime_t starttime = srs_update_system_time();
+    for (int i = 0; i < nn_handshakes; i++) {
+        _srs_internal::SrsDH dh;
+        HELPER_ASSERT_SUCCESS(dh.initialize(true));
+        
+        int size = 128;
+        HELPER_ASSERT_SUCCESS(dh.copy_shared_key(peer_key, peer_key_size, shared_key, size));
+        
+        for (int j = 0; j < 3; j++) {
+            unsigned int digest_size = 0;
+            HMAC(EVP_sha256(), _srs_internal::SrsGenuineFMSKey, 36, (unsigned char*)data, sizeof(data), (unsigned char*)digest, &digest_size);
+        }
+    }
+    srs_utime_t fresh = srs_update_system_time() - starttime;
+    
+    // Use the DH key in pool and the cached HMAC context.
+    _srs_internal::SrsDHPool pool(SRS_PERF_HANDSHAKE_DH_KEYS, SRS_PERF_HANDSHAKE_DH_REUSE);
+    _srs_internal::SrsHmacSha256Cache cache;
+    
+    // Generate all keys in pool, which is amortized by the reused handshakes.
+    for (int i = 0; i < SRS_PERF_HANDSHAKE_DH_KEYS; i++) {
+        _srs_internal::SrsDH* dh = NULL;
+        HELPER_ASSERT_SUCCESS(pool.fetch(&dh));
+    }
+    
+    starttime = srs_update_system_time();
+    for (int i = 0; i < nn_handshakes; i++) {
+        _srs_internal::SrsDH* dh = NULL;
+        HELPER_ASSERT_SUCCESS(pool.fetch(&dh));
+        
+        int size = 128;
+        HELPER_ASSERT_SUCCESS(dh->copy_shared_key(peer_key, peer_key_size, shared_key, size));
+        
+        for (int j = 0; j < 3; j++) {
+            HMAC_CTX* ctx = NULL;
+            HELPER_ASSERT_SUCCESS(cache.fetch(_srs_internal::SrsGenuineFMSKey, 36, &ctx));
+            
+            unsigned int digest_size = 0;
+            HELPER_ASSERT_SUCCESS(_srs_internal::do_openssl_HMACsha256(ctx, data, sizeof(data), digest, &digest_size));
+        }
+    }
+    srs_utime_t pooled = srs_update_system_time() - starttime;
+    
+    printf("handshake crypto of %d handshakes, fresh=%dus, pooled=%dus, dh generated=%d\n",
+        nn_handshakes, (int)fresh, (int)pooled, (int)pool.generated());
+    EXPECT_TRUE(pool.generated() <= SRS_PERF_HANDSHAKE_DH_KEYS);
+}
+
 // flash will sendout a c0c1 encrypt by ssl.
 VOID TEST(ProtocolHandshakeTest, VerifyFPC0C1)
 {
@@ -5488,6 +5631,121 @@ VOID TEST(ProtocolStackTest, ProtocolExcpectMessage)
     ASSERT_TRUE(NULL != pkt);
 }
 
+VOID TEST(ProtocolStackTest, ProtocolZeroCopyRecv)
+{
+    srs_error_t err;
+    
+    MockBufferIO bio;
+    SrsProtocol proto(&bio);
+    proto.set_zero_copy_read(true);
+    
+    // Two audio messages in one chunk, and a video message in two chunks of 128 bytes.
+    uint8_t audio[] = {
+        0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x08, 0x01, 0x00, 0x00, 0x00,
+        0xaf, 0x01, 0x21, 0x10,
+        0x44, 0x00, 0x00, 0x17, 0x00, 0x00, 0x04, 0x08,
+        0xaf, 0x01, 0x21, 0x11,
+    };
+    bio.in_buffer.append((char*)audio, sizeof(audio));
+    
+    char video[12 + 200 + 1];
+    memset(video, 0x27, sizeof(video));
+    uint8_t vh[] = {0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc8, 0x09, 0x01, 0x00, 0x00, 0x00};
+    memcpy(video, vh, sizeof(vh));
+    video[12 + 128] = (char)0xc6;
+    bio.in_buffer.append(video, sizeof(video));
+    
+    // The payload references the receive buffer.
+    SrsCommonMessage* msg = NULL;
+    HELPER_ASSERT_SUCCESS(proto.recv_message(&msg));
+    SrsAutoFree(SrsCommonMessage, msg);
+    ASSERT_EQ(4, msg->size);
+    EXPECT_EQ(0x10, (uint8_t)msg->payload[3]);
+    
+    SrsSharedPtrMessage* shared = new SrsSharedPtrMessage();
+    SrsAutoFree(SrsSharedPtrMessage, shared);
+    HELPER_ASSERT_SUCCESS(shared->create(msg));
+    
+    SrsCommonMessage* msg2 = NULL;
+    HELPER_ASSERT_SUCCESS(proto.recv_message(&msg2));
+    SrsAutoFree(SrsCommonMessage, msg2);
+    ASSERT_EQ(4, msg2->size);
+    EXPECT_EQ(23, msg2->header.timestamp);
+    EXPECT_EQ(shared->payload + 4 + 8, msg2->payload);
+    EXPECT_EQ(0x11, (uint8_t)msg2->payload[3]);
+    
+    // The message in multiple chunks is copied.
+    SrsCommonMessage* msg3 = NULL;
+    HELPER_ASSERT_SUCCESS(proto.recv_message(&msg3));
+    SrsAutoFree(SrsCommonMessage, msg3);
+    ASSERT_EQ(200, msg3->size);
+    EXPECT_EQ(0x27, (uint8_t)msg3->payload[199]);
+    
+    // The shared message is still ok.
+    EXPECT_EQ(0x10, (uint8_t)shared->payload[3]);
+    SrsSharedPtrMessage* copy = shared->copy();
+    SrsAutoFree(SrsSharedPtrMessage, copy);
+    EXPECT_EQ(shared->payload, copy->payload);
+}
+
+VOID TEST(ProtocolStackTest, ProtocolMessageBoundary)
+{
+    srs_error_t err;
+    
+    MockBufferIO bio;
+    SrsProtocol proto(&bio);
+    EXPECT_TRUE(proto.is_message_boundary());
+    
+    // The closeStream packet over stream 1.
+    if (true) {
+        HELPER_ASSERT_SUCCESS(proto.send_and_free_packet(new SrsCloseStreamPacket(), 1));
+        bio.in_buffer.append(bio.out_buffer.bytes(), bio.out_buffer.length());
+        bio.out_buffer.erase(bio.out_buffer.length());
+        
+        SrsCommonMessage* msg = NULL;
+        HELPER_ASSERT_SUCCESS(proto.recv_message(&msg));
+        SrsAutoFree(SrsCommonMessage, msg);
+        EXPECT_EQ(1, msg->header.stream_id);
+        
+        SrsPacket* pkt = NULL;
+        HELPER_ASSERT_SUCCESS(proto.decode_message(msg, &pkt));
+        SrsAutoFree(SrsPacket, pkt);
+        EXPECT_TRUE(dynamic_cast<SrsCloseStreamPacket*>(pkt) != NULL);
+        EXPECT_TRUE(proto.is_message_boundary());
+    }
+    
+    // A video message in two chunks of 128 bytes, which is partially received.
+    char video[12 + 200 + 1];
+    memset(video, 0x27, sizeof(video));
+    uint8_t vh[] = {0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc8, 0x09, 0x01, 0x00, 0x00, 0x00};
+    memcpy(video, vh, sizeof(vh));
+    video[12 + 128] = (char)0xc6;
+    
+    bio.in_buffer.append(video, 12 + 128);
+    if (true) {
+        SrsCommonMessage* msg = NULL;
+        HELPER_EXPECT_FAILED(proto.recv_message(&msg));
+        EXPECT_FALSE(proto.is_message_boundary());
+    }
+    
+    bio.in_buffer.append(video + 12 + 128, 1 + 200 - 128);
+    if (true) {
+        SrsCommonMessage* msg = NULL;
+        HELPER_ASSERT_SUCCESS(proto.recv_message(&msg));
+        SrsAutoFree(SrsCommonMessage, msg);
+        EXPECT_EQ(200, msg->size);
+        EXPECT_TRUE(proto.is_message_boundary());
+    }
+    
+    // The chunk header is partially received.
+    bio.in_buffer.append(video, 5);
+    if (true) {
+        SrsCommonMessage* msg = NULL;
+        HELPER_EXPECT_FAILED(proto.recv_message(&msg));
+        EXPECT_FALSE(proto.is_message_boundary());
+    }
+}
+
 VOID TEST(ProtocolRTMPTest, RTMPRequest)
 {
     SrsRequest req;
@@ -408,6 +408,55 @@ VOID TEST(ProtocolRTMPTest, HugeMessages)
     }
 }
 
+#ifdef SRS_PERF_SHARED_CHUNKS
+VOID TEST(ProtocolRTMPTest, SharedChunks)
+{
+    srs_error_t err;
+
+    SrsCommonMessage pkt;
+    pkt.header.initialize_video(300, 0, 1);
+    pkt.create_payload(300);
+    pkt.size = 300;
+    
+    char payload[300];
+    for (int i = 0; i < 300; i++) {
+        payload[i] = pkt.payload[i] = (char)i;
+    }
+
+    SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+    HELPER_ASSERT_SUCCESS(msg->create(&pkt));
+    SrsAutoFree(SrsSharedPtrMessage, msg);
+
+    // The players corrected the timestamp by jitter, and the last one is extended timestamp.
+    int64_t timestamps[] = {1000, 2000, 0x1000000};
+    for (int i = 0; i < 3; i++) {
+        MockBufferIO io;
+        SrsProtocol p(&io);
+
+        SrsSharedPtrMessage* cp = msg->copy();
+        cp->timestamp = timestamps[i];
+        HELPER_EXPECT_SUCCESS(p.send_and_free_message(cp, 1));
+
+        // All players use the chunks built by the first one.
+        EXPECT_EQ(6, msg->ptr->nb_chunks);
+        EXPECT_EQ(128, msg->ptr->chunk_size);
+
+        MockBufferIO rio;
+        rio.append((uint8_t*)io.out_buffer.bytes(), io.out_buffer.length());
+        SrsProtocol r(&rio);
+
+        SrsCommonMessage* rmsg = NULL;
+        HELPER_ASSERT_SUCCESS(r.recv_message(&rmsg));
+        SrsAutoFree(SrsCommonMessage, rmsg);
+
+        EXPECT_EQ(timestamps[i], rmsg->header.timestamp);
+        EXPECT_EQ(1, rmsg->header.stream_id);
+        EXPECT_EQ(300, rmsg->size);
+        EXPECT_EQ(0, memcmp(rmsg->payload, payload, 300));
+    }
+}
+#endif
+
 VOID TEST(ProtocolRTMPTest, DecodeMessages)
 {
     srs_error_t err;